@@ -0,0 +1,365 @@
+/*
+ * ======================================================================================================================
+ *  AR.h - Compressed Observation Archive
+ *
+ *  The JSON log repeats every field name on every line, a year of 1 minute observations with 30 sensors is several
+ *  hundred MB. With sd_archive set in CONFIG.TXT observations are also, or instead, kept in /OBS/YYYYMMDD.arc as
+ *  blocks of observations that share the same sensors. Values are held in RAM until the block is full, spans
+ *  AR_SECONDS, the sensors change, the day changes or the station reboots, then encoded a column at a time and
+ *  appended. A power loss loses the block being gathered, at most AR_SECONDS of observations whatever the interval.
+ *  Tools/ArchiveDecode.js turns an archive back in to the JSON lines that OBS_LOG_Add() writes to the .log file.
+ *
+ *  RAM
+ *    AR_Initialize() allocates the block once at boot, and only when sd_archive is set. It holds AR_SECONDS of rows
+ *    at the observation interval, at most AR_ROWS_MAX, and AR_COLS sensor values a row, at most AR_VALUES. That is
+ *    4.8 KB at 1 minute, 1.9 KB at 5 minutes and 0.8 KB at 15 minutes. A station with more than AR_COLS sensors
+ *    gets shorter blocks.
+ *
+ *  Block - multi byte header fields are big endian
+ *
+ *  Byte   Size  Field
+ *  0      2     Magic 'F' 'A'
+ *  2      1     Archive version (AR_VERSION)
+ *  3      1     Schema version (PL_SCHEMA_VERSION), sensor ids are OBS_ID, see PL.h
+ *  4      1     Observation count (rows)
+ *  5      1     Sensor count (columns)
+ *  6      4     Time of first observation - seconds since 1970
+ *  10     C     Sensor id of each column, in the order the observation holds them
+ *  10+C   N     Bit stream, high bit first, padded to a byte. Type of each column (F_OBS, I_OBS, U_OBS) in 2 bits,
+ *               then the Time, Battery and hth columns, then each sensor's column.
+ *  ...    2     Checksum, 16 bit sum of all the bytes before it in the block
+ *
+ *  Columns
+ *    Time       For each observation after the first, delta of delta of the time in seconds, signed
+ *    Battery    First value then delta, signed. Value is (int)bv * 100 + (int)(bv*100) % 100, the digits logged
+ *    hth        First value then XOR with the previous observation, unsigned
+ *    F_OBS      XOR of the float's bits with the previous observation's, previous is 0 for the first. Values are
+ *               first rounded to the 0.1 the log shows, so readings that look the same give an XOR of 0.
+ *                 0                    Same as previous
+ *                 10 + bits            XOR fits inside the previous XOR's leading and trailing zeros
+ *                 11 + 5 bits leading zeros + 5 bits (length-1) + length bits
+ *    I_OBS      First value then delta, signed
+ *    U_OBS      First value then delta, signed, modulo 2^32
+ *
+ *  Signed values are zigzag encoded to unsigned. Unsigned value v is stored as 0 for 0, else 1 + 5 bits (width-1)
+ *  + the width-1 bits of v below its top set bit, width being the number of bits in v.
+ * ======================================================================================================================
+ */
+#define AR_VERSION          1
+#define AR_SECONDS          3600            // Longest span of a block, what a power loss can lose
+#define AR_ROWS_MAX         60              // Most rows a block holds, AR_SECONDS at 1 minute
+#define AR_COLS             32              // Sensor values a row the block is sized for
+#define AR_VALUES           960             // Most sensor values held, 30 sensors for 32 observations
+#define AR_OUT_SIZE         128             // Bytes encoded before they are handed to the SD layer
+
+// The block, allocated by AR_Initialize(), NULL when the archive is off
+uint32_t *ar_ts = NULL;                     // Observation time
+int32_t  *ar_bv = NULL;                     // Battery voltage as logged, see Columns
+uint32_t *ar_hth = NULL;                    // System Status Bits
+uint32_t *ar_value = NULL;                  // Sensor values by row, raw bits of the SENSOR union
+uint8_t  *ar_id = NULL;                     // OBS_ID of each column
+uint8_t  *ar_type = NULL;                   // OBS_TYPE of each column
+int      ar_rows_max = 0;                   // Rows the block holds
+int      ar_values_max = 0;                 // Sensor values the block holds
+int      ar_rows = 0;                       // Observations in the block
+int      ar_cols = 0;                       // Sensors in each observation
+long     ar_day = 0;                        // Day of the block, yyyymmdd
+
+// Bit stream being written
+uint8_t  *ar_out = NULL;
+int      ar_out_len;                        // Whole bytes in ar_out
+uint32_t ar_bits;                           // Bits not yet a whole byte, low ar_nbits bits
+int      ar_nbits;
+uint16_t ar_sum;                            // Checksum of bytes handed on
+bool     ar_ok;                             // No SD write error in this block
+
+bool SD_ArchiveWrite(long day, uint8_t *buf, int len, bool last);  // Prototype this function to aviod compile function unknown issue.
+
+/*
+ * ======================================================================================================================
+ * AR_Initialize() - Allocate the block for the observation interval when sd_archive is set. Call once after the
+ *                   config file is read. If there is not the RAM the archive is turned off and the log kept.
+ * ======================================================================================================================
+ */
+void AR_Initialize() {
+  uint8_t *mem;
+
+  if (!cf_sd_archive || ar_ts) {
+    return;
+  }
+
+  ar_rows_max = AR_SECONDS / CF_ObsInterval();
+  if (ar_rows_max > AR_ROWS_MAX) {
+    ar_rows_max = AR_ROWS_MAX;
+  }
+  ar_values_max = ar_rows_max * AR_COLS;
+  if (ar_values_max > AR_VALUES) {
+    ar_values_max = AR_VALUES;
+  }
+
+  mem = (uint8_t *) malloc (((3 * ar_rows_max) + ar_values_max) * sizeof(uint32_t) + (2 * MAX_SENSORS) + AR_OUT_SIZE);
+  if (mem == NULL) {
+    Output ("AR:NO MEM");
+    cf_sd_archive = 0;
+    return;
+  }
+  ar_ts = (uint32_t *) mem;
+  ar_bv = (int32_t *) (ar_ts + ar_rows_max);
+  ar_hth = (uint32_t *) (ar_bv + ar_rows_max);
+  ar_value = ar_hth + ar_rows_max;
+  ar_id = (uint8_t *) (ar_value + ar_values_max);
+  ar_type = ar_id + MAX_SENSORS;
+  ar_out = ar_type + MAX_SENSORS;
+  ar_rows = 0;
+
+  sprintf (Buffer32Bytes, "AR:%d Rows %d Values", ar_rows_max, ar_values_max);
+  Output (Buffer32Bytes);
+}
+
+/*
+ * ======================================================================================================================
+ * AR_Out() - Hand the encoded bytes to the SD layer, last closes the block's write
+ * ======================================================================================================================
+ */
+void AR_Out(bool last) {
+  for (int i=0; i<ar_out_len; i++) {
+    ar_sum += ar_out[i];
+  }
+  if (ar_ok && (ar_out_len || last)) {
+    ar_ok = SD_ArchiveWrite(ar_day, ar_out, ar_out_len, last);
+  }
+  ar_out_len = 0;
+}
+
+/*
+ * ======================================================================================================================
+ * AR_PutByte() - Append a byte, the bit stream must be on a byte boundary
+ * ======================================================================================================================
+ */
+void AR_PutByte(uint8_t b) {
+  if (ar_out_len == AR_OUT_SIZE) {
+    AR_Out(false);
+  }
+  ar_out[ar_out_len++] = b;
+}
+
+/*
+ * ======================================================================================================================
+ * AR_PutBits() - Append the low n bits of v, high bit first. n is 0 to 32
+ * ======================================================================================================================
+ */
+void AR_PutBits(uint32_t v, int n) {
+  while (n > 0) {
+    int k = (n > 8) ? 8 : n;
+
+    n -= k;
+    ar_bits = (ar_bits << k) | ((v >> n) & ((1UL << k) - 1));
+    ar_nbits += k;
+    if (ar_nbits >= 8) {
+      ar_nbits -= 8;
+      AR_PutByte((ar_bits >> ar_nbits) & 0xFF);
+    }
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * AR_PutUInt() - Append unsigned value, 0 as one bit, otherwise its width and the bits below the top one
+ * ======================================================================================================================
+ */
+void AR_PutUInt(uint32_t v) {
+  if (v == 0) {
+    AR_PutBits(0, 1);
+    return;
+  }
+  int width = 32 - __builtin_clz(v);
+  AR_PutBits(1, 1);
+  AR_PutBits(width - 1, 5);
+  AR_PutBits(v, width - 1);
+}
+
+/*
+ * ======================================================================================================================
+ * AR_PutInt() - Append signed value zigzag encoded, small negatives stay small
+ * ======================================================================================================================
+ */
+void AR_PutInt(int32_t v) {
+  AR_PutUInt(((uint32_t) v << 1) ^ (uint32_t) (v >> 31));
+}
+
+/*
+ * ======================================================================================================================
+ * AR_PutColumn() - Append column c of every row
+ * ======================================================================================================================
+ */
+void AR_PutColumn(int c) {
+  uint32_t prev = 0;
+  int lead = 32, trail = 0;   // No previous window
+
+  for (int r=0; r<ar_rows; r++) {
+    uint32_t v = ar_value[r * ar_cols + c];
+
+    if (ar_type[c] == F_OBS) {
+      uint32_t x = v ^ prev;
+      if (x == 0) {
+        AR_PutBits(0, 1);
+      }
+      else {
+        int l = __builtin_clz(x);
+        int t = __builtin_ctz(x);
+        if ((l >= lead) && (t >= trail)) {
+          AR_PutBits(2, 2);
+          AR_PutBits(x >> trail, 32 - lead - trail);
+        }
+        else {
+          AR_PutBits(3, 2);
+          AR_PutBits(l, 5);
+          AR_PutBits(31 - l - t, 5);
+          AR_PutBits(x >> t, 32 - l - t);
+          lead = l;
+          trail = t;
+        }
+      }
+    }
+    else {
+      AR_PutInt((int32_t)(v - prev));
+    }
+    prev = v;
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * AR_Flush() - Encode the block and append it to the day's archive. Call before a reboot.
+ * ======================================================================================================================
+ */
+void AR_Flush() {
+  if (!ar_ts || (ar_rows == 0)) {
+    return;
+  }
+
+  ar_out_len = 0;
+  ar_bits = 0;
+  ar_nbits = 0;
+  ar_sum = 0;
+  ar_ok = true;
+
+  AR_PutByte('F');
+  AR_PutByte('A');
+  AR_PutByte(AR_VERSION);
+  AR_PutByte(PL_SCHEMA_VERSION);
+  AR_PutByte(ar_rows);
+  AR_PutByte(ar_cols);
+  AR_PutBits(ar_ts[0], 32);
+  for (int c=0; c<ar_cols; c++) {
+    AR_PutByte(ar_id[c]);
+  }
+  for (int c=0; c<ar_cols; c++) {
+    AR_PutBits(ar_type[c], 2);
+  }
+
+  for (int r=1; r<ar_rows; r++) {
+    int32_t delta = ar_ts[r] - ar_ts[r-1];
+    int32_t prev = (r > 1) ? (int32_t)(ar_ts[r-1] - ar_ts[r-2]) : 0;
+    AR_PutInt(delta - prev);
+  }
+  AR_PutInt(ar_bv[0]);
+  for (int r=1; r<ar_rows; r++) {
+    AR_PutInt(ar_bv[r] - ar_bv[r-1]);
+  }
+  AR_PutUInt(ar_hth[0]);
+  for (int r=1; r<ar_rows; r++) {
+    AR_PutUInt(ar_hth[r] ^ ar_hth[r-1]);
+  }
+  for (int c=0; c<ar_cols; c++) {
+    AR_PutColumn(c);
+  }
+
+  if (ar_nbits) {
+    AR_PutBits(0, 8 - ar_nbits);  // Pad to a byte
+  }
+  AR_Out(false);
+  AR_PutByte(ar_sum >> 8);
+  AR_PutByte(ar_sum & 0xFF);
+  AR_Out(true);
+
+  if (ar_ok) {
+    SystemStatusBits &= ~SSB_SD;  // Turn Off Bit
+    sprintf (Buffer32Bytes, "AR:%d OBS Added", ar_rows);
+    Output (Buffer32Bytes);
+  }
+  else {
+    SystemStatusBits |= SSB_SD;   // Turn On Bit - Note this will be reported on next observation
+    Output ("AR:Write ERR");
+  }
+  ar_rows = 0;
+}
+
+/*
+ * ======================================================================================================================
+ * AR_Add() - Add obs to the block, writing the block out first if obs does not belong in it
+ * ======================================================================================================================
+ */
+void AR_Add() {
+  uint8_t id[MAX_SENSORS];
+  uint8_t type[MAX_SENSORS];
+  int cols = 0;
+  tm *dt;
+  long day;
+
+  if (!ar_ts || !obs.inuse || !SD_exists || !RTC_valid) {
+    return;
+  }
+
+  for (int s=0; s<MAX_SENSORS; s++) {
+    if (OBS_Present(s)) {
+      id[cols] = obs.sensor[s].id;
+      type[cols] = obs.sensor[s].type;
+      cols++;
+    }
+  }
+  dt = gmtime(&obs.ts);
+  day = (dt->tm_year + 1900) * 10000L + (dt->tm_mon + 1) * 100L + dt->tm_mday;
+
+  if (ar_rows && ((day != ar_day) || (cols != ar_cols) || (ar_rows == ar_rows_max) ||
+      ((uint32_t) obs.ts - ar_ts[0] >= AR_SECONDS) || ((ar_rows + 1) * cols > ar_values_max) ||
+      memcmp(id, ar_id, cols) || memcmp(type, ar_type, cols))) {
+    AR_Flush();
+  }
+  if (cols > ar_values_max) {
+    Output ("AR:OVF");
+    return;
+  }
+
+  if (ar_rows == 0) {
+    ar_day = day;
+    ar_cols = cols;
+    memcpy (ar_id, id, cols);
+    memcpy (ar_type, type, cols);
+  }
+
+  ar_ts[ar_rows] = (uint32_t) obs.ts;
+  ar_bv[ar_rows] = (int)obs.bv * 100 + (int)(obs.bv*100) % 100;
+  ar_hth[ar_rows] = obs.hth;
+
+  uint32_t *v = ar_value + (ar_rows * cols);
+  for (int s=0, c=0; s<MAX_SENSORS; s++) {
+    if (OBS_Present(s)) {
+      if (obs.sensor[s].type == F_OBS) {
+        // Round to what the log shows, keep the value if that would change how it is shown
+        float f = obs.sensor[s].f_obs;
+        double d = rint((double) f * 10.0);
+        float q = (float)(d / 10.0);
+        if (!isnan(f) && (fabs(d) < 1e15) && (rint((double) q * 10.0) == d) && (signbit(q) == signbit(f))) {
+          f = q;
+        }
+        memcpy (&v[c], &f, sizeof(f));
+      }
+      else {
+        v[c] = obs.sensor[s].u_obs;
+      }
+      c++;
+    }
+  }
+  ar_rows++;
+}
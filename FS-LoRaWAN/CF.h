@@ -33,6 +33,19 @@
  lw_nwkskey=0123456789ABCDEF01234567890ABCDE
  lw_appskey=0123456789ABCDEF01234567890ABCDE
 
+ # LoRaWAN observation payload format
+ # Options 0 = URL text, 1 = Binary (See PL.h)
+ lw_binary=0
+
+ # Order Need to Send (N2S) observations are sent after an outage
+ # Options 0 = Oldest first, 1 = Newest first,
+ #         2 = Newest first then oldest first
+ n2s_policy=0
+
+ # Pack several N2S observations in to one binary frame
+ # Options 0 = One observation per frame, 1 = Batch (See PL.h)
+ n2s_batch=0
+
  # 1 minute observation period is the default
 
  # 5 minute observation periods. Overrides 15m & 1m options
@@ -51,14 +64,55 @@
  # Options 0,1
  rg2_enable=0
 
+ # Report peak 1 minute rain rate, rain intensity and the
+ # first and last tip times of each observation interval
+ # Options 0,1
+ rg_ext=0
+
  # Distance Sensor for Snow, Surge, Stream on pin A5
  # Options 0 = No sensor, 5 = 5M sendor, 10 = 10m sensor
  ds_enable=0
 
+ # Distance sensor samples per second, outliers are dropped and
+ # the rest averaged in to the 1 second reading. Above 1 also
+ # reports the spread and quality of the readings (See WRDB.h)
+ # Options 1 to 10
+ ds_samples=1
+
  # Number of hours between daily reboots
  # A value of 0 disables this feature
  daily_reboot=22
 
+ # Samples (seconds) averaged for wind gust, 3 = WMO gust
+ # Options 1 to 60
+ ws_gust=3
+
+ # Report 2 and 10 minute wind averages, the average over the
+ # observation interval and the interval's peak gust
+ # Options 0,1
+ ws_ext=0
+
+ # Wind direction reads per second, averaged as vectors in to
+ # the 1 second sample to smooth vane flutter
+ # Options 1 to 10
+ wd_samples=1
+
+ # Seconds between syncs of the SD observation log (See SDC.h)
+ # 0 syncs every observation, nothing logged is lost if power
+ # fails. Longer writes the card less, lines are held in RAM
+ # between syncs and up to sd_sync seconds of them are lost
+ # if power fails.
+ # Options 0 = Every observation (default), up to 3600
+ sd_sync=0
+
+ # Observation storage on the SD card
+ # Options 0 = JSON log, 1 = Compressed archive, 2 = Both (See AR.h)
+ sd_archive=0
+
+ # Sleep between tasks (See PWR.h)
+ # Options 0 = Never (default), 1 = Idle, 2 = Standby
+ pwr_mode=0
+
  * ======================================================================================================================
  */
 
@@ -78,10 +132,30 @@ char *cf_lw_appkey;
 char *cf_lw_devaddr;
 char *cf_lw_nwkskey;
 char *cf_lw_appskey;
+int cf_lw_binary=0;
+int cf_n2s_policy=0;
+int cf_n2s_batch=0;
 
 int cf_rg1_enable=0;
 int cf_rg2_enable=0;
+int cf_rg_ext=0;
 int cf_5m_enable=0;
 int cf_15m_enable=0;
 int cf_ds_enable=0;
+int cf_ds_samples=1;
 int cf_daily_reboot=0;
+int cf_pwr_mode=0;
+int cf_ws_gust=3;
+int cf_ws_ext=0;
+int cf_wd_samples=1;
+int cf_sd_sync=0;
+int cf_sd_archive=0;
+
+/*
+ * ======================================================================================================================
+ * CF_ObsInterval() - Seconds between observations as Task_Observation() schedules them
+ * ======================================================================================================================
+ */
+int CF_ObsInterval() {
+  return ((cf_5m_enable) ? 300 : ((cf_15m_enable) ? 900 : 60));
+}
@@ -15,7 +15,10 @@ typedef struct {
     float    rgt2;       // rain gauge 2 total today
     float    rgp2;       // rain gauge 2 total prior
     uint32_t rgts;       // rain gauge timestamp of last modification
-    unsigned long n2sfp; // sd need 2 send file position
+    unsigned long n2s_head; // sd need 2 send ring, sequence number of next record to write
+    unsigned long n2s_tail; // sd need 2 send ring, sequence number of oldest record not sent
+    uint32_t log_day;    // sd observation log day, yyyymmdd, that is open or not yet trimmed, 0 none
+    uint32_t log_end;    // sd observation log end of data at last sync
     unsigned long checksum;
 } EEPROM_NVM;
 EEPROM_NVM eeprom;
@@ -24,6 +27,7 @@ uint8_t *eeprom_ptr;
 int  eeprom_address = 0x00;
 bool eeprom_valid = false;
 bool eeprom_exists = false;
+bool eeprom_n2s_recover = false;  // Set when n2s pointers were lost, SD_N2S_Initialize() rebuilds them from the ring file
 
 Adafruit_EEPROM_I2C eeprom_i2c;
 
@@ -42,7 +46,10 @@ unsigned long EEPROM_ChecksumCompute() {
   checksum += (unsigned long) eeprom.rgt2;
   checksum += (unsigned long) eeprom.rgp2;
   checksum += (unsigned long) eeprom.rgts;
-  checksum += (unsigned long) eeprom.n2sfp;
+  checksum += (unsigned long) eeprom.n2s_head;
+  checksum += (unsigned long) eeprom.n2s_tail;
+  checksum += (unsigned long) eeprom.log_day;
+  checksum += (unsigned long) eeprom.log_end;
   return (checksum);
 }
 
@@ -83,7 +90,6 @@ void EEPROM_ClearRainTotals(uint32_t current_time) {
   eeprom.rgt2 = 0.0;
   eeprom.rgp2 = 0.0;
   eeprom.rgts = current_time;
-  eeprom.n2sfp = 0;
   EEPROM_ChecksumUpdate();
   eeprom_i2c.write(eeprom_address, eeprom_ptr, sizeof(eeprom));
 }
@@ -100,6 +106,11 @@ void EEPROM_Validate() {
   eeprom_i2c.read(eeprom_address, eeprom_ptr, sizeof(eeprom));
 
   if (!EEPROM_ChecksumValid() || SerialConsoleEnabled) {
+    eeprom.n2s_head = 0;
+    eeprom.n2s_tail = 0;
+    eeprom.log_day = 0;
+    eeprom.log_end = 0;
+    eeprom_n2s_recover = true;
     EEPROM_ClearRainTotals(current_time);
     if (SerialConsoleEnabled) {
       Output("EEPROM CLEARED:SCE"); // Serial Console Enabled
@@ -266,7 +277,16 @@ void EEPROM_Dump() {
   sprintf (Buffer32Bytes, " RGTS:%lu", eeprom.rgts);
   Output (Buffer32Bytes);
 
-  sprintf (Buffer32Bytes, " N2SFP:%lu", eeprom.n2sfp);
+  sprintf (Buffer32Bytes, " N2SH:%lu", eeprom.n2s_head);
+  Output (Buffer32Bytes);
+
+  sprintf (Buffer32Bytes, " N2ST:%lu", eeprom.n2s_tail);
+  Output (Buffer32Bytes);
+
+  sprintf (Buffer32Bytes, " LOGD:%lu", (unsigned long) eeprom.log_day);
+  Output (Buffer32Bytes);
+
+  sprintf (Buffer32Bytes, " LOGE:%lu", (unsigned long) eeprom.log_end);
   Output (Buffer32Bytes);
 
   sprintf (Buffer32Bytes, " CS:%lu", eeprom.checksum);
@@ -135,6 +135,7 @@
 #define REBOOT_PIN        A0  // Connect to WatchDog Trigger
 #define HEARTBEAT_PIN     A1  // Connect to WatchDog Heartbeat
 #define SCE_PIN           12  // Serial Console Enable Pin
+#define CALIBRATION_TIME  3600000UL  // ms after boot the jumpered station stays in calibration display mode
 #define LED_PIN           LED_BUILTIN
 
 /*
@@ -175,7 +176,7 @@
  */
 unsigned long  SystemStatusBits = SSB_PWRON;  // Set bit 1 to 1 for initial value power on. Is set to 0 after first obs
 bool JustPoweredOn = true;                    // Used to clear SystemStatusBits set during power on device discovery
-bool TurnLedOff = false;                      // Set true in rain gauge interrupt
+bool TurnLedOff = false;                      // Set true by Rain_TakeReading()
 
 
 int DSM_countdown = 1800; // Exit Display Station Monitor screen when reaches 0 - protects against burnt out pin or forgotten jumper
@@ -189,7 +190,19 @@ char Buffer32Bytes[32];         // General storage
 char obsbuf[MAX_OBS_SIZE];      // Url that holds observations for HTTP GET
 char *obsp;                     // Pointer to obsbuf
 
-int DailyRebootCountDownTimer;
+#define LW_PORT_TEXT      1     // LoRaWAN port for URL text observations and GPS information
+#define LW_PORT_BINARY    2     // LoRaWAN port for binary observations - See PL.h
+#define LW_PORT_FRAGMENT  3     // LoRaWAN port for fragments of payloads too large for the data rate - See OBS.h
+#define LW_PORT_BATCH     4     // LoRaWAN port for several N2S observations in one frame - See PL.h
+#define LW_PORT_BACKFILL  5     // LoRaWAN downlink port asking for a time range of the SD log to be resent - See OBS.h
+
+// Scheduler task ids, see Task_Initialize()
+int task_heartbeat_off = -1;
+int task_observation = -1;
+int task_gps = -1;
+int task_n2s = -1;
+int task_reboot = -1;
+bool StationTasksEnabled = false;             // Observation tasks start when loop() is in normal operation
 
 /*
  * ======================================================================================================================
@@ -199,15 +212,20 @@ int DailyRebootCountDownTimer;
 #include "QC.h"                   // Quality Control Min and Max Sensor Values on Surface of the Earth
 #include "SF.h"                   // Support Functions
 #include "Output.h"               // Output support for OLED and Serial Console
+#include "SCH.h"                  // Cooperative Task Scheduler
 #include "CF.h"                   // Configuration File Variables
 #include "TM.h"                   // Time Management
 #include "GPS.h"                  // GPS Support
 #include "WRDB.h"                 // Wind Rain Distance Battery
 #include "EP.h"                   // EEPROM
 #include "LW.h"                   // LoRaWAN
+#include "PWR.h"                  // Low Power Sleep Between Tasks
 #include "SDC.h"                  // SD Card
 #include "Sensors.h"              // I2C Based Sensors
 #include "OBS.h"                  // Do Observation Processing
+#include "SR.h"                   // Sensor Registry - I2C Sensor Reads, Health Checks and Station Monitor
+#include "PL.h"                   // Binary Observation Payload
+#include "AR.h"                   // Compressed Observation Archive
 #include "SM.h"                   // Station Monitor
 
 
@@ -242,36 +260,159 @@ void DeviceReset() {
 
 /*
  * ======================================================================================================================
- * BackGroundWork() - Take Sensor Reading, Check LoRa for Messages, Delay 1 Second for use as timming delay            
+ * Scheduler Tasks - Registered in Task_Initialize(), run from BackGroundWork(). Must not block.
  * ======================================================================================================================
  */
-void BackGroundWork() {
-  uint64_t OneSecondFromNow = millis() + 1000;
+void Task_WindSample() {
+  Wind_TakeReading();
+}
 
-  if (cf_ds_enable) {
-    DS_TakeReading();
+void Task_WindDirectionSample() {
+  Wind_OversampleDirection();
+}
+
+void Task_RainSample() {
+  Rain_TakeReading();
+}
+
+void Task_DistanceSample() {
+  DS_TakeReading();
+}
+
+void Task_DistanceOversample() {
+  DS_Sample();
+}
+
+void Task_PM25Sample() {
+  pm25aqi_TakeReading();
+}
+
+void Task_HeartBeatOn() {
+  digitalWrite(HEARTBEAT_PIN, HIGH);
+  SCH_Delay(task_heartbeat_off, 250);
+
+  if (TurnLedOff) {   // Turned on by Rain_TakeReading() when a tip comes in
+    digitalWrite(LED_PIN, LOW);  
+    TurnLedOff = false;
   }
-    
+}
+
+void Task_HeartBeatOff() {
+  digitalWrite(HEARTBEAT_PIN, LOW);
+}
+
+void Task_GPSPublish() {
+  // Send GPS info at boot before 1st OBS
+  if (gps_need2pub && gps_valid) {
+    gps_publish();
+    Time_of_next_obs += 30000; //delay observation by 30s, to provide time to get response from lora modem
+    SCH_SetDeadline(task_observation, Time_of_next_obs);
+  }
+}
+
+void Task_Observation() {
+  // Perform an Observation, Write to SD, Send OBS
+  Output ("Do OBS");
+  Time_of_obs = rtc_unixtime();
+  OBS_Do();
+
+  if (cf_5m_enable) {    
+    // Log 0,5,10,15... minute periods of each hour
+    // (Time_of_obs % 300) = Seconds since last 5min period
+    // (300 - (Time_of_obs % 300)) = Seconds to next 5min period
+    Time_of_next_obs = ((300 - (Time_of_obs % 300)) * 1000) + millis();  // Time_of_next_obs in ms from now
+  }
+  else if (cf_15m_enable) {    
+    // Log 0,15,30,45 minute periods of each hour
+    // (Time_of_obs % 900) = Seconds since last 15min period
+    // (900 - (Time_of_obs % 900)) = Seconds to next 15min period
+    Time_of_next_obs = ((900 - (Time_of_obs % 900)) * 1000) + millis();  // Time_of_next_obs in ms from now
+  }
+  else {
+    Time_of_next_obs = millis() + 60000;
+  }   
+  SCH_SetDeadline(task_observation, Time_of_next_obs);
+  JPO_ClearBits(); // Clear status bits from boot after we log our first observations
+}
+
+void Task_N2SPublish() {
+  OBS_N2S_Publish(); // Queue N2S backlog when the transmit queue has room
+  OBS_BF_Publish();  // Then any backfill request
+}
+
+void Task_DailyReboot() {
+  Output ("Daily Reboot/OBS");
+  SCH_Dump();
+  
+  Time_of_obs = rtc_unixtime();
+  OBS_Do();
+
+  // Give the transmit queue a chance to empty, what is left is saved to N2S
+  LW_TXQ_Flush(60000);
+  
+  // Log lines and archive observations still in RAM go to the card
+  AR_Flush();
+  SD_LogClose(false);
+  SD_N2S_WriteClose();
+
+  Output("Rebooting");  
+  delay(1000);
+ 
+  DeviceReset();
+
+  // We should never get here, but just incase 
+  Output("I'm Alive! Why?");
+  SCH_Delay(task_reboot, cf_daily_reboot * 3600000UL);
+}
+
+/*
+ * ======================================================================================================================
+ * Task_Initialize() - Register scheduler tasks. Observation tasks are registered disabled, loop() enables them.
+ * ======================================================================================================================
+ */
+void Task_Initialize() {
   if (AS5600_exists) {
-    Wind_TakeReading();
+    if (cf_wd_samples > 1) {
+      SCH_AddTask("WD", Task_WindDirectionSample, 1000 / cf_wd_samples, 0, true);
+    }
+    SCH_AddTask("WS", Task_WindSample, 1000, 0, true);
+  }
+  if (cf_rg1_enable || cf_rg2_enable) {
+    SCH_AddTask("RG", Task_RainSample, 1000, 0, true);
+  }
+  if (cf_ds_enable) {
+    if (cf_ds_samples > 1) {
+      SCH_AddTask("DSS", Task_DistanceOversample, 1000 / cf_ds_samples, 0, true);
+    }
+    SCH_AddTask("DS", Task_DistanceSample, 1000, 0, true);
   }
-    
   if (PM25AQI_exists) {
-    pm25aqi_TakeReading();
+    SCH_AddTask("PM", Task_PM25Sample, 1000, 0, true);
   }
+  SCH_AddTask("HB", Task_HeartBeatOn, 1000, 0, true);
+  task_heartbeat_off = SCH_AddTask("HBO", Task_HeartBeatOff, 0, 250, true);
 
-  HeartBeat();  // Burns 250ms
+  task_gps = SCH_AddTask("GPS", Task_GPSPublish, 1000, 0, false);
+  task_observation = SCH_AddTask("OBS", Task_Observation, 0, 0, false);
+  SCH_SetDeadline(task_observation, Time_of_next_obs);
+  task_n2s = SCH_AddTask("N2S", Task_N2SPublish, 1000, 0, false);
 
-  while(OneSecondFromNow > millis()) {
-    //delay(100);
-    os_runloop_once(); // Run as often as we can
+  if (cf_daily_reboot > 0) {
+    task_reboot = SCH_AddTask("RB", Task_DailyReboot, 0, cf_daily_reboot * 3600000UL, true);
   }
+}
 
-  if (TurnLedOff) {   // Turned on by rain gauge interrupt handler
-    digitalWrite(LED_PIN, LOW);  
-    TurnLedOff = false;
-  }
+/*
+ * ======================================================================================================================
+ * BackGroundWork() - Run due scheduler tasks and let LMIC and the transmit queue run. Does not block.
+ * ======================================================================================================================
+ */
+void BackGroundWork() {
+  SCH_Run();
+  os_runloop_once();
+  LW_TXQ_Service();  // Hand queued frames to LMIC as the radio frees up
 }
+
 /* 
  *=======================================================================================================================
  * Wind_Distance_Air_Initialize()
@@ -284,17 +425,19 @@ void Wind_Distance_Air_Initialize() {
   if (AS5600_exists) {
     anemometer_interrupt_count = 0;
     anemometer_interrupt_stime = millis();
+    Wind_PulseReset();
   
     // Init default values.
-    wind.gust = 0.0;
-    wind.gust_direction = -1;
-    wind.bucket_idx = 0;
+    Wind_Initialize();
   }
 
   // Take N 1s samples of wind speed and direction and fill arrays with values.
   if (AS5600_exists | PM25AQI_exists |cf_ds_enable) {
     for (int i=0; i< WIND_READINGS; i++) {
-      BackGroundWork();
+      uint64_t OneSecondFromNow = millis() + 1000;
+      while(OneSecondFromNow > millis()) {
+        BackGroundWork();
+      }
     
       if (SerialConsoleEnabled) Serial.print(".");  // Provide Serial Console some feedback as we loop and wait til next observation
       OLED_spin();
@@ -332,7 +475,7 @@ void Wind_Distance_Air_Initialize() {
   }
 
   if (cf_ds_enable) {
-    sprintf (Buffer32Bytes, "DS:%d", DS_Median());
+    sprintf (Buffer32Bytes, "DS:%d", (int) DS_Median());
     Output (Buffer32Bytes);
   }
 }
@@ -370,21 +513,22 @@ void setup() {
   }
   
   SD_ReadConfigFile();
+  AR_Initialize();  // Only takes RAM when sd_archive is set
 
-  // Set Daily Reboot Timer
-  DailyRebootCountDownTimer = cf_daily_reboot * 3600;
-  
   rtc_initialize();
 
   gps_initialize(true);  // true = print NotFound message
 
   EEPROM_initialize();
+
+  SD_N2S_Initialize();  // Needs the n2s ring pointers from EEPROM
   
   if (cf_rg1_enable) {
     // Optipolar Hall Effect Sensor SS451A - Rain1 Gauge
     raingauge1_interrupt_count = 0;
     raingauge1_interrupt_stime = millis();
     raingauge1_interrupt_ltime = 0;  // used to debounce the tip
+    Rain_TipsReset(&raingauge1_tips);
     attachInterrupt(RAINGAUGE1_IRQ_PIN, raingauge1_interrupt_handler, FALLING);
     Output ("RG1:ENABLED");
   }
@@ -397,6 +541,7 @@ void setup() {
     raingauge2_interrupt_count = 0;
     raingauge2_interrupt_stime = millis();
     raingauge2_interrupt_ltime = 0;  // used to debounce the tip
+    Rain_TipsReset(&raingauge2_tips);
     attachInterrupt(RAINGAUGE2_IRQ_PIN, raingauge2_interrupt_handler, FALLING);
     Output ("RG2:ENABLED");
   }
@@ -436,12 +581,16 @@ void setup() {
     // Optipolar Hall Effect Sensor SS451A - Wind Speed
     anemometer_interrupt_count = 0;
     anemometer_interrupt_stime = millis();
+    Wind_PulseReset();
     attachInterrupt(ANEMOMETER_IRQ_PIN, anemometer_interrupt_handler, FALLING);
   }
   
   Output ("Start Main Loop");
   Time_of_next_obs = millis() + 60000; // Give LoRa Radio some time to Comet about
 
+  PWR_Initialize();   // After the attachInterrupt() calls
+  Task_Initialize();  // Daily reboot timer starts now
+
   if (RTC_valid) {
     Wind_Distance_Air_Initialize(); // Will call HeartBeat() - Full station call.
   }
@@ -453,7 +602,7 @@ void setup() {
  * ======================================================================================================================
  */
 void loop() {
-  static int  countdown = 1800; // How log do we stay in calibration display mode
+  static unsigned long calibration_ms = millis(); // Calibration display mode ends CALIBRATION_TIME after this
   // Output ("LOOP");
 
   if (!RTC_valid) {
@@ -495,7 +644,7 @@ void loop() {
     }
   }
     //Calibration mode
-  else if (countdown && digitalRead(SCE_PIN) == LOW) { 
+  else if (((millis() - calibration_ms) < CALIBRATION_TIME) && digitalRead(SCE_PIN) == LOW) { 
     // Every minute, Do observation (don't save to SD) and transmit
     //I2C_Check_Sensors();
     
@@ -506,59 +655,20 @@ void loop() {
       rtc_readserial(); // check for serial input, validate for rtc, set rtc, report result
     }
     
-    countdown--;
     delay (1000);
   }
 
-  // Normal Operation
-  else {
-    // Send GPS info at boot before 1st OBS
-    if (gps_need2pub && gps_valid) {
-      gps_publish();
-      Time_of_next_obs += 30000; //delay observation by 30s, to provide time to get response from lora modem
-    }
-    
-    // Perform an Observation, Write to SD, Send OBS
-    if (millis() >= Time_of_next_obs) {
-      Output ("Do OBS");
-      Time_of_obs = rtc_unixtime();
-      OBS_Do();
-
-      if (cf_5m_enable) {    
-        // Log 0,5,10,15... minute periods of each hour
-        // (Time_of_obs % 300) = Seconds since last 5min period
-        // (300 - (Time_of_obs % 300)) = Seconds to next 5min period
-        Time_of_next_obs = ((300 - (Time_of_obs % 300)) * 1000) + millis();  // Time_of_next_obs in ms from now
-      }
-      else if (cf_15m_enable) {    
-        // Log 0,15,30,45 minute periods of each hour
-        // (Time_of_obs % 900) = Seconds since last 15min period
-        // (900 - (Time_of_obs % 900)) = Seconds to next 15min period
-        Time_of_next_obs = ((900 - (Time_of_obs % 900)) * 1000) + millis();  // Time_of_next_obs in ms from now
-      }
-      else {
-        Time_of_next_obs = millis() + 60000;
-      }   
-      JPO_ClearBits(); // Clear status bits from boot after we log our first observations
-    }
+  // Normal Operation - Observations, GPS, N2S and the daily reboot are scheduler tasks, see Task_Initialize()
+  else if (!StationTasksEnabled) {
+    SCH_Enable(task_gps, true);
+    SCH_Enable(task_observation, true);
+    SCH_Enable(task_n2s, true);
+    StationTasksEnabled = true;
   }
 
-  // Reboot Boot Countdown, only if cf_daily_reboot is set
-  if ((cf_daily_reboot>0) && (--DailyRebootCountDownTimer<=0)) {
-    Output ("Daily Reboot/OBS");
-    
-    Time_of_obs = rtc_unixtime();
-    OBS_Do();
-    
-    Output("Rebooting");  
-    delay(1000);
-   
-    DeviceReset();
+  BackGroundWork();
 
-    // We should never get here, but just incase 
-    Output("I'm Alive! Why?");
-    DailyRebootCountDownTimer = cf_daily_reboot * 3600;
+  if (StationTasksEnabled) {
+    PWR_Sleep(); // Until the next task is due
   }
-  
-  BackGroundWork();
 }
@@ -40,7 +40,7 @@ data to be transmitted by any of the located and tracked satellites.
  *  Globals
  * ======================================================================================================================
  */
-bool OBS_Send(char *); // Prototype this function to aviod compile function unknown issue
+bool OBS_Send(char *, int, int); // Prototype this function to aviod compile function unknown issue
 
 #define GPS_ADDRESS 0x10
 I2CGPS myI2CGPS; //Hook object to the library
@@ -213,7 +213,7 @@ void gps_publish() {
   
   Serial_writeln (obsbuf);
 
-  if (!OBS_Send(obsbuf)) {  
+  if (!OBS_Send(obsbuf, strlen(obsbuf), LW_PORT_TEXT)) {  
     Output("GPS->PUB FAILED");
   }
   else {
@@ -48,6 +48,69 @@
 #define LORA_SS  8      // We need to set this pin high to disable LoRa, prior to accessing the SD card.
 
 bool LW_valid = false;
+
+#define LW_FRAG_HEADER_SIZE 4   // See LW_TXQ_Service()
+
+/*
+ * ======================================================================================================================
+ *  Transmit Queue
+ *
+ *  LW_TXQ_Add() copies a payload in to the queue and returns. LW_TXQ_Service(), called from BackGroundWork(), hands
+ *  one frame at a time to LMIC when the radio is idle. onEvent(EV_TXCOMPLETE) marks the frame sent and the next
+ *  service call moves on to the next fragment or calls the entry's done callback with ok=true. An entry that LMIC
+ *  will not take, is canceled or whose frame is not complete after LW_TXQ_TIMEOUT calls done with ok=false. The
+ *  clock restarts with each fragment, at low data rates the duty cycle can hold every one of them for minutes.
+ *
+ *  Payloads larger than the data rate allows are split in to fragments and sent on LW_PORT_FRAGMENT
+ *    Byte 0    Fragment message id, same for all fragments of a payload. Rolls over at 255
+ *    Byte 1    Port the reassembled payload would have been sent on (LW_PORT_TEXT, LW_PORT_BINARY, ...)
+ *    Byte 2    Fragment index 0 to count-1
+ *    Byte 3    Fragment count
+ *    Byte 4-N  Payload bytes
+ *
+ *  An entry holds up to LW_TXQ_PAYLOAD bytes, the most one frame carries, which covers binary records and batches.
+ *  A longer payload, a text observation that will be fragmented, is copied to lw_txq_long. Only one can be queued
+ *  at a time, LW_TXQ_Add() returns false for a second.
+ *
+ *  done is given the port and payload back, so an owner that must keep a failed payload need not hold its own
+ *  copy while it waits in the queue. The payload is only valid until done returns and done must not queue.
+ * ======================================================================================================================
+ */
+#define LW_TXQ_SIZE         3           // Entries in the transmit queue
+#define LW_TXQ_PAYLOAD      MAX_LEN_PAYLOAD  // Bytes held in an entry
+#define LW_TXQ_TIMEOUT      300000      // ms a frame may wait for LMIC, covers duty cycle waits and joining
+
+typedef void (*LW_TXQ_CALLBACK)(int tag, bool ok, int port, char *payload, int len);
+
+typedef enum {
+  TXQ_IDLE,             // Nothing handed to LMIC
+  TXQ_PENDING,          // Frame handed to LMIC, waiting on EV_TXCOMPLETE
+  TXQ_SENT,             // EV_TXCOMPLETE seen
+  TXQ_FAILED            // EV_TXCANCELED seen
+} LW_TXQ_STATE;
+
+typedef struct {
+  int             port;              // LoRaWAN port of the whole payload
+  int             len;               // Bytes in payload
+  char           *payload;           // data, or lw_txq_long when len is more than LW_TXQ_PAYLOAD
+  char            data[LW_TXQ_PAYLOAD];
+  LW_TXQ_CALLBACK done;              // Called when sent or failed, may be NULL
+  int             tag;               // Passed to done
+  uint8_t         frag_id;           // Fragment message id, when fragmented
+  int             frag_max;          // Payload bytes per fragment, 0 = not fragmented
+  int             frag_count;        // Number of fragments
+  int             frag_idx;          // Next fragment to send
+} LW_TXQ_ENTRY;
+
+void OBS_BF_Request(uint32_t from, uint32_t to);  // Prototype this function to aviod compile function unknown issue.
+
+LW_TXQ_ENTRY lw_txq[LW_TXQ_SIZE];
+int lw_txq_head = 0;                 // Entry being sent
+int lw_txq_count = 0;                // Entries in queue
+volatile LW_TXQ_STATE lw_txq_state = TXQ_IDLE;
+unsigned long lw_txq_stime = 0;      // millis() when the head entry's frame was first serviced, 0 not yet
+char lw_txq_long[MAX_OBS_SIZE];      // Payload of the one entry longer than LW_TXQ_PAYLOAD
+bool lw_txq_long_inuse = false;
  
 // Pin mapping for Adafruit Feather M0 LoRa
 const lmic_pinmap lmic_pins = {
@@ -149,9 +212,24 @@ void onEvent (ev_t ev) {
         case EV_TXCOMPLETE:
             sprintf (msgbuf, "LW:EV_TXCMPLT,%d recv", LMIC.dataLen);
             Output (msgbuf);
+            if (lw_txq_state == TXQ_PENDING) {
+              lw_txq_state = TXQ_SENT;
+            }
             if (LMIC.txrxFlags & TXRX_ACK) {
               Output("LW:Received ack");
             }
+            // Downlink asking for part of the SD log to be resent, from and to times big endian, see OBS.h
+            if (LMIC.dataLen && (LMIC.txrxFlags & TXRX_PORT) && (LMIC.frame[LMIC.dataBeg-1] == LW_PORT_BACKFILL)) {
+              uint8_t *d = LMIC.frame + LMIC.dataBeg;
+
+              if (LMIC.dataLen == 8) {
+                OBS_BF_Request(((uint32_t) d[0] << 24) | ((uint32_t) d[1] << 16) | ((uint32_t) d[2] << 8) | d[3],
+                               ((uint32_t) d[4] << 24) | ((uint32_t) d[5] << 16) | ((uint32_t) d[6] << 8) | d[7]);
+              }
+              else {
+                Output("LW:Backfill Len ERR");
+              }
+            }
             /*
             if (LMIC.dataLen == 4) {
               uint32_t receivedTime = LMIC.frame[LMIC.dataBeg] |
@@ -192,6 +270,9 @@ void onEvent (ev_t ev) {
             break;
         case EV_TXCANCELED:
             Output("LW:EV_TXCANCELED");
+            if (lw_txq_state == TXQ_PENDING) {
+              lw_txq_state = TXQ_FAILED;
+            }
             break;
         case EV_RXSTART:
             /* do not print anything -- it wrecks timing */
@@ -206,6 +287,229 @@ void onEvent (ev_t ev) {
     }
 }
 
+/* 
+ *=======================================================================================================================
+ * LW_MaxPayload() - Largest application payload the current data rate will carry
+ * 
+ *   LMICbandplan_maxFrameLen() comes from the region tables in lmic_bandplan_*.h and includes the MAC header and 
+ *   MIC (5 bytes) plus the frame header and port (8 bytes). Same math as LMIC_feasibleDataRateForFrame().
+ *=======================================================================================================================
+ */
+int LW_MaxPayload() {
+  int max = LMICbandplan_maxFrameLen(LMIC.datarate) - 13;
+
+  if (max > MAX_LEN_PAYLOAD) {
+    max = MAX_LEN_PAYLOAD;
+  }
+  return ((max > 0) ? max : 0);
+}
+
+/* 
+ *=======================================================================================================================
+ * LW_TXQ_Free() - Number of free entries in the transmit queue
+ *=======================================================================================================================
+ */
+int LW_TXQ_Free() {
+  return (LW_TXQ_SIZE - lw_txq_count);
+}
+
+/* 
+ *=======================================================================================================================
+ * LW_TXQ_Add() - Copy payload in to the transmit queue. Return false if LoRaWAN is not valid or the queue is full.
+ *                done(tag, ok) is called once the payload is sent or has failed.
+ *=======================================================================================================================
+ */
+bool LW_TXQ_Add(char *payload, int len, int port, LW_TXQ_CALLBACK done, int tag) {
+  LW_TXQ_ENTRY *e;
+
+  if (!LW_valid) {
+    Output("LW:Not Valid");
+    return (false);   
+  }
+  if ((len <= 0) || (len > MAX_OBS_SIZE)) {
+    Output("LW:TXQ Size ERR");
+    return (false);
+  }
+  if (lw_txq_count >= LW_TXQ_SIZE) {
+    Output("LW:TXQ Full");
+    return (false);
+  }
+
+  if (len > LW_TXQ_PAYLOAD) {
+    if (lw_txq_long_inuse) {
+      Output("LW:TXQ Long Busy");
+      return (false);
+    }
+    lw_txq_long_inuse = true;
+  }
+
+  e = &lw_txq[(lw_txq_head + lw_txq_count) % LW_TXQ_SIZE];
+  e->payload = (len > LW_TXQ_PAYLOAD) ? lw_txq_long : e->data;
+  memcpy (e->payload, payload, len);
+  e->len = len;
+  e->port = port;
+  e->done = done;
+  e->tag = tag;
+  e->frag_max = 0;
+  e->frag_count = 1;
+  e->frag_idx = 0;
+  lw_txq_count++;
+
+  sprintf (Buffer32Bytes, "LW:TXQ Add %d", lw_txq_count);
+  Output (Buffer32Bytes);
+  return (true);
+}
+
+/* 
+ *=======================================================================================================================
+ * LW_TXQ_Done() - Remove head entry from the queue and tell its owner how it went
+ *=======================================================================================================================
+ */
+void LW_TXQ_Done(bool ok) {
+  LW_TXQ_ENTRY *e = &lw_txq[lw_txq_head];
+
+  lw_txq_head = (lw_txq_head + 1) % LW_TXQ_SIZE;
+  lw_txq_count--;
+  lw_txq_state = TXQ_IDLE;
+  lw_txq_stime = 0;
+
+  Output((ok) ? "LW:TXQ Sent" : "LW:TXQ Failed");
+  if (e->done) {
+    e->done(e->tag, ok, e->port, e->payload, e->len);
+  }
+  if (e->payload == lw_txq_long) {
+    lw_txq_long_inuse = false;
+  }
+}
+
+/* 
+ *=======================================================================================================================
+ * LW_TXQ_SendFrame() - Hand the head entry's next frame to LMIC
+ *=======================================================================================================================
+ */
+bool LW_TXQ_SendFrame() {
+  static uint8_t frag_id = 0;
+  LW_TXQ_ENTRY *e = &lw_txq[lw_txq_head];
+  uint8_t frag[MAX_LEN_PAYLOAD];
+  int size;
+
+  if (e->frag_idx == 0) {
+    // Decide once per payload if it needs fragmenting, the data rate could change between fragments
+    if (e->len > LW_MaxPayload()) {
+      e->frag_max = LW_MaxPayload() - LW_FRAG_HEADER_SIZE;
+      if (e->frag_max <= 0) {
+        Output("LW:FRAG DR ERR");
+        return (false);
+      }
+      e->frag_count = (e->len + e->frag_max - 1) / e->frag_max;
+      if (e->frag_count > 255) {
+        Output("LW:FRAG Too Large");
+        return (false);
+      }
+      e->frag_id = ++frag_id;
+      sprintf (Buffer32Bytes, "LW:FRAG %d %dx%d", e->frag_id, e->frag_count, e->frag_max);
+      Output (Buffer32Bytes);
+    }
+  }
+
+  // transmit on port (LW_PORT_TEXT, LW_PORT_BINARY, LW_PORT_FRAGMENT, ...); you can use any value from 1 to 223.
+  // don't request an ack (the last parameter, if not zero, requests an ack from the network).
+  // Remember, acks consume a lot of network resources; don't ask for an ack unless you really need it.
+  if (e->frag_max == 0) {
+    if (LMIC_setTxData2(e->port, (uint8_t*)e->payload, e->len, 0) != LMIC_ERROR_SUCCESS) {
+      Output("LW:OBS Queue ERR");
+      return (false);
+    }
+  }
+  else {
+    size = e->len - (e->frag_idx * e->frag_max);
+    if (size > e->frag_max) {
+      size = e->frag_max;
+    }
+    frag[0] = e->frag_id;
+    frag[1] = e->port;
+    frag[2] = e->frag_idx;
+    frag[3] = e->frag_count;
+    memcpy (frag+LW_FRAG_HEADER_SIZE, e->payload+(e->frag_idx * e->frag_max), size);
+    if (LMIC_setTxData2(LW_PORT_FRAGMENT, frag, size+LW_FRAG_HEADER_SIZE, 0) != LMIC_ERROR_SUCCESS) {
+      sprintf (Buffer32Bytes, "LW:FRAG %d/%d ERR", e->frag_idx, e->frag_count);
+      Output (Buffer32Bytes);
+      return (false);
+    }
+  }
+  lw_txq_state = TXQ_PENDING;
+  Output("LW:OBS Queued");
+  return (true);
+}
+
+/* 
+ *=======================================================================================================================
+ * LW_TXQ_Service() - Move the transmit queue along. Never waits on the radio.
+ *=======================================================================================================================
+ */
+void LW_TXQ_Service() {
+  if (lw_txq_count == 0) {
+    return;
+  }
+  if (lw_txq_stime == 0) {
+    lw_txq_stime = millis() | 1;   // Head entry's clock starts now, 0 means not started
+  }
+
+  switch (lw_txq_state) {
+    case TXQ_SENT :
+      lw_txq_state = TXQ_IDLE;
+      if (++lw_txq[lw_txq_head].frag_idx >= lw_txq[lw_txq_head].frag_count) {
+        LW_TXQ_Done(true);
+        return;
+      }
+      lw_txq_stime = millis() | 1;  // Next fragment gets its own LW_TXQ_TIMEOUT
+      break;
+
+    case TXQ_FAILED :
+      LW_TXQ_Done(false);
+      return;
+
+    default :
+      break;
+  }
+
+  if ((long) (millis() - lw_txq_stime) > (long) LW_TXQ_TIMEOUT) {   // stime can be 1 ahead of millis()
+    Output("LW:TXQ Timeout");
+    if (lw_txq_state == TXQ_PENDING) {
+      LMIC_clrTxData();
+    }
+    LW_TXQ_Done(false);
+    return;
+  }
+
+  // Start the next frame when LMIC is not busy with something of its own (join, mac command)
+  if ((lw_txq_state == TXQ_IDLE) && !(LMIC.opmode & OP_TXRXPEND)) {
+    if (!LW_TXQ_SendFrame()) {
+      LW_TXQ_Done(false);
+    }
+  }
+}
+
+/* 
+ *=======================================================================================================================
+ * LW_TXQ_Flush() - Run LMIC until the queue is empty or ms have passed, then fail what is left. Used before reboot.
+ *=======================================================================================================================
+ */
+void LW_TXQ_Flush(unsigned long ms) {
+  unsigned long start = millis();
+
+  while (lw_txq_count && ((millis() - start) < ms)) {
+    os_runloop_once();
+    LW_TXQ_Service();
+  }
+  if (lw_txq_state == TXQ_PENDING) {
+    LMIC_clrTxData();
+  }
+  while (lw_txq_count) {
+    LW_TXQ_Done(false);
+  }
+}
+
 /* 
  *=======================================================================================================================
  * LW_initialize()
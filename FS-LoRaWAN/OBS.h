@@ -6,7 +6,7 @@
 void BackGroundWork();   // Prototype this function to aviod compile function unknown issue.
 
 #define OBSERVATION_INTERVAL      60   // Seconds
-#define MAX_SENSORS         48
+#define MAX_SENSORS         64
 
 typedef enum {
   F_OBS, 
@@ -14,76 +14,236 @@ typedef enum {
   U_OBS
 } OBS_TYPE;
 
+/*
+ * ======================================================================================================================
+ *  Observation names - SENSOR.id is an index in to obs_names[]. The order is also the binary payload order,
+ *  see pl_sensors[] in PL.h, so only append new names to the end.
+ * ======================================================================================================================
+ */
+typedef enum {
+  SID_RG1,            // Rain Gauge 1
+  SID_RGT1,
+  SID_RGP1,
+  SID_RG2,            // Rain Gauge 2
+  SID_RGT2,
+  SID_RGP2,
+  SID_DS,             // Distance Sensor
+  SID_WS,             // Wind
+  SID_WD,
+  SID_WG,
+  SID_WGD,
+  SID_BP1,            // BMX 1
+  SID_BT1,
+  SID_BH1,
+  SID_BP2,            // BMX 2
+  SID_BT2,
+  SID_BH2,
+  SID_HH1,            // HTU21DF
+  SID_HT1,
+  SID_ST1,            // SHT 1
+  SID_SH1,
+  SID_ST2,            // SHT 2
+  SID_SH2,
+  SID_HT2,            // HIH8
+  SID_HH2,
+  SID_SV1,            // SI1145
+  SID_SI1,
+  SID_SU1,
+  SID_MT1,            // MCP 1
+  SID_MT2,            // MCP 2
+  SID_LX,             // VEML7700
+  SID_PM1S10,         // PM25AQI
+  SID_PM1S25,
+  SID_PM1S100,
+  SID_PM1E10,
+  SID_PM1E25,
+  SID_PM1E100,
+  SID_HI,             // Derived Observations
+  SID_WBT,
+  SID_WBGT,
+  SID_SLP,            // Percent of time asleep, see PWR.h
+  SID_WS2,            // Wind averages and peak, see Wind_IntervalUpdate()
+  SID_WD2,
+  SID_WS10,
+  SID_WD10,
+  SID_WSI,
+  SID_WDI,
+  SID_WP,
+  SID_WPD,
+  SID_WPT,
+  SID_RR1,            // Rain rate, intensity and tip times, see Rain_IntervalUpdate()
+  SID_RI1,
+  SID_RF1,
+  SID_RL1,
+  SID_RR2,
+  SID_RI2,
+  SID_RF2,
+  SID_RL2,
+  SID_DSR,            // Distance spread and quality, see DS_Filter()
+  SID_DSQ,
+  SID_COUNT
+} OBS_ID;
+
 typedef struct {
-  char          id[6];       // Suport 4 character length observation names
-  int           type;
-  float         f_obs;
-  int           i_obs;
-  unsigned long u_obs;
-  bool          inuse;
+  const char    *name;       // Observation name
+  uint8_t       type;        // F_OBS, I_OBS, U_OBS
+} OBS_NAME_DEF;
+
+const OBS_NAME_DEF obs_names[SID_COUNT] = {
+  {"rg1",     F_OBS},  // Rain Gauge 1
+  {"rgt1",    F_OBS},
+  {"rgp1",    F_OBS},
+  {"rg2",     F_OBS},  // Rain Gauge 2
+  {"rgt2",    F_OBS},
+  {"rgp2",    F_OBS},
+  {"ds",      F_OBS},  // Distance Sensor
+  {"ws",      F_OBS},  // Wind
+  {"wd",      I_OBS},
+  {"wg",      F_OBS},
+  {"wgd",     I_OBS},
+  {"bp1",     F_OBS},  // BMX 1
+  {"bt1",     F_OBS},
+  {"bh1",     F_OBS},
+  {"bp2",     F_OBS},  // BMX 2
+  {"bt2",     F_OBS},
+  {"bh2",     F_OBS},
+  {"hh1",     F_OBS},  // HTU21DF
+  {"ht1",     F_OBS},
+  {"st1",     F_OBS},  // SHT 1
+  {"sh1",     F_OBS},
+  {"st2",     F_OBS},  // SHT 2
+  {"sh2",     F_OBS},
+  {"ht2",     F_OBS},  // HIH8
+  {"hh2",     F_OBS},
+  {"sv1",     F_OBS},  // SI1145
+  {"si1",     F_OBS},
+  {"su1",     F_OBS},
+  {"mt1",     F_OBS},  // MCP 1
+  {"mt2",     F_OBS},  // MCP 2
+  {"lx",      F_OBS},  // VEML7700
+  {"pm1s10",  I_OBS},  // PM25AQI
+  {"pm1s25",  I_OBS},
+  {"pm1s100", I_OBS},
+  {"pm1e10",  I_OBS},
+  {"pm1e25",  I_OBS},
+  {"pm1e100", I_OBS},
+  {"hi",      F_OBS},  // Derived Observations
+  {"wbt",     F_OBS},
+  {"wbgt",    F_OBS},
+  {"slp",     F_OBS},  // Percent of time asleep, see PWR.h
+  {"ws2",     F_OBS},  // Wind averages and peak, see Wind_IntervalUpdate()
+  {"wd2",     I_OBS},
+  {"ws10",    F_OBS},
+  {"wd10",    I_OBS},
+  {"wsi",     F_OBS},
+  {"wdi",     I_OBS},
+  {"wp",      F_OBS},
+  {"wpd",     I_OBS},
+  {"wpt",     I_OBS},
+  {"rr1",     F_OBS},  // Rain rate, intensity and tip times, see Rain_IntervalUpdate()
+  {"ri1",     F_OBS},
+  {"rf1",     I_OBS},
+  {"rl1",     I_OBS},
+  {"rr2",     F_OBS},
+  {"ri2",     F_OBS},
+  {"rf2",     I_OBS},
+  {"rl2",     I_OBS},
+  {"dsr",     I_OBS},  // Distance spread and quality, see DS_Filter()
+  {"dsq",     I_OBS}
+};
+
+typedef struct {
+  union {                    // Value, which member is set by type
+    float       f_obs;
+    int32_t     i_obs;
+    uint32_t    u_obs;
+  };
+  uint8_t       id;          // OBS_ID
+  uint8_t       type;        // OBS_TYPE
 } SENSOR;
 
+static_assert(sizeof(SENSOR) == 8, "SENSOR should pack in to 8 bytes");
+static_assert(SID_COUNT <= 256, "OBS_ID must fit in SENSOR.id");
+
+#define OBS_PRESENT_SIZE    ((MAX_SENSORS + 7) / 8)
+
 typedef struct {
   bool            inuse;                // Set to true when an observation is stored here         
   time_t          ts;                   // TimeStamp
   float           bv;                   // Lipo Battery Voltage
   unsigned long   hth;                  // System Status Bits
+  uint8_t         present[OBS_PRESENT_SIZE];  // Bit set for each sensor[] entry in use, see OBS_Present()
   SENSOR          sensor[MAX_SENSORS];
 } OBSERVATION_STR;
 
+// Header is at most 32 bytes (64 bit time_t), sensor[] was 28 bytes per entry before it was packed
+static_assert(sizeof(OBSERVATION_STR) <= 32 + OBS_PRESENT_SIZE + (MAX_SENSORS * sizeof(SENSOR)), 
+  "OBSERVATION_STR has grown");
+
 OBSERVATION_STR obs;
 
 unsigned long Time_of_obs = 0;              // unix time of observation
 unsigned long Time_of_next_obs = 0;         // time of next observation
 
+int  obsbuf_len = 0;                        // Number of bytes in obsbuf built by OBS_Build()
+int  obsbuf_port = LW_PORT_TEXT;            // LoRaWAN port for what OBS_Build() placed in obsbuf
+
+// The observation encoded once by OBS_Encode(), the binary record the uplink, N2S and backfill send. It is the only
+// copy, the SD log and URL text are rendered from obs by OBS_Render() and an observation waiting in the transmit
+// queue is only held there, see OBS_TxDone().
+typedef struct {
+  bool          inuse;
+  int           bin_len;                  // Bytes in bin, 0 if PL_Encode() failed
+  uint8_t       bin[SD_N2S_MAXPL];        // PL_Encode() of obs with the System Status Bits as taken
+} OBS_RECORD;
+OBS_RECORD obs_rec;
+
+bool obs_n2s_drain = false;                 // Set after an observation is sent, cleared when an N2S send fails
+bool obs_n2s_inflight = false;              // N2S records are in the transmit queue
+bool obs_n2s_newest = false;                // Next N2S send is from the newest end of the ring
+unsigned long obs_n2s_first = 0;            // Sequence number of first N2S record in the transmit queue
+
+/*
+ * ======================================================================================================================
+ *  Backfill - Resend a time range from the SD log
+ *
+ *  A downlink on LW_PORT_BACKFILL with 8 bytes, the from and to times in seconds since 1970 both 32 bit big endian,
+ *  asks for the observations logged in that range to be sent again. OBS_BF_Publish() finds the start of each day's
+ *  range with the log index (see SDC.h), turns the JSON lines back in to observations and queues them the way N2S
+ *  records are sent, batched when n2s_batch is set, with SSB_FROM_N2S set. It runs after the N2S backlog is empty
+ *  and under the same rules, one frame at a time with a queue entry left free. Sensor values are resent with the
+ *  0.1 precision the log has. A new request replaces the one being sent.
+ * ======================================================================================================================
+ */
+#define OBS_BF_LINES        32              // Most log lines read per call of OBS_BF_Publish()
+
+bool obs_bf_active = false;                 // A backfill request is being sent
+bool obs_bf_inflight = false;               // A backfill frame is in the transmit queue
+uint32_t obs_bf_from = 0;                   // Time of the next observation to send
+uint32_t obs_bf_to = 0;                     // Time of the last observation to send
+uint32_t obs_bf_first = 0;                  // Time of the first observation in the transmit queue, 0 none
+uint32_t obs_bf_day_end = 0;                // Time the day being read ends
 
 void OBS_N2S_Publish();   // Prototype this function to aviod compile function unknown issue.
+int  PL_Encode(uint8_t *buf, int size);  // Prototype this function to aviod compile function unknown issue.
+bool PL_Decode(uint8_t *buf, int len);   // Prototype this function to aviod compile function unknown issue.
+void AR_Add();                           // Prototype this function to aviod compile function unknown issue.
+void PL_BatchBegin(uint8_t *buf, int size);  // Prototype this function to aviod compile function unknown issue.
+bool PL_BatchAdd(uint8_t *rec, int len);     // Prototype this function to aviod compile function unknown issue.
+int  PL_BatchLen();                          // Prototype this function to aviod compile function unknown issue.
+void PL_AddStatusBits(uint8_t *rec, unsigned long bits);  // Prototype this function to aviod compile function unknown issue.
+int  SR_TakeObservations(int sidx);          // Prototype this function to aviod compile function unknown issue.
+void I2C_Check_Sensors();                    // Prototype this function to aviod compile function unknown issue.
 
 /*
  * ======================================================================================================================
- * OBS_Send() - Do a GET request to log observation, process returned text for result code and set return status
+ * OBS_Send() - Queue payload of len bytes for transmit on LoRaWAN port. Returns without waiting on the radio.
+ *              Return false if it could not be queued. See LW_TXQ_Add()
  * ======================================================================================================================
  */
-bool OBS_Send(char *obs)
+bool OBS_Send(char *obs, int len, int port)
 {
-  if (LW_valid) {
-    if (LMIC.opmode & OP_TXRXPEND) {
-      uint64_t TimeFromNow = millis() + 10000;
-      Output("LW:RetryWait");
-      while(TimeFromNow > millis()) {
-        if (LMIC.opmode & OP_TXRXPEND) {
-          BackGroundWork();
-        }
-        else {
-          break;
-        }
-      }
-      Output("LW:Retry");
-      if (LMIC.opmode & OP_TXRXPEND) {
-        Output("LW:Busy, OBS NOT Sent");
-        return (false);
-      }
-      else {
-        Output("LW:OBS Queuing");
-        LMIC_setTxData2(1, (uint8_t*)obs, strlen(obs), 0);
-        Output("LW:OBS Queued");
-        return(true);        
-      }
-    } else {
-      // prepare upstream data transmission at the next possible time.
-      // transmit on port 1 (the first parameter); you can use any value from 1 to 223 (others are reserved).
-      // don't request an ack (the last parameter, if not zero, requests an ack from the network).
-      // Remember, acks consume a lot of network resources; don't ask for an ack unless you really need it.
-      Output("LW:OBS Queuing");
-      LMIC_setTxData2(1, (uint8_t*)obs, strlen(obs), 0);
-      Output("LW:OBS Queued");
-      return(true);
-    }
-  }
-  else {
-    Output("LW:Not Valid");
-    return (false);   
-  }
+  return (LW_TXQ_Add(obs, len, port, NULL, 0));
 }
 
 /*
@@ -93,64 +253,310 @@ bool OBS_Send(char *obs)
  */
 void OBS_Clear() {
   obs.inuse =false;
-  for (int s=0; s<MAX_SENSORS; s++) {
-    obs.sensor[s].inuse = false;
+  obs_rec.inuse = false;
+  memset(obs.present, 0, sizeof(obs.present));
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_Present() - Return true if obs.sensor[s] is in use
+ * ======================================================================================================================
+ */
+bool OBS_Present(int s) {
+  return (obs.present[s/8] & (0x80 >> (s%8)));
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_Add() - Mark obs.sensor[*sidx] in use for observation id of type and advance *sidx. Return the entry so the
+ *             caller can set its value, NULL if obs is full.
+ * ======================================================================================================================
+ */
+SENSOR *OBS_Add(int *sidx, int id, int type) {
+  SENSOR *sensor;
+
+  if (*sidx >= MAX_SENSORS) {
+    return (NULL);
   }
+  sensor = &obs.sensor[*sidx];
+  sensor->id = id;
+  sensor->type = type;
+  obs.present[*sidx/8] |= (0x80 >> (*sidx%8));
+  (*sidx)++;
+  return (sensor);
 }
 
 /*
  * ======================================================================================================================
- * OBS_N2S_Add() - Save OBS to N2S file
+ * OBS_AddF() - Add float observation id
+ * ======================================================================================================================
+ */
+void OBS_AddF(int *sidx, int id, float f) {
+  SENSOR *sensor = OBS_Add(sidx, id, F_OBS);
+  if (sensor) {
+    sensor->f_obs = f;
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_AddI() - Add integer observation id
+ * ======================================================================================================================
+ */
+void OBS_AddI(int *sidx, int id, int i) {
+  SENSOR *sensor = OBS_Add(sidx, id, I_OBS);
+  if (sensor) {
+    sensor->i_obs = i;
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_N2S_Add() - Save OBS to N2S ring file as a binary record, see PL.h. It is rebuilt in the configured format
+ *                 (text or binary) when it is published.
  * ======================================================================================================================
  */
 void OBS_N2S_Add() {
-  if (obs.inuse) {     // Sanity check
-    char ts[32];
-   
-    memset(obsbuf, 0, sizeof(obsbuf));
-
-    tm *dt = gmtime(&obs.ts); 
-      
-    sprintf (obsbuf+strlen(obsbuf), "&at=%d-%02d-%02dT%02d%%3A%02d%%3A%02d",
-      dt->tm_year+1900, dt->tm_mon+1,  dt->tm_mday,
-      dt->tm_hour, dt->tm_min, dt->tm_sec);
-      
-    sprintf (obsbuf+strlen(obsbuf), "&bv=%d.%02d",
-       (int)obs.bv, (int)(obs.bv*100)%100); 
-
-    // Modify System Status and Set From Need to Send file bit
-    obs.hth |= SSB_FROM_N2S; // Turn On Bit
-    sprintf (obsbuf+strlen(obsbuf), "&hth=%d", obs.hth);
-   
-    for (int s=0; s<MAX_SENSORS; s++) {
-      if (obs.sensor[s].inuse) {
-        switch (obs.sensor[s].type) {
-          case F_OBS :
-            // sprintf (obsbuf+strlen(obsbuf), "&%s=%d%%2E%d", obs.sensor[s].id, 
-            //  (int)obs.sensor[s].f_obs,  (int)(obs.sensor[s].f_obs*1000)%1000);
-            sprintf (obsbuf+strlen(obsbuf), "&%s=%.1f", obs.sensor[s].id, obs.sensor[s].f_obs);
-            break;
-          case I_OBS :
-            sprintf (obsbuf+strlen(obsbuf), "&%s=%d", obs.sensor[s].id, obs.sensor[s].i_obs);
-            break;
-          case U_OBS :
-            sprintf (obsbuf+strlen(obsbuf), "&%s=%u", obs.sensor[s].id, obs.sensor[s].i_obs);
-            break;
-          default : // Should never happen
-            Output ("WhyAmIHere?");
-            break;
-        }
-      }
+  if (obs_rec.inuse) {     // Sanity check
+    int len = obs_rec.bin_len;
+
+    if (len) {
+      // Set From Need to Send file bit in the record, obs_rec is not sent after this
+      PL_AddStatusBits(obs_rec.bin, SSB_FROM_N2S);
+
+      SD_NeedToSend_Add(obs_rec.bin, len); // Save to N2S File
+      sprintf (Buffer32Bytes, "OBS-> N2S %d", len);
+      Output (Buffer32Bytes);
+    }
+    else {
+      Output("OBS->N2S ENC:ERR");
     }
-    Serial_writeln (obsbuf);
-    SD_NeedToSend_Add(obsbuf); // Save to N2F File
-    Output("OBS-> N2S");
   }
   else {
     Output("OBS->N2S OBS:Empty");
   }
 }
 
+bool OBS_FromURL(char *text, uint32_t ts);  // Prototype this function to aviod compile function unknown issue.
+bool OBS_Encode();                          // Prototype this function to aviod compile function unknown issue.
+
+/*
+ * ======================================================================================================================
+ * OBS_N2S_AddPayload() - Save an observation payload that did not send to the N2S file. A binary record is saved as
+ *                        it was sent. A text observation is parsed back in to obs and encoded, with the 0.1
+ *                        precision the text has. ts is its time.
+ * ======================================================================================================================
+ */
+void OBS_N2S_AddPayload(uint32_t ts, int port, char *payload, int len) {
+  if (port == LW_PORT_BINARY) {
+    PL_AddStatusBits((uint8_t *) payload, SSB_FROM_N2S);
+    SD_NeedToSend_Add((uint8_t *) payload, len);
+    return;
+  }
+
+  if (len >= MAX_OBS_SIZE) {
+    Output("OBS->N2S ENC:ERR");
+    return;
+  }
+  memcpy(obsbuf, payload, len);
+  obsbuf[len] = 0;
+  if (!OBS_FromURL(obsbuf, ts) || !OBS_Encode()) {
+    Output("OBS->N2S ENC:ERR");
+    return;
+  }
+  OBS_N2S_Add();
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_TxDone() - Transmit queue callback for an observation, tag is its time. On failure the payload is saved to
+ *                the N2S file. On success the N2S backlog starts draining.
+ * ======================================================================================================================
+ */
+void OBS_TxDone(int tag, bool ok, int port, char *payload, int len) {
+  if (ok) {
+    Output("FS->PUB OK");
+    if (!obs_n2s_drain) {
+      obs_n2s_drain = true;
+      obs_n2s_newest = (cf_n2s_policy == N2S_LIFO) || (cf_n2s_policy == N2S_LATEST);
+    }
+  }
+  else {
+    Output("FS->PUB FAILED");
+    OBS_N2S_AddPayload((uint32_t) tag, port, payload, len);
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_N2S_TxDone() - Transmit queue callback for N2S records, tag is the number of records sent.
+ *                    Records are removed from the ring only after they are sent.
+ * ======================================================================================================================
+ */
+void OBS_N2S_TxDone(int tag, bool ok, int port, char *payload, int len) {
+  obs_n2s_inflight = false;
+  if (ok) {
+    SD_N2S_Remove(obs_n2s_first, tag);
+    if (cf_n2s_policy == N2S_LATEST) {
+      obs_n2s_newest = false;
+    }
+    sprintf (Buffer32Bytes, "OBS:N2S[%d]->PUB:OK", tag);
+    Output (Buffer32Bytes);
+  }
+  else {
+    // Stop until an observation gets through. Records stay in the ring for next time.
+    obs_n2s_drain = false;
+    SD_N2S_ReadClose();
+    Output ("OBS:N2S->PUB:ERR");
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_SendObservation() - Queue obsbuf built by OBS_Build() for transmit. If the transmit fails OBS_TxDone() saves
+ *                         it to the N2S file from the queue's copy. Return false if it could not be queued.
+ * ======================================================================================================================
+ */
+bool OBS_SendObservation() {
+  if (!obs_rec.inuse || (obs_rec.bin_len == 0) || (obsbuf_len == 0)) {
+    return (false);
+  }
+  return (LW_TXQ_Add(obsbuf, obsbuf_len, obsbuf_port, OBS_TxDone, (int) obs.ts));
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_WriteTime() - Append observation time as YYYY-MM-DDTHH:MM:SS with sep between the time fields
+ * ======================================================================================================================
+ */
+void OBS_WriteTime(BUFWRITER *w, const char *sep) {
+  tm *dt = gmtime(&obs.ts); 
+
+  BW_Int(w, dt->tm_year+1900, 0);
+  BW_Str(w, "-");
+  BW_Int(w, dt->tm_mon+1, 2);
+  BW_Str(w, "-");
+  BW_Int(w, dt->tm_mday, 2);
+  BW_Str(w, "T");
+  BW_Int(w, dt->tm_hour, 2);
+  BW_Str(w, sep);
+  BW_Int(w, dt->tm_min, 2);
+  BW_Str(w, sep);
+  BW_Int(w, dt->tm_sec, 2);
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_WriteBattery() - Append battery voltage as V.vv, same truncation as the "%d.%02d" it replaces
+ * ======================================================================================================================
+ */
+void OBS_WriteBattery(BUFWRITER *w) {
+  BW_Int(w, (int)obs.bv, 0);
+  BW_Str(w, ".");
+  BW_Int(w, (int)(obs.bv*100)%100, 2);
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_WriteValue() - Append sensor value, %.1f for F_OBS, %d for I_OBS and %u for U_OBS
+ * ======================================================================================================================
+ */
+void OBS_WriteValue(BUFWRITER *w, SENSOR *sensor) {
+  switch (sensor->type) {
+    case F_OBS :
+      BW_Float1(w, sensor->f_obs);
+      break;
+    case I_OBS :
+      BW_Int(w, sensor->i_obs, 0);
+      break;
+    case U_OBS :
+      BW_UInt(w, sensor->u_obs, 0);
+      break;
+    default : // Should never happen
+      Output ("WhyAmIHere?");
+      break;
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_Encode() - Encode obs in to obs_rec with PL_Encode(), once per observation. Return false if obs is empty.
+ * ======================================================================================================================
+ */
+bool OBS_Encode() {
+  obs_rec.inuse = false;
+  if (!obs.inuse) {
+    return (false);
+  }
+  obs_rec.bin_len = PL_Encode(obs_rec.bin, SD_N2S_MAXPL);
+  obs_rec.inuse = true;
+  return (true);
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_RenderName() - Append field name, "name": for JSON, name= for the URL form
+ * ======================================================================================================================
+ */
+void OBS_RenderName(BUFWRITER *w, const char *name, bool first, bool json) {
+  if (json) {
+    BW_Str(w, (first) ? "\"" : ",\"");
+    BW_Str(w, name);
+    BW_Str(w, "\":");
+  }
+  else {
+    if (!first) {
+      BW_Str(w, "&");
+    }
+    BW_Str(w, name);
+    BW_Str(w, "=");
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_Render() - Render obs in to obsbuf as JSON for the SD log or in URL form for the uplink.
+ *                Return length or -1 if it did not fit.
+ * ======================================================================================================================
+ */
+int OBS_Render(bool json) {
+  BUFWRITER w;
+
+  BW_Begin(&w, obsbuf, MAX_OBS_SIZE);
+  if (json) {
+    BW_Str(&w, "{");
+  }
+
+  // Time is quoted in JSON and the :'s are escaped in the URL
+  OBS_RenderName(&w, "at", true, json);
+  if (json) {
+    BW_Str(&w, "\"");
+    OBS_WriteTime(&w, ":");
+    BW_Str(&w, "\"");
+  }
+  else {
+    OBS_WriteTime(&w, "%3A");
+  }
+
+  OBS_RenderName(&w, "bv", false, json);
+  OBS_WriteBattery(&w);
+
+  OBS_RenderName(&w, "hth", false, json);
+  BW_Int(&w, (int) obs.hth, 0);
+
+  for (int s=0; s<MAX_SENSORS; s++) {
+    if (OBS_Present(s)) {
+      OBS_RenderName(&w, obs_names[obs.sensor[s].id].name, false, json);
+      OBS_WriteValue(&w, &obs.sensor[s]);
+    }
+  }
+
+  if (json) {
+    BW_Str(&w, "}");
+  }
+  return ((w.overflow) ? -1 : w.len);
+}
+
 /*
  * ======================================================================================================================
  * OBS_LOG_Add() - Create observation in obsbuf and save to SD card.
@@ -159,44 +565,20 @@ void OBS_N2S_Add() {
  * ======================================================================================================================
  */
 void OBS_LOG_Add() {  
-  if (obs.inuse) {     // Sanity check
-
-    memset(obsbuf, 0, sizeof(obsbuf));
-
-    sprintf (obsbuf, "{");
-
-    tm *dt = gmtime(&obs.ts); 
-    
-    sprintf (obsbuf+strlen(obsbuf), "\"at\":\"%d-%02d-%02dT%02d:%02d:%02d\"",
-      dt->tm_year+1900, dt->tm_mon+1,  dt->tm_mday,
-      dt->tm_hour, dt->tm_min, dt->tm_sec);
-      
-    sprintf (obsbuf+strlen(obsbuf), ",\"bv\":%d.%02d", (int)obs.bv, (int)(obs.bv*100)%100); 
-    sprintf (obsbuf+strlen(obsbuf), ",\"hth\":%d", obs.hth);
-    
-    for (int s=0; s<MAX_SENSORS; s++) {
-      if (obs.sensor[s].inuse) {
-        switch (obs.sensor[s].type) {
-          case F_OBS :
-            sprintf (obsbuf+strlen(obsbuf), ",\"%s\":%.1f", obs.sensor[s].id, obs.sensor[s].f_obs);
-            break;
-          case I_OBS :
-            sprintf (obsbuf+strlen(obsbuf), ",\"%s\":%d", obs.sensor[s].id, obs.sensor[s].i_obs);
-            break;
-          case U_OBS :
-            sprintf (obsbuf+strlen(obsbuf), ",\"%s\":%u", obs.sensor[s].id, obs.sensor[s].i_obs);
-            break;
-          default : // Should never happen
-            Output ("WhyAmIHere?");
-            break;
-        }
-      }
+  if (obs_rec.inuse) {     // Sanity check
+    if (OBS_Render(true) < 0) {
+      Output("OBS->SD OVF");
+      return;
     }
-    sprintf (obsbuf+strlen(obsbuf), "}");
     
     Output("OBS->SD");
     Serial_writeln (obsbuf);
-    SD_LogObservation(obsbuf); 
+    if (cf_sd_archive != 1) {
+      SD_LogObservation(obsbuf, (uint32_t) obs.ts);
+    }
+    if (cf_sd_archive) {
+      AR_Add();
+    }
   }
   else {
     Output("OBS->SD OBS:Empty");
@@ -208,40 +590,38 @@ void OBS_LOG_Add() {
  * OBS_Build() - Create observation in obsbuf for sending to Chords
  * 
  * Example at=2022-05-17T17%3A40%3A04&hth=8770 .....
+ * 
+ * When cf_lw_binary is set the observation is encoded in to obsbuf with PL_Encode(), see PL.h
  * ======================================================================================================================
  */
 bool OBS_Build() {  
-  if (obs.inuse) {     // Sanity check  
-    memset(obsbuf, 0, sizeof(obsbuf));
-
-    tm *dt = gmtime(&obs.ts); 
-    
-    sprintf (obsbuf+strlen(obsbuf), "at=%d-%02d-%02dT%02d%%3A%02d%%3A%02d",
-      dt->tm_year+1900, dt->tm_mon+1,  dt->tm_mday,
-      dt->tm_hour, dt->tm_min, dt->tm_sec);
+  if (obs_rec.inuse) {     // Sanity check  
+    if (cf_lw_binary) {
+      obsbuf_len = obs_rec.bin_len;
+      obsbuf_port = LW_PORT_BINARY;
+      if (obsbuf_len == 0) {
+        Output("OBSBLD:BIN ERR");
+        return (false);
+      }
+      memcpy(obsbuf, obs_rec.bin, obsbuf_len);
 
-    sprintf (obsbuf+strlen(obsbuf), "&bv=%d.%02d",
-       (int)obs.bv, (int)(obs.bv*100)%100); 
-    sprintf (obsbuf+strlen(obsbuf), "&hth=%d", obs.hth);
-    
-    for (int s=0; s<MAX_SENSORS; s++) {
-      if (obs.sensor[s].inuse) {
-        switch (obs.sensor[s].type) {
-          case F_OBS :
-            sprintf (obsbuf+strlen(obsbuf), "&%s=%.1f", obs.sensor[s].id, obs.sensor[s].f_obs);
-            break;
-          case I_OBS :
-            sprintf (obsbuf+strlen(obsbuf), "&%s=%d", obs.sensor[s].id, obs.sensor[s].i_obs);
-            break;
-          case U_OBS :
-            sprintf (obsbuf+strlen(obsbuf), "&%s=%u", obs.sensor[s].id, obs.sensor[s].i_obs);
-            break;
-          default : // Should never happen
-            Output ("WhyAmIHere?");
-            break;
-        }
+      // Hex dump for the Serial Console
+      for (int i=0; (i<obsbuf_len) && (i<(MAX_MSGBUF_SIZE/2)); i++) {
+        sprintf (msgbuf+(i*2), "%02X", (uint8_t) obsbuf[i]);
       }
+      sprintf (Buffer32Bytes, "OBSBLD:BIN %d", obsbuf_len);
+      Output(Buffer32Bytes);
+      Serial_writeln (msgbuf);
+      return (true);
+    }
+
+    obsbuf_len = OBS_Render(false);
+    if (obsbuf_len < 0) {
+      obsbuf_len = 0;
+      Output("OBSBLD:OVF");
+      return (false);
     }
+    obsbuf_port = LW_PORT_TEXT;
 
     Output("OBSBLD:OK");
     Serial_writeln (obsbuf);
@@ -265,6 +645,32 @@ void OBS_N2S_Save() {
   OBS_Clear();
 }
 
+/*
+ * ======================================================================================================================
+ * OBS_RainExtended() - Add rain rate, intensity and tip times from Rain_IntervalUpdate(), id is SID_RR1 or SID_RR2
+ *                      which obs_names[] follows with ri, rf and rl for the same gauge
+ * ======================================================================================================================
+ */
+void OBS_RainExtended(int *sidx, RAIN_TIPS_STR *rt, int id) {
+  float rr;
+
+  // Peak 1 Minute Rain Rate
+  rr = rt->rate;
+  rr = (isnan(rr) || (rr < QC_MIN_RR) || (rr > QC_MAX_RR)) ? QC_ERR_RR : rr;
+  OBS_AddF(sidx, id, rr);
+
+  // Rain Intensity, first to last tip
+  rr = rt->intensity;
+  rr = (isnan(rr) || (rr < QC_MIN_RR) || (rr > QC_MAX_RR)) ? QC_ERR_RR : rr;
+  OBS_AddF(sidx, id+1, rr);
+
+  // Seconds before the observation of the first and last tip
+  if (rt->interval_tips) {
+    OBS_AddI(sidx, id+2, rt->first_seconds);
+    OBS_AddI(sidx, id+3, rt->last_seconds);
+  }
+}
+
 /*
  * ======================================================================================================================
  * OBS_Take() - Take Observations - Should be called once a minute - fill data structure
@@ -278,9 +684,6 @@ void OBS_Take() {
   unsigned long rg2ds;   // rain gauge delta seconds, seconds since last rain gauge observation logged
   float ws = 0.0;
   int wd = 0;
-  float mcp1_temp = 0.0;
-  float sht1_humid = 0.0;
-  float heat_index = 0.0;
   
   // Safty Check for Vaild Time
   if (!RTC_valid) {
@@ -291,6 +694,7 @@ void OBS_Take() {
   OBS_Clear(); // Just do it again as a safty check
 
   Wind_GustUpdate(); // Update Gust and Gust Direction readings
+  Wind_IntervalUpdate(); // 2 and 10 minute averages, interval average and peak
 
   obs.inuse = true;
   // obs.ts = rtc_unixtime();
@@ -305,7 +709,7 @@ void OBS_Take() {
     rg1 = raingauge1_interrupt_count * 0.2;
     raingauge1_interrupt_count = 0;
     raingauge1_interrupt_stime = millis();
-    raingauge1_interrupt_ltime = 0; // used to debounce the tip
+    Rain_IntervalUpdate(&raingauge1_tips);
     // QC Check - Max Rain for period is (Observations Seconds / 60s) *  Max Rain for 60 Seconds
     rg1 = (isnan(rg1) || (rg1 < QC_MIN_RG) || (rg1 > ((rg1ds / 60) * QC_MAX_RG)) ) ? QC_ERR_RG : rg1;
   }
@@ -316,7 +720,7 @@ void OBS_Take() {
     rg2 = raingauge2_interrupt_count * 0.2;
     raingauge2_interrupt_count = 0;
     raingauge2_interrupt_stime = millis();
-    raingauge2_interrupt_ltime = 0; // used to debounce the tip
+    Rain_IntervalUpdate(&raingauge2_tips);
     // QC Check - Max Rain for period is (Observations Seconds / 60s) *  Max Rain for 60 Seconds
     rg2 = (isnan(rg2) || (rg2 < QC_MIN_RG) || (rg2 > ((rg2ds / 60) * QC_MAX_RG)) ) ? QC_ERR_RG : rg2;
   }
@@ -327,424 +731,109 @@ void OBS_Take() {
  
   // Rain Gauge 1
   if (cf_rg1_enable) {
-    strcpy (obs.sensor[sidx].id, "rg1");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = rg1;
-    obs.sensor[sidx++].inuse = true;
-  
-    strcpy (obs.sensor[sidx].id, "rgt1");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = eeprom.rgt1;
-    obs.sensor[sidx++].inuse = true;
+    OBS_AddF(&sidx, SID_RG1, rg1);
+    OBS_AddF(&sidx, SID_RGT1, eeprom.rgt1);
+    OBS_AddF(&sidx, SID_RGP1, eeprom.rgp1);
 
-    strcpy (obs.sensor[sidx].id, "rgp1");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = eeprom.rgp1;
-    obs.sensor[sidx++].inuse = true;
+    if (cf_rg_ext) {
+      OBS_RainExtended(&sidx, &raingauge1_tips, SID_RR1);
+    }
   }
 
   // Rain Gauge 2
   if (cf_rg2_enable) {
-    strcpy (obs.sensor[sidx].id, "rg2");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = rg2;
-    obs.sensor[sidx++].inuse = true;
-  
-    strcpy (obs.sensor[sidx].id, "rgt2");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = eeprom.rgt2;
-    obs.sensor[sidx++].inuse = true;
+    OBS_AddF(&sidx, SID_RG2, rg2);
+    OBS_AddF(&sidx, SID_RGT2, eeprom.rgt2);
+    OBS_AddF(&sidx, SID_RGP2, eeprom.rgp2);
 
-    strcpy (obs.sensor[sidx].id, "rgp2");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = eeprom.rgp2;
-    obs.sensor[sidx++].inuse = true;
+    if (cf_rg_ext) {
+      OBS_RainExtended(&sidx, &raingauge2_tips, SID_RR2);
+    }
   }
 
   if (cf_ds_enable) {
-    strcpy (obs.sensor[sidx].id, "ds");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = DS_Median();
-    obs.sensor[sidx++].inuse = true;    
+    OBS_AddF(&sidx, SID_DS, DS_Median());
+
+    if (cf_ds_samples > 1) {
+      OBS_AddI(&sidx, SID_DSR, DS_Spread());
+      OBS_AddI(&sidx, SID_DSQ, DS_Quality());
+    }
   }
 
   if (AS5600_exists) {
     // Wind Speed
     ws = Wind_SpeedAverage();
     ws = (isnan(ws) || (ws < QC_MIN_WS) || (ws > QC_MAX_WS)) ? QC_ERR_WS : ws;
-    strcpy (obs.sensor[sidx].id, "ws");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = ws;
-    obs.sensor[sidx++].inuse = true;
+    OBS_AddF(&sidx, SID_WS, ws);
 
     // Wind Direction
     wd = Wind_DirectionVector();
     wd = (isnan(wd) || (wd < QC_MIN_WD) || (wd > QC_MAX_WD)) ? QC_ERR_WD : wd;
-    strcpy (obs.sensor[sidx].id, "wd");
-    obs.sensor[sidx].type = I_OBS;
-    obs.sensor[sidx].i_obs = Wind_DirectionVector();
-    obs.sensor[sidx++].inuse = true;
+    OBS_AddI(&sidx, SID_WD, wd);
 
     // Wind Gust
     ws = Wind_Gust();
     ws = (isnan(ws) || (ws < QC_MIN_WS) || (ws > QC_MAX_WS)) ? QC_ERR_WS : ws;
-    strcpy (obs.sensor[sidx].id, "wg");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = ws;
-    obs.sensor[sidx++].inuse = true;
+    OBS_AddF(&sidx, SID_WG, ws);
 
     // Wind Gust Direction (Global)
     wd = Wind_GustDirection();
     wd = (isnan(wd) || (wd < QC_MIN_WD) || (wd > QC_MAX_WD)) ? QC_ERR_WD : wd;
-    strcpy (obs.sensor[sidx].id, "wgd");
-    obs.sensor[sidx].type = I_OBS;
-    obs.sensor[sidx].i_obs = wd;
-    obs.sensor[sidx++].inuse = true;
+    OBS_AddI(&sidx, SID_WGD, wd);
+
+    if (cf_ws_ext) {
+      // Wind 2 Minute Average
+      ws = wind.avg2.speed;
+      ws = (isnan(ws) || (ws < QC_MIN_WS) || (ws > QC_MAX_WS)) ? QC_ERR_WS : ws;
+      OBS_AddF(&sidx, SID_WS2, ws);
+
+      wd = wind.avg2.direction;
+      wd = (isnan(wd) || (wd < QC_MIN_WD) || (wd > QC_MAX_WD)) ? QC_ERR_WD : wd;
+      OBS_AddI(&sidx, SID_WD2, wd);
+
+      // Wind 10 Minute Average
+      ws = wind.avg10.speed;
+      ws = (isnan(ws) || (ws < QC_MIN_WS) || (ws > QC_MAX_WS)) ? QC_ERR_WS : ws;
+      OBS_AddF(&sidx, SID_WS10, ws);
+
+      wd = wind.avg10.direction;
+      wd = (isnan(wd) || (wd < QC_MIN_WD) || (wd > QC_MAX_WD)) ? QC_ERR_WD : wd;
+      OBS_AddI(&sidx, SID_WD10, wd);
+
+      // Wind Average over the Observation Interval
+      ws = wind.avgi.speed;
+      ws = (isnan(ws) || (ws < QC_MIN_WS) || (ws > QC_MAX_WS)) ? QC_ERR_WS : ws;
+      OBS_AddF(&sidx, SID_WSI, ws);
+
+      wd = wind.avgi.direction;
+      wd = (isnan(wd) || (wd < QC_MIN_WD) || (wd > QC_MAX_WD)) ? QC_ERR_WD : wd;
+      OBS_AddI(&sidx, SID_WDI, wd);
+
+      // Wind Peak Gust over the Observation Interval
+      ws = wind.peak;
+      ws = (isnan(ws) || (ws < QC_MIN_WS) || (ws > QC_MAX_WS)) ? QC_ERR_WS : ws;
+      OBS_AddF(&sidx, SID_WP, ws);
+
+      wd = wind.peak_direction;
+      wd = (isnan(wd) || (wd < QC_MIN_WD) || (wd > QC_MAX_WD)) ? QC_ERR_WD : wd;
+      OBS_AddI(&sidx, SID_WPD, wd);
+
+      // Seconds before the observation the peak gust ended
+      OBS_AddI(&sidx, SID_WPT, wind.peak_seconds);
+    }
+    Wind_PeakClear();
 
     Wind_ClearSampleCount(); // Clear Counter, Counter maintain how many samples since last obs sent
   }
 
   //
-  // Add I2C Sensors
+  // Add I2C Sensors and the observations derived from them, see sr_drivers[] in SR.h
   //
-  if (BMX_1_exists) {
-    float p = 0.0;
-    float t = 0.0;
-    float h = 0.0;
-
-    if (BMX_1_chip_id == BMP280_CHIP_ID) {
-      p = bmp1.readPressure()/100.0F;       // bp1 hPa
-      t = bmp1.readTemperature();           // bt1
-    }
-    else if (BMX_1_chip_id == BME280_BMP390_CHIP_ID) {
-      if (BMX_1_type == BMX_TYPE_BME280) {
-        p = bme1.readPressure()/100.0F;     // bp1 hPa
-        t = bme1.readTemperature();         // bt1
-        h = bme1.readHumidity();            // bh1 
-      }
-      if (BMX_1_type == BMX_TYPE_BMP390) {
-        p = bm31.readPressure()/100.0F;     // bp1 hPa
-        t = bm31.readTemperature();         // bt1 
-      }    
-    }
-    else { // BMP388
-      p = bm31.readPressure()/100.0F;       // bp1 hPa
-      t = bm31.readTemperature();           // bt1
-    }
-    p = (isnan(p) || (p < QC_MIN_P)  || (p > QC_MAX_P))  ? QC_ERR_P  : p;
-    t = (isnan(t) || (t < QC_MIN_T)  || (t > QC_MAX_T))  ? QC_ERR_T  : t;
-    h = (isnan(h) || (h < QC_MIN_RH) || (h > QC_MAX_RH)) ? QC_ERR_RH : h;
-    
-    // BMX1 Preasure
-    strcpy (obs.sensor[sidx].id, "bp1");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = p;
-    obs.sensor[sidx++].inuse = true;
-
-    // BMX1 Temperature
-    strcpy (obs.sensor[sidx].id, "bt1");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = t;
-    obs.sensor[sidx++].inuse = true;
-
-    // BMX1 Humidity
-    strcpy (obs.sensor[sidx].id, "bh1");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = h;
-    obs.sensor[sidx++].inuse = true;
-  }
-
-  if (BMX_2_exists) {
-    float p = 0.0;
-    float t = 0.0;
-    float h = 0.0;
-
-    if (BMX_2_chip_id == BMP280_CHIP_ID) {
-      p = bmp2.readPressure()/100.0F;       // bp2 hPa
-      t = bmp2.readTemperature();           // bt2
-    }
-    else if (BMX_2_chip_id == BME280_BMP390_CHIP_ID) {
-      if (BMX_2_type == BMX_TYPE_BME280) {
-        p = bme2.readPressure()/100.0F;     // bp2 hPa
-        t = bme2.readTemperature();         // bt2
-        h = bme2.readHumidity();            // bh2 
-      }
-      if (BMX_2_type == BMX_TYPE_BMP390) {
-        p = bm32.readPressure()/100.0F;     // bp2 hPa
-        t = bm32.readTemperature();         // bt2       
-      }
-    }
-    else { // BMP388
-      p = bm32.readPressure()/100.0F;       // bp2 hPa
-      t = bm32.readTemperature();           // bt2
-    }
-    p = (isnan(p) || (p < QC_MIN_P)  || (p > QC_MAX_P))  ? QC_ERR_P  : p;
-    t = (isnan(t) || (t < QC_MIN_T)  || (t > QC_MAX_T))  ? QC_ERR_T  : t;
-    h = (isnan(h) || (h < QC_MIN_RH) || (h > QC_MAX_RH)) ? QC_ERR_RH : h;
-
-    // BMX2 Preasure
-    strcpy (obs.sensor[sidx].id, "bp2");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = p;
-    obs.sensor[sidx++].inuse = true;
-
-    // BMX2 Temperature
-    strcpy (obs.sensor[sidx].id, "bt2");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = t;
-    obs.sensor[sidx++].inuse = true;
+  sidx = SR_TakeObservations(sidx);
 
-    // BMX2 Humidity
-    strcpy (obs.sensor[sidx].id, "bh2");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = h;
-    obs.sensor[sidx++].inuse = true;
-  }
-
-  if (HTU21DF_exists) {
-    float t = 0.0;
-    float h = 0.0;
-    
-    // HTU Humidity
-    strcpy (obs.sensor[sidx].id, "hh1");
-    obs.sensor[sidx].type = F_OBS;
-    h = htu.readHumidity();
-    h = (isnan(h) || (h < QC_MIN_RH) || (h > QC_MAX_RH)) ? QC_ERR_RH : h;
-    obs.sensor[sidx].f_obs = h;
-    obs.sensor[sidx++].inuse = true;
-
-    // HTU Temperature
-    strcpy (obs.sensor[sidx].id, "ht1");
-    obs.sensor[sidx].type = F_OBS;
-    t = htu.readTemperature();
-    t = (isnan(t) || (t < QC_MIN_T)  || (t > QC_MAX_T))  ? QC_ERR_T  : t;
-    obs.sensor[sidx].f_obs = t;
-    obs.sensor[sidx++].inuse = true;
-  }
-
-  if (SHT_1_exists) {                                                                               
-    float t = 0.0;
-    float h = 0.0;
-
-    // SHT1 Temperature
-    strcpy (obs.sensor[sidx].id, "st1");
-    obs.sensor[sidx].type = F_OBS;
-    t = sht1.readTemperature();
-    t = (isnan(t) || (t < QC_MIN_T)  || (t > QC_MAX_T))  ? QC_ERR_T  : t;
-    obs.sensor[sidx].f_obs = t;
-    obs.sensor[sidx++].inuse = true;
-    
-    // SHT1 Humidity   
-    strcpy (obs.sensor[sidx].id, "sh1");
-    obs.sensor[sidx].type = F_OBS;
-    h = sht1.readHumidity();
-    h = (isnan(h) || (h < QC_MIN_RH) || (h > QC_MAX_RH)) ? QC_ERR_RH : h;
-    obs.sensor[sidx].f_obs = h;
-    obs.sensor[sidx++].inuse = true;
-
-    sht1_humid = h; // save for derived observations
-  }
-
-  if (SHT_2_exists) {
-    float t = 0.0;
-    float h = 0.0;
-
-    // SHT2 Temperature
-    strcpy (obs.sensor[sidx].id, "st2");
-    obs.sensor[sidx].type = F_OBS;
-    t = sht2.readTemperature();
-    t = (isnan(t) || (t < QC_MIN_T)  || (t > QC_MAX_T))  ? QC_ERR_T  : t;
-    obs.sensor[sidx].f_obs = t;
-    obs.sensor[sidx++].inuse = true;
-    
-    // SHT2 Humidity   
-    strcpy (obs.sensor[sidx].id, "sh2");
-    obs.sensor[sidx].type = F_OBS;
-    h = sht2.readHumidity();
-    h = (isnan(h) || (h < QC_MIN_RH) || (h > QC_MAX_RH)) ? QC_ERR_RH : h;
-    obs.sensor[sidx].f_obs = h;
-    obs.sensor[sidx++].inuse = true;
-  }
-
-  if (HIH8_exists) {
-    float t = 0.0;
-    float h = 0.0;
-    bool status = hih8_getTempHumid(&t, &h);
-    if (!status) {
-      t = -999.99;
-      h = 0.0;
-    }
-    t = (isnan(t) || (t < QC_MIN_T)  || (t > QC_MAX_T))  ? QC_ERR_T  : t;
-    h = (isnan(h) || (h < QC_MIN_RH) || (h > QC_MAX_RH)) ? QC_ERR_RH : h;
-
-    // HIH8 Temperature
-    strcpy (obs.sensor[sidx].id, "ht2");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = t;
-    obs.sensor[sidx++].inuse = true;
-
-    // HIH8 Humidity
-    strcpy (obs.sensor[sidx].id, "hh2");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = h;
-    obs.sensor[sidx++].inuse = true;
-  }
-
-  if (SI1145_exists) {
-    float si_vis = uv.readVisible();
-    float si_ir = uv.readIR();
-    float si_uv = uv.readUV()/100.0;
-
-    // Additional code to force sensor online if we are getting 0.0s back.
-    if ( ((si_vis+si_ir+si_uv) == 0.0) && ((si_last_vis+si_last_ir+si_last_uv) != 0.0) ) {
-      // Let Reset The SI1145 and try again
-      Output ("SI RESET");
-      if (uv.begin()) {
-        SI1145_exists = true;
-        Output ("SI ONLINE");
-        SystemStatusBits &= ~SSB_SI1145; // Turn Off Bit
-
-        si_vis = uv.readVisible();
-        si_ir = uv.readIR();
-        si_uv = uv.readUV()/100.0;
-      }
-      else {
-        SI1145_exists = false;
-        Output ("SI OFFLINE");
-        SystemStatusBits |= SSB_SI1145;  // Turn On Bit    
-      }
-    }
-
-    // Save current readings for next loop around compare
-    si_last_vis = si_vis;
-    si_last_ir = si_ir;
-    si_last_uv = si_uv;
-
-    // QC Checks
-    si_vis = (isnan(si_vis) || (si_vis < QC_MIN_VI)  || (si_vis > QC_MAX_VI)) ? QC_ERR_VI  : si_vis;
-    si_ir  = (isnan(si_ir)  || (si_ir  < QC_MIN_IR)  || (si_ir  > QC_MAX_IR)) ? QC_ERR_IR  : si_ir;
-    si_uv  = (isnan(si_uv)  || (si_uv  < QC_MIN_UV)  || (si_uv  > QC_MAX_UV)) ? QC_ERR_UV  : si_uv;
-
-    // SI Visible
-    strcpy (obs.sensor[sidx].id, "sv1");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = si_vis;
-    obs.sensor[sidx++].inuse = true;
-
-    // SI IR
-    strcpy (obs.sensor[sidx].id, "si1");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = si_ir;
-    obs.sensor[sidx++].inuse = true;
-
-    // SI UV
-    strcpy (obs.sensor[sidx].id, "su1");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = si_uv;
-    obs.sensor[sidx++].inuse = true;
-  }
-  
-  if (MCP_1_exists) {
-    float t = 0.0;
-   
-    // MCP1 Temperature
-    strcpy (obs.sensor[sidx].id, "mt1");
-    obs.sensor[sidx].type = F_OBS;
-    t = mcp1.readTempC();
-    t = (isnan(t) || (t < QC_MIN_T)  || (t > QC_MAX_T))  ? QC_ERR_T  : t;
-    obs.sensor[sidx].f_obs = t;
-    obs.sensor[sidx++].inuse = true;
-
-    mcp1_temp = t; // save for derived observations
-  }
-
-  if (MCP_2_exists) {
-    float t = 0.0;
-    
-    // MCP2 Temperature
-    strcpy (obs.sensor[sidx].id, "mt2");
-    obs.sensor[sidx].type = F_OBS;
-    t = mcp2.readTempC();
-    t = (isnan(t) || (t < QC_MIN_T)  || (t > QC_MAX_T))  ? QC_ERR_T  : t;
-    obs.sensor[sidx].f_obs = t;
-    obs.sensor[sidx++].inuse = true;
-  }
-  
-  if (VEML7700_exists) {
-    float lux = veml.readLux(VEML_LUX_AUTO);
-    lux = (isnan(lux) || (lux < QC_MIN_LX)  || (lux > QC_MAX_LX))  ? QC_ERR_LX  : lux;
-
-    // VEML7700 Auto Lux Value
-    strcpy (obs.sensor[sidx].id, "lx");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = lux;
-    obs.sensor[sidx++].inuse = true;
-  }
-
-  if (PM25AQI_exists) {
-    // Standard Particle PM1.0 concentration unit µg m3
-    strcpy (obs.sensor[sidx].id, "pm1s10");
-    obs.sensor[sidx].type = I_OBS;
-    obs.sensor[sidx].i_obs = pm25aqi_obs.max_s10;
-    obs.sensor[sidx++].inuse = true;
-
-    // Standard Particle PM2.5 concentration unit µg m3
-    strcpy (obs.sensor[sidx].id, "pm1s25");
-    obs.sensor[sidx].type = I_OBS;
-    obs.sensor[sidx].i_obs = pm25aqi_obs.max_s25;
-    obs.sensor[sidx++].inuse = true;
-
-    // Standard Particle PM10.0 concentration unit µg m3
-    strcpy (obs.sensor[sidx].id, "pm1s100");
-    obs.sensor[sidx].type = I_OBS;
-    obs.sensor[sidx].i_obs = pm25aqi_obs.max_s100;
-    obs.sensor[sidx++].inuse = true;
-
-    // Atmospheric Environmental PM1.0 concentration unit µg m3
-    strcpy (obs.sensor[sidx].id, "pm1e10");
-    obs.sensor[sidx].type = I_OBS;
-    obs.sensor[sidx].i_obs = pm25aqi_obs.max_e10;
-    obs.sensor[sidx++].inuse = true;
-
-    // Atmospheric Environmental PM2.5 concentration unit µg m3
-    strcpy (obs.sensor[sidx].id, "pm1e25");
-    obs.sensor[sidx].type = I_OBS;
-    obs.sensor[sidx].i_obs = pm25aqi_obs.max_e25;
-    obs.sensor[sidx++].inuse = true;
-
-    // Atmospheric Environmental PM10.0 concentration unit µg m3
-    strcpy (obs.sensor[sidx].id, "pm1e100");
-    obs.sensor[sidx].type = I_OBS;
-    obs.sensor[sidx].i_obs = pm25aqi_obs.max_e100;
-    obs.sensor[sidx++].inuse = true;
-
-    // Clear readings
-    pm25aqi_clear();
-  }
-
-  // Heat Index Temperature
-  if (HI_exists) {
-    heat_index = hi_calculate(mcp1_temp, sht1_humid);
-    strcpy (obs.sensor[sidx].id, "hi");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = (float) heat_index;
-    obs.sensor[sidx++].inuse = true;    
-  }
-  
-  // Wet Bulb Temperature
-  if (WBT_exists) {
-    strcpy (obs.sensor[sidx].id, "wbt");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = (float) wbt_calculate(mcp1_temp, sht1_humid);
-    obs.sensor[sidx++].inuse = true;    
-  }
-
-  // Wet Bulb Globe Temperature
-  if (WBGT_exists) {
-    strcpy (obs.sensor[sidx].id, "wbgt");
-    obs.sensor[sidx].type = F_OBS;
-    obs.sensor[sidx].f_obs = (float) wbgt_calculate(heat_index);
-    obs.sensor[sidx++].inuse = true;    
+  // Percent of time asleep since the last observation
+  if (cf_pwr_mode != PWR_AWAKE) {
+    OBS_AddF(&sidx, SID_SLP, PWR_DutyCycle());
   }
 }
 
@@ -763,6 +852,9 @@ void OBS_Do() {
   OBS_Take();
 
   // At this point, the obs data structure has been filled in with observation data
+
+  // Encode it once, the uplink and the N2S record are sent from obs_rec, the log and text uplink rendered from obs
+  OBS_Encode();
   
   // Save Observation Data to Log file.
   Output("OBS_ADD()");
@@ -772,145 +864,383 @@ void OBS_Do() {
   Output("OBS_BUILD()");
   OBS_Build();
 
+  // Queued for transmit. OBS_TxDone() saves it to the N2S file if the transmit fails.
   Output("OBS_SEND()");
-  if (!OBS_Send(obsbuf)) {  
+  if (!OBS_SendObservation()) {  
     Output("FS->PUB FAILED");
     OBS_N2S_Save(); // Saves Main observations
   }
   else {
-    bool OK2Send = true;
-        
-    Output("FS->PUB OK");
+    Output("FS->PUB QUEUED");
+  }
+}
+
+/* 
+ *=======================================================================================================================
+ * OBS_N2S_BuildBatch() - Pack N2S records in to obsbuf for LW_PORT_BATCH, starting with rec (the record at the
+ *                        newest or oldest end of the ring) and continuing in to the ring while they fit the current
+ *                        data rate. Return number of records packed. Less than 2 means send rec by itself.
+ *=======================================================================================================================
+ */
+int OBS_N2S_BuildBatch(uint8_t *rec, int len, bool newest) {
+  uint8_t next[SD_N2S_MAXPL];
+  unsigned long seq;
+  int max = LW_MaxPayload();
+  int count = 1;
+
+  if (!LW_valid) {
+    return (0);
+  }
+  if (max > MAX_OBS_SIZE) {
+    max = MAX_OBS_SIZE;
+  }
+
+  PL_BatchBegin((uint8_t *) obsbuf, max);
+  if (!PL_BatchAdd(rec, len)) {
+    return (0);
+  }
 
-    // Check if we have any N2S only if we have not added to the file while trying to send OBS
-    if (OK2Send) {
-      OBS_N2S_Publish(); 
+  while ((unsigned long) count < SD_N2S_Count()) {
+    seq = (newest) ? eeprom.n2s_head - 1 - count : eeprom.n2s_tail + count;
+    if ((len = SD_N2S_Read(seq, next)) == 0) {
+      break;  // Corrupt record, SD_N2S_Peek() will skip it when it gets to it
     }
+    if (!PL_BatchAdd(next, len)) {
+      break;  // Full or sensors changed
+    }
+    count++;
   }
+
+  obsbuf_len = PL_BatchLen();
+  obsbuf_port = LW_PORT_BATCH;
+  sprintf (Buffer32Bytes, "OBS:N2S BATCH %dx%dB", count, obsbuf_len);
+  Output (Buffer32Bytes);
+  return (count);
 }
 
 /* 
  *=======================================================================================================================
- * OBS_N2S_Publish()
+ * OBS_N2S_Publish() - Queue the next N2S record (or batch) for transmit in cf_n2s_policy order. Run every second
+ *                     by the N2S scheduler task. Only one N2S send is in the transmit queue at a time, and a queue entry
+ *                     is always left free for the next observation. The global obs is reused to rebuild the record.
  *=======================================================================================================================
  */
 void OBS_N2S_Publish() {
-  File fp;
-  char ch;
-  int i;
-  int sent=0;
+  uint8_t rec[SD_N2S_MAXPL];
+  int len, n;
 
-  memset(obsbuf, 0, sizeof(obsbuf));
+  if (obs_n2s_inflight || !obs_n2s_drain || (LW_TXQ_Free() < 2)) {
+    return;
+  }
+  if (!SD_N2S_Count()) {
+    SD_N2S_ReadClose();
+    return;
+  }
 
-  Output ("OBS:N2S Publish");
+  if ((len = SD_N2S_Peek(rec, obs_n2s_newest)) == 0) {
+    return;
+  }
 
-  // Disable LoRA SPI0 Chip Select
-  pinMode(LORA_SS, OUTPUT);
-  digitalWrite(LORA_SS, HIGH);
-  
-  if (SD_exists && SD.exists(SD_n2s_file)) {
-    Output ("OBS:N2S:Exists");
+  n = (cf_n2s_batch) ? OBS_N2S_BuildBatch(rec, len, obs_n2s_newest) : 0;
+  if (n < 2) {
+    n = 1;
+    if (!PL_Decode(rec, len) || !OBS_Encode() || !OBS_Build()) {
+      Output ("OBS:N2S->BAD:ERR");
+      SD_N2S_Pop(obs_n2s_newest, 1); // Bad record, drop it
+      OBS_Clear();
+      return;
+    }
+  }
 
-    fp = SD.open(SD_n2s_file, FILE_READ); // Open the file for reading, starting at the beginning of the file.
+  if (LW_TXQ_Add(obsbuf, obsbuf_len, obsbuf_port, OBS_N2S_TxDone, n)) {
+    obs_n2s_inflight = true;
+    obs_n2s_first = (obs_n2s_newest) ? eeprom.n2s_head - n : eeprom.n2s_tail;
+    sprintf (Buffer32Bytes, "OBS:N2S %lu Queued %d", SD_N2S_Count(), n);
+    Output (Buffer32Bytes);
+  }
+  OBS_Clear();
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_SetField() - Set obs field name from the number at v. A name this build does not know is skipped to the next
+ *                  of delims. Return the end of the number, v if there is none or NULL if obs is full.
+ * ======================================================================================================================
+ */
+char *OBS_SetField(int *sidx, const char *name, char *v, const char *delims) {
+  char *p = v;
+  int id;
+  SENSOR *sensor;
+
+  if (strcmp(name, "bv") == 0) {
+    obs.bv = strtod(v, &p);
+  }
+  else if (strcmp(name, "hth") == 0) {
+    obs.hth = (unsigned long) strtol(v, &p, 10);  // Logged as int
+  }
+  else {
+    for (id=0; (id<SID_COUNT) && strcmp(name, obs_names[id].name); id++);
+    if (id == SID_COUNT) {
+      p = v + strcspn(v, delims);
+    }
+    else if ((sensor = OBS_Add(sidx, id, obs_names[id].type)) == NULL) {
+      return (NULL);
+    }
+    else if (sensor->type == F_OBS) {
+      sensor->f_obs = strtod(v, &p);
+    }
+    else if (sensor->type == I_OBS) {
+      sensor->i_obs = strtol(v, &p, 10);
+    }
+    else {
+      sensor->u_obs = strtoul(v, &p, 10);
+    }
+  }
+  return (p);
+}
 
-    if (fp) {
-      // Delete Empty File or too small of file to be valid
-      if (fp.size()<=20) {
-        fp.close();
-        Output ("OBS:N2S:Empty");
-        SD_N2S_Delete();
+/*
+ * ======================================================================================================================
+ * OBS_FromLog() - Set obs from a JSON line of the SD log logged at time ts. Names this build does not know are
+ *                 skipped. Return false if the line does not parse.
+ * ======================================================================================================================
+ */
+bool OBS_FromLog(char *line, uint32_t ts) {
+  int sidx = 0;
+  char *p = strstr(line, "\",");  // End of "at"
+
+  OBS_Clear();
+  if (!p) {
+    return (false);
+  }
+  p += 2;
+  obs.ts = ts;
+  obs.bv = 0;
+  obs.hth = 0;
+
+  for (;;) {
+    char *name, *v;
+
+    if (*p != '"') {
+      return (false);
+    }
+    name = ++p;
+    if (!(p = strchr(p, '"')) || (p[1] != ':')) {
+      return (false);
+    }
+    *p = 0;
+    v = p + 2;
+
+    if (!(p = OBS_SetField(&sidx, name, v, ",}")) || (p == v)) {
+      return (false);
+    }
+    if (*p == '}') {
+      break;
+    }
+    if (*p++ != ',') {
+      return (false);
+    }
+  }
+  obs.inuse = true;
+  return (true);
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_FromURL() - Set obs from the URL form OBS_Build() sends, taken at time ts. Return false if it does not parse.
+ * 
+ * at=2022-05-17T17%3A40%3A04&bv=4.10&hth=8770&bp1=1013.2 .....
+ * ======================================================================================================================
+ */
+bool OBS_FromURL(char *text, uint32_t ts) {
+  int sidx = 0;
+  char *p = strchr(text, '&');  // End of "at"
+
+  OBS_Clear();
+  if (!p) {
+    return (false);
+  }
+  obs.ts = ts;
+  obs.bv = 0;
+  obs.hth = 0;
+
+  while (*p == '&') {
+    char *name, *v;
+
+    name = ++p;
+    if (!(p = strchr(p, '='))) {
+      return (false);
+    }
+    *p = 0;
+    v = p + 1;
+
+    if (!(p = OBS_SetField(&sidx, name, v, "&")) || (p == v)) {
+      return (false);
+    }
+  }
+  if (*p) {
+    return (false);
+  }
+  obs.inuse = true;
+  return (true);
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_BF_Request() - Start sending the observations logged from time from to time to, see Backfill
+ * ======================================================================================================================
+ */
+void OBS_BF_Request(uint32_t from, uint32_t to) {
+  uint32_t t = rtc_unixtime();
+
+  if (to > t) {
+    to = t;
+  }
+  if (!SD_exists || !RTC_valid || (from > to)) {
+    Output ("OBS:BF Ignored");
+    return;
+  }
+  SD_LogReadClose();
+  obs_bf_from = from;
+  obs_bf_to = to;
+  obs_bf_first = 0;  // A frame of an earlier request is not resent if it fails
+  obs_bf_active = true;
+  sprintf (msgbuf, "OBS:BF %lu-%lu", (unsigned long) from, (unsigned long) to);
+  Output (msgbuf);
+}
+
+/*
+ * ======================================================================================================================
+ * OBS_BF_TxDone() - Transmit queue callback for backfill frames. On failure the frame is read again next time.
+ * ======================================================================================================================
+ */
+void OBS_BF_TxDone(int tag, bool ok, int port, char *payload, int len) {
+  obs_bf_inflight = false;
+  if (ok) {
+    sprintf (Buffer32Bytes, "OBS:BF[%d]->PUB:OK", tag);
+    Output (Buffer32Bytes);
+  }
+  else {
+    // Stop until an observation gets through, like N2S
+    obs_n2s_drain = false;
+    if (obs_bf_first) {
+      obs_bf_from = obs_bf_first;
+      SD_LogReadClose();
+    }
+    Output ("OBS:BF->PUB:ERR");
+  }
+  obs_bf_first = 0;
+}
+
+/* 
+ *=======================================================================================================================
+ * OBS_BF_Publish() - Queue the next backfill observation (or batch) for transmit. Run every second by the N2S
+ *                    scheduler task after OBS_N2S_Publish(). The global obs is reused and msgbuf holds the log line.
+ *=======================================================================================================================
+ */
+void OBS_BF_Publish() {
+  uint8_t first[SD_N2S_MAXPL];
+  int first_len = 0;
+  uint32_t first_ts = 0;
+  uint32_t ts, pos;
+  bool batch = false;
+  int count = 0;
+
+  if (!obs_bf_active || obs_bf_inflight || obs_n2s_inflight || !obs_n2s_drain || SD_N2S_Count() ||
+      (LW_TXQ_Free() < 2)) {
+    return;
+  }
+
+  for (int lines=0; lines<OBS_BF_LINES; lines++) {
+    if (!SD_lr_day) {
+      time_t t = obs_bf_from;
+      tm *dt = gmtime(&t);
+      long day = (dt->tm_year + 1900) * 10000L + (dt->tm_mon + 1) * 100L + dt->tm_mday;
+
+      if (count || (obs_bf_from > obs_bf_to)) {
+        break;
       }
-      else {
-        if (eeprom.n2sfp) {
-          if (fp.size()<=eeprom.n2sfp) {
-            // Something wrong. Can not have a file position that is larger than the file
-            eeprom.n2sfp = 0; 
-          }
-          else {
-            fp.seek(eeprom.n2sfp);  // Seek to where we left off last time. 
-          }
-        } 
-
-        // Loop through each line / obs and transmit
-        
-        // set timer on when we need to stop sending n2s obs
-        uint64_t TimeFromNow = millis() + 45000; // 1 min obs
-        if (cf_5m_enable) {  
-          TimeFromNow = millis() + (4 * 60000);  
-        }
-        else if (cf_15m_enable) {    
-          TimeFromNow = millis() + (14 * 60000);  
-        }
-        
-        i = 0;
-        while (fp.available() && (i < MAX_MSGBUF_SIZE )) {
-          ch = fp.read();
-
-          if (ch == 0x0A) {  // newline
-            if (OBS_Send(obsbuf)) { 
-              sprintf (Buffer32Bytes, "OBS:N2S[%d]->PUB:OK", sent++);
-              Output (Buffer32Bytes);
-              Serial_writeln (obsbuf);
-
-              // setup for next line in file
-              i = 0;
-
-              // file position is at the start of the next observation or at eof
-              eeprom.n2sfp = fp.position();
-              
-              sprintf (Buffer32Bytes, "OBS:N2S[%d] Contunue", sent);
-              Output (Buffer32Bytes); 
-
-              if(millis() > TimeFromNow) {
-                // need to break out so new obs can be made
-                Output ("OBS:N2S->TIME2EXIT");
-                break;                
-              }
-            }
-            else {
-                sprintf (Buffer32Bytes, "OBS:N2S[%d]->PUB:ERR", sent);
-                Output (Buffer32Bytes);
-                // On transmit failure, stop processing file.
-                break;
-            }
-            
-            // At this point file pointer's position is at the first character of the next line or at eof
-            
-          } // Newline
-          else if (ch == 0x0D) { // CR, LF follows and will trigger the line to be processed       
-            obsbuf[i] = 0; // null terminate then wait for newline to be read to process OBS
-          }
-          else {
-            obsbuf[i++] = ch;
-          }
-
-          // Check for buffer overrun
-          if (i >= MAX_MSGBUF_SIZE) {
-            sprintf (Buffer32Bytes, "OBS:N2S[%d]->BOR:ERR", sent);
-            Output (Buffer32Bytes);
-            fp.close();
-            SD_N2S_Delete(); // Bad data in the file so delete the file           
-            return;
-          }
-        } // end while 
-
-        if (fp.available() <= 20) {
-          // If at EOF or some invalid amount left then delete the file
-          fp.close();
-          SD_N2S_Delete();
-        }
-        else {
-          // At this point we sent 0 or more observations but there was a problem.
-          // eeprom.n2sfp was maintained in the above read loop. So we will close the
-          // file and next time this function is called we will seek to eeprom.n2sfp
-          // and start processing from there forward. 
-          fp.close();
-          EEPROM_Update(); // Update file postion in the eeprom.
-        }
+      obs_bf_day_end = DateTime(dt->tm_year + 1900, dt->tm_mon + 1, dt->tm_mday, 0, 0, 0).unixtime() + 86400UL;
+      if (!SD_LogReadOpen(day, obs_bf_from)) {
+        obs_bf_from = obs_bf_day_end;  // No log that day
       }
+      continue;
     }
-    else {
-        Output ("OBS:N2S->OPEN:ERR");
+
+    pos = SD_lr_pos;
+    int len = SD_LogReadLine(msgbuf, MAX_MSGBUF_SIZE, &ts);
+    if (len == 0) {
+      SD_LogReadClose();
+      if (obs_bf_from < obs_bf_day_end) {
+        obs_bf_from = obs_bf_day_end;
+      }
+      continue;
+    }
+    if ((len < 0) || (ts < obs_bf_from)) {
+      continue;
+    }
+    if (ts > obs_bf_to) {
+      SD_LogReadClose();
+      obs_bf_from = obs_bf_to + 1;
+      continue;
+    }
+
+    if (!OBS_FromLog(msgbuf, ts) || !OBS_Encode() || (obs_rec.bin_len == 0)) {
+      Output ("OBS:BF->BAD:ERR");
+      obs_bf_from = ts + 1;  // Skip it
+      continue;
+    }
+    PL_AddStatusBits(obs_rec.bin, SSB_FROM_N2S);
+
+    if (count == 0) {
+      memcpy(first, obs_rec.bin, obs_rec.bin_len);
+      first_len = obs_rec.bin_len;
+      first_ts = ts;
+      if (cf_n2s_batch && LW_valid) {
+        int max = (LW_MaxPayload() > MAX_OBS_SIZE) ? MAX_OBS_SIZE : LW_MaxPayload();
+        PL_BatchBegin((uint8_t *) obsbuf, max);
+        batch = PL_BatchAdd(first, first_len);
+      }
+    }
+    else if (!PL_BatchAdd(obs_rec.bin, obs_rec.bin_len)) {
+      SD_lr_pos = pos;  // Full or sensors changed, it starts the next frame
+      break;
+    }
+    count++;
+    obs_bf_from = ts + 1;
+    if (!batch) {
+      break;
+    }
+  }
+
+  if (count == 0) {
+    if (!SD_lr_day && (obs_bf_from > obs_bf_to)) {
+      obs_bf_active = false;
+      Output ("OBS:BF Done");
     }
+    OBS_Clear();
+    return;
+  }
+
+  if (count > 1) {
+    obsbuf_len = PL_BatchLen();
+    obsbuf_port = LW_PORT_BATCH;
+  }
+  else if (!PL_Decode(first, first_len) || !OBS_Encode() || !OBS_Build()) {
+    Output ("OBS:BF->BAD:ERR");
+    OBS_Clear();
+    return;
   }
+
+  if (LW_TXQ_Add(obsbuf, obsbuf_len, obsbuf_port, OBS_BF_TxDone, count)) {
+    obs_bf_inflight = true;
+    obs_bf_first = first_ts;
+    sprintf (Buffer32Bytes, "OBS:BF Queued %d", count);
+    Output (Buffer32Bytes);
+  }
+  else {
+    obs_bf_from = first_ts;  // Read it again next time
+    SD_LogReadClose();
+  }
+  OBS_Clear();
 }
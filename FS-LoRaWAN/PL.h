@@ -0,0 +1,440 @@
+/*
+ * ======================================================================================================================
+ *  PL.h - Binary Observation Payload (Schema Versioned)
+ *
+ *  The URL text observation built by OBS_Build() runs 300+ bytes with a full sensor load. That does not fit in a
+ *  LoRaWAN frame at SF9/SF10 and burns airtime at SF7. When lw_binary=1 in CONFIG.TXT the observation is encoded
+ *  with the layout below and sent on LW_PORT_BINARY. Decoder for The Things Network is in Tools/TTN_Decoder.js
+ *  N2S backlog can also be sent several observations to a frame on LW_PORT_BATCH, see PL_BatchAdd().
+ *
+ *  All multi byte fields are big endian.
+ *
+ *  Byte   Size  Field
+ *  0      1     Schema Version (PL_SCHEMA_VERSION)
+ *  1      4     Observation Time - seconds since PL_EPOCH (2024-01-01T00:00:00Z)
+ *  5      2     Battery Voltage * 100
+ *  7      4     System Status Bits (hth)
+ *  11     N     Bitmap of sensors present, bit i set = pl_sensors[i] present. Bit 0 is MSB of first byte.
+ *  11+N   ...   Sensor values in pl_sensors[] order for each bit set. Value = round(observation * scale),
+ *               signed integer of size bytes. Values outside the field's range are clamped, NaN is sent as the
+ *               field's minimum.
+ *
+ *  Size - 19 bytes of header and bitmap then 2 bytes a sensor, 4 for si1 and lx. A 19 sensor station is 57 bytes,
+ *  30 sensors 79 to 83. This misses the 40 byte aim for a typical station, which would have fit US915 DR1 (53
+ *  bytes); fixed width fields cannot get there. It fits DR2 and up, at DR0/DR1 the frame is fragmented, see LW.h,
+ *  and N2S backlog is better sent as a batch which runs 1 to 2 bytes a sensor.
+ *
+ *  NOTE: pl_sensors[] is indexed by the OBS_ID of the observation, so it is in obs_names[] order (OBS.h). A decode
+ *        returns the observation in that order. Only append new sensors to the end of both tables and
+ *        bump PL_SCHEMA_VERSION if an existing entry is changed or the bitmap grows. Add the old sensor count to
+ *        PL_SensorCount() so N2S records saved before the change still decode. Tools/TTN_Decoder.js must be
+ *        kept in sync.
+ *
+ *  Version  Sensors
+ *  1        40, rg1 to wbgt
+ *  2        41, adds slp
+ *  3        50, adds ws2 to wpt
+ *  4        58, adds rr1 to rl2
+ *  5        60, adds dsr and dsq
+ * ======================================================================================================================
+ */
+#define PL_SCHEMA_VERSION   5
+#define PL_EPOCH            1704067200   // 2024-01-01T00:00:00Z
+#define PL_HEADER_SIZE      11           // Version, Time, Battery, Status Bits
+
+typedef struct {
+  int           scale;       // Multiplier applied before converting to an integer
+  int           bytes;       // 2 or 4 byte signed integer on the wire
+} PL_SENSOR_DEF;
+
+// Indexed by OBS_ID, names and types are in obs_names[] in OBS.h
+const PL_SENSOR_DEF pl_sensors[] = {
+  {10,  2},  // rg1      Rain Gauge 1
+  {10,  2},  // rgt1
+  {10,  2},  // rgp1
+  {10,  2},  // rg2      Rain Gauge 2
+  {10,  2},  // rgt2
+  {10,  2},  // rgp2
+  {10,  2},  // ds       Distance Sensor
+  {10,  2},  // ws       Wind
+  {1,   2},  // wd
+  {10,  2},  // wg
+  {1,   2},  // wgd
+  {10,  2},  // bp1      BMX 1
+  {10,  2},  // bt1
+  {10,  2},  // bh1
+  {10,  2},  // bp2      BMX 2
+  {10,  2},  // bt2
+  {10,  2},  // bh2
+  {10,  2},  // hh1      HTU21DF
+  {10,  2},  // ht1
+  {10,  2},  // st1      SHT 1
+  {10,  2},  // sh1
+  {10,  2},  // st2      SHT 2
+  {10,  2},  // sh2
+  {10,  2},  // ht2      HIH8
+  {10,  2},  // hh2
+  {10,  2},  // sv1      SI1145
+  {10,  4},  // si1
+  {10,  2},  // su1
+  {10,  2},  // mt1      MCP 1
+  {10,  2},  // mt2      MCP 2
+  {10,  4},  // lx       VEML7700
+  {1,   2},  // pm1s10   PM25AQI
+  {1,   2},  // pm1s25
+  {1,   2},  // pm1s100
+  {1,   2},  // pm1e10
+  {1,   2},  // pm1e25
+  {1,   2},  // pm1e100
+  {10,  2},  // hi       Derived Observations
+  {10,  2},  // wbt
+  {10,  2},  // wbgt
+  {10,  2},  // slp      Percent of time asleep, see PWR.h
+  {10,  2},  // ws2      Wind averages and peak, see Wind_IntervalUpdate()
+  {1,   2},  // wd2
+  {10,  2},  // ws10
+  {1,   2},  // wd10
+  {10,  2},  // wsi
+  {1,   2},  // wdi
+  {10,  2},  // wp
+  {1,   2},  // wpd
+  {1,   2},  // wpt
+  {10,  2},  // rr1      Rain rate, intensity and tip times, see Rain_IntervalUpdate()
+  {10,  2},  // ri1
+  {1,   2},  // rf1
+  {1,   2},  // rl1
+  {10,  2},  // rr2
+  {10,  2},  // ri2
+  {1,   2},  // rf2
+  {1,   2},  // rl2
+  {1,   2},  // dsr      Distance spread and quality, see DS_Filter()
+  {1,   2}   // dsq
+};
+
+#define PL_SENSOR_COUNT     (sizeof(pl_sensors) / sizeof(pl_sensors[0]))
+#define PL_BITMAP_SIZE      ((PL_SENSOR_COUNT + 7) / 8)
+
+static_assert(PL_SENSOR_COUNT == SID_COUNT, "pl_sensors[] must have an entry for each obs_names[] entry");
+
+/*
+ *=======================================================================================================================
+ * PL_SensorCount() - Return number of pl_sensors[] entries in a payload of schema version, 0 if unknown version
+ *=======================================================================================================================
+ */
+int PL_SensorCount(uint8_t version) {
+  switch (version) {
+    case 1 :
+      return (40);
+    case 2 :
+      return (41);
+    case 3 :
+      return (50);
+    case 4 :
+      return (58);
+    case PL_SCHEMA_VERSION :
+      return (PL_SENSOR_COUNT);
+    default :
+      return (0);
+  }
+}
+
+/*
+ *=======================================================================================================================
+ * PL_PutInt() - Store value big endian in bytes, return bytes used
+ *=======================================================================================================================
+ */
+int PL_PutInt(uint8_t *buf, int32_t value, int bytes) {
+  for (int b=bytes-1; b>=0; b--) {
+    *buf++ = (uint8_t) ((value >> (b*8)) & 0xFF);
+  }
+  return (bytes);
+}
+
+/*
+ *=======================================================================================================================
+ * PL_GetInt() - Return big endian signed value from bytes
+ *=======================================================================================================================
+ */
+int32_t PL_GetInt(uint8_t *buf, int bytes) {
+  uint32_t value = (buf[0] & 0x80) ? 0xFFFFFFFF : 0;   // Sign extend
+
+  for (int b=0; b<bytes; b++) {
+    value = (value << 8) | buf[b];
+  }
+  return ((int32_t) value);
+}
+
+/*
+ *=======================================================================================================================
+ * PL_AddStatusBits() - Turn on bits in the System Status Bits of an encoded record
+ *=======================================================================================================================
+ */
+void PL_AddStatusBits(uint8_t *rec, unsigned long bits) {
+  PL_PutInt(rec+7, (int32_t)((uint32_t) PL_GetInt(rec+7, 4) | bits), 4);
+}
+
+/*
+ *=======================================================================================================================
+ * PL_ScaleValue() - Convert sensor observation to the scaled integer that goes on the wire
+ *=======================================================================================================================
+ */
+int32_t PL_ScaleValue(int s, int p) {
+  double v;
+  int32_t max = (pl_sensors[p].bytes == 2) ? 32767 : 2147483647;
+  int32_t min = -max - 1;
+
+  switch (obs.sensor[s].type) {
+    case F_OBS :
+      v = (double) obs.sensor[s].f_obs * pl_sensors[p].scale;
+      break;
+    case I_OBS :
+      v = (double) obs.sensor[s].i_obs * pl_sensors[p].scale;
+      break;
+    case U_OBS :
+      v = (double) obs.sensor[s].u_obs * pl_sensors[p].scale;
+      break;
+    default : // Should never happen
+      v = 0;
+      break;
+  }
+  if (isnan(v)) {
+    return (min);
+  }
+  v = (v < 0) ? v - 0.5 : v + 0.5;   // Round to nearest
+  if (v >= (double) max) {
+    return (max);
+  }
+  if (v <= (double) min) {
+    return (min);
+  }
+  return ((int32_t) v);
+}
+
+/*
+ *=======================================================================================================================
+ * PL_Encode() - Encode global obs structure in to buf. Return number of bytes or 0 if it did not fit
+ *=======================================================================================================================
+ */
+int PL_Encode(uint8_t *buf, int size) {
+  uint8_t *bitmap = buf + PL_HEADER_SIZE;
+  int slot[PL_SENSOR_COUNT];  // obs.sensor index for each pl_sensors entry, -1 not present
+  int len;
+
+  if (!obs.inuse || (size < (int)(PL_HEADER_SIZE + PL_BITMAP_SIZE))) {
+    return (0);
+  }
+
+  buf[0] = PL_SCHEMA_VERSION;
+  PL_PutInt(buf+1, (int32_t)((uint32_t) obs.ts - PL_EPOCH), 4);
+  PL_PutInt(buf+5, (int32_t)(obs.bv * 100 + 0.5), 2);
+  PL_PutInt(buf+7, (int32_t) obs.hth, 4);
+
+  for (int p=0; p<(int)PL_SENSOR_COUNT; p++) {
+    slot[p] = -1;
+  }
+  for (int s=0; s<MAX_SENSORS; s++) {
+    if (OBS_Present(s)) {
+      slot[obs.sensor[s].id] = s;   // id is the pl_sensors[] index
+    }
+  }
+
+  memset(bitmap, 0, PL_BITMAP_SIZE);
+  len = PL_HEADER_SIZE + PL_BITMAP_SIZE;
+  for (int p=0; p<(int)PL_SENSOR_COUNT; p++) {
+    if (slot[p] >= 0) {
+      if ((len + pl_sensors[p].bytes) > size) {
+        Output ("PL:Overflow");
+        return (0);
+      }
+      bitmap[p/8] |= (0x80 >> (p%8));
+      len += PL_PutInt(buf+len, PL_ScaleValue(slot[p], p), pl_sensors[p].bytes);
+    }
+  }
+  return (len);
+}
+
+/*
+ *=======================================================================================================================
+ * PL_Decode() - Decode buf in to global obs structure. Return false if payload is not valid
+ *=======================================================================================================================
+ */
+bool PL_Decode(uint8_t *buf, int len) {
+  uint8_t *bitmap = buf + PL_HEADER_SIZE;
+  int count = (len > 0) ? PL_SensorCount(buf[0]) : 0;
+  int pos = PL_HEADER_SIZE + ((count + 7) / 8);
+  int sidx = 0;
+
+  OBS_Clear();
+  if ((count == 0) || (len < pos)) {
+    return (false);
+  }
+
+  obs.ts  = (time_t) ((uint32_t) PL_GetInt(buf+1, 4) + PL_EPOCH);
+  obs.bv  = (float) ((uint16_t) PL_GetInt(buf+5, 2)) / 100.0;
+  obs.hth = (unsigned long) PL_GetInt(buf+7, 4);
+
+  for (int p=0; p<count; p++) {
+    if (bitmap[p/8] & (0x80 >> (p%8))) {
+      if (((pos + pl_sensors[p].bytes) > len) || (sidx >= MAX_SENSORS)) {
+        OBS_Clear();
+        return (false);
+      }
+      int32_t v = PL_GetInt(buf+pos, pl_sensors[p].bytes);
+      pos += pl_sensors[p].bytes;
+
+      SENSOR *sensor = OBS_Add(&sidx, p, obs_names[p].type);
+      switch (sensor->type) {
+        case F_OBS :
+          sensor->f_obs = (float) v / pl_sensors[p].scale;
+          break;
+        case I_OBS :
+          sensor->i_obs = (int) (v / pl_sensors[p].scale);
+          break;
+        case U_OBS :
+          sensor->u_obs = (unsigned long) (v / pl_sensors[p].scale);
+          break;
+      }
+    }
+  }
+  obs.inuse = true;
+  return (true);
+}
+
+/*
+ * ======================================================================================================================
+ *  Batch Payload - Several N2S observations packed in to one LW_PORT_BATCH frame during backlog catch up
+ *
+ *  Observations in a batch share the sensor bitmap. Values are sent as the difference from the previous observation,
+ *  which for one minute weather data is usually 0 or a few counts and fits in a single byte.
+ *
+ *  Byte   Size  Field
+ *  0      1     Schema Version (PL_SCHEMA_VERSION)
+ *  1      1     Observation count
+ *  2      4     Time of first observation - seconds since PL_EPOCH
+ *  6      2     Battery Voltage * 100 of first observation
+ *  8      4     System Status Bits (hth), OR of all observations in the batch
+ *  12     N     Bitmap of sensors present, same layout as PL_Encode()
+ *  12+N   ...   For each observation: seconds since the previous observation (0 for the first), then for each bit
+ *               set the scaled value minus the previous observation's scaled value (previous is 0 for the first).
+ *               Each field is a zigzag encoded base 128 varint, low 7 bits first, high bit set if more follow.
+ * ======================================================================================================================
+ */
+#define PL_BATCH_HEADER_SIZE  12
+#define PL_BATCH_MAX_COUNT    255
+
+uint8_t  *pl_batch_buf;                       // Frame being built
+int      pl_batch_size;                       // Size of pl_batch_buf
+int      pl_batch_len;                        // Bytes used in pl_batch_buf
+int      pl_batch_count;                      // Observations in the batch
+uint32_t pl_batch_ts;                         // Time of last observation added
+int32_t  pl_batch_value[PL_SENSOR_COUNT];     // Scaled values of last observation added
+
+/*
+ *=======================================================================================================================
+ * PL_PutVarint() - Store zigzag varint of value in buf. Return bytes used or 0 if it would go past end
+ *=======================================================================================================================
+ */
+int PL_PutVarint(uint8_t *buf, uint8_t *end, int32_t value) {
+  uint32_t v = ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);  // Zigzag, small negatives stay small
+  int len = 0;
+
+  do {
+    if (buf+len >= end) {
+      return (0);
+    }
+    buf[len++] = (v & 0x7F) | ((v > 0x7F) ? 0x80 : 0);
+    v >>= 7;
+  } while (v);
+  return (len);
+}
+
+/*
+ *=======================================================================================================================
+ * PL_BatchBegin() - Start a new batch in buf
+ *=======================================================================================================================
+ */
+void PL_BatchBegin(uint8_t *buf, int size) {
+  pl_batch_buf = buf;
+  pl_batch_size = size;
+  pl_batch_len = 0;
+  pl_batch_count = 0;
+}
+
+/*
+ *=======================================================================================================================
+ * PL_BatchAdd() - Add a PL_Encode() payload to the batch. Return false, leaving the batch unchanged, if it does not
+ *                 fit, its sensors differ from the batch or it is not a valid payload.
+ *=======================================================================================================================
+ */
+bool PL_BatchAdd(uint8_t *rec, int len) {
+  uint8_t bitmap[PL_BITMAP_SIZE];  // Record's bitmap at the current size, older versions have fewer sensors
+  uint8_t *end = pl_batch_buf + pl_batch_size;
+  int32_t value[PL_SENSOR_COUNT];
+  uint32_t ts;
+  int count = (len > 0) ? PL_SensorCount(rec[0]) : 0;
+  int rpos = PL_HEADER_SIZE + ((count + 7) / 8);
+  int pos, n;
+
+  if ((count == 0) || (len < rpos) || (pl_batch_count >= PL_BATCH_MAX_COUNT)) {
+    return (false);
+  }
+  memset(bitmap, 0, PL_BITMAP_SIZE);
+  memcpy(bitmap, rec + PL_HEADER_SIZE, (count + 7) / 8);
+  ts = (uint32_t) PL_GetInt(rec+1, 4);
+
+  if (pl_batch_count == 0) {
+    if (pl_batch_size < (int)(PL_BATCH_HEADER_SIZE + PL_BITMAP_SIZE)) {
+      return (false);
+    }
+    pl_batch_buf[0] = PL_SCHEMA_VERSION;
+    pl_batch_buf[1] = 0;
+    memcpy (pl_batch_buf+2, rec+1, 10);   // Time, Battery, Status Bits
+    memcpy (pl_batch_buf+PL_BATCH_HEADER_SIZE, bitmap, PL_BITMAP_SIZE);
+    pl_batch_len = PL_BATCH_HEADER_SIZE + PL_BITMAP_SIZE;
+    pl_batch_ts = ts;
+    memset(pl_batch_value, 0, sizeof(pl_batch_value));
+  }
+  else if (memcmp(pl_batch_buf+PL_BATCH_HEADER_SIZE, bitmap, PL_BITMAP_SIZE) != 0) {
+    return (false);
+  }
+
+  // Encode after the last observation, only committed if it all fits
+  pos = pl_batch_len;
+  if ((n = PL_PutVarint(pl_batch_buf+pos, end, (int32_t)(ts - pl_batch_ts))) == 0) {
+    return (false);
+  }
+  pos += n;
+  for (int p=0; p<(int)PL_SENSOR_COUNT; p++) {
+    if (bitmap[p/8] & (0x80 >> (p%8))) {
+      if ((rpos + pl_sensors[p].bytes) > len) {
+        return (false);
+      }
+      value[p] = PL_GetInt(rec+rpos, pl_sensors[p].bytes);
+      rpos += pl_sensors[p].bytes;
+      if ((n = PL_PutVarint(pl_batch_buf+pos, end, value[p] - pl_batch_value[p])) == 0) {
+        return (false);
+      }
+      pos += n;
+    }
+  }
+
+  for (int p=0; p<(int)PL_SENSOR_COUNT; p++) {
+    if (bitmap[p/8] & (0x80 >> (p%8))) {
+      pl_batch_value[p] = value[p];
+    }
+  }
+  PL_PutInt(pl_batch_buf+8, PL_GetInt(pl_batch_buf+8, 4) | PL_GetInt(rec+7, 4), 4);
+  pl_batch_buf[1] = ++pl_batch_count;
+  pl_batch_len = pos;
+  pl_batch_ts = ts;
+  return (true);
+}
+
+/*
+ *=======================================================================================================================
+ * PL_BatchLen() - Return bytes in the batch
+ *=======================================================================================================================
+ */
+int PL_BatchLen() {
+  return (pl_batch_len);
+}
@@ -0,0 +1,224 @@
+/*
+ * ======================================================================================================================
+ *  PWR.h - Low Power Sleep Between Scheduler Tasks
+ *
+ *  loop() calls PWR_Sleep() after BackGroundWork(). It sleeps until the next scheduler task is due, controlled by
+ *  pwr_mode in CONFIG.TXT.
+ *
+ *    0 - PWR_AWAKE   Never sleep, loop() spins as before.
+ *    1 - PWR_IDLE    CPU is stopped with WFI. Clocks keep running so millis(), USB and the SysTick wake up every
+ *                    ms are unaffected. Safe with the Serial Console.
+ *    2 - PWR_STANDBY Standby via RTCZero when nothing needs the CPU for PWR_STANDBY_MIN ms or more, otherwise idle.
+ *                    The RTC is run as a 1024Hz counter from the 32.768kHz crystal and ends the sleep. The EIC is
+ *                    moved to the same clock so anemometer and rain gauge interrupts still wake us.
+ *
+ *  SysTick stops in standby, so millis() is stepped forward by the time slept before interrupts are let back in.
+ *  The core has no API for that. SysTick_DefaultHandler() in cores/arduino/delay.c counts one millis() tick, it is
+ *  core private, so it is only used when the core identifies as ARDUINO_SAMD_VARIANT_COMPLIANCE 10610 or later, the
+ *  Arduino SAMD 1.6.x layout the Adafruit SAMD core follows. With any other core pwr_mode=2 falls back to idle.
+ *  Standby is not used while the Serial Console is enabled (USB does not survive it) or when LMIC is joining,
+ *  transmitting or has a job due before we would wake.
+ *
+ *  Time asleep is accumulated and reported as the "slp" observation, percent of time asleep since the last
+ *  observation. See PWR_DutyCycle().
+ * ======================================================================================================================
+ */
+#include <RTCZero.h>
+
+#define PWR_AWAKE           0
+#define PWR_IDLE            1
+#define PWR_STANDBY         2
+
+#define PWR_STANDBY_MIN     20      // ms, shorter waits are done in idle
+#define PWR_MAX_SLEEP       1000    // ms, longest sleep if no task is armed
+
+#if defined(ARDUINO_ARCH_SAMD) && defined(ARDUINO_SAMD_VARIANT_COMPLIANCE) && (ARDUINO_SAMD_VARIANT_COMPLIANCE >= 10610)
+#define PWR_CORE_SYSTICK
+extern "C" void SysTick_DefaultHandler(void);  // Arduino core, counts one millis() tick
+#endif
+
+RTCZero pwr_rtc;
+bool pwr_standby_ok = false;        // RTC counter and EIC clock set up for standby
+unsigned long pwr_sleep_us = 0;     // Time asleep since the last PWR_DutyCycle() call
+unsigned long pwr_stime = 0;        // millis() of the last PWR_DutyCycle() call
+uint32_t pwr_rtc_rem = 0;           // Standby time not yet added to millis(), in 1/1024000 s
+
+/*
+ * ======================================================================================================================
+ * PWR_RTCCount() - Read the 1024Hz RTC counter
+ * ======================================================================================================================
+ */
+uint32_t PWR_RTCCount() {
+  RTC->MODE0.READREQ.reg = RTC_READREQ_RREQ;
+  while (RTC->MODE0.STATUS.bit.SYNCBUSY);
+  return (RTC->MODE0.COUNT.reg);
+}
+
+/*
+ * ======================================================================================================================
+ * PWR_StandbySetup() - RTC as a 1024Hz counter and the EIC on the crystal clock so pins still wake us in standby
+ * ======================================================================================================================
+ */
+#ifdef PWR_CORE_SYSTICK
+void PWR_StandbySetup() {
+  pwr_rtc.begin(); // Crystal on GCLK2 at 1024Hz, RTC interrupt handler
+
+  // Replace the calendar with a 32 bit counter so a sleep can end on a ms deadline
+  RTC->MODE0.CTRL.reg &= ~RTC_MODE0_CTRL_ENABLE;
+  while (RTC->MODE0.STATUS.bit.SYNCBUSY);
+  RTC->MODE0.CTRL.reg = RTC_MODE0_CTRL_SWRST;
+  while (RTC->MODE0.CTRL.reg & RTC_MODE0_CTRL_SWRST);
+  RTC->MODE0.CTRL.reg = RTC_MODE0_CTRL_MODE_COUNT32 | RTC_MODE0_CTRL_PRESCALER_DIV1;
+  while (RTC->MODE0.STATUS.bit.SYNCBUSY);
+  RTC->MODE0.INTENSET.reg = RTC_MODE0_INTENSET_CMP0;
+  RTC->MODE0.CTRL.reg |= RTC_MODE0_CTRL_ENABLE;
+  while (RTC->MODE0.STATUS.bit.SYNCBUSY);
+
+  // EIC normally runs from the 48MHz clock which stops in standby, edges would be missed
+  GCLK->CLKCTRL.reg = GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK2 | GCLK_CLKCTRL_ID_EIC;
+  while (GCLK->STATUS.bit.SYNCBUSY);
+
+  if (AS5600_exists) {
+    EIC->WAKEUP.reg |= (1 << g_APinDescription[ANEMOMETER_IRQ_PIN].ulExtInt);
+  }
+  if (cf_rg1_enable) {
+    EIC->WAKEUP.reg |= (1 << g_APinDescription[RAINGAUGE1_IRQ_PIN].ulExtInt);
+  }
+  if (cf_rg2_enable) {
+    EIC->WAKEUP.reg |= (1 << g_APinDescription[RAINGAUGE2_IRQ_PIN].ulExtInt);
+  }
+  pwr_standby_ok = true;
+}
+#endif
+
+/*
+ * ======================================================================================================================
+ * PWR_Initialize() - Set up sleep for cf_pwr_mode. Call after all attachInterrupt() calls, they reset the EIC clock.
+ * ======================================================================================================================
+ */
+void PWR_Initialize() {
+  Output ("PWR:Init()");
+
+  SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;  // WFI is idle unless PWR_Standby() asks for more
+  PM->SLEEP.reg = PM_SLEEP_IDLE_CPU;
+
+  if (cf_pwr_mode == PWR_STANDBY) {
+#ifdef PWR_CORE_SYSTICK
+    PWR_StandbySetup();
+#else
+    Output ("PWR:Standby N/A");   // Can not step millis() on this core, idle only
+#endif
+  }
+  pwr_sleep_us = 0;
+  pwr_stime = millis();
+}
+
+/*
+ * ======================================================================================================================
+ * PWR_LMIC_Busy() - Return true if LMIC needs os_runloop_once() called within ms
+ * ======================================================================================================================
+ */
+bool PWR_LMIC_Busy(unsigned long ms) {
+  if (!LW_valid) {
+    return (false);
+  }
+  if (LMIC.opmode & (OP_TXDATA | OP_TXRXPEND | OP_JOINING)) {
+    return (true);  // Radio is polled, not on interrupts
+  }
+  return (os_queryTimeCriticalJobs(ms2osticks(ms)) != 0);
+}
+
+/*
+ * ======================================================================================================================
+ * PWR_Idle() - Stop the CPU for ms. SysTick wakes us every ms so millis() stays correct.
+ * ======================================================================================================================
+ */
+void PWR_Idle(unsigned long ms) {
+  unsigned long start = micros();
+  unsigned long us = ms * 1000;
+  unsigned long slept;
+
+  while ((slept = micros() - start) < us) {
+    __WFI();
+  }
+  pwr_sleep_us += slept;
+}
+
+/*
+ * ======================================================================================================================
+ * PWR_Standby() - Standby until the RTC counter reaches ms from now or an interrupt wakes us.
+ * ======================================================================================================================
+ */
+void PWR_Standby(unsigned long ms) {
+  uint32_t start, ticks, elapsed;
+
+  __disable_irq(); // Interrupts still wake us but handlers wait until millis() is right
+
+  start = PWR_RTCCount();
+  RTC->MODE0.COMP[0].reg = start + ((ms * 1024) / 1000);
+  while (RTC->MODE0.STATUS.bit.SYNCBUSY);
+  RTC->MODE0.INTFLAG.reg = RTC_MODE0_INTFLAG_CMP0;
+
+  pwr_rtc.standbyMode();
+  SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+
+  ticks = PWR_RTCCount() - start;
+  elapsed = (ticks * 1000) + pwr_rtc_rem;  // 1/1024000 s
+  pwr_rtc_rem = elapsed % 1024;
+  elapsed /= 1024;                         // ms
+#ifdef PWR_CORE_SYSTICK
+  for (uint32_t i=0; i<elapsed; i++) {
+    SysTick_DefaultHandler();
+  }
+#endif
+  pwr_sleep_us += elapsed * 1000;
+
+  __enable_irq();
+}
+
+/*
+ * ======================================================================================================================
+ * PWR_Sleep() - Sleep until the next scheduler task is due
+ * ======================================================================================================================
+ */
+void PWR_Sleep() {
+  unsigned long ms;
+
+  if (cf_pwr_mode == PWR_AWAKE) {
+    return;
+  }
+
+  ms = SCH_NextDeadline(PWR_MAX_SLEEP);
+  if (ms == 0) {
+    return;
+  }
+
+  if (PWR_LMIC_Busy(ms)) {
+    PWR_Idle(1);  // Back to os_runloop_once() on the next tick
+  }
+  else if (pwr_standby_ok && !SerialConsoleEnabled && (ms >= PWR_STANDBY_MIN)) {
+    PWR_Standby(ms);
+  }
+  else {
+    PWR_Idle(ms);
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * PWR_DutyCycle() - Return percent of time asleep since the last call and start a new period
+ * ======================================================================================================================
+ */
+float PWR_DutyCycle() {
+  unsigned long now = millis();
+  unsigned long period = now - pwr_stime;
+  float pct;
+
+  pct = (period) ? (float) (pwr_sleep_us / 1000) * 100.0 / period : 0.0;
+  if (pct > 100.0) {
+    pct = 100.0;
+  }
+  pwr_sleep_us = 0;
+  pwr_stime = now;
+  return (pct);
+}
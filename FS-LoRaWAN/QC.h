@@ -55,3 +55,8 @@
 #define QC_MIN_RG      0         // mm
 #define QC_MAX_RG      30.0      // mm based on the world-record 1-minute rainfall in Maryland in 1956 (31.24 mm or 1.23")
 #define QC_ERR_RG      -999.9    // Rain Gauge Error
+
+// Rain Rate and Intensity
+#define QC_MIN_RR      0.0       // mm/hr
+#define QC_MAX_RR      1800.0    // mm/hr, QC_MAX_RG in 1 minute
+#define QC_ERR_RR      -999.9    // Rain Rate Error
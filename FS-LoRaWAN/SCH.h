@@ -0,0 +1,170 @@
+/*
+ * ======================================================================================================================
+ *  SCH.h - Cooperative Task Scheduler
+ *
+ *  Tasks are registered with SCH_AddTask() and run from SCH_Run() when their deadline passes. A periodic task's next
+ *  deadline is its last deadline plus its period, so tasks do not drift when a run is late. A task with a period of
+ *  0 runs once, then waits until it is given a new deadline with SCH_SetDeadline() or SCH_Delay().
+ *
+ *  Tasks must not block. Each task keeps how many times it ran, how late it ran and how many periods it missed.
+ *
+ *  Time comes from sch_clock, millis() on the board. Point it at a fake clock to run the scheduler on a host.
+ * ======================================================================================================================
+ */
+#define SCH_MAX_TASKS       16
+
+typedef void (*SCH_FUNCTION)();
+
+typedef struct {
+  const char    *name;           // Short name for SCH_Dump()
+  SCH_FUNCTION  function;        // Task to run
+  unsigned long period;          // ms between runs, 0 = run once per deadline
+  unsigned long deadline;        // sch_clock() time of next run
+  bool          enabled;         // Only enabled tasks with a deadline are run
+  bool          armed;           // Has a deadline
+  unsigned long runs;            // Times run
+  unsigned long late_max;        // Most ms a run started after its deadline
+  unsigned long late_sum;        // Sum of ms late, for the average
+  unsigned long skips;           // Periods missed because the task ran more than a period late
+} SCH_TASK;
+
+SCH_TASK sch_tasks[SCH_MAX_TASKS];
+int sch_task_count = 0;
+unsigned long (*sch_clock)() = millis;
+
+/*
+ * ======================================================================================================================
+ * SCH_AddTask() - Register task. First run is delay ms from now. Return task id or -1 if the table is full
+ * ======================================================================================================================
+ */
+int SCH_AddTask(const char *name, SCH_FUNCTION function, unsigned long period, unsigned long delay, bool enabled) {
+  SCH_TASK *t;
+
+  if (sch_task_count >= SCH_MAX_TASKS) {
+    Output ("SCH:Full");
+    return (-1);
+  }
+  t = &sch_tasks[sch_task_count];
+  t->name = name;
+  t->function = function;
+  t->period = period;
+  t->deadline = sch_clock() + delay;
+  t->enabled = enabled;
+  t->armed = true;
+  t->runs = 0;
+  t->late_max = 0;
+  t->late_sum = 0;
+  t->skips = 0;
+  return (sch_task_count++);
+}
+
+/*
+ * ======================================================================================================================
+ * SCH_SetDeadline() - Set time (sch_clock() based) task next runs
+ * ======================================================================================================================
+ */
+void SCH_SetDeadline(int id, unsigned long deadline) {
+  if ((id >= 0) && (id < sch_task_count)) {
+    sch_tasks[id].deadline = deadline;
+    sch_tasks[id].armed = true;
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * SCH_Delay() - Set task to next run ms from now
+ * ======================================================================================================================
+ */
+void SCH_Delay(int id, unsigned long ms) {
+  SCH_SetDeadline(id, sch_clock() + ms);
+}
+
+/*
+ * ======================================================================================================================
+ * SCH_Enable() - Enable or disable task. Its deadline is kept.
+ * ======================================================================================================================
+ */
+void SCH_Enable(int id, bool enabled) {
+  if ((id >= 0) && (id < sch_task_count)) {
+    sch_tasks[id].enabled = enabled;
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * SCH_Run() - Run every task whose deadline has passed, in the order they were added
+ * ======================================================================================================================
+ */
+void SCH_Run() {
+  for (int id=0; id<sch_task_count; id++) {
+    SCH_TASK *t = &sch_tasks[id];
+    unsigned long now = sch_clock();
+    unsigned long late;
+
+    if (!t->enabled || !t->armed || ((long)(now - t->deadline) < 0)) {
+      continue;
+    }
+
+    late = now - t->deadline;
+    if (late > t->late_max) {
+      t->late_max = late;
+    }
+    t->late_sum += late;
+    t->runs++;
+
+    // Set the next deadline before running so the task can change it
+    if (t->period) {
+      if (late >= t->period) {
+        t->skips += late / t->period;
+        t->deadline = now + t->period;   // Fell behind, start over from now
+      }
+      else {
+        t->deadline += t->period;
+      }
+    }
+    else {
+      t->armed = false;
+    }
+    t->function();
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * SCH_NextDeadline() - ms until the next enabled task is due, 0 if one is due now, max if none are armed
+ * ======================================================================================================================
+ */
+unsigned long SCH_NextDeadline(unsigned long max) {
+  unsigned long now = sch_clock();
+  unsigned long next = max;
+
+  for (int id=0; id<sch_task_count; id++) {
+    SCH_TASK *t = &sch_tasks[id];
+
+    if (t->enabled && t->armed) {
+      if ((long)(t->deadline - now) <= 0) {
+        return (0);
+      }
+      if ((t->deadline - now) < next) {
+        next = t->deadline - now;
+      }
+    }
+  }
+  return (next);
+}
+
+/*
+ * ======================================================================================================================
+ * SCH_Dump() - Output task run counts and timing. Late times are ms past the deadline.
+ * ======================================================================================================================
+ */
+void SCH_Dump() {
+  Output ("SCH DUMP");
+  for (int id=0; id<sch_task_count; id++) {
+    SCH_TASK *t = &sch_tasks[id];
+
+    sprintf (msgbuf, " %s R:%lu L:%lu/%lu S:%lu", t->name, t->runs,
+      (t->runs) ? t->late_sum / t->runs : 0, t->late_max, t->skips);
+    Output (msgbuf);
+  }
+}
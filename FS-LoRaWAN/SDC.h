@@ -9,6 +9,7 @@
 #define KEY_MAX_LENGTH    30                // Config File Key Length
 #define VALUE_MAX_LENGTH  30                // Config File Value Length
 #define LINE_MAX_LENGTH   VALUE_MAX_LENGTH+KEY_MAX_LENGTH+3   // =, CR, LF 
+#define SD_BLOCKSZ        512               // SD sector size
 
 
 // SdFat SD;                                // File system object.
@@ -16,8 +17,104 @@
 File SD_fp;
 char SD_obsdir[] = "/OBS";                  // Observations stored in this directory. Created at power on if not exist
 bool SD_exists = false;                     // Set to true if SD card found at boot
-char SD_n2s_file[] = "N2SOBS.TXT";          // Need To Send Observation file
-uint32_t SD_n2s_max_filesz = 512 * 60 * 24; // Keep a little over 1 day. When it fills, it is deleted and we start over.
+char SD_n2s_file[] = "N2SOBS.BIN";          // Need To Send Observation ring file
+
+/*
+ * ======================================================================================================================
+ *  Observation Log Writer
+ *
+ *  The day's log file stays open. Lines are gathered in SD_log_buf and handed to the SD library a sector at a time,
+ *  each chunk is sized to end on a sector boundary of the file. Whole aligned sectors are written straight to the
+ *  card, the directory entry is only updated by SD_LogSync(), which runs every cf_sd_sync seconds, when the file rolls
+ *  at UTC midnight and before a reboot. A power loss loses at most the lines logged since the last sync, the N2S ring
+ *  is flushed on every record and is unaffected. cf_sd_sync defaults to 0, a sync after every observation, so a power
+ *  loss loses no lines as with the open and close per line. A longer sd_sync is a choice to lose up to that many
+ *  seconds of the log for fewer card writes.
+ *  A sync writes the sector the data ends in, so a cf_sd_sync no longer than the observation interval writes about as
+ *  many sectors as opening and closing the file did and saves only the directory updates, see Tools/test/sdlog_sim.cpp.
+ *
+ *  Preallocation
+ *    A new day's file is created in one contiguous run of clusters, so appending never searches or updates the FAT
+ *    and months of logs do not fragment the card. It is sized by SD_LogPrealloc() for a day of observations at the
+ *    configured interval, each SD_LOG_SLACK bytes longer than the line that opens the day, about 640 KB at 1 minute
+ *    and 43 KB at 15 minutes for 380 byte lines. SD_log_end is the end of the data, a sync pads the rest of its
+ *    sector with NULs and saves the end in EEPROM. When a day's file is reopened after a reboot the end is taken from
+ *    EEPROM if it checks out, otherwise it is the first NUL in the file. The file is truncated to the end at
+ *    rollover. If the card has no free run that long the file grows as before. A day that logs more than was
+ *    preallocated just grows past it.
+ *
+ *  Index
+ *    /OBS/YYYYMMDD.idx holds the observation time and log file offset of the first line after the log is opened
+ *    and of every SD_IDX_EVERY lines after that, SD_IDX_ENTRY bytes each, both 32 bit big endian. Entries are held
+ *    in RAM and appended after the lines they point at have been synced. SD_LogReadOpen() binary searches it so a
+ *    time range is found by reading a few sectors instead of the whole day's log, see OBS_BF_Publish().
+ * ======================================================================================================================
+ */
+#define SD_LOG_SLACK        16                  // Bytes a line may grow over the day's first, values get more digits
+#define SD_LOG_EXTRA        8                   // 1 in 8 more lines than the interval gives, reboots and GPS delays
+#define SD_LOG_OPEN         (O_READ | O_WRITE)  // Not FILE_WRITE, O_APPEND would write past the preallocated end
+#define SD_IDX_EVERY        16                  // Log lines per index entry
+#define SD_IDX_PENDING      8                   // Index entries held until the next sync
+#define SD_IDX_ENTRY        8                   // Bytes per index entry, time then offset
+
+File SD_log_fp;                             // Open log file
+long SD_log_day = 0;                        // Day of the open log file as yyyymmdd, 0 none open
+char SD_log_buf[SD_BLOCKSZ];                // Lines not yet handed to the SD library
+int SD_log_len = 0;                         // Bytes in SD_log_buf
+uint32_t SD_log_end = 0;                    // File offset of SD_log_buf[0], end of the data on the card
+unsigned long SD_log_synced = 0;            // millis() of last sync
+int SD_log_lines = 0;                       // Lines logged since the log was opened
+uint32_t SD_idx_ts[SD_IDX_PENDING];         // Index entries not yet written, observation time
+uint32_t SD_idx_pos[SD_IDX_PENDING];        // and offset of its line
+int SD_idx_len = 0;                         // Entries in SD_idx_ts and SD_idx_pos
+
+File SD_lr_fp;                              // Log being read back, see SD_LogReadOpen()
+long SD_lr_day = 0;                         // Day of the log being read as yyyymmdd, 0 none open
+uint32_t SD_lr_pos = 0;                     // Offset of the next line to read
+uint32_t SD_lr_end = 0;                     // End of its data, the open day's follows SD_log_end
+
+File SD_ar_fp;                              // Archive file, open while a block is written, see AR.h
+
+/*
+ * ======================================================================================================================
+ *  Need To Send (N2S) Ring File
+ *
+ *  N2SOBS.BIN is preallocated to SD_N2S_RECORDS fixed size records. Record seq is stored in slot (seq % SD_N2S_RECORDS).
+ *  eeprom.n2s_head is the sequence number of the next record to write, eeprom.n2s_tail the oldest record not yet sent.
+ *  Records are SD_N2S_RECSZ bytes so they never straddle a 512 byte SD sector, adding or removing a record is a single
+ *  sector write. When the ring is full the oldest record is overwritten.
+ *
+ *  Record Layout
+ *    Byte 0-3   Sequence number, little endian
+ *    Byte 4-5   Payload length
+ *    Byte 6-7   Checksum, 16 bit sum of sequence, length and payload bytes
+ *    Byte 8-N   Payload - PL_Encode() binary observation, see PL.h
+ *
+ *  Power Loss
+ *    The record is written and flushed to the card before the head is moved in EEPROM. A record whose sequence number
+ *    or checksum does not match what is expected is skipped. If the EEPROM pointers are lost the ring is scanned and
+ *    the pointers rebuilt from the sequence numbers in the records, see SD_N2S_Recover().
+ * ======================================================================================================================
+ */
+#define SD_N2S_RECSZ        256             // Bytes per record, must divide 512
+#define SD_N2S_HDRSZ        8               // Record header size
+#define SD_N2S_RECORDS      1440            // 1 day of 1 minute observations
+#define SD_N2S_MAXPL        (SD_N2S_RECSZ - SD_N2S_HDRSZ)
+#define SD_N2S_OPEN         (O_READ | O_WRITE | O_CREAT)  // Not FILE_WRITE, O_APPEND would ignore our seeks
+
+// N2S drain policy - cf_n2s_policy
+#define N2S_FIFO            0               // Oldest first
+#define N2S_LIFO            1               // Newest first
+#define N2S_LATEST          2               // Newest once, then backfill oldest first
+
+bool SD_n2s_valid = false;                  // Set when the ring file is preallocated and pointers are sane
+
+// N2S Reader - Records are read a whole sector at a time in to SD_n2s_block. Sequential reads of the ring then
+// cost one SD read per SD_BLOCKSZ/SD_N2S_RECSZ records. The file stays open until SD_N2S_ReadClose().
+File SD_n2s_rfp;                            // N2S reader file
+File SD_n2s_wfp;                            // N2S writer file, opened on first add and kept open, see SD_N2S_WriteClose()
+uint8_t SD_n2s_block[SD_BLOCKSZ];           // Last sector read from the ring file
+long SD_n2s_blocknum = -1;                  // Sector held in SD_n2s_block, -1 none
 
 /* 
  * =======================================================================================================================
@@ -56,12 +153,267 @@ void SD_initialize() {
 
 /* 
  * =======================================================================================================================
- * SD_LogObservation() - Call rtc_timestamp() prior to set now variable
+ * SD_LogIndexWrite() - Append the pending index entries to the open log's index file. Return false on error
  * =======================================================================================================================
  */
-void SD_LogObservation(char *observations) {
-  char SD_logfile[24];
+bool SD_LogIndexWrite() {
+  char SD_idxfile[24];
+  uint8_t entry[SD_IDX_ENTRY];
   File fp;
+  bool ok = true;
+
+  sprintf (SD_idxfile, "%s/%08ld.idx", SD_obsdir, SD_log_day);
+  fp = SD.open(SD_idxfile, FILE_WRITE);
+  if (!fp) {
+    SD_idx_len = 0;
+    return (false);
+  }
+  for (int i=0; ok && (i<SD_idx_len); i++) {
+    for (int b=0; b<4; b++) {
+      entry[b] = SD_idx_ts[i] >> (24 - (b * 8));
+      entry[b+4] = SD_idx_pos[i] >> (24 - (b * 8));
+    }
+    ok = (fp.write(entry, SD_IDX_ENTRY) == SD_IDX_ENTRY);
+  }
+  fp.close();
+  SD_idx_len = 0;
+  return (ok);
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_LogSync() - Hand buffered lines to the SD library and update the directory entry. Return false on error
+ * =======================================================================================================================
+ */
+bool SD_LogSync() {
+  bool ok = true;
+
+  if (!SD_log_fp) {
+    return (false);
+  }
+
+  // Disable LoRA SPI0 Chip Select
+  pinMode(LORA_SS, OUTPUT);
+  digitalWrite(LORA_SS, HIGH);
+
+  if (SD_log_len) {
+    int n = SD_log_len;
+
+    // Inside the preallocation write the whole sector, NULs after the data mark the end
+    if ((SD_log_end + SD_BLOCKSZ - (SD_log_end % SD_BLOCKSZ)) <= SD_log_fp.size()) {
+      n = SD_BLOCKSZ - (SD_log_end % SD_BLOCKSZ);
+      memset (SD_log_buf + SD_log_len, 0, n - SD_log_len);
+    }
+    ok = (SD_log_fp.write((uint8_t *)SD_log_buf, n) == (size_t)n);
+    SD_log_end += SD_log_len;
+    SD_log_len = 0;
+    ok = SD_log_fp.seek(SD_log_end) && ok;
+  }
+  SD_log_fp.flush();
+  SD_log_synced = millis();
+
+  // Only once the lines they point at are on the card
+  if (SD_idx_len) {
+    ok = ok && SD_LogIndexWrite();
+    SD_idx_len = 0;
+  }
+
+  if ((eeprom.log_day != (uint32_t)SD_log_day) || (eeprom.log_end != SD_log_end)) {
+    eeprom.log_day = SD_log_day;
+    eeprom.log_end = SD_log_end;
+    EEPROM_Update();
+  }
+  return (ok);
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_LogClose() - Sync and close the log file. With trim the preallocation past the data is released, do this when
+ *                 the day is over. Without, the file can be reopened and added to, call before a reboot.
+ * =======================================================================================================================
+ */
+void SD_LogClose(bool trim) {
+  if (SD_log_fp) {
+    SD_LogSync();
+    if (trim) {
+      if ((SD_log_fp.size() > SD_log_end) && !SD_log_fp.truncate(SD_log_end)) {
+        Output ("SD:Log Trim ERR");
+      }
+      eeprom.log_day = 0;
+      eeprom.log_end = 0;
+      EEPROM_Update();
+    }
+    SD_log_fp.close();
+  }
+  SD_log_day = 0;
+  SD_log_len = 0;
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_LogPrealloc() - Bytes to preallocate for a day's log of len byte lines at the observation interval, whole sectors
+ * =======================================================================================================================
+ */
+uint32_t SD_LogPrealloc(int len) {
+  uint32_t lines = 86400 / CF_ObsInterval();
+  uint32_t size;
+
+  lines += lines / SD_LOG_EXTRA;
+  size = lines * (uint32_t)(len + SD_LOG_SLACK);
+  return (size + SD_BLOCKSZ - (size % SD_BLOCKSZ));
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_LogFindEnd() - Return the end of the data in log file fp for day yyyymmdd. The scan reads through buf, bufsize
+ *                   bytes. Used when a day is reopened for writing and when one that was never trimmed is read back.
+ * =======================================================================================================================
+ */
+uint32_t SD_LogFindEnd(File &fp, long day, char *buf, int bufsize) {
+  uint32_t size = fp.size();
+  uint32_t end = eeprom.log_end;
+  uint32_t pos;
+  int n;
+
+  // A preallocation is whole sectors. Otherwise trimmed, grown past the preallocation or never preallocated, the
+  // data is the file. A trimmed file that happens to end on a sector is scanned, which finds the same end.
+  if ((size % SD_BLOCKSZ) != 0) {
+    return (size);
+  }
+
+  // Saved end must be at a line end
+  if ((eeprom.log_day == (uint32_t)day) && (end <= size) &&
+      ((end == 0) || (fp.seek(end - 1) && (fp.read() == '\n')))) {
+    return (end);
+  }
+
+  // End of the last whole line before the NUL padding, or before old card data if a sector was written after the
+  // last sync
+  Output ("SD:Log Scan");
+  fp.seek(0);
+  end = 0;
+  for (pos = 0; pos < size; pos += n) {
+    n = fp.read(buf, bufsize);
+    if (n <= 0) {
+      break;
+    }
+    for (int i=0; i<n; i++) {
+      char c = buf[i];
+      if (c == '\n') {
+        end = pos + i + 1;
+      }
+      else if ((c != '\r') && ((c < ' ') || (c > '~'))) {
+        return (end);
+      }
+    }
+  }
+  return (end);
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_LogOpen() - Open the log file for day yyyymmdd, preallocating it for len byte lines if new. Return false on error
+ * =======================================================================================================================
+ */
+bool SD_LogOpen(long day, bool create, int len) {
+  char SD_logfile[24];
+
+  sprintf (SD_logfile, "%s/%08ld.log", SD_obsdir, day);
+  Output (SD_logfile);
+
+  // Disable LoRA SPI0 Chip Select
+  pinMode(LORA_SS, OUTPUT);
+  digitalWrite(LORA_SS, HIGH);
+
+  SD_log_day = day;
+  SD_log_len = 0;
+  SD_log_lines = 0;
+  SD_idx_len = 0;
+  SD_log_synced = millis();
+
+  if (SD.exists(SD_logfile)) {
+    SD_log_fp = SD.open(SD_logfile, SD_LOG_OPEN);
+    if (!SD_log_fp) {
+      SD_log_day = 0;
+      return (false);
+    }
+    SD_log_end = SD_LogFindEnd(SD_log_fp, day, SD_log_buf, SD_BLOCKSZ);
+    if (!SD_log_fp.seek(SD_log_end)) {
+      SD_log_fp.close();
+      SD_log_day = 0;
+      return (false);
+    }
+    return (true);
+  }
+
+  if (!create) {
+    SD_log_day = 0;
+    return (false);
+  }
+
+  SD_log_end = 0;
+  SD_log_fp = SD.createContiguous(SD_logfile, SD_LogPrealloc(len));
+  if (SD_log_fp) {
+    // Old data in the first sector could be taken for log lines, see SD_LogFindEnd()
+    memset (SD_log_buf, 0, SD_BLOCKSZ);
+    if ((SD_log_fp.write((uint8_t *)SD_log_buf, SD_BLOCKSZ) != SD_BLOCKSZ) || !SD_log_fp.seek(0)) {
+      SD_log_fp.close();
+      SD_log_day = 0;
+      return (false);
+    }
+    return (true);
+  }
+
+  Output ("SD:Log Not Contiguous");
+  SD_log_fp = SD.open(SD_logfile, SD_LOG_OPEN | O_CREAT);
+  if (!SD_log_fp) {
+    SD_log_day = 0;
+    return (false);
+  }
+  return (true);
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_LogWrite() - Append n bytes to the log, writing each sector to the card as it fills. Return false on error
+ * =======================================================================================================================
+ */
+bool SD_LogWrite(const char *s, int n) {
+  while (n > 0) {
+    int cap = SD_BLOCKSZ - (SD_log_end % SD_BLOCKSZ);  // Room before the file reaches a sector boundary
+    int k = cap - SD_log_len;
+    if (k > n) {
+      k = n;
+    }
+    memcpy (SD_log_buf + SD_log_len, s, k);
+    SD_log_len += k;
+    s += k;
+    n -= k;
+
+    if (SD_log_len == cap) {
+      // Disable LoRA SPI0 Chip Select
+      pinMode(LORA_SS, OUTPUT);
+      digitalWrite(LORA_SS, HIGH);
+
+      if (SD_log_fp.write((uint8_t *)SD_log_buf, SD_log_len) != (size_t)SD_log_len) {
+        SD_log_len = 0;
+        return (false);
+      }
+      SD_log_end += SD_log_len;
+      SD_log_len = 0;
+    }
+  }
+  return (true);
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_LogObservation() - Call rtc_timestamp() prior to set now variable. ts is the observation time, for the index.
+ * =======================================================================================================================
+ */
+void SD_LogObservation(char *observations, uint32_t ts) {
+  long day;
+  bool ok;
     
   if (!SD_exists) {
     Output ("SD:NOT EXIST");
@@ -73,69 +425,397 @@ void SD_LogObservation(char *observations) {
     return;
   }
 
-  sprintf (SD_logfile, "%s/%4d%02d%02d.log", SD_obsdir, now.year(), now.month(), now.day());
-  Output (SD_logfile);
-  
+  // Roll to a new file at UTC midnight
+  day = now.year() * 10000L + now.month() * 100L + now.day();
+  if (day != SD_log_day) {
+    SD_LogClose(true);
+
+    // A day left open by a reboot or power loss
+    if (eeprom.log_day && (eeprom.log_day != (uint32_t)day)) {
+      if (SD_LogOpen(eeprom.log_day, false, 0)) {
+        SD_LogClose(true);
+      }
+      else {
+        eeprom.log_day = 0;
+      }
+    }
+
+    if (!SD_LogOpen(day, true, strlen(observations) + 2)) {
+      SystemStatusBits |= SSB_SD;  // Turn On Bit - Note this will be reported on next observation
+      Output ("SD:Open(Log)ERR");
+      // At thins point we could set SD_exists to false and/or set a status bit to report it
+      // sd_initialize();  // Reports SD NOT Found. Library bug with SD
+      return;
+    }
+  }
+
+  // Index the first line after an open and every SD_IDX_EVERY lines after it
+  if ((SD_log_lines++ % SD_IDX_EVERY) == 0) {
+    SD_idx_ts[SD_idx_len] = ts;
+    SD_idx_pos[SD_idx_len] = SD_log_end + SD_log_len;
+    SD_idx_len++;
+  }
+
+  ok = SD_LogWrite(observations, strlen(observations)) && SD_LogWrite("\r\n", 2);
+  if (ok && ((cf_sd_sync == 0) || ((millis() - SD_log_synced) >= (cf_sd_sync * 1000UL)) ||
+      (SD_idx_len == SD_IDX_PENDING))) {
+    ok = SD_LogSync();
+  }
+
+  if (ok) {
+    SystemStatusBits &= ~SSB_SD;  // Turn Off Bit
+    Output ("OBS Logged to SD");
+  }
+  else {
+    SystemStatusBits |= SSB_SD;  // Turn On Bit - Note this will be reported on next observation
+    Output ("SD:Write(Log)ERR");
+    SD_idx_len = 0;                // Entries may point at lines that did not make it
+    SD_LogClose(false);            // Reopen on the next observation
+  }
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_LogLineTime() - Return the time of a log line from its "at", 0 if it is not a log line
+ * =======================================================================================================================
+ */
+uint32_t SD_LogLineTime(const char *line) {
+  const char *at = "{\"at\":\"";
+  int f[6];
+
+  if (strncmp(line, at, strlen(at)) != 0) {
+    return (0);
+  }
+  line += strlen(at);
+
+  // YYYY-MM-DDTHH:MM:SS
+  for (int i=0; i<6; i++) {
+    int digits = (i == 0) ? 4 : 2;
+
+    f[i] = 0;
+    for (int d=0; d<digits; d++, line++) {
+      if (!isdigit(*line)) {
+        return (0);
+      }
+      f[i] = (f[i] * 10) + (*line - '0');
+    }
+    if (*line++ != ((i == 5) ? '"' : "--T::"[i])) {
+      return (0);
+    }
+  }
+  if ((f[0] < 2000) || (f[1] < 1) || (f[1] > 12) || (f[2] < 1) || (f[2] > 31)) {
+    return (0);
+  }
+  return (DateTime(f[0], f[1], f[2], f[3], f[4], f[5]).unixtime());
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_LogReadClose() - Close the log being read back
+ * =======================================================================================================================
+ */
+void SD_LogReadClose() {
+  if (SD_lr_fp) {
+    SD_lr_fp.close();
+  }
+  SD_lr_day = 0;
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_LogReadOpen() - Open the log for day yyyymmdd for reading, at the last indexed line logged at or before ts.
+ *                    Without an index the whole day is read. Return false if there is no log for the day.
+ *
+ *   A past day left untrimmed by a power loss before its SD_LogClose(true) still has its preallocation, which past
+ *   the last sync can hold old card data. Its end is found the way SD_LogOpen() finds it, from EEPROM or a scan.
+ * =======================================================================================================================
+ */
+bool SD_LogReadOpen(long day, uint32_t ts) {
+  char SD_logfile[24];
+  char scan[64];
+  uint8_t entry[SD_IDX_ENTRY];
+  File fp;
+
+  SD_LogReadClose();
+  if (!SD_exists) {
+    return (false);
+  }
+
   // Disable LoRA SPI0 Chip Select
   pinMode(LORA_SS, OUTPUT);
   digitalWrite(LORA_SS, HIGH);
-     
-  fp = SD.open(SD_logfile, FILE_WRITE); 
+
+  if (day == SD_log_day) {
+    SD_LogSync();  // Today's lines and index entries still in RAM
+  }
+
+  sprintf (SD_logfile, "%s/%08ld.log", SD_obsdir, day);
+  SD_lr_fp = SD.open(SD_logfile, FILE_READ);
+  if (!SD_lr_fp) {
+    return (false);
+  }
+  SD_lr_day = day;
+  SD_lr_pos = 0;
+  SD_lr_end = (day == SD_log_day) ? SD_log_end : SD_LogFindEnd(SD_lr_fp, day, scan, sizeof(scan));
+
+  // Binary search for the last entry at or before ts
+  sprintf (SD_logfile, "%s/%08ld.idx", SD_obsdir, day);
+  fp = SD.open(SD_logfile, FILE_READ);
   if (fp) {
-    fp.println(observations);
+    uint32_t lo = 0;
+    uint32_t hi = fp.size() / SD_IDX_ENTRY;
+
+    while (lo < hi) {
+      uint32_t mid = (lo + hi) / 2;
+      uint32_t t, pos;
+
+      if (!fp.seek(mid * SD_IDX_ENTRY) || (fp.read(entry, SD_IDX_ENTRY) != SD_IDX_ENTRY)) {
+        break;
+      }
+      t = ((uint32_t) entry[0] << 24) | ((uint32_t) entry[1] << 16) | ((uint32_t) entry[2] << 8) | entry[3];
+      pos = ((uint32_t) entry[4] << 24) | ((uint32_t) entry[5] << 16) | ((uint32_t) entry[6] << 8) | entry[7];
+      if (t <= ts) {
+        SD_lr_pos = pos;
+        lo = mid + 1;
+      }
+      else {
+        hi = mid;
+      }
+    }
     fp.close();
-    SystemStatusBits &= ~SSB_SD;  // Turn Off Bit
-    Output ("OBS Logged to SD");
   }
-  else {
-    SystemStatusBits |= SSB_SD;  // Turn On Bit - Note this will be reported on next observation
-    Output ("SD:Open(Log)ERR");
-    // At thins point we could set SD_exists to false and/or set a status bit to report it
-    // sd_initialize();  // Reports SD NOT Found. Library bug with SD
+  return (true);
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_LogReadLine() - Read the next line of the log being read in to buf, without its CR LF, and set *ts to its time.
+ *                    Return length, 0 at the end of the day's data, -1 for a line that is not an observation or does
+ *                    not fit in buf, which is skipped.
+ * =======================================================================================================================
+ */
+int SD_LogReadLine(char *buf, int size, uint32_t *ts) {
+  uint32_t end;
+  int n, i;
+
+  if (!SD_lr_fp) {
+    return (0);
   }
+
+  // Disable LoRA SPI0 Chip Select
+  pinMode(LORA_SS, OUTPUT);
+  digitalWrite(LORA_SS, HIGH);
+
+  // The open day's data ends at SD_log_end, past it is padding or old card data. Others at the end found by the open.
+  if (SD_lr_day == SD_log_day) {
+    SD_lr_end = SD_log_end;
+  }
+  end = SD_lr_end;
+  for (bool skip=false; SD_lr_pos < end; skip=true) {
+    n = ((end - SD_lr_pos) < (uint32_t)(size - 1)) ? (end - SD_lr_pos) : (size - 1);
+    if (!SD_lr_fp.seek(SD_lr_pos) || ((n = SD_lr_fp.read(buf, n)) <= 0)) {
+      return (0);
+    }
+    for (i=0; (i<n) && (buf[i] != '\n'); i++) {
+      if (buf[i] == 0) {
+        return (0);
+      }
+    }
+    SD_lr_pos += (i < n) ? i + 1 : n;
+    if ((i < n) && !skip) {
+      buf[i] = 0;
+      if ((i > 0) && (buf[i-1] == '\r')) {
+        buf[--i] = 0;
+      }
+      *ts = SD_LogLineTime(buf);
+      return ((*ts) ? i : -1);
+    }
+    if (i < n) {
+      return (-1);  // End of a line too long for buf
+    }
+  }
+  return (0);
 }
 
 /* 
  * =======================================================================================================================
- * SD_N2S_Delete()
+ * SD_ArchiveWrite() - Append len bytes of an archive block to the archive file for day yyyymmdd. The file is opened
+ *                     on the first write of a block and closed after the last. Return false on error. See AR.h
  * =======================================================================================================================
  */
-bool SD_N2S_Delete() {
-  bool result;
+bool SD_ArchiveWrite(long day, uint8_t *buf, int len, bool last) {
+  bool ok = true;
+
+  if (!SD_exists) {
+    return (false);
+  }
 
   // Disable LoRA SPI0 Chip Select
   pinMode(LORA_SS, OUTPUT);
   digitalWrite(LORA_SS, HIGH);
-  
-  if (SD_exists && SD.exists(SD_n2s_file)) {
-    if (SD.remove (SD_n2s_file)) {
-      SystemStatusBits &= ~SSB_N2S; // Turn Off Bit
-      Output ("N2S->DEL:OK");
-      result = true;
+
+  if (!SD_ar_fp) {
+    char SD_arfile[24];
+
+    sprintf (SD_arfile, "%s/%08ld.arc", SD_obsdir, day);
+    SD_ar_fp = SD.open(SD_arfile, FILE_WRITE);
+    if (!SD_ar_fp) {
+      Output ("SD:Open(Arc)ERR");
+      return (false);
     }
-    else {
-      Output ("N2S->DEL:ERR");
-      SystemStatusBits |= SSB_SD; // Turn On Bit
-      result = false;
+  }
+
+  if (len) {
+    ok = (SD_ar_fp.write(buf, len) == (size_t)len);
+  }
+  if (last || !ok) {
+    SD_ar_fp.close();
+  }
+  return (ok);
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_N2S_Count() - Number of records waiting to be sent
+ * =======================================================================================================================
+ */
+unsigned long SD_N2S_Count() {
+  return (eeprom.n2s_head - eeprom.n2s_tail);
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_N2S_Checksum() - 16 bit sum of the record sequence, length and payload
+ * =======================================================================================================================
+ */
+uint16_t SD_N2S_Checksum(uint8_t *rec, int len) {
+  uint16_t sum = 0;
+
+  for (int i=0; i<6; i++) {
+    sum += rec[i];
+  }
+  for (int i=0; i<len; i++) {
+    sum += rec[SD_N2S_HDRSZ+i];
+  }
+  return (sum);
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_N2S_ReadClose() - Close the N2S reader and drop the cached sector
+ * =======================================================================================================================
+ */
+void SD_N2S_ReadClose() {
+  if (SD_n2s_rfp) {
+    SD_n2s_rfp.close();
+  }
+  SD_n2s_blocknum = -1;
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_N2S_WriteClose() - Close the N2S writer. Call before a reboot.
+ * =======================================================================================================================
+ */
+void SD_N2S_WriteClose() {
+  if (SD_n2s_wfp) {
+    SD_n2s_wfp.close();
+  }
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_N2S_ReadRecord() - Return pointer to record in slot, NULL if slot is empty or corrupt. Sets *len and *seq
+ *                       Pointer is in to SD_n2s_block and is valid until the next read.
+ * =======================================================================================================================
+ */
+uint8_t *SD_N2S_ReadRecord(unsigned long slot, int *len, unsigned long *seq) {
+  unsigned long offset = slot * SD_N2S_RECSZ;
+  long blocknum = offset / SD_BLOCKSZ;
+  uint8_t *rec;
+
+  if (!SD_n2s_rfp) {
+    // Disable LoRA SPI0 Chip Select
+    pinMode(LORA_SS, OUTPUT);
+    digitalWrite(LORA_SS, HIGH);
+
+    SD_n2s_blocknum = -1;
+    SD_n2s_rfp = SD.open(SD_n2s_file, FILE_READ);
+    if (!SD_n2s_rfp) {
+      SystemStatusBits |= SSB_SD;  // Turn On Bit
+      Output ("N2S:Open Error");
+      return (NULL);
+    }
+  }
+
+  if (blocknum != SD_n2s_blocknum) {
+    SD_n2s_blocknum = -1;
+    if (!SD_n2s_rfp.seek(blocknum * SD_BLOCKSZ) || (SD_n2s_rfp.read(SD_n2s_block, SD_BLOCKSZ) != SD_BLOCKSZ)) {
+      return (NULL);
     }
+    SD_n2s_blocknum = blocknum;
+  }
+
+  rec = SD_n2s_block + (offset % SD_BLOCKSZ);
+  *seq = (unsigned long)rec[0] | ((unsigned long)rec[1] << 8) | ((unsigned long)rec[2] << 16) | ((unsigned long)rec[3] << 24);
+  *len = rec[4] | (rec[5] << 8);
+  if ((*len == 0) || (*len > SD_N2S_MAXPL)) {
+    return (NULL);
+  }
+  if ((rec[6] | (rec[7] << 8)) != SD_N2S_Checksum(rec, *len)) {
+    return (NULL);
+  }
+  return (rec);
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_N2S_Recover() - Rebuild head and tail pointers by scanning the sequence numbers in the ring file
+ * =======================================================================================================================
+ */
+void SD_N2S_Recover() {
+  unsigned long seq, newest = 0;
+  int len;
+  bool found = false;
+
+  Output ("N2S:Recover");
+
+  // Sequence numbers increase by one per record so the newest record is the largest number
+  for (unsigned long slot=0; slot<SD_N2S_RECORDS; slot++) {
+    if (SD_N2S_ReadRecord(slot, &len, &seq) && ((seq % SD_N2S_RECORDS) == slot)) {
+      if (!found || ((long)(seq - newest) > 0)) {
+        newest = seq;
+        found = true;
+      }
+    }
+  }
+  SD_N2S_ReadClose();
+
+  if (found) {
+    // We do not know what was sent, so everything still in the ring is resent
+    eeprom.n2s_head = newest + 1;
+    eeprom.n2s_tail = (eeprom.n2s_head > SD_N2S_RECORDS) ? eeprom.n2s_head - SD_N2S_RECORDS : 0;
   }
   else {
-    Output ("N2S->DEL:NF");
-    result = true;
+    eeprom.n2s_head = 0;
+    eeprom.n2s_tail = 0;
   }
-  eeprom.n2sfp = 0;
+  eeprom_n2s_recover = false;
   EEPROM_Update();
-  return (result);
+
+  sprintf (Buffer32Bytes, "N2S:H%lu T%lu", eeprom.n2s_head, eeprom.n2s_tail);
+  Output (Buffer32Bytes);
 }
 
 /* 
  * =======================================================================================================================
- * SD_NeedToSend_Add()
+ * SD_N2S_Initialize() - Create and preallocate the N2S ring file. Check pointers. Call after EEPROM_initialize()
  * =======================================================================================================================
  */
-void SD_NeedToSend_Add(char *observation) {
+void SD_N2S_Initialize() {
   File fp;
 
+  SD_n2s_valid = false;
   if (!SD_exists) {
     return;
   }
@@ -143,31 +823,238 @@ void SD_NeedToSend_Add(char *observation) {
   // Disable LoRA SPI0 Chip Select
   pinMode(LORA_SS, OUTPUT);
   digitalWrite(LORA_SS, HIGH);
-  
-  fp = SD.open(SD_n2s_file, FILE_WRITE); // Open the file for reading and writing, starting at the end of the file.
-                                         // It will be created if it doesn't already exist.
-  if (fp) {  
-    if (fp.size() > SD_n2s_max_filesz) {
-      fp.close();
-      Output ("N2S:Full");
-      if (SD_N2S_Delete()) {
-        // Only call ourself again if we truely deleted the file. Otherwise infinate loop.
-        SD_NeedToSend_Add(observation); // Now go and log the data
+
+  fp = SD.open(SD_n2s_file, SD_N2S_OPEN);
+  if (!fp) {
+    SystemStatusBits |= SSB_SD;  // Turn On Bit
+    Output ("N2S:Open Error");
+    return;
+  }
+
+  if (fp.size() != (SD_N2S_RECORDS * SD_N2S_RECSZ)) {
+    uint8_t zero[SD_N2S_RECSZ];
+
+    // New or wrong size file. Zero filled records have a length of 0 and are treated as empty.
+    Output ("N2S:Prealloc");
+    memset(zero, 0, sizeof(zero));
+    fp.seek(0);
+    for (unsigned long slot=0; slot<SD_N2S_RECORDS; slot++) {
+      if (fp.write(zero, SD_N2S_RECSZ) != SD_N2S_RECSZ) {
+        fp.close();
+        SystemStatusBits |= SSB_SD;  // Turn On Bit
+        Output ("N2S:Prealloc ERR");
+        return;
       }
     }
-    else {
-      fp.println(observation); //Print data, followed by a carriage return and newline, to the File
-      fp.close();
-      SystemStatusBits &= ~SSB_SD;  // Turn Off Bit
-      SystemStatusBits |= SSB_N2S; // Turn on Bit that says there are entries in the N2S File
-      Output ("N2S:OBS Added");
+    eeprom.n2s_tail = eeprom.n2s_head;   // Nothing in the ring
+    EEPROM_Update();
+  }
+  fp.close();
+
+  if (eeprom_n2s_recover || !eeprom_valid || (SD_N2S_Count() > SD_N2S_RECORDS)) {
+    SD_N2S_Recover();
+  }
+
+  if (SD_N2S_Count()) {
+    SystemStatusBits |= SSB_N2S;   // Turn on Bit that says there are entries in the N2S File
+  }
+  else {
+    SystemStatusBits &= ~SSB_N2S;  // Turn Off Bit
+  }
+  SD_n2s_valid = true;
+
+  sprintf (Buffer32Bytes, "N2S:OK %lu", SD_N2S_Count());
+  Output (Buffer32Bytes);
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_N2S_Delete() - Discard all records waiting to be sent. The ring file is kept.
+ * =======================================================================================================================
+ */
+bool SD_N2S_Delete() {
+  eeprom.n2s_tail = eeprom.n2s_head;
+  EEPROM_Update();
+  SystemStatusBits &= ~SSB_N2S; // Turn Off Bit
+  Output ("N2S->DEL:OK");
+  return (true);
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_NeedToSend_Add() - Write payload as the next record in the ring, overwriting the oldest when full
+ * =======================================================================================================================
+ */
+void SD_NeedToSend_Add(uint8_t *payload, int len) {
+  uint8_t rec[SD_N2S_RECSZ];
+  unsigned long seq = eeprom.n2s_head;
+  uint16_t sum;
+
+  if (!SD_exists || !SD_n2s_valid) {
+    return;
+  }
+
+  if ((len <= 0) || (len > SD_N2S_MAXPL)) {
+    Output ("N2S:Size ERR");
+    return;
+  }
+
+  memset(rec, 0, sizeof(rec));
+  rec[0] = seq & 0xFF;
+  rec[1] = (seq >> 8) & 0xFF;
+  rec[2] = (seq >> 16) & 0xFF;
+  rec[3] = (seq >> 24) & 0xFF;
+  rec[4] = len & 0xFF;
+  rec[5] = (len >> 8) & 0xFF;
+  memcpy (rec+SD_N2S_HDRSZ, payload, len);
+  sum = SD_N2S_Checksum(rec, len);
+  rec[6] = sum & 0xFF;
+  rec[7] = (sum >> 8) & 0xFF;
+
+  // Disable LoRA SPI0 Chip Select
+  pinMode(LORA_SS, OUTPUT);
+  digitalWrite(LORA_SS, HIGH);
+  
+  if (!SD_n2s_wfp) {
+    SD_n2s_wfp = SD.open(SD_n2s_file, SD_N2S_OPEN);
+  }
+  if (SD_n2s_wfp) {
+    if (!SD_n2s_wfp.seek((seq % SD_N2S_RECORDS) * SD_N2S_RECSZ) || 
+        (SD_n2s_wfp.write(rec, SD_N2S_RECSZ) != SD_N2S_RECSZ)) {
+      SD_n2s_wfp.close();          // Reopen on the next add
+      SystemStatusBits |= SSB_SD;  // Turn On Bit
+      Output ("N2S:Write Error");
+      return;
     }
+    SD_n2s_wfp.flush();   // Record is on the card before the head moves
+    SD_n2s_blocknum = -1;  // Reader's cached sector may hold the old copy of this slot
+
+    eeprom.n2s_head = seq + 1;
+    if (SD_N2S_Count() > SD_N2S_RECORDS) {
+      eeprom.n2s_tail = eeprom.n2s_head - SD_N2S_RECORDS;  // Oldest record was overwritten
+      Output ("N2S:Full");
+    }
+    EEPROM_Update();
+
+    SystemStatusBits &= ~SSB_SD;  // Turn Off Bit
+    SystemStatusBits |= SSB_N2S; // Turn on Bit that says there are entries in the N2S File
+    Output ("N2S:OBS Added");
   }
   else {
     SystemStatusBits |= SSB_SD;  // Turn On Bit - Note this will be reported on next observation
     Output ("N2S:Open Error");
-    // At thins point we could set SD_exists to false and/or set a status bit to report it
-    // sd_initialize();  // Reports SD NOT Found. Library bug with SD
+  }
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_N2S_Peek() - Copy the oldest (or newest) record's payload in to buf. Return length, 0 if none.
+ *                 Corrupt records are skipped. Leaves the N2S reader open, call SD_N2S_ReadClose() when done.
+ * =======================================================================================================================
+ */
+int SD_N2S_Peek(uint8_t *buf, bool newest) {
+  uint8_t *rec;
+  unsigned long want, seq;
+  int len;
+
+  if (!SD_exists || !SD_n2s_valid || !SD_N2S_Count()) {
+    return (0);
+  }
+
+  while (SD_N2S_Count()) {
+    want = (newest) ? eeprom.n2s_head - 1 : eeprom.n2s_tail;
+    rec = SD_N2S_ReadRecord(want % SD_N2S_RECORDS, &len, &seq);
+    if (rec && (seq == want)) {
+      memcpy (buf, rec+SD_N2S_HDRSZ, len);
+      return (len);
+    }
+    if (!SD_n2s_rfp || (SD_n2s_blocknum < 0)) {
+      return (0);  // Open or read failed, try again next time
+    }
+    // Record was lost to a power failure or overwritten before the pointers were saved
+    sprintf (Buffer32Bytes, "N2S:%lu Skip", want);
+    Output (Buffer32Bytes);
+    if (newest) {
+      eeprom.n2s_head--;
+    }
+    else {
+      eeprom.n2s_tail++;
+    }
+  }
+  EEPROM_Update();
+  SystemStatusBits &= ~SSB_N2S; // Turn Off Bit
+  return (0);
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_N2S_Read() - Copy payload of record seq in to buf. Return length, 0 if the record is not there or corrupt.
+ *                 Leaves the N2S reader open, call SD_N2S_ReadClose() when done.
+ * =======================================================================================================================
+ */
+int SD_N2S_Read(unsigned long seq, uint8_t *buf) {
+  uint8_t *rec;
+  unsigned long rseq;
+  int len;
+
+  if (!SD_exists || !SD_n2s_valid) {
+    return (0);
+  }
+  rec = SD_N2S_ReadRecord(seq % SD_N2S_RECORDS, &len, &rseq);
+  if (!rec || (rseq != seq)) {
+    return (0);
+  }
+  memcpy (buf, rec+SD_N2S_HDRSZ, len);
+  return (len);
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_N2S_Pop() - Remove count oldest (or newest) records after they have been sent. Removing the newest gives their
+ *                sequence numbers back to the next SD_NeedToSend_Add().
+ * =======================================================================================================================
+ */
+void SD_N2S_Pop(bool newest, unsigned long count) {
+  if (count > SD_N2S_Count()) {
+    count = SD_N2S_Count();
+  }
+  if (count) {
+    if (newest) {
+      eeprom.n2s_head -= count;
+    }
+    else {
+      eeprom.n2s_tail += count;
+    }
+    EEPROM_Update();
+  }
+  if (!SD_N2S_Count()) {
+    SystemStatusBits &= ~SSB_N2S; // Turn Off Bit
+  }
+}
+
+/* 
+ * =======================================================================================================================
+ * SD_N2S_Remove() - Remove records first to first+count-1 after they have been sent. Records may have been added or
+ *                   overwritten since they were read, so they are only removed if they are still at an end of the ring.
+ *                   Otherwise they stay and are sent again.
+ * =======================================================================================================================
+ */
+void SD_N2S_Remove(unsigned long first, unsigned long count) {
+  unsigned long last = first + count;   // One past
+
+  if (((long)(eeprom.n2s_tail - first) >= 0) && ((long)(last - eeprom.n2s_tail) > 0)) {
+    eeprom.n2s_tail = ((long)(last - eeprom.n2s_head) > 0) ? eeprom.n2s_head : last;
+  }
+  else if ((last == eeprom.n2s_head) && ((long)(first - eeprom.n2s_tail) >= 0)) {
+    eeprom.n2s_head = first;
+  }
+  else {
+    Output ("N2S:Moved, Keep");
+    return;
+  }
+  EEPROM_Update();
+  if (!SD_N2S_Count()) {
+    SystemStatusBits &= ~SSB_N2S; // Turn Off Bit
   }
 }
 
@@ -366,15 +1253,33 @@ void SD_ReadConfigFile() {
   cf_lw_appskey   = SD_findCharStr(F("lw_appskey"));
   sprintf(msgbuf, "CF:%s=[%s]", F("lw_appkey"), cf_lw_appskey); Output (msgbuf);
 
+  cf_lw_binary    = SD_findInt(F("lw_binary"));
+  sprintf(msgbuf, "CF:%s=[%d]", F("lw_binary"), cf_lw_binary); Output (msgbuf);
+
+  cf_n2s_policy   = SD_findInt(F("n2s_policy"));
+  sprintf(msgbuf, "CF:%s=[%d]", F("n2s_policy"), cf_n2s_policy); Output (msgbuf);
+
+  cf_n2s_batch    = SD_findInt(F("n2s_batch"));
+  sprintf(msgbuf, "CF:%s=[%d]", F("n2s_batch"), cf_n2s_batch); Output (msgbuf);
+
   cf_rg1_enable   = SD_findInt(F("rg1_enable"));
   sprintf(msgbuf, "CF:%s=[%d]", F("rg1_enable"), cf_rg1_enable); Output (msgbuf);
 
   cf_rg2_enable   = SD_findInt(F("rg2_enable"));
   sprintf(msgbuf, "CF:%s=[%d]", F("rg2_enable"), cf_rg2_enable); Output (msgbuf);
 
+  cf_rg_ext       = SD_findInt(F("rg_ext"));
+  sprintf(msgbuf, "CF:%s=[%d]", F("rg_ext"), cf_rg_ext); Output (msgbuf);
+
   cf_ds_enable    = SD_findInt(F("ds_enable"));
   sprintf(msgbuf, "CF:%s=[%d]", F("ds_enable"), cf_ds_enable); Output (msgbuf);
 
+  cf_ds_samples   = SD_findInt(F("ds_samples"));
+  if ((cf_ds_samples < 1) || (cf_ds_samples > DS_SAMPLES_MAX)) {
+    cf_ds_samples = 1;
+  }
+  sprintf(msgbuf, "CF:%s=[%d]", F("ds_samples"), cf_ds_samples); Output (msgbuf);
+
   cf_5m_enable    = SD_findInt(F("5m_enable"));
   sprintf(msgbuf, "CF:%s=[%d]", F("5m_enable"), cf_5m_enable); Output (msgbuf);
   
@@ -383,4 +1288,37 @@ void SD_ReadConfigFile() {
 
   cf_daily_reboot = SD_findInt(F("daily_reboot"));
   sprintf(msgbuf, "CF:%s=[%d]", F("daily_reboot"), cf_daily_reboot); Output (msgbuf);
+
+  cf_pwr_mode     = SD_findInt(F("pwr_mode"));
+  if ((cf_pwr_mode < PWR_AWAKE) || (cf_pwr_mode > PWR_STANDBY)) {
+    cf_pwr_mode = PWR_AWAKE;
+  }
+  sprintf(msgbuf, "CF:%s=[%d]", F("pwr_mode"), cf_pwr_mode); Output (msgbuf);
+
+  cf_ws_gust      = SD_findInt(F("ws_gust"));
+  if ((cf_ws_gust < 1) || (cf_ws_gust > WIND_READINGS)) {
+    cf_ws_gust = 3;  // WMO 3 second gust
+  }
+  sprintf(msgbuf, "CF:%s=[%d]", F("ws_gust"), cf_ws_gust); Output (msgbuf);
+
+  cf_ws_ext       = SD_findInt(F("ws_ext"));
+  sprintf(msgbuf, "CF:%s=[%d]", F("ws_ext"), cf_ws_ext); Output (msgbuf);
+
+  cf_wd_samples   = SD_findInt(F("wd_samples"));
+  if ((cf_wd_samples < 1) || (cf_wd_samples > WD_SAMPLES_MAX)) {
+    cf_wd_samples = 1;
+  }
+  sprintf(msgbuf, "CF:%s=[%d]", F("wd_samples"), cf_wd_samples); Output (msgbuf);
+
+  cf_sd_sync      = SD_findInt(F("sd_sync"));
+  if ((cf_sd_sync < 0) || (cf_sd_sync > 3600)) {
+    cf_sd_sync = 0;
+  }
+  sprintf(msgbuf, "CF:%s=[%d]", F("sd_sync"), cf_sd_sync); Output (msgbuf);
+
+  cf_sd_archive   = SD_findInt(F("sd_archive"));
+  if ((cf_sd_archive < 0) || (cf_sd_archive > 2)) {
+    cf_sd_archive = 0;
+  }
+  sprintf(msgbuf, "CF:%s=[%d]", F("sd_archive"), cf_sd_archive); Output (msgbuf);
 }
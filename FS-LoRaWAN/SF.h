@@ -231,6 +231,8 @@ void hexStringToByteArray(const char *hexString, uint8_t *byteArray, int len) {
     }
 }
 
+void SR_ClearStatusBits(); // Prototype this function to aviod compile function unknown issue.
+
 /*
  * ======================================================================================================================
  * JPO_ClearBits() - Clear System Status Bits related to initialization
@@ -242,18 +244,8 @@ void JPO_ClearBits() {
     SystemStatusBits &= ~SSB_PWRON;   // Turn Off Power On Bit
     SystemStatusBits &= ~SSB_OLED;    // Turn Off OLED Not Found Bit
     SystemStatusBits &= ~SSB_LORA;    // Turn Off LoRa Not Found Bit
-    SystemStatusBits &= ~SSB_BMX_1;   // Turn Off BMX_1 Not Found Bit
-    SystemStatusBits &= ~SSB_BMX_2;   // Turn Off BMX_2 Not Found Bit
-    SystemStatusBits &= ~SSB_HTU21DF; // Turn Off HTU Not Found Bit
-    SystemStatusBits &= ~SSB_MCP_1;   // Turn Off MCP_1 Not Found Bit
-    SystemStatusBits &= ~SSB_MCP_2;   // Turn Off MCP_2 Not Found Bit
-    SystemStatusBits &= ~SSB_SHT_1;   // Turn Off SHT_1 Not Found Bit
-    SystemStatusBits &= ~SSB_SHT_2;   // Turn Off SHT_2 Not Found Bit
-    SystemStatusBits &= ~SSB_HIH8;    // Turn Off HIH Not Found Bit
+    SR_ClearStatusBits();             // Turn Off every I2C sensor's Not Found Bit, see sr_drivers[]
     // SystemStatusBits &= ~SSB_GPS;     // Turn Off GPS Not Found Bit - Required
-    SystemStatusBits &= ~SSB_SI1145;  // Turn Off UV,IR, VIS Not Found Bit
-    SystemStatusBits &= ~SSB_PM25AQI; // Turn Off PM25AQI Not Found Bit
-    SystemStatusBits &= ~SSB_AS5600;  // Turn Off AS5600 Not Found Bit (Wind Direction)
     // SystemStatusBits &= ~SSB_EEPROM;  // Turn Off 24LC32 EEPROM Not Found Bit - Reqired
   }
 }
@@ -280,3 +272,169 @@ float vbat_get() {
   v /= 4096; // convert to voltage
   return (v);
 }
+
+/*
+ * ======================================================================================================================
+ *  Buffer Writer - Append formatted fields to a fixed size buffer
+ * 
+ *  Building obsbuf with sprintf(buf+strlen(buf), ...) rescans the buffer for every field and nothing stops it
+ *  running past the end. BW_ keeps a cursor and the space left, never writes past size-1 and keeps the buffer NUL
+ *  terminated. A field that does not fit is dropped whole and sets overflow, so callers check it once at the end.
+ *  Output matches what sprintf gives for %d, %0Nd, %u and %.1f.
+ * ======================================================================================================================
+ */
+typedef struct {
+  char          *buf;
+  int           len;         // Characters in buf, not counting the NUL
+  int           size;        // Size of buf including the NUL
+  bool          overflow;    // A field did not fit
+} BUFWRITER;
+
+/*
+ *=======================================================================================================================
+ * BW_Begin() - Start writing at the beginning of buf
+ *=======================================================================================================================
+ */
+void BW_Begin(BUFWRITER *w, char *buf, int size) {
+  w->buf = buf;
+  w->len = 0;
+  w->size = size;
+  w->overflow = false;
+  buf[0] = 0;
+}
+
+/*
+ *=======================================================================================================================
+ * BW_Write() - Append n characters of s
+ *=======================================================================================================================
+ */
+void BW_Write(BUFWRITER *w, const char *s, int n) {
+  if (w->overflow || ((w->len + n) >= w->size)) {
+    w->overflow = true;
+    return;
+  }
+  memcpy (w->buf+w->len, s, n);
+  w->len += n;
+  w->buf[w->len] = 0;
+}
+
+/*
+ *=======================================================================================================================
+ * BW_Str() - Append string
+ *=======================================================================================================================
+ */
+void BW_Str(BUFWRITER *w, const char *s) {
+  BW_Write(w, s, strlen(s));
+}
+
+/*
+ *=======================================================================================================================
+ * BW_Digits() - Put v in s before index i, zero padded to width digits. Return the index of the first digit.
+ *=======================================================================================================================
+ */
+int BW_Digits(char *s, int i, unsigned long v, int width) {
+  int end = i;
+
+  do {
+    s[--i] = '0' + (v % 10);
+    v /= 10;
+  } while (v && (i > 0));
+  while ((i > end - width) && (i > 0)) {
+    s[--i] = '0';
+  }
+  return (i);
+}
+
+/*
+ *=======================================================================================================================
+ * BW_UInt() - Append unsigned value, zero padded to width digits like %0Nu. Width 0 is %u
+ *=======================================================================================================================
+ */
+void BW_UInt(BUFWRITER *w, unsigned long v, int width) {
+  char s[24];
+  int i = BW_Digits(s, sizeof(s), v, width);
+
+  BW_Write(w, s+i, sizeof(s)-i);
+}
+
+/*
+ *=======================================================================================================================
+ * BW_Int() - Append signed value, zero padded to width characters like %0Nd. Width 0 is %d
+ *=======================================================================================================================
+ */
+void BW_Int(BUFWRITER *w, long v, int width) {
+  char s[24];
+  int i;
+
+  if (v < 0) {
+    i = BW_Digits(s, sizeof(s), 0UL - (unsigned long) v, width-1);
+    s[--i] = '-';
+  }
+  else {
+    i = BW_Digits(s, sizeof(s), (unsigned long) v, width);
+  }
+  BW_Write(w, s+i, sizeof(s)-i);
+}
+
+/*
+ *=======================================================================================================================
+ * BW_Float1() - Append value with one decimal place like %.1f
+ * 
+ * A float times 10 is exact in a double (24 + 4 bits) so rint() gives the same round half to even printf does.
+ * From 1e14 up a float is a whole number, its 24 bit mantissa times 2^e. That is doubled e times in base 1e9 limbs
+ * to give every digit printf would, up to the 39 of FLT_MAX, so printf float support is not needed. NaN is "nan"
+ * whatever its sign bit.
+ *=======================================================================================================================
+ */
+void BW_Float1(BUFWRITER *w, float f) {
+  double d = fabs((double) f * 10.0);
+  char s[48];
+  int i = sizeof(s);
+
+  if (isnan(f)) {
+    BW_Str(w, "nan");
+    return;
+  }
+  if (isinf(f)) {
+    BW_Str(w, (signbit(f)) ? "-inf" : "inf");
+    return;
+  }
+  if (d < 1e15) {
+    // Integer part may need more than 32 bits
+    long long n = (long long) rint(d);
+    s[--i] = '0' + (int)(n % 10);
+    s[--i] = '.';
+    n /= 10;
+    do {
+      s[--i] = '0' + (int)(n % 10);
+      n /= 10;
+    } while (n);
+  }
+  else {
+    uint32_t limb[5] = {0, 0, 0, 0, 0};   // Least significant first, 45 digits
+    int e, top = 4;
+
+    limb[0] = (uint32_t) ldexp(frexp(fabs(f), &e), 24);
+    for (e -= 24; e > 0; e--) {
+      uint32_t carry = 0;
+      for (int k=0; k<5; k++) {
+        limb[k] = limb[k] * 2 + carry;
+        carry = (limb[k] >= 1000000000UL);
+        limb[k] -= (carry) ? 1000000000UL : 0;
+      }
+    }
+    s[--i] = '0';
+    s[--i] = '.';
+    while ((top > 0) && (limb[top] == 0)) {
+      top--;
+    }
+    for (int k=0; k<top; k++) {
+      i = BW_Digits(s, i, limb[k], 9);
+    }
+    i = BW_Digits(s, i, limb[top], 0);
+  }
+  if (signbit(f)) {
+    s[--i] = '-';
+  }
+  BW_Write(w, s+i, sizeof(s)-i);
+}
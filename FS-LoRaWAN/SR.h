@@ -0,0 +1,406 @@
+/*
+ * ======================================================================================================================
+ *  SR.h - Sensor Registry
+ * 
+ *  One sr_drivers[] entry per I2C sensor and derived observation, in the order OBS_Take() reports them. Each entry
+ *  has its exists flag, status bit, the address I2C_Check_Sensors() watches (0 = not watched), a probe to bring it
+ *  back online, a read that fills up to SR_MAX_VALUES values and the observations those values become, with their
+ *  QC ranges. Derived entries (no hardware) list the status bits of the sensors they are computed from in depends
+ *  and are skipped while any of those are set.
+ * 
+ *  OBS_Take(), I2C_Check_Sensors(), StationMonitor() and JPO_ClearBits() walk the table, so adding a sensor is
+ *  its read function and one entry. Reads are run in table order, a derived read can use what an earlier read
+ *  saved (sr_mcp1_temp, sr_sht1_humid, sr_heat_index).
+ * ======================================================================================================================
+ */
+#define SR_MAX_VALUES       6
+
+typedef struct {
+  uint8_t       id;          // OBS_ID, the name and F_OBS or I_OBS type are in obs_names[]
+  float         qc_min;      // Value outside min to max is reported as qc_err
+  float         qc_max;
+  float         qc_err;
+} SR_OBS_DEF;
+
+typedef struct {
+  const char        *name;       // For ONLINE / OFFLINE messages and the Station Monitor
+  bool              *exists;
+  unsigned long     ssb;         // SystemStatusBits bit set while missing, 0 if none
+  int               address;     // I2C address watched by I2C_Check_Sensors(), 0 = not watched
+  bool              (*probe)();  // Bring the sensor online after it reappears, NULL if nothing to do
+  void              (*read)(float *v);  // Fill v[0..count-1]
+  void              (*clear)();  // Called after OBS_Take() reads it, NULL if nothing to do
+  unsigned long     depends;     // Derived, status bits of the sensors it is computed from
+  const SR_OBS_DEF  *obs;
+  int               count;       // Observations, 0 for health check only entries
+} SR_DRIVER;
+
+float sr_mcp1_temp = 0.0;    // Saved by the reads for the derived observations
+float sr_sht1_humid = 0.0;
+float sr_heat_index = 0.0;
+
+/*
+ * ======================================================================================================================
+ *  Sensor Registry - Probe functions
+ * ======================================================================================================================
+ */
+bool sr_probe_bmx1() {
+  if (BMX_1_chip_id == BMP280_CHIP_ID) {
+    return (bmp1.begin(BMX_ADDRESS_1));
+  }
+  if (BMX_1_type == BMX_TYPE_BME280) {
+    return (bme1.begin(BMX_ADDRESS_1));
+  }
+  return (bm31.begin_I2C(BMX_ADDRESS_1));
+}
+
+bool sr_probe_bmx2() {
+  if (BMX_2_chip_id == BMP280_CHIP_ID) {
+    return (bmp2.begin(BMX_ADDRESS_2));
+  }
+  if (BMX_2_type == BMX_TYPE_BME280) {
+    return (bme2.begin(BMX_ADDRESS_2));
+  }
+  return (bm32.begin_I2C(BMX_ADDRESS_2));
+}
+
+bool sr_probe_htu()     { return (htu.begin()); }
+bool sr_probe_si1145()  { return (uv.begin()); }
+bool sr_probe_veml()    { return (veml.begin()); }
+
+bool sr_probe_pm25aqi() {
+  if (pmaq.begin_I2C()) {
+    pm25aqi_clear();
+    return (true);
+  }
+  return (false);
+}
+
+/*
+ * ======================================================================================================================
+ *  Sensor Registry - Read functions
+ * ======================================================================================================================
+ */
+void sr_read_bmx(byte chip_id, byte type, Adafruit_BMP280 *bmp, Adafruit_BME280 *bme, Adafruit_BMP3XX *bm3, 
+  float *v) {
+  v[0] = 0.0;   // Pressure hPa
+  v[1] = 0.0;   // Temperature
+  v[2] = 0.0;   // Humidity, BME280 only
+  
+  if (chip_id == BMP280_CHIP_ID) {
+    v[0] = bmp->readPressure()/100.0F;
+    v[1] = bmp->readTemperature();
+  }
+  else if ((chip_id == BME280_BMP390_CHIP_ID) && (type == BMX_TYPE_BME280)) {
+    v[0] = bme->readPressure()/100.0F;
+    v[1] = bme->readTemperature();
+    v[2] = bme->readHumidity();
+  }
+  else { // BMP388, BMP390
+    v[0] = bm3->readPressure()/100.0F;
+    v[1] = bm3->readTemperature();
+  }
+}
+
+void sr_read_bmx1(float *v) { sr_read_bmx(BMX_1_chip_id, BMX_1_type, &bmp1, &bme1, &bm31, v); }
+void sr_read_bmx2(float *v) { sr_read_bmx(BMX_2_chip_id, BMX_2_type, &bmp2, &bme2, &bm32, v); }
+
+void sr_read_htu(float *v) {
+  v[0] = htu.readHumidity();
+  v[1] = htu.readTemperature();
+}
+
+void sr_read_sht1(float *v) {
+  v[0] = sht1.readTemperature();
+  v[1] = sht1.readHumidity();
+  sr_sht1_humid = (isnan(v[1]) || (v[1] < QC_MIN_RH) || (v[1] > QC_MAX_RH)) ? QC_ERR_RH : v[1];
+}
+
+void sr_read_sht2(float *v) {
+  v[0] = sht2.readTemperature();
+  v[1] = sht2.readHumidity();
+}
+
+void sr_read_hih8(float *v) {
+  if (!hih8_getTempHumid(&v[0], &v[1])) {
+    v[0] = -999.99;
+    v[1] = 0.0;
+  }
+}
+
+void sr_read_si1145(float *v) {
+  float si_vis = uv.readVisible();
+  float si_ir = uv.readIR();
+  float si_uv = uv.readUV()/100.0;
+
+  // Additional code to force sensor online if we are getting 0.0s back.
+  if ( ((si_vis+si_ir+si_uv) == 0.0) && ((si_last_vis+si_last_ir+si_last_uv) != 0.0) ) {
+    // Let Reset The SI1145 and try again
+    Output ("SI RESET");
+    if (uv.begin()) {
+      SI1145_exists = true;
+      Output ("SI ONLINE");
+      SystemStatusBits &= ~SSB_SI1145; // Turn Off Bit
+
+      si_vis = uv.readVisible();
+      si_ir = uv.readIR();
+      si_uv = uv.readUV()/100.0;
+    }
+    else {
+      SI1145_exists = false;
+      Output ("SI OFFLINE");
+      SystemStatusBits |= SSB_SI1145;  // Turn On Bit    
+    }
+  }
+
+  // Save current readings for next loop around compare
+  si_last_vis = si_vis;
+  si_last_ir = si_ir;
+  si_last_uv = si_uv;
+
+  v[0] = si_vis;
+  v[1] = si_ir;
+  v[2] = si_uv;
+}
+
+void sr_read_mcp1(float *v) {
+  v[0] = mcp1.readTempC();
+  sr_mcp1_temp = (isnan(v[0]) || (v[0] < QC_MIN_T) || (v[0] > QC_MAX_T)) ? QC_ERR_T : v[0];
+}
+
+void sr_read_mcp2(float *v) {
+  v[0] = mcp2.readTempC();
+}
+
+void sr_read_veml(float *v) {
+  v[0] = veml.readLux(VEML_LUX_AUTO);
+}
+
+void sr_read_pm25aqi(float *v) {
+  v[0] = pm25aqi_obs.max_s10;
+  v[1] = pm25aqi_obs.max_s25;
+  v[2] = pm25aqi_obs.max_s100;
+  v[3] = pm25aqi_obs.max_e10;
+  v[4] = pm25aqi_obs.max_e25;
+  v[5] = pm25aqi_obs.max_e100;
+}
+
+void sr_read_hi(float *v) {
+  sr_heat_index = hi_calculate(sr_mcp1_temp, sr_sht1_humid);
+  v[0] = sr_heat_index;
+}
+
+void sr_read_wbt(float *v) {
+  v[0] = (float) wbt_calculate(sr_mcp1_temp, sr_sht1_humid);
+}
+
+void sr_read_wbgt(float *v) {
+  v[0] = (float) wbgt_calculate(sr_heat_index);
+}
+
+/*
+ * ======================================================================================================================
+ *  Sensor Registry - Observations and the table
+ * ======================================================================================================================
+ */
+#define SR_T   QC_MIN_T,  QC_MAX_T,  QC_ERR_T
+#define SR_RH  QC_MIN_RH, QC_MAX_RH, QC_ERR_RH
+#define SR_P   QC_MIN_P,  QC_MAX_P,  QC_ERR_P
+#define SR_PM  0, 65535, 0                      // Counts from the sensor, not QC'd
+
+const SR_OBS_DEF sr_obs_bmx1[]    = {{SID_BP1, SR_P}, {SID_BT1, SR_T}, {SID_BH1, SR_RH}};
+const SR_OBS_DEF sr_obs_bmx2[]    = {{SID_BP2, SR_P}, {SID_BT2, SR_T}, {SID_BH2, SR_RH}};
+const SR_OBS_DEF sr_obs_htu[]     = {{SID_HH1, SR_RH}, {SID_HT1, SR_T}};
+const SR_OBS_DEF sr_obs_sht1[]    = {{SID_ST1, SR_T}, {SID_SH1, SR_RH}};
+const SR_OBS_DEF sr_obs_sht2[]    = {{SID_ST2, SR_T}, {SID_SH2, SR_RH}};
+const SR_OBS_DEF sr_obs_hih8[]    = {{SID_HT2, SR_T}, {SID_HH2, SR_RH}};
+const SR_OBS_DEF sr_obs_si1145[]  = {
+  {SID_SV1, QC_MIN_VI, QC_MAX_VI, QC_ERR_VI},
+  {SID_SI1, QC_MIN_IR, QC_MAX_IR, QC_ERR_IR},
+  {SID_SU1, QC_MIN_UV, QC_MAX_UV, QC_ERR_UV}};
+const SR_OBS_DEF sr_obs_mcp1[]    = {{SID_MT1, SR_T}};
+const SR_OBS_DEF sr_obs_mcp2[]    = {{SID_MT2, SR_T}};
+const SR_OBS_DEF sr_obs_veml[]    = {{SID_LX, QC_MIN_LX, QC_MAX_LX, QC_ERR_LX}};
+const SR_OBS_DEF sr_obs_pm25aqi[] = {
+  {SID_PM1S10, SR_PM}, {SID_PM1S25, SR_PM}, {SID_PM1S100, SR_PM},
+  {SID_PM1E10, SR_PM}, {SID_PM1E25, SR_PM}, {SID_PM1E100, SR_PM}};
+const SR_OBS_DEF sr_obs_hi[]      = {{SID_HI, QC_MIN_HI, QC_MAX_HI, QC_ERR_HI}};
+const SR_OBS_DEF sr_obs_wbt[]     = {{SID_WBT, SR_T}};
+const SR_OBS_DEF sr_obs_wbgt[]    = {{SID_WBGT, SR_T}};
+
+#define SR_OBS(o)  o, (sizeof(o) / sizeof(o[0]))
+
+const SR_DRIVER sr_drivers[] = {
+  // name    exists           ssb          address          probe             read             clear          depends
+  {"BMX1",   &BMX_1_exists,   SSB_BMX_1,   BMX_ADDRESS_1,   sr_probe_bmx1,    sr_read_bmx1,    NULL,          0, SR_OBS(sr_obs_bmx1)},
+  {"BMX2",   &BMX_2_exists,   SSB_BMX_2,   BMX_ADDRESS_2,   sr_probe_bmx2,    sr_read_bmx2,    NULL,          0, SR_OBS(sr_obs_bmx2)},
+  {"HTU",    &HTU21DF_exists, SSB_HTU21DF, HTU21DF_I2CADDR, sr_probe_htu,     sr_read_htu,     NULL,          0, SR_OBS(sr_obs_htu)},
+  {"SHT1",   &SHT_1_exists,   SSB_SHT_1,   0,               NULL,             sr_read_sht1,    NULL,          0, SR_OBS(sr_obs_sht1)},
+  {"SHT2",   &SHT_2_exists,   SSB_SHT_2,   0,               NULL,             sr_read_sht2,    NULL,          0, SR_OBS(sr_obs_sht2)},
+  {"HIH8",   &HIH8_exists,    SSB_HIH8,    0,               NULL,             sr_read_hih8,    NULL,          0, SR_OBS(sr_obs_hih8)},
+  {"SI",     &SI1145_exists,  SSB_SI1145,  SI1145_ADDR,     sr_probe_si1145,  sr_read_si1145,  NULL,          0, SR_OBS(sr_obs_si1145)},
+  {"MCP1",   &MCP_1_exists,   SSB_MCP_1,   0,               NULL,             sr_read_mcp1,    NULL,          0, SR_OBS(sr_obs_mcp1)}, // Watching it stops updates
+  {"MCP2",   &MCP_2_exists,   SSB_MCP_2,   0,               NULL,             sr_read_mcp2,    NULL,          0, SR_OBS(sr_obs_mcp2)},
+  {"LX",     &VEML7700_exists, 0,          0,               sr_probe_veml,    sr_read_veml,    NULL,          0, SR_OBS(sr_obs_veml)}, // Not enabled, see lux_initialize()
+  {"PM",     &PM25AQI_exists, SSB_PM25AQI, PM25AQI_ADDRESS, sr_probe_pm25aqi, sr_read_pm25aqi, pm25aqi_clear, 0, SR_OBS(sr_obs_pm25aqi)},
+  {"WD",     &AS5600_exists,  SSB_AS5600,  AS5600_ADR,      NULL,             NULL,            NULL,          0, NULL, 0},             // Health check only
+  {"HI",     &HI_exists,      0,           0,               NULL,             sr_read_hi,      NULL,          SSB_MCP_1 | SSB_SHT_1, SR_OBS(sr_obs_hi)},
+  {"WBT",    &WBT_exists,     0,           0,               NULL,             sr_read_wbt,     NULL,          SSB_MCP_1 | SSB_SHT_1, SR_OBS(sr_obs_wbt)},
+  {"WBGT",   &WBGT_exists,    0,           0,               NULL,             sr_read_wbgt,    NULL,          SSB_MCP_1 | SSB_SHT_1, SR_OBS(sr_obs_wbgt)}
+};
+
+#define SR_COUNT   (int)(sizeof(sr_drivers) / sizeof(sr_drivers[0]))
+
+/*
+ * ======================================================================================================================
+ * SR_Available() - Return true if driver d is to be read
+ * ======================================================================================================================
+ */
+bool SR_Available(const SR_DRIVER *d) {
+  return (*d->exists && d->count && d->read && !(SystemStatusBits & d->depends));
+}
+
+/*
+ * ======================================================================================================================
+ * SR_Read() - Read driver d in to v and QC the values. Return number of values.
+ * ======================================================================================================================
+ */
+int SR_Read(const SR_DRIVER *d, float *v) {
+  d->read(v);
+  for (int i=0; i<d->count; i++) {
+    const SR_OBS_DEF *o = &d->obs[i];
+    v[i] = (isnan(v[i]) || (v[i] < o->qc_min) || (v[i] > o->qc_max)) ? o->qc_err : v[i];
+  }
+  return (d->count);
+}
+
+/*
+ * ======================================================================================================================
+ * SR_TakeObservations() - Read every available driver in to obs starting at sensor sidx. Return the next sidx.
+ * ======================================================================================================================
+ */
+int SR_TakeObservations(int sidx) {
+  float v[SR_MAX_VALUES];
+
+  sr_mcp1_temp = 0.0;
+  sr_sht1_humid = 0.0;
+  sr_heat_index = 0.0;
+
+  for (int r=0; r<SR_COUNT; r++) {
+    const SR_DRIVER *d = &sr_drivers[r];
+
+    if (!SR_Available(d)) {
+      continue;
+    }
+    SR_Read(d, v);
+    for (int i=0; i<d->count; i++) {
+      if (obs_names[d->obs[i].id].type == F_OBS) {
+        OBS_AddF(&sidx, d->obs[i].id, v[i]);
+      }
+      else {
+        OBS_AddI(&sidx, d->obs[i].id, (int) v[i]);
+      }
+    }
+    if (d->clear) {
+      d->clear();
+    }
+  }
+  return (sidx);
+}
+
+/*
+ * ======================================================================================================================
+ * SR_MonitorCount() - Number of drivers StationMonitor() cycles through, hardware sensors with observations
+ * ======================================================================================================================
+ */
+int SR_MonitorCount() {
+  int n = 0;
+  for (int r=0; r<SR_COUNT; r++) {
+    if (sr_drivers[r].count && !sr_drivers[r].depends) {
+      n++;
+    }
+  }
+  return (n);
+}
+
+/*
+ * ======================================================================================================================
+ * SR_MonitorLine() - Put the name and values of the nth hardware sensor in msgbuf, "NF" if not found
+ * ======================================================================================================================
+ */
+void SR_MonitorLine(int n) {
+  float v[SR_MAX_VALUES];
+  const SR_DRIVER *d = NULL;
+
+  for (int r=0; r<SR_COUNT; r++) {
+    if (sr_drivers[r].count && !sr_drivers[r].depends && (n-- == 0)) {
+      d = &sr_drivers[r];
+      break;
+    }
+  }
+  if (d == NULL) {
+    msgbuf[0] = 0;
+    return;
+  }
+
+  sprintf (msgbuf, "%s", d->name);
+  if (!*d->exists) {
+    sprintf (msgbuf+strlen(msgbuf), " NF");
+    return;
+  }
+  SR_Read(d, v);
+  for (int i=0; i<d->count; i++) {
+    if (obs_names[d->obs[i].id].type == F_OBS) {
+      int t = (int) round(v[i]*10);   // One decimal place, keep the sign of -0.x
+      sprintf (msgbuf+strlen(msgbuf), " %s%d.%d", (t<0) ? "-" : "", abs(t)/10, abs(t)%10);
+    }
+    else {
+      sprintf (msgbuf+strlen(msgbuf), " %d", (int)v[i]);
+    }
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * SR_ClearStatusBits() - Clear every driver's status bit, called once after the first observation
+ * ======================================================================================================================
+ */
+void SR_ClearStatusBits() {
+  for (int r=0; r<SR_COUNT; r++) {
+    SystemStatusBits &= ~sr_drivers[r].ssb;
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * I2C_Check_Sensors() - See if each watched I2C sensor responds on the bus and take action accordingly             
+ * ======================================================================================================================
+ */
+void I2C_Check_Sensors() {
+  for (int r=0; r<SR_COUNT; r++) {
+    const SR_DRIVER *d = &sr_drivers[r];
+
+    if (d->address == 0) {
+      continue;
+    }
+
+    if (I2C_Device_Exist (d->address)) {
+      // Sensor online but our state had it offline, see if we can bring it online
+      if (!*d->exists && ((d->probe == NULL) || d->probe())) {
+        *d->exists = true;
+        sprintf (msgbuf, "%s ONLINE", d->name);
+        Output (msgbuf);
+        SystemStatusBits &= ~d->ssb; // Turn Off Bit
+      }
+    }
+    else {
+      // Sensor offline but our state has it online
+      if (*d->exists) {
+        *d->exists = false;
+        sprintf (msgbuf, "%s OFFLINE", d->name);
+        Output (msgbuf);
+        SystemStatusBits |= d->ssb;  // Turn On Bit
+      }
+    }
+  }
+}
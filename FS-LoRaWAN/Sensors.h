@@ -358,7 +358,7 @@ void bmx_initialize() {
   BMX_2_chip_id = get_Bosch_ChipID(BMX_ADDRESS_2);
   switch (BMX_2_chip_id) {
     case BMP280_CHIP_ID :
-      if (!bmp1.begin(BMX_ADDRESS_2)) { 
+      if (!bmp2.begin(BMX_ADDRESS_2)) { 
         msgp = (char *) "BMP2 ERR";
         BMX_2_exists = false;
         SystemStatusBits |= SSB_BMX_2;  // Turn On Bit          
@@ -372,7 +372,7 @@ void bmx_initialize() {
 
     case BME280_BMP390_CHIP_ID :
       if (!bme2.begin(BMX_ADDRESS_2)) { 
-        if (!bm31.begin_I2C(BMX_ADDRESS_2)) {  // Perhaps it is a BMP390
+        if (!bm32.begin_I2C(BMX_ADDRESS_2)) {  // Perhaps it is a BMP390
           msgp = (char *) "BMX2 ERR";
           BMX_2_exists = false;
           SystemStatusBits |= SSB_BMX_2;  // Turn On Bit          
@@ -391,7 +391,7 @@ void bmx_initialize() {
     break;
 
     case BMP388_CHIP_ID :
-      if (!bm31.begin_I2C(BMX_ADDRESS_2)) { 
+      if (!bm32.begin_I2C(BMX_ADDRESS_2)) { 
         msgp = (char *) "BM31 ERR";
         BMX_2_exists = false;
         SystemStatusBits |= SSB_BMX_2;  // Turn On Bit          
@@ -902,211 +902,3 @@ void pm25aqi_TakeReading() {
     }
   }
 }
-
-/*
- * ======================================================================================================================
- * I2C_Check_Sensors() - See if each I2C sensor responds on the bus and take action accordingly             
- * ======================================================================================================================
- */
-void I2C_Check_Sensors() {
-
-  // BMX_1 Barometric Pressure 
-  if (I2C_Device_Exist (BMX_ADDRESS_1)) {
-    // Sensor online but our state had it offline
-    if (BMX_1_exists == false) {
-      if (BMX_1_chip_id == BME280_BMP390_CHIP_ID) {
-        if (bmp1.begin(BMX_ADDRESS_1)) { 
-          BMX_1_exists = true;
-          Output ("BMP1 ONLINE");
-          SystemStatusBits &= ~SSB_BMX_1; // Turn Off Bit
-        } 
-      }
-      else if (BMX_1_chip_id == BME280_BMP390_CHIP_ID) {
-        if (bme1.begin(BMX_ADDRESS_1)) { 
-          BMX_1_exists = true;
-          Output ("BME1 ONLINE");
-          SystemStatusBits &= ~SSB_BMX_1; // Turn Off Bit
-        }          
-      }
-      else {
-        if (bm31.begin_I2C(BMX_ADDRESS_1)) { 
-          BMX_1_exists = true;
-          Output ("BM31 ONLINE");
-          SystemStatusBits &= ~SSB_BMX_1; // Turn Off Bit
-        }                  
-      }      
-    }
-  }
-  else {
-    // Sensor offline but our state has it online
-    if (BMX_1_exists == true) {
-      BMX_1_exists = false;
-      Output ("BMX1 OFFLINE");
-      SystemStatusBits |= SSB_BMX_1;  // Turn On Bit 
-    }    
-  }
-
-  // BMX_2 Barometric Pressure 
-  if (I2C_Device_Exist (BMX_ADDRESS_2)) {
-    // Sensor online but our state had it offline
-    if (BMX_2_exists == false) {
-      if (BMX_2_chip_id == BME280_BMP390_CHIP_ID) {
-        if (bmp2.begin(BMX_ADDRESS_2)) { 
-          BMX_2_exists = true;
-          Output ("BMP2 ONLINE");
-          SystemStatusBits &= ~SSB_BMX_2; // Turn Off Bit
-        } 
-      }
-      else if (BMX_2_chip_id == BME280_BMP390_CHIP_ID) {
-        if (bme2.begin(BMX_ADDRESS_2)) { 
-          BMX_2_exists = true;
-          Output ("BME2 ONLINE");
-          SystemStatusBits &= ~SSB_BMX_2; // Turn Off Bit
-        }          
-      }
-      else {
-         if (bm32.begin_I2C(BMX_ADDRESS_2)) { 
-          BMX_2_exists = true;
-          Output ("BM32 ONLINE");
-          SystemStatusBits &= ~SSB_BMX_2; // Turn Off Bit
-        }                         
-      }     
-    }
-  }
-  else {
-    // Sensor offline but we our state has it online
-    if (BMX_2_exists == true) {
-      BMX_2_exists = false;
-      Output ("BMX2 OFFLINE");
-      SystemStatusBits |= SSB_BMX_2;  // Turn On Bit 
-    }    
-  }
-
-  // HTU21DF Humidity & Temp Sensor
-  if (I2C_Device_Exist (HTU21DF_I2CADDR)) {
-    // Sensor online but our state had it offline
-    if (HTU21DF_exists == false) {
-      // See if we can bring sensor online
-      if (htu.begin()) {
-        HTU21DF_exists = true;
-        Output ("HTU ONLINE");
-        SystemStatusBits &= ~SSB_HTU21DF; // Turn Off Bit
-      }
-    }
-  }
-  else {
-    // Sensor offline but we our state has it online
-    if (HTU21DF_exists == true) {
-      HTU21DF_exists = false;
-      Output ("HTU OFFLINE");
-      SystemStatusBits |= SSB_HTU21DF;  // Turn On Bit
-    }   
-  }
-
-#ifdef NOWAY    // Sensor fails to update if this code is enabled
-  // MCP9808 Precision I2C Temperature Sensor
-  if (I2C_Device_Exist (MCP_ADDRESS_1)) {
-    // Sensor online but our state had it offline
-    if (MCP_1_exists == false) {
-      // See if we can bring sensor online
-      if (mcp1.begin(MCP_ADDRESS_1)) {
-        MCP_1_exists = true;
-        Output ("MCP ONLINE");
-        SystemStatusBits &= ~SSB_MCP_1; // Turn Off Bit
-      }
-    }
-  }
-  else {
-    // Sensor offline but we our state has it online
-    if (MCP_1_exists == true) {
-      MCP_1_exists = false;
-      Output ("MCP OFFLINE");
-      SystemStatusBits |= SSB_MCP_1;  // Turn On Bit
-    }   
-  }
-#endif
-
-  // SI1145 UV index & IR & Visible Sensor
-  if (I2C_Device_Exist (SI1145_ADDR)) {
-    // Sensor online but our state had it offline
-    if (SI1145_exists == false) {
-      // See if we can bring sensore online
-      if (uv.begin()) {
-        SI1145_exists = true;
-        Output ("SI ONLINE");
-        SystemStatusBits &= ~SSB_SI1145; // Turn Off Bit
-      }
-    }
-  }
-  else {
-    // Sensor offline but we our state has it online
-    if (SI1145_exists == true) {
-      SI1145_exists = false;
-      Output ("SI OFFLINE");
-      SystemStatusBits |= SSB_SI1145;  // Turn On Bit
-    }   
-  }
-  
-  // AS5600 Wind Direction
-  if (I2C_Device_Exist (AS5600_ADR)) {
-    // Sensor online but our state had it offline
-    if (AS5600_exists == false) {
-      AS5600_exists = true;
-      Output ("WD ONLINE");
-      SystemStatusBits &= ~SSB_AS5600; // Turn Off Bit
-    }
-  }
-  else {
-    // Sensor offline but we our state has it online
-    if (AS5600_exists == true) {
-      AS5600_exists = false;
-      Output ("WD OFFLINE");
-      SystemStatusBits |= SSB_AS5600;  // Turn On Bit
-    }   
-  }
-
-#ifdef NOWAY
-  // VEML7700 Lux 
-  if (I2C_Device_Exist (VEML7700_ADDRESS)) {
-    // Sensor online but our state had it offline
-    if (VEML7700_exists == false) {
-      // See if we can bring sensore online
-      if (veml.begin()) {
-        VEML7700_exists = true;
-        Output ("LUX ONLINE");
-        SystemStatusBits &= ~SSB_LUX; // Turn Off Bit
-      }
-    }
-  }
-  else {
-    // Sensor offline but we our state has it online
-    if (VEML7700_exists == true) {
-      VEML7700_exists = false;
-      Output ("LUX OFFLINE");
-      SystemStatusBits |= SSB_LUX;  // Turn On Bit
-    }   
-  }
-#endif
-
-  // PM25AQI
-  if (I2C_Device_Exist (PM25AQI_ADDRESS)) {
-    // Sensor online but our state had it offline
-    if (PM25AQI_exists == false) {
-      // See if we can bring sensor online
-      if (pmaq.begin_I2C()) {
-        PM25AQI_exists = true;
-        Output ("PM ONLINE");
-        SystemStatusBits &= ~SSB_PM25AQI; // Turn Off Bit
-        pm25aqi_clear();
-      }
-    }
-  }
-  else {
-    // Sensor offline but we our state has it online
-    if (PM25AQI_exists == true) {
-      PM25AQI_exists = false;
-      Output ("PM OFFLINE");
-      SystemStatusBits |= SSB_PM25AQI;  // Turn On Bit
-    }   
-  }
-}
@@ -14,6 +14,184 @@ void HeartBeat(); // Prototype this function to aviod compile function unknown i
 #define RAINGAUGE1_IRQ_PIN  A3
 #define RAINGAUGE2_IRQ_PIN  A4
 
+/*
+ * ======================================================================================================================
+ *  Rain Tips
+ * 
+ *  The interrupt handlers debounce and count tips as before, and also put the millis() time of each tip in a ring.
+ *  The "RG" task calls Rain_TakeReading() every second to take the tips out and turn on the LED, which the
+ *  heartbeat turns off. Nothing but the count and the time is done in the interrupt.
+ *
+ *  Only the handler writes head and only Rain_TipsProcess() writes tail and keep. Tips from keep to tail are the
+ *  ones within RG_RATE_WINDOW of the newest tip processed, the handler will not overwrite them. When the ring is
+ *  full the handler drops the time and counts it in lost, the interrupt count and rain totals are still right.
+ *
+ *  Reported per observation interval when rg_ext=1 in CONFIG.TXT, see Rain_IntervalUpdate()
+ *    Peak Rain Rate   = Most tips in any RG_RATE_WINDOW ending in the interval, as mm/hr. (rr1, rr2)
+ *    Rain Intensity   = Rain from the first to the last tip over their span, as mm/hr.
+ *                       0 with fewer than 2 tips. (ri1, ri2)
+ *    First, Last Tip  = Seconds before the observation of the first and last tip. Only reported
+ *                       with tips in the interval. (rf1, rl1, rf2, rl2)
+ *
+ *  The window holds at most RG_TIP_WINDOW tips, 12mm in a minute, a higher rate reads as 720 mm/hr.
+ *  RAM: 2 x (RG_TIP_RING * 4 + 40) bytes.
+ * ======================================================================================================================
+ */
+#define RG_TIP_RING         64           // Power of 2
+#define RG_TIP_WINDOW       (RG_TIP_RING - 4) // Leaves room for the tips that come in between Rain_TakeReading() calls
+#define RG_RATE_WINDOW      60000        // ms, 1 minute rain rate
+#define RG_TIP_MM           0.2          // mm of rain per tip
+
+typedef struct {
+  volatile unsigned long tip[RG_TIP_RING];  // millis() of each tip
+  volatile unsigned long head;              // Tips put in the ring
+  volatile unsigned long lost;              // Tips dropped because the ring was full
+  unsigned long tail;                       // Tips taken out of the ring
+  unsigned long keep;                       // Oldest tip in the rate window
+  unsigned int tips;                        // Tips taken out this interval
+  unsigned int peak;                        // Most tips in the rate window this interval
+  unsigned long first;                      // millis() of the first and last tip this interval
+  unsigned long last;
+  unsigned int interval_tips;               // Set by Rain_IntervalUpdate(), tips in the interval just ended
+  float rate;
+  float intensity;
+  int first_seconds;
+  int last_seconds;
+} RAIN_TIPS_STR;
+
+RAIN_TIPS_STR raingauge1_tips;
+RAIN_TIPS_STR raingauge2_tips;
+
+/*
+ * ======================================================================================================================
+ *  Rain_TipAdd() - Put a tip time in the ring, called from the interrupt handlers
+ * ======================================================================================================================
+ */
+void Rain_TipAdd(RAIN_TIPS_STR *rt, unsigned long ms) {
+  unsigned long head = rt->head;
+
+  if ((head - rt->keep) < RG_TIP_RING) {
+    rt->tip[head & (RG_TIP_RING-1)] = ms;
+    rt->head = head + 1;  // Publish after the time is stored
+  }
+  else {
+    rt->lost++;
+  }
+}
+
+/*
+ * ======================================================================================================================
+ *  Rain_TipsReset() - Empty the ring and clear the interval
+ * ======================================================================================================================
+ */
+void Rain_TipsReset(RAIN_TIPS_STR *rt) {
+  rt->tail = rt->head;
+  rt->keep = rt->tail;
+  rt->lost = 0;
+  rt->tips = 0;
+  rt->peak = 0;
+  rt->interval_tips = 0;
+  rt->rate = 0.0;
+  rt->intensity = 0.0;
+  rt->first_seconds = 0;
+  rt->last_seconds = 0;
+}
+
+/*
+ * ======================================================================================================================
+ *  Rain_TipsProcess() - Take new tips out of the ring, update the rate window and interval. Return tips taken.
+ * ======================================================================================================================
+ */
+int Rain_TipsProcess(RAIN_TIPS_STR *rt) {
+  unsigned long head = rt->head;
+  unsigned long ms;
+  int n = 0;
+
+  while (rt->tail != head) {
+    ms = rt->tip[rt->tail & (RG_TIP_RING-1)];
+    rt->tail++;
+
+    // Drop tips that are out of the window, the newest tip is always in it
+    while ((ms - rt->tip[rt->keep & (RG_TIP_RING-1)]) >= RG_RATE_WINDOW) {
+      rt->keep++;
+    }
+    if ((rt->tail - rt->keep) > RG_TIP_WINDOW) {
+      rt->keep = rt->tail - RG_TIP_WINDOW;
+    }
+
+    if (rt->tips == 0) {
+      rt->first = ms;
+    }
+    rt->last = ms;
+    rt->tips++;
+    if ((rt->tail - rt->keep) > rt->peak) {
+      rt->peak = rt->tail - rt->keep;
+    }
+    n++;
+  }
+
+  // Free the ring of tips too old to be in any later window
+  ms = millis();
+  while ((rt->keep != rt->tail) && ((ms - rt->tip[rt->keep & (RG_TIP_RING-1)]) >= RG_RATE_WINDOW)) {
+    rt->keep++;
+  }
+  return (n);
+}
+
+/*
+ * ======================================================================================================================
+ *  Rain_IntervalUpdate() - Work out rate, intensity and tip times for the observation. Starts a new interval,
+ *                          the rate window carries over.
+ * ======================================================================================================================
+ */
+void Rain_IntervalUpdate(RAIN_TIPS_STR *rt) {
+  unsigned long now;
+
+  Rain_TipsProcess(rt);
+  now = millis();
+
+  rt->rate = rt->peak * RG_TIP_MM * (3600000.0 / RG_RATE_WINDOW);
+  if ((rt->tips > 1) && (rt->last != rt->first)) {
+    rt->intensity = (rt->tips - 1) * RG_TIP_MM * 3600000.0 / (rt->last - rt->first);
+  }
+  else {
+    rt->intensity = 0.0;
+  }
+  if (rt->tips) {
+    rt->first_seconds = (now - rt->first) / 1000;
+    rt->last_seconds = (now - rt->last) / 1000;
+  }
+
+  if (rt->lost) {
+    sprintf (msgbuf, "RG:Tips Lost %lu", rt->lost);
+    Output (msgbuf);
+    rt->lost = 0;
+  }
+  rt->interval_tips = rt->tips;
+  rt->tips = 0;
+  rt->peak = 0;
+}
+
+/*
+ * ======================================================================================================================
+ *  Rain_TakeReading() - Take tips out of the rings every second. The LED shows a tip, HeartBeat turns it off.
+ * ======================================================================================================================
+ */
+void Rain_TakeReading() {
+  int n = 0;
+
+  if (cf_rg1_enable) {
+    n += Rain_TipsProcess(&raingauge1_tips);
+  }
+  if (cf_rg2_enable) {
+    n += Rain_TipsProcess(&raingauge2_tips);
+  }
+  if (n) {
+    digitalWrite(LED_PIN, HIGH);
+    TurnLedOff = true;
+  }
+}
+
 /*
  * ======================================================================================================================
  *  Rain Gauge 1 - Optipolar Hall Effect Sensor SS451A
@@ -32,10 +210,9 @@ uint64_t raingauge1_interrupt_toi;   // Time of Interrupt
 void raingauge1_interrupt_handler()
 {
   if ((millis() - raingauge1_interrupt_ltime) > 500) { // Count tip if a half second has gone by since last interrupt
-    digitalWrite(LED_PIN, HIGH);
     raingauge1_interrupt_ltime = millis();
     raingauge1_interrupt_count++;
-    TurnLedOff = true;
+    Rain_TipAdd(&raingauge1_tips, millis());
   }   
 }
 
@@ -57,10 +234,9 @@ uint64_t raingauge2_interrupt_toi;   // Time of Interrupt
 void raingauge2_interrupt_handler()
 {
   if ((millis() - raingauge2_interrupt_ltime) > 500) { // Count tip if a half second has gone by since last interrupt
-    digitalWrite(LED_PIN, HIGH);
     raingauge2_interrupt_ltime = millis();
     raingauge2_interrupt_count++;
-    TurnLedOff = true;
+    Rain_TipAdd(&raingauge2_tips, millis());
   }   
 }
 
@@ -74,29 +250,106 @@ void raingauge2_interrupt_handler()
  * 
  *        Station observations are logged every minute
  *        Wind and Direction are sampled every second producing 60 samples 
- *        The one second wind speed sample are produced from the interrupt count and ms duration.
+ *        The interrupt handler puts the micros() time of each pulse in a ring. The one second wind speed sample
+ *        is the number of pulse periods over the time they took, from the last pulse of the previous sample to
+ *        the last pulse of this one. Scheduler jitter does not change the sample.
  *        Wind Observations a 
  *        Reported Observations
  *          Wind Speed = Average of the 60 samples.
  *          Wind Direction = Average of the 60 vectors from Direction and Speed.
- *          Wind Gust = Highest 3 consecutive samples from the 60 samples. The 3 samples are then averaged.
- *          Wind Gust Direction = Average of the 3 Vectors from the Wind Gust samples.
+ *          Wind Gust = Highest cf_ws_gust consecutive samples (default 3, WMO 3 second gust) from the 60 samples.
+ *                      The samples are then averaged.
+ *          Wind Gust Direction = Average of the Vectors from the Wind Gust samples.
+ *
+ *        Wind_AddSample() keeps running sums of the buckets (speed, North South and East West vectors) and a
+ *        deque of gust windows in decreasing sum order, so the observation does not rescan the buckets.
+ *
+ *        Longer windows come from one minute slots. Each slot holds the speed and vector sums of up to 60 samples.
+ *        A slot is closed every 60 samples and at each observation, so slots line up with the observation
+ *        interval. Wind_IntervalUpdate() works out at observation time
+ *          Wind 2 Minute Average   = Speed and Direction from the last 120 samples.  (ws2, wd2)
+ *          Wind 10 Minute Average  = Speed and Direction from the last 600 samples, WMO. (ws10, wd10)
+ *          Wind Interval Average   = Speed and Direction from the slots since the last observation. (wsi, wdi)
+ *          Wind Peak               = Highest gust that ended since the last observation, its direction
+ *                                    and seconds before the observation it ended. (wp, wpd, wpt)
+ *        The observation does not keep step with the 1 s samples, an interval can be 59 or 61 samples (299 or 301)
+ *        and then closes a short slot. Wind_SlotAverage() walks back over the slots by their sample counts and takes
+ *        the part of the oldest slot it needs, as if its samples were evenly spread, so the 2 and 10 minute
+ *        averages always cover 120 and 600 samples once that many have been taken. A short slot costs a slot, one
+ *        every interval at most, WIND_SLOTS allows for that at 1 minute and for 15 minute observations.
+ *        The first gust windows after an observation start with samples from before it.
+ *        These are reported when ws_ext=1 in CONFIG.TXT.
+ *
+ *        RAM: buckets 480, gust deque 488, slots 400 ((WIND_SLOTS+1) * 16) plus about 100 bytes of sums.
+ *        None of it grows with the observation interval. Without WIND_TRIG_LUT slots are 24 bytes each.
+ *
+ *        The SAMD21 has no FPU. With WIND_TRIG_LUT defined the wind vectors are integers in cm/s, sin and cos come
+ *        from a quarter wave table and atan2 from a table with interpolation, see Wind_Sin() and Wind_Atan2().
+ *        Error against libm is about 0.02 degree before the result is truncated to whole degrees. The whole cm/s
+ *        components add to that at low speed, a single 0.2 m/s sample can be 2 degrees off, and sums of light
+ *        variable wind that nearly cancel a few degrees. Integer sums also take a bucket back out exactly.
+ *        Comment it out to use double precision libm. Tools/test/wind_test.cpp measures the tables against libm.
  * ======================================================================================================================
  */
 #define ANEMOMETER_IRQ_PIN  A2
 #define WIND_READINGS       60       // One minute of 1s Samples
+#define WIND_SLOTS          24       // Closed slots, 600 samples when every interval closes a short slot, and 15 minutes
+#define WIND_TRIG_LUT                // Table trig and integer vectors, comment out for libm
+
+#ifdef WIND_TRIG_LUT
+typedef int32_t WIND_VECTOR;         // North South or East West component in cm/s
+#else
+typedef double WIND_VECTOR;          // North South or East West component in m/s
+#endif
 
 typedef struct {
   int direction;
   float speed;
 } WIND_BUCKETS_STR;
 
+typedef struct {
+  float sum;                   // Sum of the window's speeds
+  unsigned long start;         // Sample number of the window's first sample
+} WIND_GUST_WINDOW_STR;
+
+typedef struct {
+  float speed_sum;             // Sums of the slot's samples
+  WIND_VECTOR ns_sum;
+  WIND_VECTOR ew_sum;
+  uint16_t count;              // Samples in the slot
+  uint16_t invalid;            // Samples with direction -1
+} WIND_SLOT_STR;
+
+typedef struct {
+  float speed;                 // Average speed, 0 if no samples
+  int direction;               // Vector average direction, -1 if invalid
+} WIND_AVERAGE_STR;
+
 typedef struct {
   WIND_BUCKETS_STR bucket[WIND_READINGS];
   int bucket_idx;
   float gust;
   int gust_direction;
   int sample_count;
+  unsigned long samples;       // Samples added, bucket of sample n is n % WIND_READINGS
+  double speed_sum;            // Running sums over the buckets
+  WIND_VECTOR ns_sum;
+  WIND_VECTOR ew_sum;
+  int moving;                  // Buckets with speed > 0
+  int invalid;                 // Buckets with direction -1
+  WIND_GUST_WINDOW_STR gust_window[WIND_READINGS+1]; // Deque, window sums decrease from front to back
+  int gust_head;
+  int gust_count;
+  WIND_SLOT_STR slot[WIND_SLOTS+1];  // Ring of one minute slots, WIND_SLOTS closed plus the one being filled
+  int slot_idx;                    // Slot being filled
+  int slot_closed;                 // Slots closed since the last observation
+  float peak;                      // Highest gust since the last observation
+  int peak_direction;
+  unsigned long peak_ms;           // millis() when the peak gust window ended
+  WIND_AVERAGE_STR avg2;           // Set by Wind_IntervalUpdate()
+  WIND_AVERAGE_STR avg10;
+  WIND_AVERAGE_STR avgi;
+  int peak_seconds;                // Seconds before the observation the peak ended
 } WIND_STR;
 WIND_STR wind;
 
@@ -107,9 +360,24 @@ WIND_STR wind;
  */
 bool      AS5600_exists     = true;
 int       AS5600_ADR        = 0x36;
-const int AS5600_raw_ang_hi = 0x0c;
+const int AS5600_raw_ang_hi = 0x0c;  // Read as a pair, the address auto increments to raw_ang_lo
 const int AS5600_raw_ang_lo = 0x0d;
 
+/*
+ * ======================================================================================================================
+ *  Wind Direction Oversampling - wd_samples in CONFIG.TXT
+ * 
+ *  With wd_samples > 1 the "WD" task reads the vane wd_samples times a second and sums unit vectors. The 1s wind
+ *  sample uses the vector average of those reads, which smooths vane flutter. Any failed read makes the sample -1.
+ * ======================================================================================================================
+ */
+#define WD_SAMPLES_MAX      10
+
+WIND_VECTOR wd_os_ns = 0;           // Sums of unit vectors since the last wind sample
+WIND_VECTOR wd_os_ew = 0;
+int wd_os_count = 0;                // Reads summed
+bool wd_os_invalid = false;         // A read failed
+
 /*
  * ======================================================================================================================
  *  Wind Speed Calibration
@@ -121,11 +389,26 @@ float ws_radius = 0.079;           // In meters
 /*
  * ======================================================================================================================
  *  Optipolar Hall Effect Sensor SS451A - Interrupt 1 - Anemometer
+ * 
+ *  Pulse times are passed from the interrupt handler without disabling interrupts. Only the handler writes
+ *  anemometer_pulse_head and only Wind_SampleSpeed() writes anemometer_pulse_tail. When the ring is full the
+ *  handler drops the time and counts it in anemometer_pulse_lost, the sample then falls back to the interrupt count.
+ *  128 entries is over a second of pulses at 75 m/s.
  * ======================================================================================================================
  */
+#define WS_PULSE_RING       128          // Power of 2
+#define WS_PULSE_MAXGAP     3000000      // us, a pulse older than this does not start a period, speed is 0
+
 volatile unsigned int anemometer_interrupt_count;
 unsigned long anemometer_interrupt_stime;
 
+volatile unsigned long anemometer_pulse_time[WS_PULSE_RING]; // micros() of each pulse
+volatile unsigned long anemometer_pulse_head = 0;            // Pulses put in the ring
+volatile unsigned long anemometer_pulse_tail = 0;            // Pulses taken out of the ring
+volatile unsigned long anemometer_pulse_lost = 0;            // Pulses dropped because the ring was full
+unsigned long anemometer_pulse_last = 0;                     // micros() of the last pulse taken out
+bool anemometer_pulse_valid = false;                         // anemometer_pulse_last is set
+float anemometer_pulse_speed = 0.0;                          // Speed over the last pulse period
 
 /*
  * ======================================================================================================================
@@ -134,19 +417,103 @@ unsigned long anemometer_interrupt_stime;
  */
 void anemometer_interrupt_handler()
 {
+  unsigned long head = anemometer_pulse_head;
+
   anemometer_interrupt_count++;
+  if ((head - anemometer_pulse_tail) < WS_PULSE_RING) {
+    anemometer_pulse_time[head & (WS_PULSE_RING-1)] = micros();
+    anemometer_pulse_head = head + 1;  // Publish after the time is stored
+  }
+  else {
+    anemometer_pulse_lost++;
+  }
+}
+
+/* 
+ *=======================================================================================================================
+ * Wind_PulseReset() - Empty the pulse ring and forget the last pulse. Call with the interrupt count cleared.
+ *=======================================================================================================================
+ */
+void Wind_PulseReset() {
+  anemometer_pulse_tail = anemometer_pulse_head;
+  anemometer_pulse_lost = 0;
+  anemometer_pulse_valid = false;
+  anemometer_pulse_speed = 0.0;
 }
 
 /* 
  *=======================================================================================================================
- * Wind_SampleSpeed() - Return a wind speed based on interrupts and duration wind
+ * Wind_SampleSpeed() - Return a wind speed from the pulse periods since the last sample
  * 
  * Optipolar Hall Effect Sensor SS451A - Anemometer
  * speed  = (( (signals/2) * (2 * pi * radius) ) / time) * calibration_factor
- * speed in m/s =  (   ( (interrupts/2) * (2 * 3.14156 * 0.079) )  / (time_period in ms / 1000)  )  * 2.64
+ * speed in m/s =  (   ( (pulse periods/2) * (2 * 3.14156 * 0.079) )  / (time_period in us / 1000000)  )  * 2.64
+ *
+ * With no pulse since the last sample the speed is the last period's speed until that period has passed, then
+ * the fastest speed that could have gone without a pulse. 0 after WS_PULSE_MAXGAP.
+ * If pulses were lost the sample is taken from the interrupt count, see Wind_SampleCount(), and the next sample's
+ * periods start at its own first pulse.
  *=======================================================================================================================
  */
+float Wind_SampleCount(); // Prototype this function to aviod compile function unknown issue.
+
 float Wind_SampleSpeed() {
+  unsigned long head = anemometer_pulse_head;
+  unsigned long tail = anemometer_pulse_tail;
+  unsigned long first, last, span;
+  unsigned long periods;
+  float meters = 3.14156 * ws_radius * ws_calibration;   // Distance for one pulse
+
+  if (anemometer_pulse_lost) {
+    anemometer_pulse_lost = 0;
+    anemometer_pulse_valid = false;  // Newest pulse in the ring is older than the ones dropped
+    anemometer_pulse_tail = head;
+    return (Wind_SampleCount());
+  }
+
+  anemometer_interrupt_count = 0;
+  anemometer_interrupt_stime = millis();
+
+  if (head == tail) {
+    if (anemometer_pulse_valid) {
+      span = micros() - anemometer_pulse_last;
+      if (span > WS_PULSE_MAXGAP) {
+        anemometer_pulse_valid = false;
+        anemometer_pulse_speed = 0.0;
+      }
+      else if ((meters * 1000000.0 / span) < anemometer_pulse_speed) {
+        return (meters * 1000000.0 / span);
+      }
+      return (anemometer_pulse_speed);
+    }
+    return (0.0);
+  }
+
+  first = anemometer_pulse_time[tail & (WS_PULSE_RING-1)];
+  last = anemometer_pulse_time[(head-1) & (WS_PULSE_RING-1)];
+  periods = head - tail - 1;
+  if (anemometer_pulse_valid && ((first - anemometer_pulse_last) <= WS_PULSE_MAXGAP)) {
+    first = anemometer_pulse_last;   // Period from the previous sample's last pulse
+    periods++;
+  }
+  anemometer_pulse_tail = head;      // Free the ring for the handler
+  anemometer_pulse_last = last;
+  anemometer_pulse_valid = true;
+
+  span = last - first;
+  if ((periods == 0) || (span == 0)) {
+    return (0.0);                    // First pulse after calm, no period yet
+  }
+  anemometer_pulse_speed = ((float) periods * meters * 1000000.0) / (float) span;
+  return (anemometer_pulse_speed);
+}
+
+/* 
+ *=======================================================================================================================
+ * Wind_SampleCount() - Return a wind speed based on interrupts and duration wind
+ *=======================================================================================================================
+ */
+float Wind_SampleCount() {
   unsigned long delta_ms, time_ms;
   float wind_speed;
   
@@ -176,52 +543,40 @@ float Wind_SampleSpeed() {
 /* 
  *=======================================================================================================================
  * Wind_SampleDirection() -- Talk i2c to the AS5600 sensor and get direction
+ * 
+ *   Raw angle hi and lo are read in one 2 byte transaction. Reading them one at a time let the vane move between
+ *   the reads, so a read crossing a byte boundary (0x0FF to 0x100) could be off by up to 22 degrees.
  *=======================================================================================================================
  */
 int Wind_SampleDirection() {
   int degree;
   
-  // Read Raw Angle Low Byte
   Wire.beginTransmission(AS5600_ADR);
-  Wire.write(AS5600_raw_ang_lo);
+  Wire.write(AS5600_raw_ang_hi);
   if (Wire.endTransmission()) {
     if (AS5600_exists) {
-      Output ("WD Offline_L");
+      Output ("WD Offline");
     }
     AS5600_exists = false;
   }
-  else if (Wire.requestFrom(AS5600_ADR, 1)) {
-    int AS5600_lo_raw = Wire.read();
-  
-    // Read Raw Angle High Byte
-    Wire.beginTransmission(AS5600_ADR);
-    Wire.write(AS5600_raw_ang_hi);
-    if (Wire.endTransmission()) {
-      if (AS5600_exists) {
-        Output ("WD Offline_H");
-      }
-      AS5600_exists = false;
+  else if (Wire.requestFrom(AS5600_ADR, 2) == 2) {
+    word AS5600_raw = Wire.read();     // raw_ang_hi
+    AS5600_raw = (AS5600_raw << 8) | Wire.read(); // raw_ang_lo
+    AS5600_raw &= 0x0FFF;              // 12 bit angle, upper nibble is unused
+
+    if (!AS5600_exists) {
+      Output ("WD Online");
     }
-    else if (Wire.requestFrom(AS5600_ADR, 1)) {
-      word AS5600_hi_raw = Wire.read();
+    AS5600_exists = true;           // We made it 
+    SystemStatusBits &= ~SSB_AS5600; // Turn Off Bit
 
-      if (!AS5600_exists) {
-        Output ("WD Online");
-      }
-      AS5600_exists = true;           // We made it 
-      SystemStatusBits &= ~SSB_AS5600; // Turn Off Bit
-      
-      AS5600_hi_raw = AS5600_hi_raw << 8; //shift raw angle hi 8 left
-      AS5600_hi_raw = AS5600_hi_raw | AS5600_lo_raw; //AND high and low raw angle value
-
-      // Do data integ check
-      degree = (int) AS5600_hi_raw * 0.0879;
-      if ((degree >=0) && (degree <= 360)) {
-        return (degree);
-      }
-      else {
-        return (-1);
-      }
+    // Do data integ check
+    degree = (int) AS5600_raw * 0.0879;
+    if ((degree >=0) && (degree <= 360)) {
+      return (degree);
+    }
+    else {
+      return (-1);
     }
   }
   SystemStatusBits |= SSB_AS5600;  // Turn On Bit
@@ -230,51 +585,197 @@ int Wind_SampleDirection() {
 
 /* 
  *=======================================================================================================================
- * Wind_DirectionVector()
+ * Wind Vector Trig - Degrees in, North South (cos) and East West (sin) components out
  *=======================================================================================================================
  */
-int Wind_DirectionVector() {
-  double NS_vector_sum = 0.0;
-  double EW_vector_sum = 0.0;
-  double r;
-  float s;
-  int d, i, rtod;
-  bool ws_zero = true;
+#ifdef WIND_TRIG_LUT
+// sin(0..90 degrees) * 32767
+const int16_t wind_sin_table[91] = {
+  0, 572, 1144, 1715, 2286, 2856, 3425, 3993, 4560, 5126,
+  5690, 6252, 6813, 7371, 7927, 8481, 9032, 9580, 10126, 10668,
+  11207, 11743, 12275, 12803, 13328, 13848, 14364, 14876, 15383, 15886,
+  16383, 16876, 17364, 17846, 18323, 18794, 19260, 19720, 20173, 20621,
+  21062, 21497, 21925, 22347, 22762, 23170, 23571, 23964, 24351, 24730,
+  25101, 25465, 25821, 26169, 26509, 26841, 27165, 27481, 27788, 28087,
+  28377, 28659, 28932, 29196, 29451, 29697, 29934, 30162, 30381, 30591,
+  30791, 30982, 31163, 31335, 31498, 31650, 31794, 31927, 32051, 32165,
+  32269, 32364, 32448, 32523, 32587, 32642, 32687, 32722, 32747, 32762,
+  32767
+};
 
-  for (i=0; i<WIND_READINGS; i++) {
-    d = wind.bucket[i].direction;
+// atan(i/64) in hundredths of a degree
+const int16_t wind_atan_table[65] = {
+  0, 90, 179, 268, 358, 447, 536, 624, 713, 800,
+  888, 975, 1062, 1148, 1234, 1319, 1404, 1488, 1571, 1653,
+  1735, 1817, 1897, 1977, 2056, 2134, 2211, 2287, 2363, 2438,
+  2511, 2584, 2657, 2728, 2798, 2867, 2936, 3003, 3070, 3136,
+  3201, 3264, 3327, 3390, 3451, 3511, 3571, 3629, 3687, 3744,
+  3800, 3855, 3909, 3963, 4016, 4067, 4119, 4169, 4218, 4267,
+  4315, 4363, 4409, 4455, 4500
+};
 
-    // if at any time 1 of the 60 wind direction readings is -1
-    // then the sensor was offline and we need to invalidate or data
-    // until it is clean with out any -1's
-    if (d == -1) {
-      return (-1);
-    }
-    
-    s = wind.bucket[i].speed;
+/* 
+ *=======================================================================================================================
+ * Wind_Sin() - sin of whole degrees * 32767
+ *=======================================================================================================================
+ */
+int32_t Wind_Sin(int d) {
+  d = d % 360;
+  if (d < 90) {
+    return (wind_sin_table[d]);
+  }
+  if (d < 180) {
+    return (wind_sin_table[180-d]);
+  }
+  if (d < 270) {
+    return (-wind_sin_table[d-180]);
+  }
+  return (-wind_sin_table[360-d]);
+}
 
-    // Flag we have wind speed
-    if (s > 0) {
-      ws_zero = false;  
-    }
-    r = (d * 71) / 4068.0;
-    
-    // North South Direction 
-    NS_vector_sum += cos(r) * s;
-    EW_vector_sum += sin(r) * s;
+/* 
+ *=======================================================================================================================
+ * Wind_Atan2() - atan2(y, x) in hundredths of a degree, -18000 to 18000
+ *=======================================================================================================================
+ */
+int32_t Wind_Atan2(int32_t y, int32_t x) {
+  uint32_t ax = (x < 0) ? -x : x;
+  uint32_t ay = (y < 0) ? -y : y;
+  uint32_t mx = (ax > ay) ? ax : ay;
+  uint32_t mn = (ax > ay) ? ay : ax;
+  uint32_t r, i;
+  int32_t a;
+
+  if (mx == 0) {
+    return (0);
+  }
+  while (mx > 0x7FFF) {  // Keep mn << 14 in 32 bits
+    mx >>= 1;
+    mn >>= 1;
+  }
+  r = (mn << 14) / mx;   // mn/mx, 0 to 1 in 1/16384
+  i = r >> 8;
+  if (i >= 64) {
+    a = wind_atan_table[64];
   }
-  rtod = (atan2(EW_vector_sum, NS_vector_sum)*4068.0)/71.0;
+  else {
+    a = wind_atan_table[i] + (((wind_atan_table[i+1] - wind_atan_table[i]) * (int32_t)(r & 0xFF)) >> 8);
+  }
+  if (ay > ax) {
+    a = 9000 - a;
+  }
+  if (x < 0) {
+    a = 18000 - a;
+  }
+  return ((y < 0) ? -a : a);
+}
+#endif
+
+/* 
+ *=======================================================================================================================
+ * Wind_Vector() - North South and East West components of a sample
+ *=======================================================================================================================
+ */
+void Wind_Vector(int d, float s, WIND_VECTOR *ns, WIND_VECTOR *ew) {
+#ifdef WIND_TRIG_LUT
+  int32_t cm = (s < 655.0) ? (int32_t) (s * 100.0 + 0.5) : 65535;  // Keeps cm * 32767 in 32 bits
+
+  *ns = (cm * Wind_Sin(d + 90) + 16384) >> 15;
+  *ew = (cm * Wind_Sin(d) + 16384) >> 15;
+#else
+  double r = (d * 71) / 4068.0;
+  
+  *ns = cos(r) * s;
+  *ew = sin(r) * s;
+#endif
+}
+
+/* 
+ *=======================================================================================================================
+ * Wind_VectorDirection() - Direction 0-359 of summed North South and East West components
+ *=======================================================================================================================
+ */
+int Wind_VectorDirection(WIND_VECTOR ns, WIND_VECTOR ew) {
+  int rtod;
+
+#ifdef WIND_TRIG_LUT
+  rtod = Wind_Atan2(ew, ns) / 100;
+#else
+  rtod = (atan2(ew, ns)*4068.0)/71.0;
+#endif
   if (rtod<0) {
     rtod = 360 + rtod;
   }
+  return (rtod);
+}
 
-  // If all the winds speeds are 0 then we return current wind direction or 0 on failure of that.
-  if (ws_zero) {
-    return (Wind_SampleDirection()); // Can return -1
+/* 
+ *=======================================================================================================================
+ * Wind_OversampleDirection() -- Read the vane and add it to the oversample sums, called by the "WD" task
+ *=======================================================================================================================
+ */
+void Wind_OversampleDirection() {
+  int degree = Wind_SampleDirection();
+  WIND_VECTOR ns, ew;
+
+  if (degree < 0) {
+    wd_os_invalid = true;
   }
   else {
-    return (rtod);
+    Wind_Vector(degree, 100.0, &ns, &ew);  // Unit vector, scaled so integer vectors keep resolution
+    wd_os_ns += ns;
+    wd_os_ew += ew;
   }
+  wd_os_count++;
+}
+
+/* 
+ *=======================================================================================================================
+ * Wind_OversampledDirection() -- Return the vector average of the reads since the last call and clear the sums.
+ *                                Falls back to a single read if the "WD" task has not run.
+ *=======================================================================================================================
+ */
+int Wind_OversampledDirection() {
+  int degree;
+
+  if (wd_os_count == 0) {
+    return (Wind_SampleDirection());
+  }
+
+  if (wd_os_invalid) {
+    degree = -1;
+  }
+  else if ((wd_os_ns == 0) && (wd_os_ew == 0)) {
+    degree = Wind_SampleDirection();  // Reads cancelled out, take what the vane says now
+  }
+  else {
+    degree = Wind_VectorDirection(wd_os_ns, wd_os_ew);
+  }
+  wd_os_ns = 0;
+  wd_os_ew = 0;
+  wd_os_count = 0;
+  wd_os_invalid = false;
+  return (degree);
+}
+
+/* 
+ *=======================================================================================================================
+ * Wind_DirectionVector() - Average of the 60 vectors from Direction and Speed
+ *=======================================================================================================================
+ */
+int Wind_DirectionVector() {
+  // if at any time 1 of the 60 wind direction readings is -1
+  // then the sensor was offline and we need to invalidate or data
+  // until it is clean with out any -1's
+  if (wind.invalid) {
+    return (-1);
+  }
+
+  // If all the winds speeds are 0 then we return current wind direction or 0 on failure of that.
+  if (!wind.moving) {
+    return (Wind_SampleDirection()); // Can return -1
+  }
+  return (Wind_VectorDirection(wind.ns_sum, wind.ew_sum));
 }
 
 /* 
@@ -283,12 +784,10 @@ int Wind_DirectionVector() {
  *=======================================================================================================================
  */
 float Wind_SpeedAverage() {
-  float wind_speed = 0.0;
-  for (int i=0; i<WIND_READINGS; i++) {
-    // sum wind speeds for later average
-    wind_speed += wind.bucket[i].speed;
+  if (!wind.moving || (wind.speed_sum < 0)) {
+    return (0.0);  // Running sum can be a rounding error off zero
   }
-  return( wind_speed / (float) WIND_READINGS);
+  return ((float) (wind.speed_sum / WIND_READINGS));
 }
 
 /* 
@@ -312,48 +811,41 @@ int Wind_GustDirection() {
 /* 
  *=======================================================================================================================
  * Wind_GustUpdate()
- *   Wind Gust = Highest 3 consecutive samples from the 60 samples. The 3 samples are then averaged.
- *   Wind Gust Direction = Average of the 3 Vectors from the Wind Gust samples.
+ *   Wind Gust = Highest cf_ws_gust consecutive samples from the 60 samples. The samples are then averaged.
+ *   Wind Gust Direction = Average of the Vectors from the Wind Gust samples.
  * 
  *   Note: To handle the case of 2 or more gusts at the same speed but different directions
- *          Sstart with oldest reading and work forward to report most recent.
- * 
- *   Algorithm: 
- *     Start with oldest reading.
- *     Sum this reading with next 2.
- *     If greater than last, update last 
+ *          report the most recent.
  * 
+ *   The highest window is at the front of the gust deque, see Wind_GustWindow().
  *=======================================================================================================================
  */
+int Wind_WindowDirection(int bucket, int n); // Prototype this function to aviod compile function unknown issue.
+
 void Wind_GustUpdate() {
-  int bucket = wind.bucket_idx; // Start at next bucket to fill (aka oldest reading)
-  float ws_sum = 0.0;
-  int ws_bucket = bucket;
-  float sum;
-
-  for (int i=0; i<(WIND_READINGS-2); i++) {  // subtract 2 because we are looking ahead at the next 2 buckets
-    // sum wind speeds 
-    sum = wind.bucket[bucket].speed +
-          wind.bucket[(bucket+1) % WIND_READINGS].speed +
-          wind.bucket[(bucket+2) % WIND_READINGS].speed;
-    if (sum >= ws_sum) {
-      ws_sum = sum;
-      ws_bucket = bucket;
-    }
-    bucket = (++bucket) % WIND_READINGS;
+  if (wind.gust_count == 0) {
+    wind.gust = 0.0;
+    wind.gust_direction = -1;
+    return;
   }
-  wind.gust = ws_sum/3;
-  
-  // Determine Gust Direction 
-  double NS_vector_sum = 0.0;
-  double EW_vector_sum = 0.0;
-  double r;
+  wind.gust = wind.gust_window[wind.gust_head].sum/cf_ws_gust;
+  wind.gust_direction = Wind_WindowDirection(wind.gust_window[wind.gust_head].start % WIND_READINGS, cf_ws_gust);
+}
+
+/* 
+ *=======================================================================================================================
+ * Wind_WindowDirection() - Average of the Vectors of n buckets from bucket. -1 if calm or a direction is -1
+ *=======================================================================================================================
+ */
+int Wind_WindowDirection(int bucket, int n) {
+  WIND_VECTOR NS_vector_sum = 0;
+  WIND_VECTOR EW_vector_sum = 0;
+  WIND_VECTOR ns, ew;
   float s;
-  int d, i, rtod;
+  int d, i;
   bool ws_zero = true;
 
-  bucket = ws_bucket;
-  for (i=0; i<3; i++) {
+  for (i=0; i<n; i++) {
     d = wind.bucket[bucket].direction;
 
     // if at any time any wind direction readings is -1
@@ -370,27 +862,238 @@ void Wind_GustUpdate() {
     if (s > 0) {
       ws_zero = false;  
     }
-    r = (d * 71) / 4068.0;
     
     // North South Direction 
-    NS_vector_sum += cos(r) * s;
-    EW_vector_sum += sin(r) * s;
+    Wind_Vector(d, s, &ns, &ew);
+    NS_vector_sum += ns;
+    EW_vector_sum += ew;
 
     bucket = (++bucket) % WIND_READINGS;
   }
 
-  rtod = (atan2(EW_vector_sum, NS_vector_sum)*4068.0)/71.0;
-  if (rtod<0) {
-    rtod = 360 + rtod;
-  }
-
   // If all the winds speeds are 0 or we has a -1 direction then set -1 dor direction.
   if (ws_zero) {
-    wind.gust_direction = -1;
+    return (-1);
+  }
+  return (Wind_VectorDirection(NS_vector_sum, EW_vector_sum));
+}
+
+/*
+ * ======================================================================================================================
+ * Wind_BucketSums() - Add (sign 1) or remove (sign -1) a bucket from the running sums
+ * ======================================================================================================================
+ */
+void Wind_BucketSums(WIND_BUCKETS_STR *b, int sign) {
+  WIND_VECTOR ns, ew;
+
+  wind.speed_sum += sign * b->speed;
+  if (b->speed > 0) {
+    wind.moving += sign;
+  }
+  if (b->direction == -1) {
+    wind.invalid += sign;
+    if (sign > 0) {
+      wind.slot[wind.slot_idx].invalid++;
+    }
+  }
+  else {
+    Wind_Vector(b->direction, b->speed, &ns, &ew);
+    wind.ns_sum += sign * ns;
+    wind.ew_sum += sign * ew;
+    if (sign > 0) {
+      wind.slot[wind.slot_idx].ns_sum += ns;
+      wind.slot[wind.slot_idx].ew_sum += ew;
+    }
+  }
+  if (sign > 0) {
+    wind.slot[wind.slot_idx].speed_sum += b->speed;
+    wind.slot[wind.slot_idx].count++;
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * Wind_GustWindow() - Add the window ending at the newest sample to the gust deque
+ * 
+ *   Windows at the back with a sum no larger than the new one can never be the gust again, the new window is more
+ *   recent. Windows at the front are dropped once their first sample has left the buckets.
+ * ======================================================================================================================
+ */
+void Wind_GustWindow() {
+  int n = cf_ws_gust;
+  unsigned long start;
+  float sum = 0.0;
+  int back;
+
+  if (wind.samples < (unsigned long) n) {
+    return;
+  }
+  start = wind.samples - n;
+  for (int j=0; j<n; j++) {
+    sum += wind.bucket[(start+j) % WIND_READINGS].speed;
+  }
+
+  while (wind.gust_count) {
+    back = (wind.gust_head + wind.gust_count - 1) % (WIND_READINGS+1);
+    if (wind.gust_window[back].sum > sum) {
+      break;
+    }
+    wind.gust_count--;
+  }
+  back = (wind.gust_head + wind.gust_count) % (WIND_READINGS+1);
+  wind.gust_window[back].sum = sum;
+  wind.gust_window[back].start = start;
+  wind.gust_count++;
+
+  while ((wind.samples - wind.gust_window[wind.gust_head].start) > WIND_READINGS) {
+    wind.gust_head = (wind.gust_head + 1) % (WIND_READINGS+1);
+    wind.gust_count--;
+  }
+
+  // Peak gust of the observation interval, the latest of equal gusts like Wind_GustUpdate()
+  if ((sum/n) >= wind.peak) {
+    wind.peak = sum/n;
+    wind.peak_direction = Wind_WindowDirection(start % WIND_READINGS, n);
+    wind.peak_ms = millis();
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * Wind_SlotClose() - Start a new one minute slot if the current one has samples
+ * ======================================================================================================================
+ */
+void Wind_SlotClose() {
+  if (wind.slot[wind.slot_idx].count == 0) {
+    return;
+  }
+  wind.slot_idx = (wind.slot_idx + 1) % (WIND_SLOTS+1);
+  memset(&wind.slot[wind.slot_idx], 0, sizeof(WIND_SLOT_STR));
+  if (wind.slot_closed < WIND_SLOTS) {
+    wind.slot_closed++;
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * Wind_SlotAverage() - Average speed and direction of the last samples samples in the last n closed slots, all of
+ *                      them when samples is 0. Part of the oldest slot is taken when it holds more than are needed.
+ *
+ *   Direction follows Wind_DirectionVector(), -1 if any sample's direction was -1 and the current direction
+ *   if there was no wind.
+ * ======================================================================================================================
+ */
+WIND_AVERAGE_STR Wind_SlotAverage(int n, unsigned long samples) {
+  WIND_AVERAGE_STR avg;
+  double speed_sum = 0.0;
+  WIND_VECTOR NS_vector_sum = 0;
+  WIND_VECTOR EW_vector_sum = 0;
+  unsigned long count = 0;
+  bool invalid = false;
+  int s = wind.slot_idx;
+
+  for (int i=0; (i<n) && (!samples || (count < samples)); i++) {
+    s = (s + WIND_SLOTS) % (WIND_SLOTS+1);  // Closed slots are behind the one being filled
+    if (samples && (count + wind.slot[s].count > samples)) {
+      double part = (double) (samples - count) / wind.slot[s].count;
+
+      speed_sum += wind.slot[s].speed_sum * part;
+      NS_vector_sum += (WIND_VECTOR) (wind.slot[s].ns_sum * part);
+      EW_vector_sum += (WIND_VECTOR) (wind.slot[s].ew_sum * part);
+      count = samples;
+    }
+    else {
+      speed_sum += wind.slot[s].speed_sum;
+      NS_vector_sum += wind.slot[s].ns_sum;
+      EW_vector_sum += wind.slot[s].ew_sum;
+      count += wind.slot[s].count;
+    }
+    if (wind.slot[s].invalid) {
+      invalid = true;
+    }
+  }
+
+  avg.speed = (count && (speed_sum > 0)) ? (float) (speed_sum / count) : 0.0;
+  if (invalid) {
+    avg.direction = -1;
+  }
+  else if (avg.speed == 0.0) {
+    avg.direction = Wind_SampleDirection(); // Can return -1
   }
   else {
-    wind.gust_direction = rtod;
+    avg.direction = Wind_VectorDirection(NS_vector_sum, EW_vector_sum);
+  }
+  return (avg);
+}
+
+/*
+ * ======================================================================================================================
+ * Wind_IntervalUpdate() - Close the slot and work out the averages and peak for the observation. Starts a new
+ *                         interval.
+ * ======================================================================================================================
+ */
+void Wind_IntervalUpdate() {
+  Wind_SlotClose();
+
+  wind.avg2 = Wind_SlotAverage(WIND_SLOTS, 2 * WIND_READINGS);
+  wind.avg10 = Wind_SlotAverage(WIND_SLOTS, 10 * WIND_READINGS);
+  wind.avgi = Wind_SlotAverage(wind.slot_closed, 0);
+  wind.peak_seconds = (millis() - wind.peak_ms) / 1000;
+
+  wind.slot_closed = 0;
+}
+
+/*
+ * ======================================================================================================================
+ * Wind_PeakClear() - Start looking for a new peak gust, after the observation has reported the last one
+ * ======================================================================================================================
+ */
+void Wind_PeakClear() {
+  wind.peak = 0.0;
+  wind.peak_direction = -1;
+  wind.peak_ms = millis();
+}
+
+/*
+ * ======================================================================================================================
+ * Wind_AddSample() - Replace the oldest bucket with a sample and update the running sums
+ * ======================================================================================================================
+ */
+void Wind_AddSample(int direction, float speed) {
+  WIND_BUCKETS_STR *b = &wind.bucket[wind.bucket_idx];
+
+  Wind_BucketSums(b, -1);
+  b->direction = direction;
+  b->speed = speed;
+  Wind_BucketSums(b, 1);
+
+  wind.bucket_idx = (++wind.bucket_idx) % WIND_READINGS; // Advance bucket index for next reading
+  wind.samples++;
+  Wind_GustWindow();
+
+  if (wind.slot[wind.slot_idx].count >= WIND_READINGS) {
+    Wind_SlotClose();
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * Wind_Initialize() - Fill the buckets with calm samples and clear the gust
+ * ======================================================================================================================
+ */
+void Wind_Initialize() {
+  memset(&wind, 0, sizeof(wind));
+  for (int i=0; i<WIND_READINGS; i++) {
+    Wind_AddSample(0, 0.0);
   }
+  wind.gust = 0.0;
+  wind.gust_direction = -1;
+
+  // Calm fill is not a real minute, the slots start empty
+  memset(wind.slot, 0, sizeof(wind.slot));
+  wind.slot_idx = 0;
+  wind.slot_closed = 0;
+  Wind_PeakClear();
 }
 
 /*
@@ -408,9 +1111,9 @@ void Wind_ClearSampleCount() {
  * ======================================================================================================================
  */
 void Wind_TakeReading() {
-  wind.bucket[wind.bucket_idx].direction = (int) Wind_SampleDirection();
-  wind.bucket[wind.bucket_idx].speed = Wind_SampleSpeed();
-  wind.bucket_idx = (++wind.bucket_idx) % WIND_READINGS; // Advance bucket index for next reading
+  int direction = (cf_wd_samples > 1) ? Wind_OversampledDirection() : Wind_SampleDirection();
+
+  Wind_AddSample(direction, Wind_SampleSpeed());
   wind.sample_count++;
 }
 
@@ -436,13 +1139,131 @@ void as5600_initialize() {
 /*
  * =======================================================================================================================
  *  Distance Gauge -
+ * 
+ *  dg_buckets is a ring of the last 60 readings in the order taken. dg_sorted holds the same readings in
+ *  ascending order. Each reading replaces the oldest one in both, so DS_Median() is a lookup and never
+ *  reorders the ring.
+ *
+ *  With ds_samples > 1 in CONFIG.TXT the "DSS" task reads the ADC ds_samples times a second, spread across the
+ *  sensor's ranging cycles. DS_TakeReading() then filters them in to the 1s reading, see DS_Filter(). Samples
+ *  further than DS_MAD_LIMIT median absolute deviations from the median are dropped as echo noise and the rest
+ *  averaged. The ADC's hardware averaging is not used as it would average the outliers in before they could
+ *  be dropped. The observation adds
+ *    Distance Spread  = Interquartile range of the 60 readings, same units as ds. (dsr)
+ *    Distance Quality = Percent of samples kept since the last observation. (dsq)
  * =======================================================================================================================
  */
 #define DISTANCE_GAUGE_PIN  A5
 #define DG_BUCKETS          60
+#define DS_SAMPLES_MAX      10
+#define DS_MAD_LIMIT        4.45              // Outlier if further than this many MADs from the median, 3 sigma
 unsigned int dg_bucket = 0;
 unsigned int dg_divideby = 4;                 // Default divisor of sensor reading is for the 10m, 5m is 8
 unsigned int dg_buckets[DG_BUCKETS];
+unsigned int dg_sorted[DG_BUCKETS];           // dg_buckets in ascending order
+unsigned int ds_samples[DS_SAMPLES_MAX];      // Raw ADC samples since the last reading
+int ds_sample_count = 0;
+unsigned long ds_samples_taken = 0;           // Since the last DS_Quality() call
+unsigned long ds_samples_kept = 0;
+
+/*
+ * ======================================================================================================================
+ * DS_SortedReplace() - Take old out of dg_sorted and put new in, keeping it in order
+ * ======================================================================================================================
+ */
+void DS_SortedReplace(unsigned int old, unsigned int value) {
+  int lo = 0, hi = DG_BUCKETS-1, mid;
+  int i;
+
+  // Binary search for a copy of old, it is there since every reading went in to both arrays
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (dg_sorted[mid] < old) {
+      lo = mid + 1;
+    }
+    else {
+      hi = mid;
+    }
+  }
+  i = lo;
+
+  // Slide value toward its place, moving the readings it passes over into the hole
+  while ((i > 0) && (dg_sorted[i-1] > value)) {
+    dg_sorted[i] = dg_sorted[i-1];
+    i--;
+  }
+  while ((i < DG_BUCKETS-1) && (dg_sorted[i+1] < value)) {
+    dg_sorted[i] = dg_sorted[i+1];
+    i++;
+  }
+  dg_sorted[i] = value;
+}
+
+/*
+ * ======================================================================================================================
+ * DS_InsertionSort() - Sort a few values ascending in place
+ * ======================================================================================================================
+ */
+void DS_InsertionSort(unsigned int a[], int n) {
+  for (int i=1; i<n; i++) {
+    unsigned int v = a[i];
+    int j = i;
+    while ((j > 0) && (a[j-1] > v)) {
+      a[j] = a[j-1];
+      j--;
+    }
+    a[j] = v;
+  }
+}
+
+/*
+ * ======================================================================================================================
+ * DS_Filter() - Drop samples more than DS_MAD_LIMIT MADs from the median and return the rounded average of the
+ *               rest. Sets kept to the number averaged. Sorts samples.
+ * ======================================================================================================================
+ */
+unsigned int DS_Filter(unsigned int samples[], int n, int *kept) {
+  unsigned int dev[DS_SAMPLES_MAX];
+  unsigned int median, mad;
+  float limit;
+  unsigned long sum = 0;
+  int k = 0;
+
+  if (n <= 0) {
+    *kept = 0;
+    return (0);
+  }
+
+  DS_InsertionSort(samples, n);
+  median = samples[(n-1) / 2];
+
+  for (int i=0; i<n; i++) {
+    dev[i] = (samples[i] > median) ? samples[i] - median : median - samples[i];
+  }
+  DS_InsertionSort(dev, n);
+  mad = dev[n / 2];            // Upper median so 2 samples do not get a MAD of 0
+  limit = DS_MAD_LIMIT * ((mad) ? mad : 1); // Quiet bursts have a MAD of 0, allow for a count of ADC noise
+
+  for (int i=0; i<n; i++) {
+    if (((samples[i] > median) ? samples[i] - median : median - samples[i]) <= limit) {
+      sum += samples[i];
+      k++;
+    }
+  }
+  *kept = k;
+  return ((sum + k/2) / k);   // The median is always kept, k > 0
+}
+
+/*
+ * ======================================================================================================================
+ * DS_Sample() - Add a raw ADC sample for the next reading, called by the "DSS" task
+ * ======================================================================================================================
+ */
+void DS_Sample() {
+  if (ds_sample_count < DS_SAMPLES_MAX) {
+    ds_samples[ds_sample_count++] = analogRead(DISTANCE_GAUGE_PIN);
+  }
+}
 
 /*
  * ======================================================================================================================
@@ -450,11 +1271,26 @@ unsigned int dg_buckets[DG_BUCKETS];
  * ======================================================================================================================
  */
 void DS_TakeReading() {
-  dg_buckets[dg_bucket] = (int) analogRead(DISTANCE_GAUGE_PIN)/dg_divideby; // Partical Pins are 12bit resolution (0-4095) 
-                                                                            // Sensors 0-1023
-                                                                            // 10m Sensors need a divisor of 4
-                                                                            // 5m  Sensors need a divisor of 8
-  dg_bucket = (++dg_bucket) % DG_BUCKETS; // Advance bucket index for next reading
+  unsigned int raw;
+  int kept;
+
+  if ((cf_ds_samples > 1) && ds_sample_count) {
+    raw = DS_Filter(ds_samples, ds_sample_count, &kept);
+    ds_samples_taken += ds_sample_count;
+    ds_samples_kept += kept;
+    ds_sample_count = 0;
+  }
+  else {
+    raw = analogRead(DISTANCE_GAUGE_PIN);
+  }
+
+  unsigned int value = raw/dg_divideby; // Partical Pins are 12bit resolution (0-4095) 
+                                        // Sensors 0-1023
+                                        // 10m Sensors need a divisor of 4
+                                        // 5m  Sensors need a divisor of 8
+  DS_SortedReplace(dg_buckets[dg_bucket], value);
+  dg_buckets[dg_bucket] = value;
+  dg_bucket = (dg_bucket + 1) % DG_BUCKETS; // Advance bucket index for next reading
 }
 
 /* 
@@ -485,14 +1321,38 @@ void DS_Initialize() {
 
 /* 
  *=======================================================================================================================
- * DS_Median()
+ * DS_Median() - Median of the last 60 readings from dg_sorted, dg_buckets is left in the order taken
  *=======================================================================================================================
  */
 float DS_Median() {
   int i;
   
-  mysort(dg_buckets, DG_BUCKETS);
   i = (DG_BUCKETS+1) / 2 - 1; // -1 as array indexing in C starts from 0
   
-  return (dg_buckets[i]); 
+  return (dg_sorted[i]); 
+}
+
+/* 
+ *=======================================================================================================================
+ * DS_Spread() - Interquartile range of the last 60 readings
+ *=======================================================================================================================
+ */
+int DS_Spread() {
+  return (dg_sorted[(3 * DG_BUCKETS) / 4 - 1] - dg_sorted[DG_BUCKETS / 4 - 1]);
+}
+
+/* 
+ *=======================================================================================================================
+ * DS_Quality() - Percent of samples DS_Filter() kept since the last call, 100 if none were taken
+ *=======================================================================================================================
+ */
+int DS_Quality() {
+  int pct = 100;
+
+  if (ds_samples_taken) {
+    pct = (ds_samples_kept * 100) / ds_samples_taken;
+  }
+  ds_samples_taken = 0;
+  ds_samples_kept = 0;
+  return (pct);
 }
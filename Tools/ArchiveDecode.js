@@ -0,0 +1,233 @@
+/*
+ * ======================================================================================================================
+ *  ArchiveDecode.js - Turn FS-LoRaWAN /OBS/YYYYMMDD.arc archive files back in to JSON log lines
+ *
+ *  Output is the lines OBS_LOG_Add() writes to /OBS/YYYYMMDD.log, CR LF terminated, so the two can be compared
+ *  byte for byte. Block layout and encodings are described in FS-LoRaWAN/AR.h
+ *
+ *    node ArchiveDecode.js 20240517.arc [...] > 20240517.log
+ *
+ *  A block with a bad checksum, or cut short by a power loss, is reported on stderr and skipped, decoding carries
+ *  on at the next block found.
+ * ======================================================================================================================
+ */
+var fs = require("fs");
+var SENSORS = require("./TTN_Decoder.js").SENSORS;   // Names indexed by sensor id
+
+var AR_VERSION = 1;
+var F_OBS = 0, I_OBS = 1, U_OBS = 2;
+
+function BitReader(bytes, pos, end) {
+  this.bytes = bytes;
+  this.pos = pos;     // Next byte
+  this.end = end;
+  this.bit = 0;       // Bits used of bytes[pos]
+}
+
+BitReader.prototype.get = function (n) {
+  var v = 0;
+  while (n > 0) {
+    if (this.pos >= this.end) {
+      throw new Error("block cut short");
+    }
+    var k = Math.min(n, 8 - this.bit);
+    var b = (this.bytes[this.pos] >> (8 - this.bit - k)) & ((1 << k) - 1);
+    v = (v * Math.pow(2, k)) + b;
+    n -= k;
+    this.bit += k;
+    if (this.bit == 8) {
+      this.bit = 0;
+      this.pos++;
+    }
+  }
+  return v;
+};
+
+BitReader.prototype.getUInt = function () {
+  if (this.get(1) == 0) {
+    return 0;
+  }
+  var width = this.get(5) + 1;
+  return Math.pow(2, width - 1) + this.get(width - 1);
+};
+
+BitReader.prototype.getInt = function () {
+  var v = this.getUInt();
+  return (v % 2) ? -(v + 1) / 2 : v / 2;    // Zigzag
+};
+
+// rint(), round half to even like the station's C library
+function rint(x) {
+  var r = Math.round(x);
+  if (Math.abs(x % 1) == 0.5) {
+    r = 2 * Math.round(x / 2);
+  }
+  return r;
+}
+
+// Same text as BW_Float1() in FS-LoRaWAN/SF.h
+function float1(f) {
+  var d = f * 10;
+  if (isNaN(f)) {
+    return "nan";
+  }
+  if (Math.abs(d) >= 1e15) {
+    if (!isFinite(f)) {
+      return (f < 0) ? "-inf" : "inf";
+    }
+    return BigInt(f).toString() + ".0";     // Floats this large are whole numbers
+  }
+  var n = rint(d);
+  var sign = "";
+  if (f < 0 || Object.is(f, -0)) {
+    sign = "-";
+    n = -n;
+  }
+  return sign + Math.floor(n / 10) + "." + (n % 10);
+}
+
+function bitsToFloat(u) {
+  var dv = new DataView(new ArrayBuffer(4));
+  dv.setUint32(0, u);
+  return dv.getFloat32(0);
+}
+
+function pad2(n) {
+  return (n < 10 ? "0" : "") + n;
+}
+
+// Same text as OBS_WriteBattery(), v is (int)bv * 100 + (int)(bv*100) % 100
+function battery(v) {
+  var i = Math.trunc(v / 100), c = v % 100;   // Both truncate toward 0 like C
+  return i + "." + ((c < 0) ? "-" + Math.abs(c) : pad2(c));
+}
+
+function decodeBlock(bytes, pos, end) {
+  var rows = bytes[pos + 4], cols = bytes[pos + 5];
+  var t0 = bytes.readUInt32BE(pos + 6);
+  var ids = [], types = [];
+  var i, r, c;
+
+  if (pos + 10 + cols > end) {
+    throw new Error("block cut short");
+  }
+  for (c = 0; c < cols; c++) {
+    ids.push(bytes[pos + 10 + c]);
+  }
+  var br = new BitReader(bytes, pos + 10 + cols, end);
+  for (c = 0; c < cols; c++) {
+    types.push(br.get(2));
+  }
+
+  var ts = [t0], delta = 0;
+  for (r = 1; r < rows; r++) {
+    delta += br.getInt();
+    ts.push((ts[r - 1] + delta) >>> 0);
+  }
+  var bv = [br.getInt()];
+  for (r = 1; r < rows; r++) {
+    bv.push(bv[r - 1] + br.getInt());
+  }
+  var hth = [br.getUInt()];
+  for (r = 1; r < rows; r++) {
+    hth.push((hth[r - 1] ^ br.getUInt()) >>> 0);
+  }
+
+  var values = [];
+  for (c = 0; c < cols; c++) {
+    var col = [], prev = 0, lead = 32, trail = 0;
+    for (r = 0; r < rows; r++) {
+      var v;
+      if (types[c] == F_OBS) {
+        if (br.get(1) == 0) {
+          v = prev;
+        }
+        else {
+          if (br.get(1) == 1) {
+            lead = br.get(5);
+            trail = 32 - lead - (br.get(5) + 1);
+          }
+          v = (prev ^ (br.get(32 - lead - trail) * Math.pow(2, trail))) >>> 0;
+        }
+      }
+      else {
+        v = (prev + br.getInt()) >>> 0;
+      }
+      col.push(v);
+      prev = v;
+    }
+    values.push(col);
+  }
+  if (br.bit) {
+    br.pos++;
+  }
+
+  // Checksum follows the padded bit stream
+  if (br.pos + 2 > end) {
+    throw new Error("block cut short");
+  }
+  var sum = 0;
+  for (i = pos; i < br.pos; i++) {
+    sum = (sum + bytes[i]) & 0xFFFF;
+  }
+  if (sum != bytes.readUInt16BE(br.pos)) {
+    throw new Error("checksum");
+  }
+
+  var lines = [];
+  for (r = 0; r < rows; r++) {
+    var line = "{\"at\":\"" + new Date(ts[r] * 1000).toISOString().substring(0, 19) + "\"";
+    line += ",\"bv\":" + battery(bv[r]);
+    line += ",\"hth\":" + (hth[r] | 0);
+    for (c = 0; c < cols; c++) {
+      var u = values[c][r];
+      var name = (ids[c] < SENSORS.length) ? SENSORS[ids[c]][0] : "id" + ids[c];
+      line += ",\"" + name + "\":";
+      if (types[c] == F_OBS) {
+        line += float1(bitsToFloat(u));
+      }
+      else if (types[c] == I_OBS) {
+        line += (u | 0);
+      }
+      else {
+        line += u;
+      }
+    }
+    lines.push(line + "}");
+  }
+  return { lines: lines, next: br.pos + 2 };
+}
+
+function decodeFile(name, emit) {
+  var bytes = fs.readFileSync(name);
+  var pos = 0;
+
+  while (pos + 10 <= bytes.length) {
+    if (bytes[pos] != 0x46 || bytes[pos + 1] != 0x41 || bytes[pos + 2] != AR_VERSION) {
+      pos++;    // Look for the next block
+      continue;
+    }
+    try {
+      var b = decodeBlock(bytes, pos, bytes.length);
+      b.lines.forEach(emit);
+      pos = b.next;
+    }
+    catch (e) {
+      console.error(name + ": block at " + pos + " skipped, " + e.message);
+      pos++;
+    }
+  }
+}
+
+if (require.main === module) {
+  var args = process.argv.slice(2);
+  if (args.length == 0) {
+    console.error("usage: node ArchiveDecode.js YYYYMMDD.arc [...]");
+    process.exit(1);
+  }
+  args.forEach(function (name) {
+    decodeFile(name, function (line) { process.stdout.write(line + "\r\n"); });
+  });
+}
+
+module.exports = { decodeFile: decodeFile };
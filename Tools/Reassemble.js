@@ -0,0 +1,78 @@
+/*
+ * ======================================================================================================================
+ *  Reassemble.js - Put FS-LoRaWAN port 3 fragments back together and decode the observation
+ *
+ *  Input is one uplink per line on stdin as JSON with at least fPort and frm_payload (base64), which is what 
+ *  the TTN MQTT and webhook integrations deliver as uplink_message. Output is one decoded observation per line.
+ *
+ *    node Reassemble.js < uplinks.json
+ *
+ *  Fragments may arrive in any order. A payload is dropped, and reported on stderr, if it is still missing
+ *  fragments after MAX_PENDING newer fragment ids have been seen (the station rolls its id at 255).
+ * ======================================================================================================================
+ */
+var decoder = require("./TTN_Decoder.js");
+var readline = require("readline");
+
+var MAX_PENDING = 8;
+var pending = {};     // frag_id -> { port, count, parts[], have, seq }
+var seq = 0;
+
+function addFragment(f, emit) {
+  var p = pending[f.frag_id];
+
+  // Same id with a different count means the id rolled over and the old payload is lost
+  if (p && p.count != f.count) {
+    console.error("fragment id " + f.frag_id + " incomplete, " + p.have + " of " + p.count);
+    p = undefined;
+  }
+  if (!p) {
+    p = { port: f.port, count: f.count, parts: [], have: 0, seq: seq++ };
+    pending[f.frag_id] = p;
+  }
+  if (!p.parts[f.index]) {
+    p.parts[f.index] = f.bytes;
+    p.have++;
+  }
+
+  if (p.have == p.count) {
+    var bytes = [];
+    for (var i = 0; i < p.count; i++) {
+      bytes = bytes.concat(Array.prototype.slice.call(p.parts[i]));
+    }
+    delete pending[f.frag_id];
+    emit(decoder.decodeUplink({ fPort: p.port, bytes: bytes }));
+  }
+
+  // Expire payloads that have fallen too far behind
+  for (var id in pending) {
+    if (seq - pending[id].seq > MAX_PENDING) {
+      console.error("fragment id " + id + " incomplete, " + pending[id].have + " of " + pending[id].count);
+      delete pending[id];
+    }
+  }
+}
+
+function processUplink(msg, emit) {
+  var up = msg.uplink_message || msg;
+  var bytes = Array.prototype.slice.call(Buffer.from(up.frm_payload || "", "base64"));
+  var result = decoder.decodeUplink({ fPort: up.f_port || up.fPort, bytes: bytes });
+
+  if ((up.f_port || up.fPort) == 3 && result.errors.length == 0) {
+    addFragment(result.data, emit);
+  }
+  else {
+    emit(result);
+  }
+}
+
+if (require.main === module) {
+  var rl = readline.createInterface({ input: process.stdin });
+  rl.on("line", function (line) {
+    if (line.trim().length) {
+      processUplink(JSON.parse(line), function (r) { console.log(JSON.stringify(r.data)); });
+    }
+  });
+}
+
+module.exports = { processUplink: processUplink, addFragment: addFragment, MAX_PENDING: MAX_PENDING };
@@ -0,0 +1,239 @@
+/*
+ * ======================================================================================================================
+ *  TTN_Decoder.js - The Things Network Uplink Payload Formatter for FS-LoRaWAN
+ *
+ *  Paste in to TTN Console -> Application -> Payload formatters -> Uplink -> Custom Javascript formatter
+ *
+ *  Port 1 - URL text observation  at=2024-05-17T17%3A40%3A04&bv=4.12&hth=0&bp1=...
+ *  Port 2 - Binary observation, see FS-LoRaWAN/PL.h for the layout
+ *  Port 3 - Fragment of a port 1 or 2 payload too large for the data rate, see LW_TXQ_Service() in
+ *           FS-LoRaWAN/LW.h. TTN formatters are stateless so fragments are returned as is and put back
+ *           together with Tools/Reassemble.js
+ *  Port 4 - Batch of N2S binary observations, see PL_BatchAdd() in FS-LoRaWAN/PL.h
+ *
+ *  Downlink - Paste the same file in to Payload formatters -> Downlink. encodeDownlink() takes
+ *  { "from": "2026-10-15T09:00:00", "to": "2026-10-15T12:00:00" } and asks the station to resend the observations
+ *  its SD log has for that range, see Backfill in FS-LoRaWAN/OBS.h
+ *  Port 5 - Backfill request, from and to in seconds since 1970, 4 bytes each big endian
+ *
+ *  The SENSORS table must match obs_names[] in FS-LoRaWAN/OBS.h and pl_sensors[] in FS-LoRaWAN/PL.h
+ * ======================================================================================================================
+ */
+var PL_EPOCH = 1704067200;   // 2024-01-01T00:00:00Z
+var PL_HEADER_SIZE = 11;
+var PL_BATCH_HEADER_SIZE = 12;
+
+// [id, scale, bytes]
+var SENSORS = [
+  ["rg1", 10, 2], ["rgt1", 10, 2], ["rgp1", 10, 2],
+  ["rg2", 10, 2], ["rgt2", 10, 2], ["rgp2", 10, 2],
+  ["ds", 10, 2],
+  ["ws", 10, 2], ["wd", 1, 2], ["wg", 10, 2], ["wgd", 1, 2],
+  ["bp1", 10, 2], ["bt1", 10, 2], ["bh1", 10, 2],
+  ["bp2", 10, 2], ["bt2", 10, 2], ["bh2", 10, 2],
+  ["hh1", 10, 2], ["ht1", 10, 2],
+  ["st1", 10, 2], ["sh1", 10, 2],
+  ["st2", 10, 2], ["sh2", 10, 2],
+  ["ht2", 10, 2], ["hh2", 10, 2],
+  ["sv1", 10, 2], ["si1", 10, 4], ["su1", 10, 2],
+  ["mt1", 10, 2], ["mt2", 10, 2],
+  ["lx", 10, 4],
+  ["pm1s10", 1, 2], ["pm1s25", 1, 2], ["pm1s100", 1, 2],
+  ["pm1e10", 1, 2], ["pm1e25", 1, 2], ["pm1e100", 1, 2],
+  ["hi", 10, 2], ["wbt", 10, 2], ["wbgt", 10, 2],
+  ["slp", 10, 2],
+  ["ws2", 10, 2], ["wd2", 1, 2], ["ws10", 10, 2], ["wd10", 1, 2],
+  ["wsi", 10, 2], ["wdi", 1, 2], ["wp", 10, 2], ["wpd", 1, 2], ["wpt", 1, 2],
+  ["rr1", 10, 2], ["ri1", 10, 2], ["rf1", 1, 2], ["rl1", 1, 2],
+  ["rr2", 10, 2], ["ri2", 10, 2], ["rf2", 1, 2], ["rl2", 1, 2],
+  ["dsr", 1, 2], ["dsq", 1, 2]
+];
+
+// Sensors in a payload of each schema version, see PL_SensorCount() in FS-LoRaWAN/PL.h
+var SENSOR_COUNT = { 1: 40, 2: 41, 3: 50, 4: 58, 5: 60 };
+
+function bitmapSize(count) {
+  return Math.floor((count + 7) / 8);
+}
+
+function getInt(bytes, pos, size) {
+  var v = 0;
+  for (var i = 0; i < size; i++) {
+    v = (v * 256) + bytes[pos + i];
+  }
+  if (bytes[pos] & 0x80) {
+    v -= Math.pow(2, size * 8);   // Sign extend
+  }
+  return v;
+}
+
+function getUInt(bytes, pos, size) {
+  var v = getInt(bytes, pos, size);
+  return (v < 0) ? v + Math.pow(2, size * 8) : v;
+}
+
+function isoTime(seconds) {
+  return new Date(seconds * 1000).toISOString().substring(0, 19);
+}
+
+function decodeText(bytes) {
+  var data = {};
+  var text = String.fromCharCode.apply(null, bytes);
+  var pairs = text.split("&");
+  for (var i = 0; i < pairs.length; i++) {
+    var kv = pairs[i].split("=");
+    if (kv.length == 2 && kv[0].length) {
+      var v = decodeURIComponent(kv[1]);
+      data[kv[0]] = isNaN(Number(v)) ? v : Number(v);
+    }
+  }
+  return data;
+}
+
+function decodeBinary(bytes, errors) {
+  var data = {};
+  var count = SENSOR_COUNT[bytes[0]];
+  if (!count) {
+    errors.push("unknown schema version " + bytes[0]);
+    return data;
+  }
+  if (bytes.length < PL_HEADER_SIZE + bitmapSize(count)) {
+    errors.push("payload too short");
+    return data;
+  }
+  data.at  = isoTime(getUInt(bytes, 1, 4) + PL_EPOCH);
+  data.bv  = getUInt(bytes, 5, 2) / 100;
+  data.hth = getUInt(bytes, 7, 4);
+
+  var pos = PL_HEADER_SIZE + bitmapSize(count);
+  for (var p = 0; p < count; p++) {
+    if (bytes[PL_HEADER_SIZE + (p >> 3)] & (0x80 >> (p % 8))) {
+      if (pos + SENSORS[p][2] > bytes.length) {
+        errors.push("payload truncated at " + SENSORS[p][0]);
+        break;
+      }
+      data[SENSORS[p][0]] = getInt(bytes, pos, SENSORS[p][2]) / SENSORS[p][1];
+      pos += SENSORS[p][2];
+    }
+  }
+  return data;
+}
+
+// Zigzag base 128 varint, returns [value, next position] or null if truncated
+function getVarint(bytes, pos) {
+  var v = 0;
+  var mult = 1;
+  while (pos < bytes.length) {
+    var b = bytes[pos++];
+    v += (b & 0x7F) * mult;
+    mult *= 128;
+    if (!(b & 0x80)) {
+      return [(v % 2) ? -(v + 1) / 2 : v / 2, pos];
+    }
+  }
+  return null;
+}
+
+function decodeBatch(bytes, errors) {
+  var data = { observations: [] };
+  var count = SENSOR_COUNT[bytes[0]];
+  if (!count) {
+    errors.push("unknown schema version " + bytes[0]);
+    return data;
+  }
+  if (bytes.length < PL_BATCH_HEADER_SIZE + bitmapSize(count)) {
+    errors.push("payload too short");
+    return data;
+  }
+  var n   = bytes[1];
+  var ts  = getUInt(bytes, 2, 4) + PL_EPOCH;
+  var bv  = getUInt(bytes, 6, 2) / 100;
+  var hth = getUInt(bytes, 8, 4);
+  var value = [];
+  var pos = PL_BATCH_HEADER_SIZE + bitmapSize(count);
+
+  for (var i = 0; i < n; i++) {
+    var r = getVarint(bytes, pos);
+    if (r === null) {
+      errors.push("payload truncated at observation " + i);
+      break;
+    }
+    ts += r[0];
+    pos = r[1];
+    var o = { at: isoTime(ts), bv: bv, hth: hth };
+    for (var p = 0; p < count; p++) {
+      if (bytes[PL_BATCH_HEADER_SIZE + (p >> 3)] & (0x80 >> (p % 8))) {
+        r = getVarint(bytes, pos);
+        if (r === null) {
+          errors.push("payload truncated at " + SENSORS[p][0]);
+          return data;
+        }
+        value[p] = (value[p] || 0) + r[0];
+        pos = r[1];
+        o[SENSORS[p][0]] = value[p] / SENSORS[p][1];
+      }
+    }
+    data.observations.push(o);
+  }
+  return data;
+}
+
+function decodeFragment(bytes, errors) {
+  if (bytes.length < 4) {
+    errors.push("fragment too short");
+    return {};
+  }
+  return {
+    frag_id: bytes[0],
+    port: bytes[1],
+    index: bytes[2],
+    count: bytes[3],
+    bytes: bytes.slice(4)
+  };
+}
+
+function decodeUplink(input) {
+  var errors = [];
+  var data = {};
+
+  switch (input.fPort) {
+    case 1:
+      data = decodeText(input.bytes);
+      break;
+    case 2:
+      data = decodeBinary(input.bytes, errors);
+      break;
+    case 3:
+      data = decodeFragment(input.bytes, errors);
+      break;
+    case 4:
+      data = decodeBatch(input.bytes, errors);
+      break;
+    default:
+      errors.push("unknown port " + input.fPort);
+      break;
+  }
+  return { data: data, warnings: [], errors: errors };
+}
+
+function putUInt32(bytes, v) {
+  bytes.push((v >>> 24) & 0xFF, (v >>> 16) & 0xFF, (v >>> 8) & 0xFF, v & 0xFF);
+}
+
+function encodeDownlink(input) {
+  var from = Date.parse(input.data.from + "Z") / 1000;
+  var to = Date.parse(input.data.to + "Z") / 1000;
+  var bytes = [];
+
+  if (isNaN(from) || isNaN(to) || (from > to)) {
+    return { errors: ["from and to must be times YYYY-MM-DDTHH:MM:SS, from not after to"] };
+  }
+  putUInt32(bytes, from);
+  putUInt32(bytes, to);
+  return { bytes: bytes, fPort: 5, warnings: [], errors: [] };
+}
+
+// Allow use from node for testing: node -e 'require("./TTN_Decoder.js")'
+if (typeof module !== "undefined") {
+  module.exports = { decodeUplink: decodeUplink, encodeDownlink: encodeDownlink, SENSORS: SENSORS };
+}
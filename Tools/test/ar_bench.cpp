@@ -0,0 +1,96 @@
+/*
+ * ======================================================================================================================
+ *  ar_bench.cpp - Compressed observation archive against the JSON log, see AR.h
+ *
+ *    log     The day's .log, OBS_Render(true) and a CRLF for every observation
+ *    arc     The day's .arc, AR_Add() and the AR_Flush() of every block
+ *
+ *  A day of 10, 30 and 60 sensors at 1 and 15 minutes, values that drift as a station's do. Bytes are per
+ *  observation, the times per observation on the host and include the in memory card's writes. The SAMD21 is far
+ *  slower, the ratio is the guide.
+ * ======================================================================================================================
+ */
+#include "test.h"
+#include <chrono>
+
+const uint32_t T0 = 1760054400;         // 2025-10-10T00:00:00
+uint32_t seed = 11;
+float walk[SID_COUNT];
+
+double Now() {
+  return (std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// mulberry32, as ar_test.cpp
+uint32_t Rand() {
+  uint32_t t = (seed += 0x6D2B79F5);
+
+  t = (t ^ (t >> 15)) * (t | 1);
+  t ^= t + ((t ^ (t >> 7)) * (t | 61));
+  return (t ^ (t >> 14));
+}
+
+void Fill(uint32_t t, int sensors) {
+  int sidx = 0;
+
+  OBS_Clear();
+  obs.inuse = true;
+  obs.ts = t;
+  obs.bv = 4.1 - (t - T0) / 3e6;
+  for (int id=0; sidx<sensors; id++) {
+    walk[id] += (id % 5 == 0) ? ((int) (Rand() % 101) - 50) / 10.0 : ((int) (Rand() % 3) - 1) / 10.0;
+    if (obs_names[id].type == F_OBS) {
+      OBS_AddF(&sidx, id, walk[id]);
+    }
+    else {
+      OBS_AddI(&sidx, id, (int32_t) walk[id]);
+    }
+  }
+  now = DateTime(t);
+}
+
+void Day(int interval, int sensors) {
+  long lines = 1440 / interval, log_bytes = 0;
+  double log_s = 0, arc_s = 0, t;
+
+  test_sd("ar_bench");
+  host_sd_root = "";                    // Nothing to save
+  SD_exists = false;
+  SD_initialize();
+  free(ar_ts);
+  ar_ts = NULL;
+  ar_rows = 0;
+  cf_sd_archive = 1;
+  cf_5m_enable = 0;
+  cf_15m_enable = (interval == 15);
+  AR_Initialize();
+  memset(walk, 0, sizeof(walk));
+  for (long i=0; i<lines; i++) {
+    Fill(T0 + i * interval * 60, sensors);
+    t = Now();
+    log_bytes += OBS_Render(true) + 2;
+    log_s += Now() - t;
+    t = Now();
+    AR_Add();
+    arc_s += Now() - t;
+  }
+  t = Now();
+  AR_Flush();
+  arc_s += Now() - t;
+
+  long arc_bytes = host_sd_files["/OBS/20251010.arc"].card.size();
+  printf("%2d sensors %2d min  log %6.1f bytes %6.2f us  arc %5.1f bytes %6.2f us  %4.1fx smaller\n", sensors,
+         interval, (double) log_bytes / lines, log_s * 1e6 / lines, (double) arc_bytes / lines, arc_s * 1e6 / lines,
+         (double) log_bytes / arc_bytes);
+}
+
+int main() {
+  RTC_valid = true;
+  printf("ar_bench: a day of observations, per observation\n");
+  for (int interval : { 1, 15 }) {
+    for (int sensors : { 10, 30, 60 }) {
+      Day(interval, sensors);
+    }
+  }
+  return (0);
+}
@@ -0,0 +1,150 @@
+/*
+ * ======================================================================================================================
+ *  ar_test.cpp - Compressed observation archive, see AR.h. The block is only allocated when sd_archive is set and is
+ *                sized for the observation interval, and a block never spans more than AR_SECONDS. Days at 1, 5 and
+ *                15 minutes are logged to both the .log and .arc files, build/ar_fixture.json lists the pairs for
+ *                archive_decode.test.js to check Tools/ArchiveDecode.js turns each .arc back in to its .log.
+ * ======================================================================================================================
+ */
+#include "test.h"
+
+const uint32_t T0 = 1760054400;         // 2025-10-10T00:00:00
+uint32_t seed = 11;
+float walk[SID_COUNT];                  // Each sensor's value, a random walk
+
+// mulberry32, the same numbers on every host
+uint32_t Rand() {
+  uint32_t t = (seed += 0x6D2B79F5);
+
+  t = (t ^ (t >> 15)) * (t | 1);
+  t ^= t + ((t ^ (t >> 7)) * (t | 61));
+  return (t ^ (t >> 14));
+}
+
+// Free the block, as a reboot would lose it, and set the interval
+void Boot(int archive, int interval) {
+  free(ar_ts);
+  ar_ts = NULL;
+  ar_rows = 0;
+  cf_sd_archive = archive;
+  cf_5m_enable = (interval == 5);
+  cf_15m_enable = (interval == 15);
+  AR_Initialize();
+}
+
+// Observation at t of n sensors, ids from first. Most drift a tenth at a time, every fifth is noisy, I_OBS and
+// U_OBS sensors count.
+void Observe(uint32_t t, int n, int first) {
+  int sidx = 0;
+
+  OBS_Clear();
+  obs.inuse = true;
+  obs.ts = t;
+  obs.bv = 4.1 - (t - T0) / 3e6;
+  obs.hth = (Rand() % 50) ? 0 : (1UL << (Rand() % 20));
+  for (int i=0; i<n; i++) {
+    int id = (first + i) % SID_COUNT;
+    SENSOR *sensor = OBS_Add(&sidx, id, obs_names[id].type);
+
+    walk[id] += (id % 5 == 0) ? ((int) (Rand() % 101) - 50) / 10.0 : ((int) (Rand() % 3) - 1) / 10.0;
+    if (sensor->type == F_OBS) {
+      sensor->f_obs = walk[id];
+    }
+    else if (sensor->type == I_OBS) {
+      sensor->i_obs = (int32_t) walk[id];
+    }
+    else {
+      sensor->u_obs = (uint32_t) fabs(walk[id] * 10);
+    }
+  }
+  host_unixtime = t;
+  host_millis = (unsigned long) (t - T0) * 1000;
+  now = DateTime(t);
+  obs_rec.inuse = true;
+  OBS_LOG_Add();
+}
+
+void Setup() {
+  test_sd("ar");
+  memset(host_eeprom, 0, sizeof(host_eeprom));
+  SD_exists = false;
+  eeprom_valid = false;
+  SD_initialize();
+  EEPROM_initialize();
+  RTC_valid = true;
+  cf_sd_sync = 300;
+}
+
+// Nothing is allocated and no archive is written when sd_archive is 0
+void Off() {
+  Boot(0, 1);
+  CHECK(ar_ts == NULL);
+  CHECK(ar_value == NULL);
+  Observe(T0 - 86400, 30, 0);
+  AR_Flush();
+  CHECK(!SD.exists("/OBS/20251009.arc"));
+  CHECK(SD.exists("/OBS/20251009.log"));
+  SD_LogClose(true);
+}
+
+// The block holds AR_SECONDS of rows at the interval
+void Sizes() {
+  Boot(1, 1);
+  CHECK_EQ(ar_rows_max, 60);
+  CHECK_EQ(ar_values_max, 960);
+  Boot(2, 5);
+  CHECK_EQ(ar_rows_max, 12);
+  CHECK_EQ(ar_values_max, 384);
+  Boot(2, 15);
+  CHECK_EQ(ar_rows_max, 4);
+  CHECK_EQ(ar_values_max, 128);
+  CHECK_EQ(ar_out - (uint8_t *) ar_ts, (3 * 4 + 128) * 4 + 2 * MAX_SENSORS);     // One region, 0.8 KB
+}
+
+// A day at interval minutes logged to both files. Each block spans less than AR_SECONDS and the rows a power loss
+// can lose stay under an hour's worth. The sensors change for an hour mid-day.
+void Day(int interval, uint32_t day, int n, FILE *fixture, bool first) {
+  char name[32];
+  uint32_t span = 0;
+
+  Boot(2, interval);
+  for (uint32_t t=day; t<day + 86400; t+=interval * 60) {
+    bool changed = (t - day >= 36000) && (t - day < 39600);
+
+    Observe(t + ((t % 7200 == 0) ? 30 : 0), (changed) ? n - 1 : n, 0);  // Late now and then, as after GPS
+    span = std::max<uint32_t>(span, (uint32_t) obs.ts - ar_ts[0]);
+    CHECK(ar_rows <= ar_rows_max);
+  }
+  CHECK(span < AR_SECONDS);
+  AR_Flush();
+  SD_LogClose(true);
+
+  DateTime dt(day);
+  sprintf(name, "%04d%02d%02d", dt.year(), dt.month(), dt.day());
+  CHECK(SD.exists((std::string("/OBS/") + name + ".arc").c_str()));
+  fprintf(fixture, "%s  { \"interval\": %d, \"sensors\": %d, \"arc\": \"%s/OBS/%s.arc\", \"log\": \"%s/OBS/%s.log\" }",
+          (first) ? "" : ",\n", interval, n, host_sd_root.c_str(), name, host_sd_root.c_str(), name);
+}
+
+int main() {
+  FILE *fixture;
+
+  Setup();
+  Off();
+  Sizes();
+
+  fixture = fopen("build/ar_fixture.json", "w");
+  CHECK(fixture != NULL);
+  if (!fixture) {
+    return (test_done("ar_test"));
+  }
+  fprintf(fixture, "[\n");
+  Day(1, T0, 30, fixture, true);
+  Day(5, T0 + 86400, 30, fixture, false);
+  Day(15, T0 + 2 * 86400, 30, fixture, false);
+  Day(1, T0 + 3 * 86400, 40, fixture, false);                    // More than AR_COLS sensors, shorter blocks
+  fprintf(fixture, "\n]\n");
+  fclose(fixture);
+  host_sd_sync();
+  return (test_done("ar_test"));
+}
@@ -0,0 +1,58 @@
+/*
+ * ======================================================================================================================
+ *  archive_decode.test.js - Tools/ArchiveDecode.js against the .arc and .log pairs in build/ar_fixture.json from
+ *                           ar_test.cpp, each .arc must decode to its .log byte for byte
+ * ======================================================================================================================
+ */
+var test = require("node:test");
+var assert = require("node:assert");
+var fs = require("fs");
+var path = require("path");
+var archive = require("../ArchiveDecode.js");
+
+var fixture = JSON.parse(fs.readFileSync(path.join(__dirname, "build", "ar_fixture.json")));
+
+// Lines of an .arc file, the block errors counted rather than printed
+function decode(name) {
+  var lines = [];
+  var skipped = 0;
+  var error = console.error;
+
+  console.error = function () { skipped++; };
+  try {
+    archive.decodeFile(name, function (line) { lines.push(line); });
+  }
+  finally {
+    console.error = error;
+  }
+  return { lines: lines, skipped: skipped };
+}
+
+fixture.forEach(function (f) {
+  var arc = path.join(__dirname, f.arc);
+  var log = fs.readFileSync(path.join(__dirname, f.log), "latin1");
+
+  test(path.basename(f.arc) + " " + f.interval + " min " + f.sensors + " sensors", function () {
+    var r = decode(arc);
+
+    assert.strictEqual(r.skipped, 0);
+    assert.ok(r.lines.length > 0);
+    assert.ok(r.lines.join("\r\n") + "\r\n" === log, "decoded .arc differs from its .log");
+    assert.ok(fs.statSync(arc).size * 3 < log.length, "archive not a third of the log");
+  });
+
+  // Cut short by a power loss mid append, the blocks before the cut still decode and the one cut is skipped
+  test(path.basename(f.arc) + " cut short", function () {
+    var bytes = fs.readFileSync(arc);
+    var cut = path.join(__dirname, "build", "cut_" + path.basename(f.arc));
+    var lines = log.split("\r\n");
+
+    fs.writeFileSync(cut, bytes.subarray(0, Math.floor(bytes.length * 2 / 3)));
+    var r = decode(cut);
+    fs.unlinkSync(cut);
+
+    assert.ok(r.lines.length > 0);
+    assert.ok(r.lines.length < lines.length - 1);
+    assert.deepStrictEqual(r.lines, lines.slice(0, r.lines.length));
+  });
+});
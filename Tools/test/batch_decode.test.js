@@ -0,0 +1,39 @@
+/*
+ * ======================================================================================================================
+ *  batch_decode.test.js - Tools/TTN_Decoder.js port 4 against build/batch_fixture.json from batch_test.cpp
+ * ======================================================================================================================
+ */
+var test = require("node:test");
+var assert = require("node:assert");
+var fs = require("fs");
+var path = require("path");
+var decoder = require("../TTN_Decoder.js");
+
+var fixture = JSON.parse(fs.readFileSync(path.join(__dirname, "build", "batch_fixture.json")));
+
+fixture.forEach(function (f, i) {
+  test("batch " + i + " of " + f.expect.length + " observations", function () {
+    var bytes = Array.from(Buffer.from(f.hex, "hex"));
+    var r = decoder.decodeUplink({ fPort: 4, bytes: bytes });
+
+    assert.deepStrictEqual(r.errors, []);
+    assert.strictEqual(r.data.observations.length, f.expect.length);
+    r.data.observations.forEach(function (o, n) {
+      var want = f.expect[n];
+      assert.deepStrictEqual(Object.keys(o).sort(), Object.keys(want).sort());
+      Object.keys(want).forEach(function (k) {
+        if (typeof want[k] === "number") {
+          assert.ok(Math.abs(o[k] - want[k]) < 1e-6, "observation " + n + " " + k + " " + o[k] + " != " + want[k]);
+        }
+        else {
+          assert.strictEqual(o[k], want[k], "observation " + n + " " + k);
+        }
+      });
+    });
+
+    // Cut short, the observations before the cut still decode
+    r = decoder.decodeUplink({ fPort: 4, bytes: bytes.slice(0, bytes.length - 1) });
+    assert.strictEqual(r.errors.length, 1);
+    assert.strictEqual(r.data.observations.length, f.expect.length - 1);
+  });
+});
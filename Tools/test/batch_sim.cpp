@@ -0,0 +1,96 @@
+/*
+ * ======================================================================================================================
+ *  batch_sim.cpp - Frames and airtime to drain 1440 backlogged observations, one day at 1 minute, for each US915
+ *                  data rate with n2s_batch off and on. Runs OBS_N2S_Publish() and the transmit queue against the
+ *                  host SD and LMIC stand-ins, every frame is acknowledged.
+ *
+ *  Airtime is the Semtech SX1276 formula, 125kHz, CR 4/5, 8 symbol preamble, explicit header, CRC on, 13 bytes of
+ *  LoRaWAN overhead per frame.
+ * ======================================================================================================================
+ */
+#include "test.h"
+
+const int N = 1440;
+
+double Airtime(int payload, int sf) {
+  double tsym = pow(2, sf) / 125000.0;
+  double symbols = 8 + fmax(ceil((8.0 * (payload + 13) - 4 * sf + 28 + 16) / (4.0 * sf)) * 5, 0);
+  return ((8 + 4.25 + symbols) * tsym);
+}
+
+// A 19 sensor station, values walking the way one minute weather does
+void Backlog() {
+  const int ids[] = { SID_RG1, SID_RGT1, SID_RGP1, SID_WS, SID_WD, SID_WG, SID_WGD, SID_BP1, SID_BT1, SID_BH1,
+                      SID_ST1, SID_SH1, SID_MT1, SID_HI, SID_WBT, SID_WBGT, SID_SLP, SID_WS2, SID_WD2 };
+  double v[19];
+
+  srand(1);
+  for (int i=0; i<19; i++) {
+    v[i] = 10 + i * 3;
+  }
+  v[7] = 1013.2;
+  for (int k=0; k<N; k++) {
+    int sidx = 0;
+    OBS_Clear();
+    obs.inuse = true;
+    obs.ts = 1792022400 + k * 60;
+    obs.bv = 4.1;
+    obs.hth = 0;
+    for (int i=0; i<19; i++) {
+      v[i] += ((rand() % 7) - 3) * 0.1;
+      if (obs_names[ids[i]].type == F_OBS) {
+        OBS_AddF(&sidx, ids[i], v[i]);
+      }
+      else {
+        OBS_AddI(&sidx, ids[i], ((int) (v[i] * 10)) % 360);
+      }
+    }
+    OBS_Encode();
+    OBS_N2S_Add();
+  }
+}
+
+void Drain(int dr, int sf, int batch) {
+  double airtime = 0;
+  int bytes = 0;
+
+  test_sd("batch_sim");
+  memset(host_eeprom, 0, sizeof(host_eeprom));
+  SD_initialize();
+  EEPROM_initialize();
+  SD_N2S_Initialize();
+  Backlog();
+
+  LW_valid = true;
+  LMIC.datarate = dr;
+  cf_n2s_batch = batch;
+  cf_lw_binary = 1;
+  obs_n2s_drain = true;
+  host_lw_frames.clear();
+  SerialConsoleEnabled = host_serial = getenv("SERIAL") != NULL;
+  for (long guard=0; SD_N2S_Count() && guard<100000; guard++) {
+    delay(1000);
+    OBS_N2S_Publish();
+    LW_TXQ_Service();
+    if (LMIC.opmode & OP_TXRXPEND) {
+      host_lw_txdone(true);
+      LW_TXQ_Service();
+    }
+  }
+  for (auto &f : host_lw_frames) {
+    airtime += Airtime(f.bytes.size(), sf);
+    bytes += f.bytes.size();
+  }
+  printf("DR%d SF%-2d max %3d  n2s_batch=%d  %5zu frames %7d bytes %8.1f s airtime%s\n", dr, sf, LW_MaxPayload(),
+         batch, host_lw_frames.size(), bytes, airtime, SD_N2S_Count() ? "  NOT DRAINED" : "");
+}
+
+int main() {
+  printf("batch_sim: %d observations of a 19 sensor station\n", N);
+  for (int dr=0; dr<=3; dr++) {
+    for (int batch=0; batch<=1; batch++) {
+      Drain(dr, 10 - dr, batch);
+    }
+  }
+  return (0);
+}
@@ -0,0 +1,139 @@
+/*
+ * ======================================================================================================================
+ *  batch_test.cpp - PL_BatchBegin() / PL_BatchAdd() LW_PORT_BATCH frames, see PL.h
+ *
+ *  Writes build/batch_fixture.json, batch frames with the observations a decoder must return, for
+ *  batch_decode.test.js to check Tools/TTN_Decoder.js port 4 against.
+ * ======================================================================================================================
+ */
+#include "test.h"
+
+const int ids[] = { SID_RG1, SID_WD, SID_BP1, SID_BT1, SID_BH1, SID_LX, SID_DSQ };
+const int nids = sizeof(ids) / sizeof(ids[0]);
+const uint32_t t0 = 1792065600;   // 2026-10-15T12:00:00Z
+
+struct Obs {
+  uint32_t ts;
+  unsigned long hth;
+  double v[nids];
+};
+
+// Observation i, values that move up and down by small and large steps
+Obs Make(int i) {
+  Obs o;
+  o.ts = t0 + i * 60 + ((i == 7) ? 3600 : 0) + ((i > 7) ? 3600 : 0) + ((i == 3) ? 1 : 0);
+  o.hth = (i == 5) ? 0x400 : ((i == 9) ? 0x20 : 0);
+  o.v[0] = (i % 4) * 0.1;                 // rg1
+  o.v[1] = (i * 97) % 360;                // wd, wraps
+  o.v[2] = 1013.2 - i * 0.3;              // bp1
+  o.v[3] = (i == 6) ? -40.0 : 21.5 + i;   // bt1, a jump and back
+  o.v[4] = 55.0 + ((i % 2) ? 0.1 : -0.1); // bh1
+  o.v[5] = 120000.0 - i * 5432.1;         // lx, 4 byte
+  o.v[6] = 100 - i;                       // dsq
+  return (o);
+}
+
+int Encode(const Obs &o, uint8_t *buf) {
+  int sidx = 0;
+
+  OBS_Clear();
+  obs.inuse = true;
+  obs.ts = o.ts;
+  obs.bv = 4.05;
+  obs.hth = o.hth;
+  for (int i=0; i<nids; i++) {
+    if (obs_names[ids[i]].type == F_OBS) {
+      OBS_AddF(&sidx, ids[i], o.v[i]);
+    }
+    else {
+      OBS_AddI(&sidx, ids[i], (int) o.v[i]);
+    }
+  }
+  return (PL_Encode(buf, SD_N2S_MAXPL));
+}
+
+// Fixture entry for a batch of observations first to first+count-1
+void Fixture(FILE *fp, const uint8_t *frame, int len, int first, int count, bool last) {
+  unsigned long hth = 0;
+
+  for (int i=first; i<first+count; i++) {
+    hth |= Make(i).hth;
+  }
+  fprintf(fp, "  {\"hex\": \"%s\", \"expect\": [\n", test_hex(frame, len).c_str());
+  for (int i=first; i<first+count; i++) {
+    Obs o = Make(i);
+    time_t t = o.ts;
+    char at[32];
+    strftime(at, sizeof(at), "%Y-%m-%dT%H:%M:%S", gmtime(&t));
+    fprintf(fp, "    {\"at\": \"%s\", \"bv\": 4.05, \"hth\": %lu", at, hth);
+    for (int k=0; k<nids; k++) {
+      double scale = pl_sensors[ids[k]].scale;
+      fprintf(fp, ", \"%s\": %.1f", obs_names[ids[k]].name, round(o.v[k] * scale) / scale);
+    }
+    fprintf(fp, "}%s\n", (i < first + count - 1) ? "," : "");
+  }
+  fprintf(fp, "  ]}%s\n", last ? "" : ",");
+}
+
+int main() {
+  FILE *fp = fopen("build/batch_fixture.json", "w");
+  uint8_t rec[SD_N2S_MAXPL], other[SD_N2S_MAXPL], frame[256];
+  int len, n;
+
+  fprintf(fp, "[\n");
+
+  // All 12 in one frame
+  PL_BatchBegin(frame, sizeof(frame));
+  for (n=0; n<12; n++) {
+    len = Encode(Make(n), rec);
+    CHECK(PL_BatchAdd(rec, len));
+  }
+  CHECK_EQ(PL_BatchLen() > 0, 1);
+  CHECK_EQ(frame[1], 12);
+  CHECK_EQ((uint32_t) PL_GetInt(frame+8, 4), 0x420);            // Status bits of the batch are the OR
+  CHECK(PL_BatchLen() < 12 * len / 2);                            // Deltas are smaller than the records
+  Fixture(fp, frame, PL_BatchLen(), 0, 12, false);
+
+  // A small frame takes what fits and leaves the batch as it was for the one that does not
+  PL_BatchBegin(frame, 53);                                       // US915 DR1
+  for (n=0; n<12; n++) {
+    len = Encode(Make(n), rec);
+    int before = PL_BatchLen();
+    if (!PL_BatchAdd(rec, len)) {
+      CHECK_EQ(PL_BatchLen(), before);
+      break;
+    }
+  }
+  CHECK(n >= 2 && n < 12);
+  CHECK_EQ(frame[1], n);
+  Fixture(fp, frame, PL_BatchLen(), 0, n, true);
+  fprintf(fp, "]\n");
+  fclose(fp);
+
+  // Records with a different set of sensors, or not a payload, do not join a batch
+  PL_BatchBegin(frame, sizeof(frame));
+  CHECK(PL_BatchAdd(rec, Encode(Make(0), rec)));
+  len = Encode(Make(1), other);
+  other[PL_HEADER_SIZE] ^= 0x01;
+  CHECK(!PL_BatchAdd(other, len));
+  other[0] = 0;
+  CHECK(!PL_BatchAdd(other, len));
+  CHECK(!PL_BatchAdd(rec, PL_HEADER_SIZE));
+  CHECK_EQ(frame[1], 1);
+
+  // An older schema version record joins a batch of the current version
+  Obs o = Make(0);
+  int sidx = 0;
+  OBS_Clear();
+  obs.inuse = true;
+  obs.ts = o.ts;
+  OBS_AddF(&sidx, SID_BT1, 20.0);
+  len = PL_Encode(rec, sizeof(rec));
+  memmove(rec + PL_HEADER_SIZE + 5, rec + PL_HEADER_SIZE + PL_BITMAP_SIZE, len - PL_HEADER_SIZE - PL_BITMAP_SIZE);
+  rec[0] = 1;                                                     // 40 sensors, 5 byte bitmap
+  PL_BatchBegin(frame, sizeof(frame));
+  CHECK(PL_BatchAdd(rec, len - (PL_BITMAP_SIZE - 5)));
+  CHECK_EQ(frame[0], PL_SCHEMA_VERSION);
+
+  return (test_done("batch_test"));
+}
@@ -0,0 +1,332 @@
+/*
+ * ======================================================================================================================
+ *  bf_test.cpp - Log read back and backfill, see SDC.h and OBS.h. SD_LogReadOpen()'s binary search of the .idx file
+ *                against the line offsets the log was written with, before the first entry, between and on entries,
+ *                after the last, a reboot mid-day and a missing index. SD_LogReadLine() to the end of a closed day
+ *                and of the open one, and past a line too long for its buffer. Then OBS_BF_Request() ranges sent
+ *                through the transmit queue: from before a day's first line, across a day with no log, to past now,
+ *                a day with no log alone, a reversed range and a frame that fails and is sent again.
+ * ======================================================================================================================
+ */
+#include "test.h"
+
+const uint32_t T0 = 1760054400;         // 2025-10-10T00:00:00
+std::vector<uint32_t> times;            // Time of every line logged to the open day
+std::vector<uint32_t> offsets;          // and its offset in the file
+std::vector<uint32_t> sent;             // Time of every observation logged, all days
+
+// A station's log line at time t, 10 sensors
+const char *Line(uint32_t t) {
+  int sidx = 0;
+
+  OBS_Clear();
+  obs.inuse = true;
+  obs.ts = t;
+  obs.bv = 4.12;
+  for (int id=0; sidx<10; id++) {
+    if (obs_names[id].type == F_OBS) {
+      OBS_AddF(&sidx, id, (id * 37.1) + (t % 600) / 10.0);
+    }
+    else {
+      OBS_AddI(&sidx, id, (t / 60) % 360);
+    }
+  }
+  OBS_Render(true);
+  return (obsbuf);
+}
+
+// Observation at time t, the clocks moved to it as the sketch's would be
+void Log(uint32_t t) {
+  host_unixtime = t;
+  host_millis = (unsigned long) (t - T0) * 1000;
+  now = DateTime(t);
+  if (!times.empty() && (times.back() / 86400 != t / 86400)) {
+    times.clear();
+    offsets.clear();
+  }
+  offsets.push_back((offsets.empty()) ? 0 : offsets.back() + strlen(Line(times.back())) + 2);
+  times.push_back(t);
+  SD_LogObservation((char *) Line(t), t);
+  sent.push_back(t);
+}
+
+// Power on: RAM is lost, the card and EEPROM are what was last written
+void Reboot() {
+  host_sd_powerloss();
+  SD_log_fp = File();
+  SD_log_day = 0;
+  SD_log_len = 0;
+  SD_idx_len = 0;
+  SD_lr_fp = File();
+  SD_lr_day = 0;
+  SD_exists = false;
+  eeprom_valid = false;
+  SD_initialize();
+  EEPROM_initialize();
+}
+
+void Blank() {
+  test_sd("bf");
+  memset(host_eeprom, 0, sizeof(host_eeprom));
+  Reboot();
+  RTC_valid = true;
+  cf_sd_sync = 300;
+  times.clear();
+  offsets.clear();
+  sent.clear();
+}
+
+// Offset SD_LogReadOpen() should start at for ts, the last indexed line at or before it
+uint32_t Indexed(uint32_t ts) {
+  uint32_t pos = 0;
+
+  for (size_t i=0; i<times.size(); i+=SD_IDX_EVERY) {
+    if (times[i] <= ts) {
+      pos = offsets[i];
+    }
+  }
+  return (pos);
+}
+
+// Read from ts to the end of day, the times of the lines at or after ts
+std::vector<uint32_t> Read(long day, uint32_t ts) {
+  std::vector<uint32_t> got;
+  char buf[MAX_MSGBUF_SIZE];
+  uint32_t t;
+  int len;
+
+  if (!SD_LogReadOpen(day, ts)) {
+    return (got);
+  }
+  while ((len = SD_LogReadLine(buf, sizeof(buf), &t)) != 0) {
+    if ((len > 0) && (t >= ts)) {
+      got.push_back(t);
+    }
+  }
+  SD_LogReadClose();
+  return (got);
+}
+
+// The logged times from from to to
+std::vector<uint32_t> Want(const std::vector<uint32_t> &logged, uint32_t from, uint32_t to) {
+  std::vector<uint32_t> want;
+
+  for (uint32_t t : logged) {
+    if ((t >= from) && (t <= to)) {
+      want.push_back(t);
+    }
+  }
+  return (want);
+}
+
+// A day of 1 minute observations, 90 index entries. Every start the search can land on, and it reads a few of them.
+void Search() {
+  uint32_t day_end = T0 + 86400;
+
+  Blank();
+  for (int m=0; m<1440; m++) {
+    Log(T0 + m * 60);
+  }
+  std::vector<uint32_t> day_times = times, day_offsets = offsets;
+  Log(day_end);                                                 // Closes the day
+  times = day_times;
+  offsets = day_offsets;
+  CHECK_EQ(host_sd_files["/OBS/20251010.idx"].dirsize, 90 * SD_IDX_ENTRY);
+
+  for (uint32_t ts : { T0 - 86400, T0 - 1, T0, T0 + 1, T0 + 15 * 60, T0 + 16 * 60 - 1, T0 + 16 * 60,
+                       T0 + 16 * 60 + 1, T0 + 12 * 3600 + 7, T0 + 88 * 16 * 60, T0 + 89 * 16 * 60,
+                       day_end - 60, day_end - 1, day_end, day_end + 86400 }) {
+    long reads = host_sd_reads;
+
+    CHECK(SD_LogReadOpen(20251010, ts));
+    CHECK_EQ(SD_lr_pos, Indexed(ts));
+    CHECK(host_sd_reads - reads <= 10);                         // Directory, idx sectors, no log sectors
+    SD_LogReadClose();
+  }
+
+  // Start to end, the lines from ts on and no padding after the last
+  CHECK(Read(20251010, T0 - 1) == times);
+  CHECK(Read(20251010, T0 + 5 * 3600 + 30) == Want(times, T0 + 5 * 3600 + 30, day_end));
+  CHECK(Read(20251010, day_end - 60) == Want(times, day_end - 60, day_end));
+  CHECK(Read(20251010, day_end).empty());
+
+  // No log, no day
+  CHECK(!SD_LogReadOpen(20251009, T0 - 3600));
+  CHECK(!SD_LogReadOpen(20251012, day_end + 86400));
+  CHECK_EQ(SD_lr_day, 0);
+}
+
+// The open day reads to what has been logged, synced by the open, not the preallocated space after it. Lines after
+// the read are still found by the next.
+void OpenDay() {
+  Blank();
+  for (int m=0; m<100; m++) {
+    Log(T0 + m * 60);
+  }
+  CHECK(SD_log_len > 0);                                        // Lines held in RAM
+  CHECK(Read(20251010, T0) == times);
+  CHECK_EQ(SD_log_len, 0);
+  CHECK(SD_log_fp.size() > offsets.back() + 4096);               // Preallocated
+  for (int m=100; m<130; m++) {
+    Log(T0 + m * 60);
+  }
+  CHECK(Read(20251010, T0 + 99 * 60) == Want(times, T0 + 99 * 60, T0 + 86400));
+  CHECK_EQ(SD_LogReadOpen(20251010, T0 + 129 * 60), true);
+  CHECK_EQ(SD_lr_pos, Indexed(T0 + 129 * 60));
+  SD_LogReadClose();
+}
+
+// A reboot mid-day restarts the index count and loses the entries not yet synced, the entries stay in time order
+// and every line is still found. Without the .idx the whole day is read from its start.
+void Reboots() {
+  std::vector<uint32_t> all;
+
+  Blank();
+  cf_sd_sync = 300;
+  for (int m=0; m<400; m++) {
+    Log(T0 + m * 60);
+    if ((m == 123) || (m == 250)) {
+      Reboot();                                                 // Lines since the last sync lost
+      uint32_t end = eeprom.log_end;
+      while (!offsets.empty() && (offsets.back() >= end)) {
+        offsets.pop_back();
+        times.pop_back();
+      }
+    }
+  }
+  SD_LogClose(true);
+  all = times;
+  CHECK(all.size() < 400);
+  for (size_t i=1; i<all.size(); i++) {
+    CHECK(all[i] > all[i-1]);
+  }
+  for (uint32_t ts : { T0, T0 + 124 * 60 + 30, T0 + 200 * 60, T0 + 251 * 60, T0 + 399 * 60 }) {
+    CHECK(Read(20251010, ts) == Want(all, ts, T0 + 86400));
+  }
+
+  SD.remove("/OBS/20251010.idx");
+  CHECK(SD_LogReadOpen(20251010, T0 + 300 * 60));
+  CHECK_EQ(SD_lr_pos, 0);
+  SD_LogReadClose();
+  CHECK(Read(20251010, T0 + 300 * 60) == Want(all, T0 + 300 * 60, T0 + 86400));
+}
+
+// A line longer than the buffer is skipped, -1, and the line after it read
+void LongLine() {
+  char buf[600];
+  uint32_t t;
+
+  Blank();
+  Log(T0);
+  SD_LogWrite(std::string(3000, 'x').c_str(), 3000);
+  SD_LogWrite("\r\n", 2);
+  SD_LogWrite("not an observation\r\n", 20);
+  Log(T0 + 60);
+  SD_LogClose(true);
+
+  CHECK(SD_LogReadOpen(20251010, T0));
+  CHECK(SD_LogReadLine(buf, sizeof(buf), &t) > 0);
+  CHECK_EQ(t, T0);
+  CHECK_STR(buf, Line(T0));
+  CHECK_EQ(SD_LogReadLine(buf, sizeof(buf), &t), -1);
+  CHECK_EQ(SD_LogReadLine(buf, sizeof(buf), &t), -1);
+  CHECK(SD_LogReadLine(buf, sizeof(buf), &t) > 0);
+  CHECK_EQ(t, T0 + 60);
+  CHECK_EQ(SD_LogReadLine(buf, sizeof(buf), &t), 0);
+  CHECK_EQ(SD_LogReadLine(buf, sizeof(buf), &t), 0);
+  SD_LogReadClose();
+}
+
+// Send from to to and service the queue until the request is done, failing frame fail. The times of the
+// observations acknowledged.
+std::vector<uint32_t> Backfill(uint32_t from, uint32_t to, int fail=-1) {
+  std::vector<uint32_t> got;
+  size_t frames = 0;
+
+  host_lw_frames.clear();
+  OBS_BF_Request(from, to);
+  for (int guard=0; (obs_bf_active || lw_txq_count) && (guard < 100000); guard++) {
+    obs_n2s_drain = true;                                       // An observation got through
+    OBS_BF_Publish();
+    delay(1000);
+    LW_TXQ_Service();
+    if (LMIC.opmode & OP_TXRXPEND) {
+      bool ok = ((int) frames != fail);
+
+      host_lw_txdone(ok);
+      CHECK_EQ(host_lw_frames[frames].port, LW_PORT_BINARY);
+      if (ok && PL_Decode(host_lw_frames[frames].bytes.data(), host_lw_frames[frames].bytes.size())) {
+        got.push_back((uint32_t) obs.ts);
+        CHECK(obs.hth & SSB_FROM_N2S);
+      }
+      frames++;
+    }
+  }
+  CHECK(!obs_bf_active);
+  CHECK_EQ(lw_txq_count, 0);
+  OBS_Clear();
+  return (got);
+}
+
+// Three days at 15 minutes, the second with no log and the third still open at 06:00. Ranges of each edge.
+void Ranges() {
+  uint32_t d1 = T0, d2 = T0 + 86400, d3 = T0 + 2 * 86400, at;
+
+  Blank();
+  cf_sd_sync = 4000;                                            // Synced at 05:00, 05:15 to 06:00 held in RAM
+  cf_15m_enable = 1;
+  cf_lw_binary = 1;
+  cf_n2s_batch = 0;
+  LW_valid = true;
+  LMIC.datarate = 3;
+  for (at=d1; at<d2; at+=900) {
+    Log(at);
+  }
+  for (at=d3; at<=d3 + 6 * 3600; at+=900) {
+    Log(at);
+  }
+  host_unixtime = at;                                           // Now, the 06:15 observation not yet taken
+  CHECK(!SD.exists("/OBS/20251011.log"));
+
+  // To past now, the open day's lines still in RAM included
+  CHECK(SD_log_len > 0);
+  CHECK(Backfill(d3 + 5 * 3600, d3 + 100 * 86400) == Want(sent, d3 + 5 * 3600, d3 + 6 * 3600));
+  CHECK_EQ(Want(sent, d3 + 5 * 3600, d3 + 6 * 3600).size(), 5);
+
+  // From the day before the log starts, no log that day
+  CHECK(Backfill(d1 - 3600, d1 + 3 * 3600) == Want(sent, d1 - 3600, d1 + 3 * 3600));
+  CHECK_EQ(Want(sent, d1 - 3600, d1 + 3 * 3600).size(), 13);
+
+  // Starting between index entries and between lines
+  CHECK(Backfill(d1 + 10 * 3600 + 7 * 60, d1 + 11 * 3600) == Want(sent, d1 + 10 * 3600 + 7 * 60, d1 + 11 * 3600));
+
+  // Across the day with no log
+  CHECK(Backfill(d1 + 20 * 3600, d3 + 2 * 3600) == Want(sent, d1 + 20 * 3600, d3 + 2 * 3600));
+  CHECK_EQ(Want(sent, d1 + 20 * 3600, d3 + 2 * 3600).size(), 16 + 9);
+
+  // A range in the day with no log, nothing sent
+  CHECK(Backfill(d2 + 3600, d2 + 5 * 3600).empty());
+  CHECK_EQ(host_lw_frames.size(), 0);
+
+  // One observation, on its time exactly
+  CHECK(Backfill(d1 + 900, d1 + 900) == Want(sent, d1 + 900, d1 + 900));
+
+  // Reversed, ignored
+  OBS_BF_Request(d1 + 3600, d1);
+  CHECK(!obs_bf_active);
+
+  // The third frame fails, it and the rest are sent after
+  CHECK(Backfill(d1, d1 + 3 * 3600, 2) == Want(sent, d1, d1 + 3 * 3600));
+  CHECK_EQ(host_lw_frames.size(), Want(sent, d1, d1 + 3 * 3600).size() + 1);
+
+  cf_15m_enable = 0;
+}
+
+int main() {
+  Search();
+  OpenDay();
+  Reboots();
+  LongLine();
+  Ranges();
+  return (test_done("bf_test"));
+}
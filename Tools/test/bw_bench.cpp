@@ -0,0 +1,91 @@
+/*
+ * ======================================================================================================================
+ *  bw_bench.cpp - Text observation formatting, see SF.h and OBS.h
+ *
+ *    sprintf+strlen  The old builder, sprintf(obsbuf+strlen(obsbuf), "&%s=%.1f", ...) for every field
+ *    writer          OBS_Encode() then OBS_Render() in URL form, the BW_ formatters
+ *
+ *  For an observation of 10, 30 and 60 sensors, most of them floats. The SAMD21 has no FPU and the %.1f is soft
+ *  float there too, so the ratio is the guide, not the host times.
+ * ======================================================================================================================
+ */
+#include "test.h"
+#include <chrono>
+
+const int N = 20000;
+volatile int sink;
+
+double Now() {
+  return (std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Fill(int sensors) {
+  int sidx = 0;
+
+  srand(1);
+  OBS_Clear();
+  obs.inuse = true;
+  obs.ts = 1792022400;
+  obs.bv = 4.12;
+  obs.hth = 0x4000;
+  for (int id=0; sidx<sensors; id++) {
+    if (obs_names[id].type == F_OBS) {
+      OBS_AddF(&sidx, id, (rand() % 20000 - 5000) / 10.0);
+    }
+    else {
+      OBS_AddI(&sidx, id, rand() % 360);
+    }
+  }
+}
+
+// The builder before the writer, URL form
+int Old() {
+  tm *dt = gmtime(&obs.ts);
+
+  memset(obsbuf, 0, MAX_OBS_SIZE);
+  sprintf (obsbuf+strlen(obsbuf), "at=%d-%02d-%02dT%02d%%3A%02d%%3A%02d", dt->tm_year+1900, dt->tm_mon+1,
+    dt->tm_mday, dt->tm_hour, dt->tm_min, dt->tm_sec);
+  sprintf (obsbuf+strlen(obsbuf), "&bv=%d.%02d", (int)obs.bv, (int)(obs.bv*100)%100);
+  sprintf (obsbuf+strlen(obsbuf), "&hth=%d", (int)obs.hth);
+  for (int s=0; s<MAX_SENSORS; s++) {
+    if (OBS_Present(s)) {
+      if (obs.sensor[s].type == F_OBS) {
+        sprintf (obsbuf+strlen(obsbuf), "&%s=%.1f", obs_names[obs.sensor[s].id].name, obs.sensor[s].f_obs);
+      }
+      else {
+        sprintf (obsbuf+strlen(obsbuf), "&%s=%d", obs_names[obs.sensor[s].id].name, obs.sensor[s].i_obs);
+      }
+    }
+  }
+  return (strlen(obsbuf));
+}
+
+int New() {
+  OBS_Encode();
+  return (OBS_Render(false));
+}
+
+double Time(int (*fn)()) {
+  double t = Now();
+  for (int i=0; i<N; i++) {
+    sink = fn();
+  }
+  return ((Now() - t) * 1e6 / N);
+}
+
+int main() {
+  const int sizes[] = { 10, 30, 60 };
+  std::string old_text;
+
+  printf("bw_bench: %d observations each\n", N);
+  for (int sensors : sizes) {
+    Fill(sensors);
+    Old();
+    old_text = obsbuf;
+    New();
+    double old_us = Time(Old), new_us = Time(New);
+    printf("%2d sensors %4zu bytes  sprintf+strlen %6.2f us  writer %6.2f us  %4.1fx%s\n", sensors,
+           old_text.size(), old_us, new_us, old_us / new_us, (old_text == obsbuf) ? "" : "  DIFFERS");
+  }
+  return (0);
+}
@@ -0,0 +1,199 @@
+/*
+ * ======================================================================================================================
+ *  bw_test.cpp - Buffer writer, see SF.h. BW_Float1(), BW_Int() and BW_UInt() against snprintf on random and edge
+ *                values, and random field lists written in to every buffer size to check truncation.
+ * ======================================================================================================================
+ */
+#include "test.h"
+#include <float.h>
+#include <limits.h>
+#include <random>
+
+std::mt19937_64 rng(1);
+
+std::string Float1(float f) {
+  char buf[64];
+  BUFWRITER w;
+
+  BW_Begin(&w, buf, sizeof(buf));
+  BW_Float1(&w, f);
+  return (buf);
+}
+
+// BW_Float1() of f against %.1f, returns false on a mismatch and prints the first few
+bool SameFloat(float f) {
+  static int shown = 0;
+  char want[64];
+
+  snprintf(want, sizeof(want), "%.1f", (double) f);
+  if (isnan(f)) {
+    strcpy(want, "nan");
+  }
+  if (Float1(f) != want) {
+    if (shown++ < 5) {
+      printf("BW_Float1(%a) [%s] != [%s]\n", f, Float1(f).c_str(), want);
+    }
+    return (false);
+  }
+  return (true);
+}
+
+float Bits(uint32_t u) {
+  float f;
+  memcpy(&f, &u, 4);
+  return (f);
+}
+
+void Floats() {
+  long bad = 0;
+
+  // Random bit patterns, every exponent from denormals to inf and NaN
+  for (int i=0; i<1000000; i++) {
+    bad += !SameFloat(Bits((uint32_t) rng()));
+  }
+
+  // Ties at .x5, the round half to even cases
+  for (int i=-500000; i<500000; i++) {
+    bad += !SameFloat(i / 100.0f + 0.05f);
+    bad += !SameFloat(i / 20.0f);
+  }
+
+  // From 1e14 up, every exponent with random mantissas, the limb path
+  for (int e=40; e<128; e++) {
+    for (int i=0; i<2000; i++) {
+      uint32_t m = (uint32_t) rng() & 0x7FFFFF;
+      bad += !SameFloat(Bits(((uint32_t) (e + 127) << 23) | m));
+      bad += !SameFloat(-Bits(((uint32_t) (e + 127) << 23) | m));
+    }
+  }
+  CHECK_EQ(bad, 0);
+
+  CHECK_STR(Float1(FLT_MAX), "340282346638528859811704183484516925440.0");
+  CHECK_STR(Float1(-FLT_MAX), "-340282346638528859811704183484516925440.0");
+  CHECK_STR(Float1(1e14f), "100000000376832.0");
+  CHECK_STR(Float1(INFINITY), "inf");
+  CHECK_STR(Float1(-INFINITY), "-inf");
+  CHECK_STR(Float1(-NAN), "nan");
+  CHECK_STR(Float1(-0.0f), "-0.0");
+  CHECK_STR(Float1(-0.04f), "-0.0");
+  CHECK_STR(Float1(0.25f), "0.2");
+  CHECK_STR(Float1(0.35f), "0.3");                               // 0.3499999940...
+  CHECK_STR(Float1(QC_ERR_T), "-999.9");
+}
+
+void Ints() {
+  const int widths[] = { 0, 1, 2, 3, 4, 9, 12 };
+  char want[64], got[64];
+  long bad = 0;
+  BUFWRITER w;
+
+  for (int i=0; i<1000000; i++) {
+    long v = (long) rng() >> (rng() % 64);
+    unsigned long u = (unsigned long) rng() >> (rng() % 64);
+    int width = widths[i % 7];
+
+    BW_Begin(&w, got, sizeof(got));
+    BW_Int(&w, v, width);
+    snprintf(want, sizeof(want), "%0*ld", width, v);
+    bad += (strcmp(got, want) != 0);
+
+    BW_Begin(&w, got, sizeof(got));
+    BW_UInt(&w, u, width);
+    snprintf(want, sizeof(want), "%0*lu", width, u);
+    bad += (strcmp(got, want) != 0);
+  }
+  CHECK_EQ(bad, 0);
+
+  BW_Begin(&w, got, sizeof(got));
+  BW_Int(&w, LONG_MIN, 0);
+  BW_Str(&w, " ");
+  BW_Int(&w, -5, 3);
+  BW_Str(&w, " ");
+  BW_UInt(&w, ULONG_MAX, 0);
+  snprintf(want, sizeof(want), "%ld -05 %lu", LONG_MIN, ULONG_MAX);
+  CHECK_STR(got, want);
+}
+
+// One field of a random observation
+struct Field {
+  int kind;
+  long i;
+  float f;
+  std::string s;
+};
+
+void WriteField(BUFWRITER *w, const Field &f) {
+  switch (f.kind) {
+    case 0 : BW_Str(w, f.s.c_str()); break;
+    case 1 : BW_Int(w, f.i, f.i & 3); break;
+    case 2 : BW_UInt(w, (unsigned long) f.i, 0); break;
+    case 3 : BW_Float1(w, f.f); break;
+    case 4 : BW_Write(w, "", 1); break;                          // NUL separator as OBS_Encode() writes
+  }
+}
+
+// Random field lists written in to every size of buffer. The writer must stay inside it, keep it NUL terminated
+// and hold exactly the fields that fit before the first that did not, so a negative number is never cut to "-".
+void Truncation() {
+  const char *names[] = { "&rg1=", "\"at\":\"", ",", "&bp1=", "}" };
+  char full[2048], buf[2048 + 16];
+  long bad = 0;
+  BUFWRITER w;
+
+  for (int t=0; t<1000; t++) {
+    std::vector<Field> fields;
+    std::vector<int> ends;                                       // Length after each field
+
+    for (int n=rng() % 40 + 1; n>0; n--) {
+      Field f;
+      f.kind = rng() % 5;
+      f.i = (long) rng() >> (rng() % 64);
+      f.f = (rng() & 1) ? Bits((uint32_t) rng()) : (float) ((long) (rng() % 200000) - 100000) / 10;
+      f.s = names[rng() % 5];
+      fields.push_back(f);
+    }
+    BW_Begin(&w, full, sizeof(full));
+    for (auto &f : fields) {
+      WriteField(&w, f);
+      ends.push_back(w.len);
+    }
+
+    for (int size=1; size<=ends.back() + 2; size++) {
+      int want = 0;
+
+      memset(buf, 0x5A, sizeof(buf));
+      BW_Begin(&w, buf, size);
+      for (auto &f : fields) {
+        WriteField(&w, f);
+      }
+      for (int k=0; k<(int)ends.size() && ends[k] < size; k++) {
+        want = ends[k];
+      }
+      bad += (w.len != want) || (memcmp(buf, full, want) != 0) || (buf[want] != 0) || 
+             (w.overflow != (want < ends.back())) || (buf[size] != 0x5A) || (buf[size + 15] != 0x5A);
+    }
+  }
+  CHECK_EQ(bad, 0);
+
+  // The "-" is not written before the digits that do not fit
+  char b[4];
+  BW_Begin(&w, b, sizeof(b));
+  BW_Str(&w, "a");
+  BW_Int(&w, -45, 0);
+  CHECK_STR(b, "a");
+  CHECK(w.overflow);
+  BW_Begin(&w, b, sizeof(b));
+  BW_Float1(&w, -1.5);
+  CHECK_STR(b, "");
+  BW_Begin(&w, b, sizeof(b));
+  BW_Float1(&w, -INFINITY);
+  CHECK_STR(b, "");
+  CHECK(w.overflow);
+}
+
+int main() {
+  Floats();
+  Ints();
+  Truncation();
+  return (test_done("bw_test"));
+}
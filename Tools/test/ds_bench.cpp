@@ -0,0 +1,70 @@
+/*
+ * ======================================================================================================================
+ *  ds_bench.cpp - Distance gauge median, see WRDB.h
+ *
+ *    old sort      The old DS_Median(), mysort() of the 60 bucket ring in place on every call
+ *    sorted copy   DS_TakeReading() keeping dg_sorted with DS_SortedReplace(), DS_Median() a lookup
+ *
+ *  The old cost is per DS_Median() call, once an observation and twice a StationMonitor() refresh. The new cost is
+ *  per reading, once a second, and the median is free. Element compares and moves are what cost time on the SAMD21,
+ *  the host times are only relative.
+ * ======================================================================================================================
+ */
+#include "test.h"
+#include <chrono>
+
+const int N = 200000;
+volatile unsigned long sink;   // Keeps the medians from being optimized away
+
+double Now() {
+  return (std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+unsigned int Random(int i) { return (rand() % 4096); }
+unsigned int Noisy(int i)  { return (1600 + rand() % 16); }
+unsigned int Rising(int i) { return ((i * 4) % 4096); }        // Worst case, the oldest is the least, the new the most
+
+void Bench(const char *name, unsigned int (*gen)(int)) {
+  static unsigned int raw[N];
+  unsigned int ring[DG_BUCKETS] = {};
+  double t, old_us, new_us;
+  int b = 0;
+
+  srand(1);
+  for (int i=0; i<N; i++) {
+    raw[i] = gen(i);
+  }
+
+  // As the sketch did, the reading in to the ring then mysort() the ring
+  t = Now();
+  for (int i=0; i<N; i++) {
+    ring[b] = raw[i] / 4;
+    b = (b + 1) % DG_BUCKETS;
+    mysort(ring, DG_BUCKETS);
+    sink += ring[(DG_BUCKETS+1) / 2 - 1];
+  }
+  old_us = (Now() - t) * 1e6 / N;
+
+  memset(dg_buckets, 0, sizeof(dg_buckets));
+  memset(dg_sorted, 0, sizeof(dg_sorted));
+  dg_bucket = 0;
+  dg_divideby = 4;
+  cf_ds_samples = 1;
+  t = Now();
+  for (int i=0; i<N; i++) {
+    host_analog[DISTANCE_GAUGE_PIN] = raw[i];
+    DS_TakeReading();
+    sink += (unsigned int) DS_Median();
+  }
+  new_us = (Now() - t) * 1e6 / N;
+
+  printf("%-8s old sort %7.3f us   sorted copy %7.3f us   %6.0fx\n", name, old_us, new_us, old_us / new_us);
+}
+
+int main() {
+  printf("ds_bench: %d readings, a reading and a median each\n", N);
+  Bench("random", Random);
+  Bench("noisy", Noisy);
+  Bench("rising", Rising);
+  return (0);
+}
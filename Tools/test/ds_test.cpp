@@ -0,0 +1,243 @@
+/*
+ * ======================================================================================================================
+ *  ds_test.cpp - Distance gauge, see WRDB.h. DS_TakeReading() keeps dg_sorted in step with the dg_buckets ring, and
+ *                DS_Median() and DS_Spread() are checked against the old mysort() of a copy of the ring. DS_Filter()
+ *                on hand made bursts and on the noisy traces in traces/, see traces/ds_traces.js for their format.
+ * ======================================================================================================================
+ */
+#include "test.h"
+#include <algorithm>
+#include <deque>
+#include <dirent.h>
+
+std::deque<unsigned int> taken;         // Every reading in the order taken, the ring's contents are the last 60
+
+void Reset() {
+  memset(dg_buckets, 0, sizeof(dg_buckets));
+  memset(dg_sorted, 0, sizeof(dg_sorted));
+  dg_bucket = 0;
+  dg_divideby = 4;
+  cf_ds_samples = 1;
+  taken.assign(DG_BUCKETS, 0);
+}
+
+// The median as it was, mysort() on the ring in place then the lower middle. Here on a copy.
+unsigned int OldMedian() {
+  unsigned int a[DG_BUCKETS];
+
+  memcpy(a, dg_buckets, sizeof(a));
+  mysort(a, DG_BUCKETS);
+  return (a[(DG_BUCKETS+1) / 2 - 1]);
+}
+
+// One reading of raw ADC counts, then check the sorted copy, the median, the spread and the ring order. Returns
+// false on the first mismatch so a bad sequence does not print thousands of lines.
+bool Reading(unsigned int raw) {
+  unsigned int a[DG_BUCKETS];
+
+  host_analog[DISTANCE_GAUGE_PIN] = raw;
+  DS_TakeReading();
+  taken.push_back(raw / dg_divideby);
+  taken.pop_front();
+
+  memcpy(a, dg_buckets, sizeof(a));
+  std::sort(a, a + DG_BUCKETS);
+  if (memcmp(a, dg_sorted, sizeof(a)) != 0) {
+    printf("dg_sorted is not the ring sorted after %u\n", raw);
+    return (false);
+  }
+  if ((unsigned int) DS_Median() != OldMedian()) {
+    printf("median %u, old %u after %u\n", (unsigned int) DS_Median(), OldMedian(), raw);
+    return (false);
+  }
+  if (DS_Spread() != (int) (a[(3 * DG_BUCKETS) / 4 - 1] - a[DG_BUCKETS / 4 - 1])) {
+    printf("spread %d after %u\n", DS_Spread(), raw);
+    return (false);
+  }
+  for (int i=0; i<DG_BUCKETS; i++) {                            // Oldest first from the next bucket to write
+    if (dg_buckets[(dg_bucket + i) % DG_BUCKETS] != taken[i]) {
+      printf("ring out of order at %d after %u\n", i, raw);
+      return (false);
+    }
+  }
+  return (true);
+}
+
+// n readings from gen, one CHECK for the lot
+void Sequence(const char *name, int n, unsigned int (*gen)(int)) {
+  bool ok = true;
+
+  Reset();
+  for (int i=0; i<n && ok; i++) {
+    ok = Reading(gen(i));
+  }
+  if (!ok) {
+    printf("  in sequence %s\n", name);
+  }
+  CHECK(ok);
+}
+
+unsigned int Random(int i)   { return (rand() % 4096); }
+unsigned int Steady(int i)   { return (2000); }
+unsigned int Ramp(int i)     { return ((i * 7) % 4096); }
+unsigned int Fall(int i)     { return (4095 - (i * 3) % 4096); }
+unsigned int Few(int i)      { return ((rand() % 4) * 4); }        // Lots of equal readings
+unsigned int Swing(int i)    { return ((i & 1) ? 4095 : 0); }      // Every reading crosses the whole array
+unsigned int Outliers(int i) { return ((rand() % 10) ? 1600 + rand() % 8 : ((rand() & 1) ? 4095 : 40)); }
+
+// DS_Filter() of n samples, returns the reading and sets kept
+unsigned int Filter(std::vector<unsigned int> v, int *kept) {
+  return (DS_Filter(v.data(), v.size(), kept));
+}
+
+void FilterBursts() {
+  unsigned int s[DS_SAMPLES_MAX] = { 1610, 4095, 1600, 1605, 40, 1602, 1598 };
+  int kept;
+
+  CHECK_EQ(Filter({}, &kept), 0);
+  CHECK_EQ(kept, 0);
+  CHECK_EQ(Filter({ 1234 }, &kept), 1234);
+  CHECK_EQ(kept, 1);
+  CHECK_EQ(Filter({ 1600, 1601 }, &kept), 1601);                  // Rounded average, the MAD is the upper one
+  CHECK_EQ(kept, 2);
+
+  // A quiet burst has a MAD of 0, a count or 4 off is kept and 5 off dropped
+  CHECK_EQ(Filter({ 1600, 1600, 1600, 1604, 1600 }, &kept), 1601);
+  CHECK_EQ(kept, 5);
+  CHECK_EQ(Filter({ 1600, 1600, 1600, 1605, 1600 }, &kept), 1600);
+  CHECK_EQ(kept, 4);
+
+  // Full range dropouts and a short multipath echo are dropped, and samples is left sorted
+  CHECK_EQ(DS_Filter(s, 7, &kept), 1603);
+  CHECK_EQ(kept, 5);
+  for (int i=1; i<7; i++) {
+    CHECK(s[i-1] <= s[i]);
+  }
+
+  // Half the burst dropped out, the median is one of them so they are kept and the rest dropped
+  CHECK_EQ(Filter({ 4095, 1600, 4095, 1601, 4095, 1602, 4095 }, &kept), 4095);
+  CHECK_EQ(kept, 4);
+}
+
+// Each trace through DS_Sample() and DS_TakeReading() as the "DSS" and "DS" tasks run them, errors in counts of the
+// reading after dg_divideby. The filtered readings must be far closer to the truth than one read a second, as the
+// sketch used to take, and the observation's 60 second median must be within a count or two. DS_Quality() must be
+// near the share of clean samples.
+void Trace(const char *file) {
+  std::string path = std::string("traces/") + file;
+  FILE *fp = fopen(path.c_str(), "r");
+  char line[256];
+  double filtered = 0, single = 0, median = 0, quality = 0, err;
+  int seconds = 0, close = 0, minutes = 0, n;
+  unsigned int truth, raw[DS_SAMPLES_MAX], minute[DG_BUCKETS];
+
+  CHECK(fp != NULL);
+  if (!fp) {
+    return;
+  }
+  Reset();
+  cf_ds_samples = 9;
+  DS_Quality();
+  while (fgets(line, sizeof(line), fp)) {
+    if (line[0] == '#') {
+      continue;
+    }
+    n = sscanf(line, "%u %u %u %u %u %u %u %u %u %u", &truth, &raw[0], &raw[1], &raw[2], &raw[3], &raw[4],
+               &raw[5], &raw[6], &raw[7], &raw[8]);
+    CHECK_EQ(n, 10);
+    for (int i=0; i<9; i++) {
+      host_analog[DISTANCE_GAUGE_PIN] = raw[i];
+      DS_Sample();
+    }
+    truth /= dg_divideby;
+    single += fabs((double) (raw[0] / dg_divideby) - truth);
+    DS_TakeReading();
+    err = fabs((double) dg_buckets[(dg_bucket + DG_BUCKETS - 1) % DG_BUCKETS] - truth);
+    filtered += err;
+    close += (err <= 2);
+    minute[seconds % DG_BUCKETS] = truth;
+    if ((++seconds % DG_BUCKETS) == 0) {                         // An observation, the median against the truth's
+      std::sort(minute, minute + DG_BUCKETS);
+      median = fmax(median, fabs(DS_Median() - minute[(DG_BUCKETS+1) / 2 - 1]));
+      quality += DS_Quality();
+      minutes++;
+    }
+  }
+  fclose(fp);
+
+  CHECK(seconds >= 600);
+  filtered /= seconds;
+  single /= seconds;
+  quality /= minutes;
+  if (getenv("SERIAL")) {
+    printf("%-18s single read %6.1f  filtered %5.2f, %5.1f%% within 2  60s median worst %2.0f  quality %5.1f%%\n",
+           file, single, filtered, close * 100.0 / seconds, median, quality);
+  }
+  CHECK((filtered * 5 < single) || (single < 1));
+  CHECK(close > seconds * 0.9);
+  CHECK(median <= 2);
+  CHECK(quality > (strstr(file, "quiet") ? 95 : 60));
+}
+
+void Traces() {
+  DIR *d = opendir("traces");
+  struct dirent *e;
+  int n = 0;
+
+  CHECK(d != NULL);
+  while (d && (e = readdir(d))) {
+    if ((strncmp(e->d_name, "ds_", 3) == 0) && strstr(e->d_name, ".txt")) {
+      Trace(e->d_name);
+      n++;
+    }
+  }
+  if (d) {
+    closedir(d);
+  }
+  CHECK(n >= 4);
+}
+
+int main() {
+  FilterBursts();
+  Traces();
+
+  srand(1);
+  Sequence("random", 50000, Random);
+  Sequence("steady", 1000, Steady);
+  Sequence("ramp", 20000, Ramp);
+  Sequence("fall", 20000, Fall);
+  Sequence("few", 20000, Few);
+  Sequence("swing", 5000, Swing);
+  Sequence("outliers", 50000, Outliers);
+
+  // From power up the ring is zeros, the lower median stays 0 until 31 readings are in
+  Reset();
+  for (int i=0; i<30; i++) {
+    Reading(4000);
+  }
+  CHECK_EQ(DS_Median(), 0);
+  Reading(4000);
+  CHECK_EQ(DS_Median(), 1000);
+
+  // DS_Median() no longer sorts the ring, readings stay in the order taken
+  Reset();
+  for (int i=0; i<DG_BUCKETS; i++) {
+    Reading((DG_BUCKETS - i) * 40);
+  }
+  DS_Median();
+  DS_Median();
+  for (int i=0; i<DG_BUCKETS; i++) {
+    CHECK_EQ(dg_buckets[i], (DG_BUCKETS - i) * 10);
+  }
+
+  // The 5m sensor divisor
+  Reset();
+  dg_divideby = 8;
+  for (int i=0; i<DG_BUCKETS; i++) {
+    Reading(800 + i);
+  }
+  CHECK_EQ(DS_Median(), 103);
+  CHECK_EQ(DS_Spread(), 4);
+
+  return (test_done("ds_test"));
+}
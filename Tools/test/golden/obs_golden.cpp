@@ -0,0 +1,121 @@
+/*
+ * ======================================================================================================================
+ *  obs_golden.cpp - Writes obs_render.txt, the observations obs_render_test.cpp renders and what the sprintf()
+ *                   OBS_LOG_Add() and OBS_Build() made of them before the buffer writer, see OBS.h. Built against
+ *                   the sketch as it was then, a19ded3. Run make golden to rewrite the file.
+ *
+ *  Each observation is three lines
+ *    obs  ts bv hth id:type:value ...   bv and F_OBS values are the float's bits in hex, I_OBS and U_OBS decimal
+ *    json {"at":...}                    The SD log line
+ *    url  at=...                        The text uplink
+ * ======================================================================================================================
+ */
+#include "Arduino.h"
+#include SKETCH
+
+#include <string>
+
+uint32_t seed = 7;
+
+// mulberry32, the same numbers on every host
+uint32_t Rand() {
+  uint32_t t = (seed += 0x6D2B79F5);
+
+  t = (t ^ (t >> 15)) * (t | 1);
+  t ^= t + ((t ^ (t >> 7)) * (t | 61));
+  return (t ^ (t >> 14));
+}
+
+uint32_t Bits(float f) {
+  uint32_t u;
+
+  memcpy(&u, &f, 4);
+  return (u);
+}
+
+// A value for a sensor of type, mostly the range a station reads with the edges the formatter has to get right
+void Value(SENSOR *sensor, int kind) {
+  static const float edge[] = { 0.0f, -0.0f, 0.05f, -0.05f, 0.25f, 0.35f, -0.45f, 2.5f, 1013.25f, 99.95f,
+                                -40.04f, 123456.78f, 1e9f, -3.4e38f, 3.4e38f, INFINITY, -INFINITY, NAN, 1e-30f };
+
+  switch (sensor->type) {
+    case F_OBS :
+      if (kind == 0) {
+        sensor->f_obs = edge[Rand() % (sizeof(edge) / sizeof(edge[0]))];
+      }
+      else {
+        sensor->f_obs = ((int32_t) (Rand() % 200000) - 50000) / 100.0f;
+      }
+      break;
+    case I_OBS :
+      sensor->i_obs = (kind == 0) ? (int32_t) Rand() : (int32_t) (Rand() % 2000) - 1000;
+      break;
+    default :
+      sensor->u_obs = (kind == 0) ? Rand() : Rand() % 5000;
+      break;
+  }
+}
+
+// Observation n, n sensors at most, edge values when edges is set
+void Observation(int n, bool edges) {
+  int sidx = 0;
+
+  OBS_Clear();
+  obs.inuse = true;
+  obs.ts = 1700000000 + (time_t) (Rand() % 400000000);
+  obs.bv = (Rand() % 500) / 100.0f + ((Rand() & 1) ? 0.005f : 0.0f);
+  obs.hth = Rand() & 0x7FFFFFFF;
+  for (int i=0; i<n; i++) {
+    int id = Rand() % SID_COUNT;
+    Value(OBS_Add(&sidx, id, obs_names[id].type), (edges) ? Rand() % 2 : 1);
+  }
+}
+
+void Write(FILE *fp) {
+  fprintf(fp, "obs %ld %08X %lu", (long) obs.ts, Bits(obs.bv), obs.hth);
+  for (int s=0; s<MAX_SENSORS; s++) {
+    if (OBS_Present(s)) {
+      SENSOR *sensor = &obs.sensor[s];
+      if (sensor->type == F_OBS) {
+        fprintf(fp, " %d:%d:%08X", sensor->id, sensor->type, Bits(sensor->f_obs));
+      }
+      else if (sensor->type == I_OBS) {
+        fprintf(fp, " %d:%d:%d", sensor->id, sensor->type, sensor->i_obs);
+      }
+      else {
+        fprintf(fp, " %d:%d:%u", sensor->id, sensor->type, sensor->u_obs);
+      }
+    }
+  }
+  OBS_LOG_Add();
+  fprintf(fp, "\njson %s\n", obsbuf);
+  cf_lw_binary = 0;
+  OBS_Build();
+  fprintf(fp, "url %s\n", obsbuf);
+}
+
+int main(int argc, char **argv) {
+  FILE *fp = fopen((argc > 1) ? argv[1] : "golden/obs_render.txt", "w");
+
+  if (!fp) {
+    return (1);
+  }
+  host_sd_root = "build/sd_golden";
+  host_sd_format();
+  fprintf(fp, "# Written by golden/obs_golden.cpp from the sprintf() formatter, see it for the format\n");
+  for (int i=0; i<40; i++) {
+    Observation(1 + Rand() % 12, true);
+    Write(fp);
+  }
+  for (int i=0; i<10; i++) {
+    Observation(MAX_SENSORS, false);                           // A full station, long lines
+    Write(fp);
+  }
+  OBS_Clear();                                                 // No sensors
+  obs.inuse = true;
+  obs.ts = 0;
+  obs.bv = 4.2f;
+  Write(fp);
+  fclose(fp);
+  return (0);
+}
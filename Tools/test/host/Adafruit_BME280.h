@@ -0,0 +1,6 @@
+#pragma once
+// Host stand-in, a mock driver. Not found unless a test sets host_found, reads return the host_ values it sets
+#include "Adafruit_Sensor.h"
+class Adafruit_BME280 { public: bool host_found = false; float host_p = 0, host_t = 0, host_h = 0;
+  bool begin(uint8_t a=0x77) { (void)a; return host_found; } float readPressure() { return host_p; }
+  float readTemperature() { return host_t; } float readHumidity() { return host_h; } float readAltitude(float) { return 0; } };
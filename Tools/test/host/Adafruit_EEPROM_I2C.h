@@ -0,0 +1,14 @@
+#pragma once
+// Host stand-in for the 32KB I2C EEPROM, kept in RAM across simulated reboots. Counts byte writes.
+// A write lands whole or not at all, see host_power_write()
+#include "Adafruit_Sensor.h"
+inline uint8_t host_eeprom[32768];
+inline long host_eeprom_writes = 0;
+class Adafruit_EEPROM_I2C {
+public:
+  bool begin(uint8_t a=0x50) { (void)a; return true; }
+  uint16_t read(uint16_t addr, uint8_t *buf, uint16_t n) { memcpy(buf, host_eeprom + addr, n); return n; }
+  uint16_t write(uint16_t addr, uint8_t *buf, uint16_t n) { host_power_write(); memcpy(host_eeprom + addr, buf, n); host_eeprom_writes += n; return n; }
+  bool write(uint16_t addr, uint8_t v) { host_power_write(); host_eeprom[addr] = v; host_eeprom_writes++; return true; }
+  uint8_t read(uint16_t addr) { return host_eeprom[addr]; }
+};
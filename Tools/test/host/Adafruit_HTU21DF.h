@@ -0,0 +1,6 @@
+#pragma once
+// Host stand-in, a mock driver. Not found unless a test sets host_found, reads return the host_ values it sets
+#include "Adafruit_Sensor.h"
+#define HTU21DF_I2CADDR 0x40
+class Adafruit_HTU21DF { public: bool host_found = false; float host_t = 0, host_h = 0;
+  bool begin() { return host_found; } float readHumidity() { return host_h; } float readTemperature() { return host_t; } };
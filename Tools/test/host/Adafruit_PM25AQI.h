@@ -0,0 +1,5 @@
+#pragma once
+// Host stand-in, the sensor is never found
+#include "Adafruit_Sensor.h"
+typedef struct { uint16_t pm10_standard, pm25_standard, pm100_standard, pm10_env, pm25_env, pm100_env; } PM25_AQI_Data;
+class Adafruit_PM25AQI { public: bool begin_I2C() { return false; } bool read(PM25_AQI_Data *) { return false; } };
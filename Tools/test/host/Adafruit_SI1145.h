@@ -0,0 +1,7 @@
+#pragma once
+// Host stand-in, a mock driver. Not found unless a test sets host_found, reads return the host_ values it sets
+#include "Adafruit_Sensor.h"
+#define SI1145_ADDR 0x60
+class Adafruit_SI1145 { public: bool host_found = false; uint16_t host_vis = 0, host_ir = 0, host_uv = 0;
+  bool begin(TwoWire *w=0) { (void)w; return host_found; } uint16_t readVisible() { return host_vis; }
+  uint16_t readIR() { return host_ir; } uint16_t readUV() { return host_uv; } };
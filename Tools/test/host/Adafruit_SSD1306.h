@@ -0,0 +1,14 @@
+#pragma once
+// Host stand-in, the display is never found
+#include "Wire.h"
+#define SSD1306_DISPLAYOFF 0xAE
+#define SSD1306_DISPLAYON 0xAF
+#define SSD1306_SWITCHCAPVCC 2
+class Adafruit_SSD1306 : public Print {
+public:
+  Adafruit_SSD1306(int, int, TwoWire *, int) {}
+  bool begin(int, int) { return false; }
+  void clearDisplay() {} void display() {} void setCursor(int, int) {} void setTextColor(int) {} void setTextColor(int, int) {}
+  void setTextSize(int) {} void ssd1306_command(int) {}
+  size_t write(uint8_t) { return 1; }
+};
@@ -0,0 +1,164 @@
+#pragma once
+/*
+ * ======================================================================================================================
+ *  Arduino.h - Host stand-in for the Arduino SAMD core, enough to build and run the sketch in a host test
+ *
+ *  millis() and micros() are host_millis and host_micros, tests move them. Serial output is dropped unless
+ *  host_serial is set. The SAMD21 registers PWR.h touches are plain structs.
+ * ======================================================================================================================
+ */
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <ctype.h>
+#include <ctime>
+#include <string>
+
+typedef uint8_t byte; typedef uint16_t word; typedef bool boolean;
+#define HIGH 1
+#define LOW 0
+#define OUTPUT 1
+#define INPUT 0
+#define INPUT_PULLUP 2
+#define FALLING 2
+#define RISING 3
+#define CHANGE 4
+enum { A0=14, A1, A2, A3, A4, A5, A6, A7 };
+#define LED_BUILTIN 13
+#define WHITE 1
+#define BLACK 0
+
+inline unsigned long host_millis = 0;
+inline unsigned long host_micros = 0;
+inline bool host_serial = false;
+inline int host_pin[64];
+inline int host_analog[64];
+
+// Power loss: after host_power_ops more writes to the SD card or EEPROM the next one throws HostPowerLoss instead
+// of landing. -1 never. See host_sd_powerloss() in SD.h
+struct HostPowerLoss {};
+inline long host_power_ops = -1;
+inline void host_power_write() {
+  if (host_power_ops == 0) throw HostPowerLoss();
+  if (host_power_ops > 0) host_power_ops--;
+}
+
+inline unsigned long millis() { return host_millis; }
+inline unsigned long micros() { return host_micros; }
+inline void delay(unsigned long ms) { host_millis += ms; host_micros += ms * 1000UL; }
+inline void delayMicroseconds(unsigned int us) { host_micros += us; }
+inline void digitalWrite(int p, int v) { host_pin[p & 63] = v; }
+inline int digitalRead(int p) { return host_pin[p & 63]; }
+inline void pinMode(int, int) {}
+inline int analogRead(int p) { return host_analog[p & 63]; }
+inline void analogReadResolution(int) {}
+inline void analogWrite(int, int) {}
+inline void attachInterrupt(int, void (*)(), int) {}
+inline void detachInterrupt(int) {}
+inline int digitalPinToInterrupt(int p) { return p; }
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define PGM_P const char *
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define memcpy_P memcpy
+#define strcpy_P strcpy
+
+class String {
+  std::string s;
+public:
+  String() {}
+  String(char c) : s(1, c) {}
+  String(const char *c) : s(c ? c : "") {}
+  void reserve(int n) { s.reserve(n); }
+  String& operator=(const char *c) { s = c ? c : ""; return *this; }
+  String& operator+=(const String &o) { s += o.s; return *this; }
+  const char *c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.size(); }
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) { if (host_serial) putchar(c); return 1; }
+  size_t write(const uint8_t *b, size_t n) { for (size_t i=0; i<n; i++) write(b[i]); return n; }
+  size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t print(const __FlashStringHelper *s) { return print((const char *)s); }
+  size_t print(int v) { char b[16]; snprintf(b, sizeof(b), "%d", v); return print(b); }
+  size_t println() { return print("\r\n"); }
+  size_t println(const char *s) { return print(s) + println(); }
+  size_t println(const __FlashStringHelper *s) { return print(s) + println(); }
+  size_t println(int v) { return print(v) + println(); }
+};
+class Stream : public Print {
+public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual int peek() { return -1; }
+  virtual void flush() {}
+  size_t readBytesUntil(char t, char *b, size_t n) {
+    size_t k = 0;
+    int c;
+    while (k < n && (c = read()) >= 0 && c != t) b[k++] = c;
+    return k;
+  }
+  size_t readBytes(char *b, size_t n) {
+    size_t k = 0;
+    int c;
+    while (k < n && (c = read()) >= 0) b[k++] = c;
+    return k;
+  }
+};
+class Serial_ : public Stream {
+public:
+  void begin(long) {}
+  operator bool() { return true; }
+};
+inline Serial_ Serial;
+
+// SAMD21 registers used by PWR.h
+struct SCB_t { uint32_t SCR; };
+inline SCB_t host_scb;
+inline SCB_t *SCB = &host_scb;
+#define SCB_SCR_SLEEPDEEP_Msk (1u<<2)
+struct _reg8 { volatile uint8_t reg; };
+struct _reg16 { volatile uint16_t reg; struct { uint16_t SYNCBUSY:1; } bit; };
+struct _reg32 { volatile uint32_t reg; };
+struct _rtc0 { _reg16 CTRL; _reg16 READREQ; _reg8 INTENSET; _reg8 INTFLAG; _reg16 STATUS; _reg32 COUNT; _reg32 COMP[1]; };
+struct _rtc { _rtc0 MODE0; };
+struct _pm { _reg8 SLEEP; };
+struct _gclk { _reg16 CLKCTRL; _reg16 STATUS; };
+struct _eic { _reg32 WAKEUP; };
+inline _rtc host_rtc; inline _rtc *RTC = &host_rtc;
+inline _pm host_pm; inline _pm *PM = &host_pm;
+inline _gclk host_gclk; inline _gclk *GCLK = &host_gclk;
+inline _eic host_eic; inline _eic *EIC = &host_eic;
+#define PM_SLEEP_IDLE_CPU 0
+#define RTC_READREQ_RREQ 0x8000
+#define RTC_MODE0_CTRL_ENABLE 2
+#define RTC_MODE0_CTRL_SWRST 1
+#define RTC_MODE0_CTRL_MODE_COUNT32 0
+#define RTC_MODE0_CTRL_PRESCALER_DIV1 0
+#define RTC_MODE0_INTENSET_CMP0 1
+#define RTC_MODE0_INTFLAG_CMP0 1
+#define GCLK_CLKCTRL_CLKEN 0x4000
+#define GCLK_CLKCTRL_GEN_GCLK2 0x200
+#define GCLK_CLKCTRL_ID_EIC 5
+struct PinDescription { uint32_t ulExtInt; };
+inline const PinDescription g_APinDescription[64] = {};
+inline void __WFI() {}
+inline void __DSB() {}
+inline void __disable_irq() {}
+inline void __enable_irq() {}
+
+// Arduino SAMD core, delay.c, one millis() tick
+#define ARDUINO_ARCH_SAMD
+#define ARDUINO_SAMD_VARIANT_COMPLIANCE 10610
+extern "C" inline void SysTick_DefaultHandler(void) { host_millis++; host_micros += 1000; }
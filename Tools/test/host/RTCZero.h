@@ -0,0 +1,11 @@
+#pragma once
+// Host stand-in
+#include "Arduino.h"
+class RTCZero {
+public:
+  enum Alarm_Match { MATCH_OFF=0, MATCH_SS, MATCH_MMSS, MATCH_HHMMSS, MATCH_DHHMMSS, MATCH_MMDDHHMMSS, MATCH_YYMMDDHHMMSS };
+  void begin(bool resetTime=false) { (void)resetTime; }
+  void setEpoch(uint32_t) {} uint32_t getEpoch() { return 0; } void setAlarmEpoch(uint32_t) {} void enableAlarm(int) {}
+  void disableAlarm() {} void attachInterrupt(void (*)()) {} void standbyMode() {} void setAlarmSeconds(uint8_t) {}
+  void setAlarmTime(uint8_t, uint8_t, uint8_t) {} uint8_t getSeconds() { return 0; }
+};
@@ -0,0 +1,23 @@
+#pragma once
+// Host stand-in for the PCF8523, now() is host_unixtime
+#include "Wire.h"
+inline uint32_t host_unixtime = 1704067200;
+class DateTime {
+  uint32_t t;
+  struct tm f() const { time_t x = t; struct tm r; gmtime_r(&x, &r); return r; }
+public:
+  DateTime(uint32_t u=0) : t(u) {}
+  DateTime(int y, int mo, int d, int h, int mi, int s) {
+    struct tm x = {}; x.tm_year = y - 1900; x.tm_mon = mo - 1; x.tm_mday = d; x.tm_hour = h; x.tm_min = mi; x.tm_sec = s;
+    t = (uint32_t) timegm(&x);
+  }
+  int year() const { return f().tm_year + 1900; } int month() const { return f().tm_mon + 1; } int day() const { return f().tm_mday; }
+  int hour() const { return f().tm_hour; } int minute() const { return f().tm_min; } int second() const { return f().tm_sec; }
+  uint32_t unixtime() const { return t; }
+};
+class RTC_PCF8523 {
+public:
+  bool begin() { return true; }
+  DateTime now() { return DateTime(host_unixtime); }
+  void adjust(const DateTime &d) { host_unixtime = d.unixtime(); }
+};
@@ -0,0 +1,343 @@
+#pragma once
+/*
+ * ======================================================================================================================
+ *  SD.h - Host stand-in for the Arduino SD library, files are kept in a directory on the host
+ *
+ *  Modelled on the SdFat code the library wraps: one 512 byte block cache shared by every open file, a file's size
+ *  reaches the card when it is flushed or closed, reads and writes go through the cache one sector at a time. An
+ *  open() reads a directory sector in to the cache.
+ *
+ *  host_sd_reads, host_sd_writes and host_sd_dirwrites count sector reads, data sector writes and directory entry
+ *  writes. host_sd_powerloss() drops the cache and every open handle, each file is left at its last flushed size like
+ *  a card pulled mid write.
+ *
+ *  The FAT is modelled as a map of host_sd_clusters clusters of host_sd_cluster bytes. A file that grows takes the
+ *  next free cluster after its last, as SdFat does, createContiguous() takes the first free run long enough, and
+ *  truncate() and remove() free them. host_sd_fatwrites counts FAT sector writes, one per cluster added to a chain
+ *  and one per 128 entries set or freed at once. host_sd_fragments() is the number of runs a file is in.
+ *
+ *  Files are saved to host_sd_root when closed, at a power loss and at exit, or by host_sd_sync(), so tools can read
+ *  what the sketch left on the card. An empty host_sd_root keeps the card in memory only, for simulations.
+ * ======================================================================================================================
+ */
+#include "Arduino.h"
+#include <map>
+#include <set>
+#include <vector>
+#include <algorithm>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define O_READ   0x01
+#define O_WRITE  0x02
+#define O_RDWR   (O_READ | O_WRITE)
+#define O_APPEND 0x04
+#define O_CREAT  0x10
+#define FILE_READ  O_READ
+#define FILE_WRITE (O_READ | O_WRITE | O_CREAT | O_APPEND)
+
+inline std::string host_sd_root = "build/sd";
+inline long host_sd_reads = 0;
+inline long host_sd_writes = 0;
+inline long host_sd_dirwrites = 0;
+inline bool host_sd_present = true;
+inline uint8_t host_sd_fill = 0xFF;        // Content of a newly allocated contiguous file
+inline long host_sd_fatwrites = 0;
+inline long host_sd_cluster = 32768;       // Bytes per cluster, 64 sectors as a FAT32 card is formatted
+inline long host_sd_clusters = 8192;       // Clusters on the card
+inline std::vector<bool> host_sd_fat;      // Cluster in use
+
+struct HostSDNode {
+  std::string path;
+  std::string card;                        // Bytes on the card
+  uint32_t dirsize = 0;                    // File size in the directory entry
+  bool saved = false;                      // Host copy is up to date
+  std::vector<long> chain;                 // Clusters in file order
+};
+inline std::map<std::string, HostSDNode> host_sd_files;
+inline std::set<std::string> host_sd_dirs;
+inline long host_sd_generation = 0;        // Bumped by host_sd_powerloss(), older handles are dead
+
+struct HostSDCache {
+  HostSDNode *n = nullptr;
+  long blk = -1;
+  bool dirty = false;
+  uint8_t data[512];
+};
+inline HostSDCache host_sd_cache;
+inline HostSDNode host_sd_dir;             // Stands in for the directory sectors an open() searches
+
+inline long host_sd_fat_find(long from) {
+  if ((long) host_sd_fat.size() != host_sd_clusters) host_sd_fat.assign(host_sd_clusters, false);
+  for (long i=0; i<host_sd_clusters; i++) {
+    long c = (from + i) % host_sd_clusters;
+    if (!host_sd_fat[c]) return c;
+  }
+  return -1;
+}
+
+// Add clusters to n's chain until it holds size bytes, the next free after its last. False if the card is full.
+inline bool host_sd_grow(HostSDNode *n, size_t size) {
+  while ((size_t) n->chain.size() * host_sd_cluster < size) {
+    long c = host_sd_fat_find(n->chain.empty() ? 0 : n->chain.back() + 1);
+    if (c < 0) return false;
+    host_sd_fat[c] = true;
+    n->chain.push_back(c);
+    host_sd_fatwrites++;
+  }
+  return true;
+}
+
+// Free n's clusters past the first keep
+inline void host_sd_shrink(HostSDNode *n, size_t keep) {
+  if (n->chain.size() <= keep) return;
+  for (size_t i=keep; i<n->chain.size(); i++) host_sd_fat[n->chain[i]] = false;
+  host_sd_fatwrites += (n->chain.size() - keep + 127) / 128;
+  n->chain.resize(keep);
+}
+
+inline void host_sd_save(HostSDNode *n) {
+  if (n->saved || host_sd_root.empty()) return;
+  n->saved = true;
+  std::string p = host_sd_root + n->path;
+  FILE *f = fopen(p.c_str(), "wb");
+  if (f) {
+    fwrite(n->card.data(), 1, std::min<size_t>(n->dirsize, n->card.size()), f);
+    fclose(f);
+  }
+}
+
+inline void host_sd_cache_flush() {
+  HostSDCache &c = host_sd_cache;
+  if (c.n && c.dirty) {
+    host_power_write();
+    size_t off = (size_t) c.blk * 512;
+    if (c.n->card.size() < off + 512) c.n->card.resize(off + 512, 0);
+    memcpy(&c.n->card[off], c.data, 512);
+    c.n->saved = false;
+    host_sd_writes++;
+    c.dirty = false;
+  }
+}
+
+// Make block blk of n the cached block, read it from the card unless the caller is about to overwrite all of it
+inline void host_sd_cache_get(HostSDNode *n, long blk, bool read) {
+  HostSDCache &c = host_sd_cache;
+  if (c.n == n && c.blk == blk) return;
+  host_sd_cache_flush();
+  c.n = n;
+  c.blk = blk;
+  memset(c.data, 0, 512);
+  size_t off = (size_t) blk * 512;
+  if (off < n->card.size()) memcpy(c.data, &n->card[off], std::min<size_t>(512, n->card.size() - off));
+  if (read) host_sd_reads++;
+}
+
+class File : public Stream {
+  HostSDNode *n = nullptr;
+  long gen = -1;
+  uint32_t pos = 0, fsize = 0;
+  int flags = 0;
+  bool dirdirty = false;
+  bool live() const { return n && gen == host_sd_generation; }
+public:
+  File() {}
+  File(HostSDNode *node, int f) : n(node), gen(host_sd_generation), fsize(node->dirsize), flags(f) {
+    if (flags & O_APPEND) pos = fsize;
+  }
+  operator bool() const { return live(); }
+  uint32_t size() const { return live() ? fsize : 0; }
+  uint32_t position() const { return pos; }
+  bool seek(uint32_t p) {
+    if (!live() || p > fsize) return false;
+    pos = p;
+    return true;
+  }
+  int available() { return live() ? fsize - pos : 0; }
+  int read() {
+    uint8_t b;
+    return (read(&b, 1) == 1) ? b : -1;
+  }
+  int peek() {
+    int c = read();
+    if (c >= 0) pos--;
+    return c;
+  }
+  int read(void *buf, uint16_t cnt) {
+    if (!live() || !(flags & O_READ)) return -1;
+    int k = 0;
+    while (k < cnt && pos < fsize) {
+      host_sd_cache_get(n, pos / 512, true);
+      int m = std::min<uint32_t>({(uint32_t) (512 - pos % 512), (uint32_t) (cnt - k), fsize - pos});
+      memcpy((uint8_t *) buf + k, host_sd_cache.data + pos % 512, m);
+      k += m;
+      pos += m;
+    }
+    return k;
+  }
+  size_t write(uint8_t b) { return write(&b, 1); }
+  size_t write(const char *s) { return write((const uint8_t *) s, strlen(s)); }
+  size_t write(const uint8_t *b, size_t cnt) {
+    if (!live() || !(flags & O_WRITE)) return 0;
+    if (flags & O_APPEND) pos = fsize;
+    size_t done = 0;
+    while (done < cnt) {
+      uint32_t off = pos % 512, k = std::min<uint32_t>(512 - off, cnt - done);
+      if (!host_sd_grow(n, pos + k)) break;
+      if (off == 0 && k == 512) {
+        // Whole sector, SdFat writes it straight to the card
+        host_power_write();
+        if (host_sd_cache.n == n && host_sd_cache.blk == pos / 512) host_sd_cache.dirty = false, host_sd_cache.blk = -1;
+        size_t at = (size_t) pos;
+        if (n->card.size() < at + 512) n->card.resize(at + 512, 0);
+        memcpy(&n->card[at], b + done, 512);
+        n->saved = false;
+        host_sd_writes++;
+      }
+      else {
+        host_sd_cache_get(n, pos / 512, !(off == 0 && pos >= fsize));
+        memcpy(host_sd_cache.data + off, b + done, k);
+        host_sd_cache.dirty = true;
+      }
+      pos += k;
+      done += k;
+      if (pos > fsize) {
+        fsize = pos;
+        dirdirty = true;
+      }
+    }
+    return cnt;
+  }
+  bool truncate(uint32_t len) {
+    if (!live() || len > fsize) return false;
+    flush();
+    fsize = len;
+    n->card.resize(std::max<size_t>(n->card.size(), len));
+    host_sd_shrink(n, (len + host_sd_cluster - 1) / host_sd_cluster);
+    if (pos > len) pos = len;
+    dirdirty = true;
+    flush();
+    return true;
+  }
+  void flush() {
+    if (!live()) return;
+    host_sd_cache_flush();
+    if (dirdirty) {
+      host_power_write();
+      n->dirsize = fsize;
+      n->saved = false;
+      host_sd_dirwrites++;
+      dirdirty = false;
+    }
+  }
+  void close() {
+    flush();
+    if (live()) host_sd_save(n);
+    n = nullptr;
+  }
+  const char *name() const { return live() ? n->path.c_str() : ""; }
+};
+
+class SDClass {
+  static std::string norm(const char *p) { return (p[0] == '/') ? std::string(p) : "/" + std::string(p); }
+  File open_new(const std::string &p, int flags) {
+    host_power_write();
+    HostSDNode &n = host_sd_files[p];
+    n.path = p;
+    host_sd_shrink(&n, 0);
+    n.card.clear();
+    n.dirsize = 0;
+    n.saved = false;
+    host_sd_dirwrites++;
+    host_sd_save(&n);
+    return File(&n, flags);
+  }
+public:
+  bool begin(int cs = 0) {
+    (void) cs;
+    if (!host_sd_present) return false;
+    ::mkdir(host_sd_root.c_str(), 0777);
+    return true;
+  }
+  bool exists(const char *path) {
+    std::string p = norm(path);
+    while (p.size() > 1 && p.back() == '/') p.pop_back();
+    return host_sd_files.count(p) || host_sd_dirs.count(p);
+  }
+  bool mkdir(const char *path) {
+    std::string p = norm(path);
+    host_sd_dirs.insert(p);
+    ::mkdir((host_sd_root + p).c_str(), 0777);
+    return true;
+  }
+  File open(const char *path, int flags = FILE_READ) {
+    std::string p = norm(path);
+    host_sd_cache_get(&host_sd_dir, 0, true);   // Directory search
+    auto it = host_sd_files.find(p);
+    if (it == host_sd_files.end()) return (flags & O_CREAT) ? open_new(p, flags) : File();
+    return File(&it->second, flags);
+  }
+  File open(const String &path, int flags = FILE_READ) { return open(path.c_str(), flags); }
+  File createContiguous(const char *path, uint32_t size) {
+    std::string p = norm(path);
+    long need = (size + host_sd_cluster - 1) / host_sd_cluster, run = 0, c;
+    if (host_sd_files.count(p)) return File();
+    host_sd_fat_find(0);
+    for (c=0; c<host_sd_clusters && run<need; c++) run = host_sd_fat[c] ? 0 : run + 1;
+    if (run < need) return File();           // No free run that long
+    File f = open_new(p, O_READ | O_WRITE);
+    HostSDNode &n = host_sd_files[p];
+    for (long i=c-need; i<c; i++) host_sd_fat[i] = true, n.chain.push_back(i);
+    host_sd_fatwrites += (need + 127) / 128;
+    n.card.assign(size, (char) host_sd_fill);
+    n.dirsize = size;
+    n.saved = false;
+    return File(&n, O_READ | O_WRITE);
+  }
+  bool remove(const char *path) {
+    std::string p = norm(path);
+    if (host_sd_cache.n == &host_sd_files[p]) host_sd_cache.n = nullptr;
+    host_sd_shrink(&host_sd_files[p], 0);
+    host_sd_files.erase(p);
+    ::unlink((host_sd_root + p).c_str());
+    return true;
+  }
+};
+inline SDClass SD;
+
+// Runs of clusters the file at path is in, 0 if it has none
+inline int host_sd_fragments(const std::string &path) {
+  auto it = host_sd_files.find(path);
+  if (it == host_sd_files.end() || it->second.chain.empty()) return 0;
+  int runs = 1;
+  for (size_t i=1; i<it->second.chain.size(); i++) runs += (it->second.chain[i] != it->second.chain[i-1] + 1);
+  return runs;
+}
+
+// Save every file to host_sd_root
+inline void host_sd_sync() {
+  for (auto &f : host_sd_files) host_sd_save(&f.second);
+}
+struct HostSDSyncAtExit { ~HostSDSyncAtExit() { host_sd_sync(); } };
+inline HostSDSyncAtExit host_sd_sync_at_exit;
+
+// Card pulled mid write: dirty cache lost, open handles dead, every file at the size its directory entry says
+inline void host_sd_powerloss() {
+  host_sd_cache.n = nullptr;
+  host_sd_cache.dirty = false;
+  host_sd_generation++;
+  host_sd_sync();
+}
+
+// Forget every file, for a test that starts from a blank card
+inline void host_sd_format() {
+  host_sd_cache.n = nullptr;
+  host_sd_cache.dirty = false;
+  host_sd_generation++;
+  host_sd_files.clear();
+  host_sd_dirs.clear();
+  host_sd_fat.assign(host_sd_clusters, false);
+  std::string cmd = "rm -rf '" + host_sd_root + "'";
+  if (system(cmd.c_str())) {}
+  ::mkdir(host_sd_root.c_str(), 0777);
+}
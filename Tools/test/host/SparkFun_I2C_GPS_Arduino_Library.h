@@ -0,0 +1,4 @@
+#pragma once
+// Host stand-in, the GPS is never found
+#include "Wire.h"
+class I2CGPS { public: bool begin() { return false; } int available() { return 0; } uint8_t read() { return 0; } };
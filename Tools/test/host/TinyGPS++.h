@@ -0,0 +1,9 @@
+#pragma once
+// Host stand-in
+#include "Arduino.h"
+struct TG_D { uint16_t year() { return 0; } uint8_t month() { return 0; } uint8_t day() { return 0; } };
+struct TG_T { uint8_t hour() { return 0; } uint8_t minute() { return 0; } uint8_t second() { return 0; } };
+struct TG_L { double lat() { return 0; } double lng() { return 0; } };
+struct TG_A { double meters() { return 0; } double feet() { return 0; } };
+struct TG_S { uint32_t value() { return 0; } };
+class TinyGPSPlus { public: bool encode(char) { return false; } TG_D date; TG_T time; TG_L location; TG_A altitude; TG_S satellites; };
@@ -0,0 +1,29 @@
+#pragma once
+/*
+ *  Wire.h - Host stand-in for the I2C bus. A test sets host_i2c_present() to say which addresses ACK and
+ *  host_i2c_read() to supply the bytes a requestFrom() returns, reg is the first byte of the last write.
+ */
+#include "Arduino.h"
+
+inline bool (*host_i2c_present)(int addr) = nullptr;
+inline int (*host_i2c_read)(int addr, int reg, uint8_t *buf, int n) = nullptr;
+
+class TwoWire : public Stream {
+  int addr = 0, reg = -1, txlen = 0, rxlen = 0, rxpos = 0;
+  uint8_t rx[64];
+public:
+  void begin() {}
+  void beginTransmission(int a) { addr = a; txlen = 0; }
+  size_t write(uint8_t b) { if (txlen++ == 0) reg = b; return 1; }
+  uint8_t endTransmission(bool stop=true) { (void) stop; return (host_i2c_present && host_i2c_present(addr)) ? 0 : 2; }
+  uint8_t requestFrom(int a, int n, bool stop=true) {
+    (void) stop;
+    if (n > (int) sizeof(rx)) n = sizeof(rx);
+    rxlen = (host_i2c_read) ? host_i2c_read(a, reg, rx, n) : 0;
+    rxpos = 0;
+    return rxlen;
+  }
+  int available() { return rxlen - rxpos; }
+  int read() { return (rxpos < rxlen) ? rx[rxpos++] : -1; }
+};
+inline TwoWire Wire;
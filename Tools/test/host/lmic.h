@@ -0,0 +1,89 @@
+#pragma once
+/*
+ * ======================================================================================================================
+ *  lmic.h - Host stand-in for the MCCI LMIC library, US915
+ *
+ *  LMIC_setTxData2() records the frame in host_lw_frames and marks the radio busy. host_lw_txdone() finishes the
+ *  frame the way the radio would, calling the sketch's onEvent(EV_TXCOMPLETE), with an optional downlink.
+ * ======================================================================================================================
+ */
+#include "Arduino.h"
+#include <vector>
+
+#define CFG_us915 1
+typedef int lmic_tx_error_t;
+enum { LMIC_ERROR_SUCCESS=0, LMIC_ERROR_TX_BUSY=-1, LMIC_ERROR_TX_TOO_LARGE=-2, LMIC_ERROR_TX_NOT_FEASIBLE=-3,
+       LMIC_ERROR_TX_FAILED=-4 };
+typedef uint8_t u1_t; typedef uint16_t u2_t; typedef uint32_t u4_t; typedef int32_t s4_t; typedef u4_t devaddr_t;
+typedef uint8_t dr_t; typedef int32_t ostime_t;
+enum { OP_TXRXPEND = 0x80, OP_TXDATA = 0x40, OP_JOINING = 0x04 };
+enum { TXRX_ACK = 0x80, TXRX_NACK = 0x40, TXRX_PORT = 0x10 };
+typedef enum { EV_SCAN_TIMEOUT=1, EV_BEACON_FOUND, EV_BEACON_MISSED, EV_BEACON_TRACKED, EV_JOINING, EV_JOINED, EV_RFU1,
+  EV_JOIN_FAILED, EV_REJOIN_FAILED, EV_TXCOMPLETE, EV_LOST_TSYNC, EV_RESET, EV_RXCOMPLETE, EV_LINK_DEAD, EV_LINK_ALIVE,
+  EV_SCAN_FOUND, EV_TXSTART, EV_TXCANCELED, EV_RXSTART, EV_JOIN_TXCOMPLETE } ev_t;
+enum { DR_SF10=0, DR_SF9, DR_SF8, DR_SF7, DR_SF8C, DR_NONE, DR_SF12CR=8, DR_SF11CR, DR_SF10CR, DR_SF9CR, DR_SF8CR,
+       DR_SF7CR };
+#define MAX_LEN_PAYLOAD 255
+#define MAX_LEN_FRAME 64
+struct lmic_t { u1_t opmode; u1_t dataLen; u1_t dataBeg; u1_t txrxFlags; u1_t frame[256]; u1_t dn2Dr; dr_t datarate; };
+inline lmic_t LMIC;
+#define LMIC_UNUSED_PIN 0xff
+struct lmic_pinmap { u1_t nss; u1_t rxtx; u1_t rst; u1_t dio[3]; u1_t rxtx_rx_active; int8_t rssi_cal; uint32_t spi_freq; };
+
+struct HostLWFrame { int port; std::vector<uint8_t> bytes; };
+inline std::vector<HostLWFrame> host_lw_frames;   // Every frame handed to LMIC_setTxData2()
+
+void onEvent(ev_t ev);
+
+inline void os_init() {}
+inline void LMIC_reset() { LMIC.opmode = 0; }
+inline void os_runloop_once() {}
+inline lmic_tx_error_t LMIC_setTxData2(u1_t port, u1_t *data, u1_t len, u1_t confirmed) {
+  (void) confirmed;
+  if (LMIC.opmode & OP_TXRXPEND) return LMIC_ERROR_TX_BUSY;
+  host_lw_frames.push_back({port, std::vector<uint8_t>(data, data + len)});
+  LMIC.opmode |= OP_TXRXPEND | OP_TXDATA;
+  return LMIC_ERROR_SUCCESS;
+}
+inline void LMIC_clrTxData() { LMIC.opmode &= ~(OP_TXRXPEND | OP_TXDATA); }
+inline void LMIC_getSessionKeys(u4_t *netid, devaddr_t *addr, u1_t *nwk, u1_t *app) {
+  *netid = 0; *addr = 0; memset(nwk, 0, 16); memset(app, 0, 16);
+}
+inline void LMIC_setLinkCheckMode(int) {}
+inline void LMIC_setSession(u4_t, devaddr_t, u1_t *, u1_t *) {}
+inline void LMIC_setDrTxpow(int dr, int) { LMIC.datarate = dr; }
+inline void LMIC_selectSubBand(int) {}
+inline void LMIC_setupChannel(int, uint32_t, int, int) {}
+inline u1_t LMICus915_maxFrameLen(u1_t dr) {
+  static const u1_t len[] = { 19+5, 61+5, 133+5, 250+5, 250+5 };    // lmic_us915.c maxFrameLens[], DR0-DR4
+  return (dr < 5) ? len[dr] : 0;
+}
+#define LMICbandplan_maxFrameLen(dr) LMICus915_maxFrameLen(dr)
+inline ostime_t os_getTime() { return (ostime_t) (micros() / 16); }
+inline bool os_queryTimeCriticalJobs(ostime_t) { return false; }
+inline int LMIC_queryTxReady() { return !(LMIC.opmode & OP_TXRXPEND); }
+#define ms2osticks(ms) ((ostime_t)(ms)*62)
+#define osticks2ms(os) ((int32_t)(os)/62)
+#define sec2osticks(s) ((ostime_t)(s)*62500)
+#define DR_RANGE_MAP(a,b) 0
+#define BAND_CENTI 0
+#define BAND_MILLI 1
+
+// Finish the frame in flight, ok false cancels it like EV_TXCANCELED, dn is an optional downlink on port dnport
+inline void host_lw_txdone(bool ok, const uint8_t *dn = nullptr, int dnlen = 0, int dnport = 0) {
+  LMIC.opmode &= ~(OP_TXRXPEND | OP_TXDATA);
+  LMIC.txrxFlags = 0;
+  LMIC.dataLen = 0;
+  if (!ok) {
+    onEvent(EV_TXCANCELED);
+    return;
+  }
+  if (dn && dnlen) {
+    LMIC.txrxFlags |= TXRX_PORT;
+    LMIC.dataBeg = 1;
+    LMIC.frame[0] = dnport;
+    memcpy(LMIC.frame + 1, dn, dnlen);
+    LMIC.dataLen = dnlen;
+  }
+  onEvent(EV_TXCOMPLETE);
+}
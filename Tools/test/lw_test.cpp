@@ -0,0 +1,103 @@
+/*
+ * ======================================================================================================================
+ *  lw_test.cpp - LoRaWAN transmit queue, see LW.h. Entries, the one long payload and its fragments.
+ * ======================================================================================================================
+ */
+#include "test.h"
+
+int done_ok, done_failed;
+
+void Done(int tag, bool ok, int port, char *payload, int len) {
+  (ok) ? done_ok++ : done_failed++;
+}
+
+// Service the queue until it is empty, acknowledging every frame
+void Drain() {
+  for (int guard=0; lw_txq_count && guard<1000; guard++) {
+    delay(1000);
+    LW_TXQ_Service();
+    if (LMIC.opmode & OP_TXRXPEND) {
+      host_lw_txdone(true);
+    }
+  }
+  CHECK_EQ(lw_txq_count, 0);
+}
+
+int main() {
+  char text[600], small[LW_TXQ_PAYLOAD];
+
+  LW_valid = true;
+  LMIC.datarate = 3;                                   // 242 bytes
+  for (int i=0; i<(int)sizeof(text); i++) {
+    text[i] = 'a' + (i % 26);
+  }
+  memset(small, 0x5A, sizeof(small));
+
+  // Short payloads are held in the entries, one long one in lw_txq_long
+  CHECK(LW_TXQ_Add(small, 40, LW_PORT_BINARY, Done, 0));
+  CHECK(LW_TXQ_Add(text, sizeof(text), LW_PORT_TEXT, Done, 1));
+  CHECK(lw_txq_long_inuse);
+  CHECK(!LW_TXQ_Add(text, sizeof(text), LW_PORT_TEXT, Done, 2));
+  CHECK(LW_TXQ_Add(small, LW_TXQ_PAYLOAD, LW_PORT_BINARY, Done, 3));
+  CHECK(!LW_TXQ_Add(small, 1, LW_PORT_BINARY, Done, 4));           // Full
+  CHECK(!LW_TXQ_Add(text, MAX_OBS_SIZE + 1, LW_PORT_TEXT, Done, 5));
+  std::string want(text, sizeof(text));
+  memset(text, 0, sizeof(text));                                 // The queue has its own copy
+
+  host_lw_frames.clear();
+  Drain();
+  CHECK_EQ(done_ok, 3);
+  CHECK(!lw_txq_long_inuse);
+
+  // 40 bytes, then 600 bytes in 3 fragments of 238, then 255 bytes in 2 fragments
+  CHECK_EQ(host_lw_frames.size(), 6);
+  CHECK_EQ(host_lw_frames[0].port, LW_PORT_BINARY);
+  CHECK_EQ(host_lw_frames[0].bytes.size(), 40);
+  std::string got;
+  for (int f=1; f<=3; f++) {
+    CHECK_EQ(host_lw_frames[f].port, LW_PORT_FRAGMENT);
+    CHECK_EQ(host_lw_frames[f].bytes[1], LW_PORT_TEXT);
+    CHECK_EQ(host_lw_frames[f].bytes[2], f - 1);
+    CHECK_EQ(host_lw_frames[f].bytes[3], 3);
+    got.append(host_lw_frames[f].bytes.begin() + LW_FRAG_HEADER_SIZE, host_lw_frames[f].bytes.end());
+  }
+  CHECK(got == want);
+
+  // A failed long entry gives the buffer back too
+  CHECK(LW_TXQ_Add(text, sizeof(text), LW_PORT_TEXT, Done, 6));
+  LW_TXQ_Service();
+  host_lw_txdone(false);
+  LW_TXQ_Service();
+  CHECK_EQ(done_failed, 1);
+  CHECK(!lw_txq_long_inuse);
+  CHECK(LW_TXQ_Add(text, sizeof(text), LW_PORT_TEXT, Done, 7));
+  Drain();
+
+  // A slow frame clock, DR1 and the duty cycle holding each fragment for 4 minutes. Each fragment has its own
+  // LW_TXQ_TIMEOUT, so 7 fragments taking 28 minutes still get through.
+  LMIC.datarate = 1;                                   // 53 bytes, 49 a fragment
+  done_ok = done_failed = 0;
+  host_lw_frames.clear();
+  CHECK(LW_TXQ_Add(text, 300, LW_PORT_TEXT, Done, 8));
+  for (int guard=0; lw_txq_count && guard<10000; guard++) {
+    delay(1000);
+    LW_TXQ_Service();
+    if ((LMIC.opmode & OP_TXRXPEND) && (guard % 240 == 239)) {
+      host_lw_txdone(true);
+    }
+  }
+  CHECK_EQ(done_ok, 1);
+  CHECK_EQ(done_failed, 0);
+  CHECK_EQ(host_lw_frames.size(), 7);
+
+  // One frame that never completes still times out
+  CHECK(LW_TXQ_Add(small, 40, LW_PORT_BINARY, Done, 9));
+  for (int s=0; lw_txq_count && s<(LW_TXQ_TIMEOUT / 1000) + 5; s++) {
+    delay(1000);
+    LW_TXQ_Service();
+  }
+  CHECK_EQ(done_failed, 1);
+  CHECK_EQ(lw_txq_count, 0);
+
+  return (test_done("lw_test"));
+}
@@ -0,0 +1,127 @@
+/*
+ * ======================================================================================================================
+ *  n2s_bench.cpp - Reading a one day N2S backlog, 1440 observations, through the host SD stand-in
+ *
+ *    text per byte  The original N2SOBS.TXT, URL text lines rebuilt with one fp.read() per character
+ *    ring per rec   The binary ring with a seek and a 256 byte fp.read() per record, file opened per record
+ *    ring blocks    SD_N2S_Peek() / SD_N2S_Pop() as the sketch does now, one 512 byte read per two records
+ *
+ *  Host bytes/second shows the call overhead, sector reads and read() calls are what cost time on the SAMD21.
+ * ======================================================================================================================
+ */
+#include "test.h"
+#include <chrono>
+
+const int N = SD_N2S_RECORDS;
+const int PAYLOAD = 57;       // PL_Encode() of a 19 sensor station, see PL.h
+const int TEXT = 300;         // URL text observation of the same station
+
+struct Result {
+  long bytes, reads, calls, records;
+  double seconds;
+};
+
+double Now() {
+  return (std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Report(const char *name, Result r) {
+  printf("%-16s %5ld records %8ld bytes %6ld sector reads %7ld read calls %8.1f MB/s\n", name, r.records, r.bytes,
+         r.reads, r.calls, r.bytes / r.seconds / 1e6);
+}
+
+Result TextPerByte() {
+  char line[MAX_OBS_SIZE];
+  Result r = {};
+  File fp = SD.open("/N2SOBS.TXT", FILE_READ);
+  int n = 0;
+  int c;
+
+  while (fp.available()) {
+    c = fp.read();
+    r.calls++;
+    r.bytes++;
+    if (c == '\n') {
+      line[n] = 0;
+      n = 0;
+      r.records++;
+    }
+    else if (n < MAX_OBS_SIZE - 1) {
+      line[n++] = c;
+    }
+  }
+  fp.close();
+  return (r);
+}
+
+Result RingPerRecord() {
+  uint8_t rec[SD_N2S_RECSZ];
+  Result r = {};
+
+  for (unsigned long seq=eeprom.n2s_tail; seq!=eeprom.n2s_head; seq++) {
+    File fp = SD.open(SD_n2s_file, FILE_READ);
+    fp.seek((seq % SD_N2S_RECORDS) * SD_N2S_RECSZ);
+    r.bytes += fp.read(rec, SD_N2S_RECSZ);
+    r.calls++;
+    r.records += ((rec[4] | (rec[5] << 8)) == PAYLOAD);
+    fp.close();
+  }
+  return (r);
+}
+
+Result RingBlocks() {
+  uint8_t buf[SD_N2S_MAXPL];
+  Result r = {};
+  unsigned long head = eeprom.n2s_head, tail = eeprom.n2s_tail;
+  int len;
+
+  while ((len = SD_N2S_Peek(buf, false)) > 0) {
+    r.records++;
+    r.bytes += SD_N2S_RECSZ;
+    eeprom.n2s_tail++;                 // SD_N2S_Pop() without the EEPROM write
+  }
+  SD_N2S_ReadClose();
+  eeprom.n2s_head = head;
+  eeprom.n2s_tail = tail;
+  r.calls = r.bytes / SD_BLOCKSZ;
+  return (r);
+}
+
+Result Run(Result (*fn)(), int repeat) {
+  Result r = {};
+  long reads = host_sd_reads;
+  double t = Now();
+
+  for (int i=0; i<repeat; i++) {
+    r = fn();
+  }
+  r.seconds = (Now() - t) / repeat;
+  r.reads = (host_sd_reads - reads) / repeat;
+  return (r);
+}
+
+int main() {
+  uint8_t payload[PAYLOAD];
+  char line[TEXT + 1];
+
+  test_sd("n2s_bench");
+  SD_initialize();
+  EEPROM_initialize();
+  SD_N2S_Initialize();
+
+  File fp = SD.open("/N2SOBS.TXT", FILE_WRITE);
+  for (int i=0; i<N; i++) {
+    memset(payload, i, sizeof(payload));
+    SD_NeedToSend_Add(payload, sizeof(payload));
+    memset(line, 'a' + (i % 26), TEXT - 1);
+    line[TEXT - 1] = '\n';
+    fp.write((uint8_t *) line, TEXT);
+  }
+  fp.close();
+
+  printf("n2s_bench: one day backlog, %d observations\n", N);
+  Report("text per byte", Run(TextPerByte, 5));
+  Report("ring per rec", Run(RingPerRecord, 20));
+  Report("ring blocks", Run(RingBlocks, 20));
+  return (0);
+}
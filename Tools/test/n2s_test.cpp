@@ -0,0 +1,198 @@
+/*
+ * ======================================================================================================================
+ *  n2s_test.cpp - Need To Send ring file, see SDC.h. Wraparound, both ends, SD_N2S_Remove() and power loss at every
+ *                 SD and EEPROM write of an add and send workload, with and without the EEPROM pointers surviving.
+ * ======================================================================================================================
+ */
+#include "test.h"
+#include <set>
+
+const unsigned long N = SD_N2S_RECORDS;
+
+// Payload for sequence number seq, length varies so records of every size are seen
+int Payload(unsigned long seq, uint8_t *b) {
+  int len = 1 + (seq % SD_N2S_MAXPL);
+  for (int i=0; i<len; i++) {
+    b[i] = (uint8_t) (seq * 7 + i);
+  }
+  return (len);
+}
+
+bool PayloadOk(unsigned long seq, uint8_t *b, int len) {
+  uint8_t want[SD_N2S_MAXPL];
+  return ((len == Payload(seq, want)) && (memcmp(b, want, len) == 0));
+}
+
+// Power on: RAM is lost, the EEPROM and card are what was last written
+void Reboot(bool lose_eeprom) {
+  host_power_ops = -1;
+  host_sd_powerloss();
+  SD_n2s_blocknum = -1;
+  SD_n2s_valid = false;
+  SystemStatusBits = 0;
+  eeprom_valid = false;
+  SD_exists = false;
+  if (lose_eeprom) {
+    host_eeprom[0] ^= 0xFF;   // Checksum no longer matches
+  }
+  SD_initialize();
+  EEPROM_initialize();
+  SD_N2S_Initialize();
+}
+
+// Blank card and EEPROM, the ring starting at sequence number seq
+void Blank(unsigned long seq=0) {
+  test_sd("n2s");
+  memset(host_eeprom, 0, sizeof(host_eeprom));
+  Reboot(false);
+  eeprom.n2s_head = seq;
+  eeprom.n2s_tail = seq;
+  EEPROM_Update();
+}
+
+void Add(unsigned long seq) {
+  uint8_t b[SD_N2S_MAXPL];
+  SD_NeedToSend_Add(b, Payload(seq, b));
+}
+
+void Wraparound() {
+  uint8_t b[SD_N2S_MAXPL];
+  unsigned long total = N * 3 + N / 2;
+  long reads;
+
+  Blank();
+  CHECK(SD_n2s_valid);
+  CHECK_EQ(host_sd_files["/N2SOBS.BIN"].dirsize, N * SD_N2S_RECSZ);
+  for (unsigned long seq=0; seq<total; seq++) {
+    Add(seq);
+    CHECK_EQ(SD_N2S_Count(), (seq + 1 < N) ? seq + 1 : N);
+  }
+  CHECK_EQ(eeprom.n2s_head, total);
+  CHECK_EQ(eeprom.n2s_tail, total - N);
+
+  // Oldest first, each sector read once for the two records in it, plus the directory when the file is opened
+  reads = host_sd_reads;
+  for (unsigned long seq=total-N; seq<total; seq++) {
+    int len = SD_N2S_Peek(b, false);
+    CHECK(PayloadOk(seq, b, len));
+    SD_N2S_Pop(false, 1);
+  }
+  SD_N2S_ReadClose();
+  CHECK_EQ(host_sd_reads - reads, N * SD_N2S_RECSZ / SD_BLOCKSZ + 1);
+  CHECK_EQ(SD_N2S_Count(), 0);
+  CHECK(!(SystemStatusBits & SSB_N2S));
+
+  // A reboot keeps the pointers
+  Add(total);
+  Reboot(false);
+  CHECK_EQ(SD_N2S_Count(), 1);
+  CHECK(PayloadOk(total, b, SD_N2S_Peek(b, false)));
+  SD_N2S_ReadClose();
+}
+
+void Ends() {
+  uint8_t b[SD_N2S_MAXPL];
+
+  Blank();
+  for (unsigned long seq=0; seq<10; seq++) {
+    Add(seq);
+  }
+  CHECK(PayloadOk(9, b, SD_N2S_Peek(b, true)));
+  SD_N2S_Pop(true, 1);
+  Add(100);                                    // Takes sequence 9 again
+  CHECK_EQ(eeprom.n2s_head, 10);
+  CHECK(PayloadOk(100, b, SD_N2S_Peek(b, true)));
+  CHECK(PayloadOk(0, b, SD_N2S_Peek(b, false)));
+  CHECK(PayloadOk(3, b, SD_N2S_Read(3, b)));
+  CHECK_EQ(SD_N2S_Read(12, b), 0);             // Not written
+
+  SD_N2S_Remove(0, 4);                         // At the tail
+  CHECK_EQ(eeprom.n2s_tail, 4);
+  SD_N2S_Remove(8, 2);                         // At the head
+  CHECK_EQ(eeprom.n2s_head, 8);
+  SD_N2S_Remove(5, 1);                         // Middle, kept and sent again
+  CHECK_EQ(SD_N2S_Count(), 4);
+  SD_N2S_Remove(2, 10);                        // Overlaps the tail and runs past the head
+  CHECK_EQ(SD_N2S_Count(), 0);
+  SD_N2S_ReadClose();
+}
+
+// Add and send records with the power cut at write k of the workload. Return true if the workload finished first.
+bool PowerLoss(long k, bool lose_eeprom, unsigned long start) {
+  uint8_t b[SD_N2S_MAXPL];
+  std::set<unsigned long> added, sent;  // Finished adds and sends
+  unsigned long next = start;           // One past the newest add, or the add the power was cut in
+  bool finished = true;
+
+  Blank(start);
+  for (; next<start+N-3; next++) {        // Nearly full, the workload wraps the ring
+    Add(next);
+  }
+  host_power_ops = k;
+  try {
+    for (int step=0; step<6; step++) {
+      unsigned long seq = eeprom.n2s_head;  // Sending the newest gives its number back
+      next = seq;
+      Add(seq);
+      added.insert(seq);
+      sent.erase(seq);
+      next = seq + 1;
+      if (SD_N2S_Peek(b, (step % 3) == 2)) {
+        seq = ((step % 3) == 2) ? eeprom.n2s_head - 1 : eeprom.n2s_tail;
+        SD_N2S_Pop((step % 3) == 2, 1);
+        sent.insert(seq);
+      }
+    }
+  }
+  catch (HostPowerLoss &) {
+    finished = false;
+  }
+  Reboot(lose_eeprom);
+
+  // Whatever is left reads back in order with the right payload, nothing finished is lost, nothing sent comes back
+  // unless the pointers were lost, overwritten records are the only gap
+  CHECK(SD_n2s_valid);
+  CHECK(SD_N2S_Count() <= N);
+  std::set<unsigned long> left;
+  while (SD_N2S_Count()) {
+    unsigned long seq = eeprom.n2s_tail;
+    int len = SD_N2S_Peek(b, false);
+    if (!len) {
+      break;
+    }
+    seq = eeprom.n2s_tail;
+    CHECK(PayloadOk(seq, b, len));
+    CHECK(left.empty() || (seq > *left.rbegin()));
+    CHECK(seq <= next);
+    left.insert(seq);
+    SD_N2S_Pop(false, 1);
+  }
+  SD_N2S_ReadClose();
+  for (unsigned long seq : added) {
+    if (!sent.count(seq) && (seq + N > next)) {
+      CHECK(left.count(seq));
+    }
+  }
+  if (!lose_eeprom) {
+    for (unsigned long seq : sent) {
+      CHECK(!left.count(seq));
+    }
+  }
+  return (finished);
+}
+
+int main() {
+  Wraparound();
+  Ends();
+
+  long cuts = 0;
+  for (int lose=0; lose<2; lose++) {
+    for (unsigned long start : {0UL, 3 * N + 5}) {
+      for (long k=0; !PowerLoss(k, lose, start); k++) {
+        cuts++;
+      }
+    }
+  }
+  printf("n2s_test: %ld power cuts\n", cuts);
+  return (test_done("n2s_test"));
+}
@@ -0,0 +1,155 @@
+/*
+ * ======================================================================================================================
+ *  obs_render_test.cpp - OBS_Render() of each observation in golden/obs_render.txt must be byte for byte what the
+ *                        sprintf() OBS_LOG_Add() and OBS_Build() made of it, see golden/obs_golden.cpp. Then
+ *                        OBS_TxDone() saving a failed text or binary uplink to the N2S file from the queue's copy.
+ * ======================================================================================================================
+ */
+#include "test.h"
+
+float Float(const char *hex) {
+  uint32_t u = strtoul(hex, NULL, 16);
+  float f;
+
+  memcpy(&f, &u, 4);
+  return (f);
+}
+
+// Set obs from an "obs" line of the golden file
+void Obs(char *line) {
+  char *tok = strtok(line + 4, " \n");
+  int sidx = 0;
+
+  OBS_Clear();
+  obs.inuse = true;
+  obs.ts = strtol(tok, NULL, 10);
+  obs.bv = Float(strtok(NULL, " \n"));
+  obs.hth = strtoul(strtok(NULL, " \n"), NULL, 10);
+  while ((tok = strtok(NULL, " \n"))) {
+    int id, type;
+    char value[16];
+    SENSOR *sensor;
+
+    sscanf(tok, "%d:%d:%15s", &id, &type, value);
+    sensor = OBS_Add(&sidx, id, type);
+    if (type == F_OBS) {
+      sensor->f_obs = Float(value);
+    }
+    else if (type == I_OBS) {
+      sensor->i_obs = strtol(value, NULL, 10);
+    }
+    else {
+      sensor->u_obs = strtoul(value, NULL, 10);
+    }
+  }
+}
+
+// The golden line less its prefix and newline
+std::string Want(const char *line, const char *prefix) {
+  std::string s = line;
+
+  CHECK_STR(s.substr(0, strlen(prefix)), prefix);
+  s = s.substr(strlen(prefix));
+  if (!s.empty() && (s.back() == '\n')) {
+    s.pop_back();
+  }
+  return (s);
+}
+
+void Golden() {
+  FILE *fp = fopen("golden/obs_render.txt", "r");
+  char line[2048], json[2048], url[2048];
+  int n = 0;
+
+  CHECK(fp != NULL);
+  if (!fp) {
+    return;
+  }
+  while (fgets(line, sizeof(line), fp)) {
+    if (line[0] == '#') {
+      continue;
+    }
+    CHECK(fgets(json, sizeof(json), fp) != NULL);
+    CHECK(fgets(url, sizeof(url), fp) != NULL);
+    Obs(line);
+    CHECK_EQ(OBS_Render(true), Want(json, "json ").size());
+    CHECK_STR(obsbuf, Want(json, "json "));
+    CHECK_EQ(OBS_Render(false), Want(url, "url ").size());
+    CHECK_STR(obsbuf, Want(url, "url "));
+    n++;
+  }
+  fclose(fp);
+  CHECK(n >= 50);
+}
+
+// A station's observation, every value on a 0.1 step so the text loses nothing
+void Station() {
+  int sidx = 0;
+
+  OBS_Clear();
+  obs.inuse = true;
+  obs.ts = 1760000000;
+  obs.bv = 4.12;
+  obs.hth = 0x0100;
+  OBS_AddF(&sidx, SID_BP1, 1013.2);
+  OBS_AddF(&sidx, SID_BT1, -12.5);
+  OBS_AddF(&sidx, SID_BH1, 55.0);
+  OBS_AddI(&sidx, SID_WD, 271);
+  OBS_AddF(&sidx, SID_WS, 3.4);
+  OBS_AddF(&sidx, SID_MT1, -0.1);
+}
+
+// The newest N2S record, with its length
+std::vector<uint8_t> Newest() {
+  uint8_t b[SD_N2S_MAXPL];
+  int len = SD_N2S_Peek(b, true);
+
+  SD_N2S_ReadClose();
+  return (std::vector<uint8_t>(b, b + len));
+}
+
+void TxFailed() {
+  char payload[MAX_OBS_SIZE];
+  uint8_t want[SD_N2S_MAXPL];
+  int len, want_len;
+
+  test_sd("obs_render");
+  SD_initialize();
+  SD_N2S_Initialize();
+  eeprom.n2s_head = eeprom.n2s_tail = 0;
+
+  // A text uplink that failed is parsed back and saved as the binary record the N2S file holds
+  Station();
+  want_len = PL_Encode(want, SD_N2S_MAXPL);
+  PL_AddStatusBits(want, SSB_FROM_N2S);
+  len = OBS_Render(false);
+  memcpy(payload, obsbuf, len);
+  OBS_Clear();
+  OBS_TxDone(1760000000, false, LW_PORT_TEXT, payload, len);
+  CHECK_EQ(SD_N2S_Count(), 1);
+  CHECK(Newest() == std::vector<uint8_t>(want, want + want_len));
+
+  // A binary uplink is saved as it was sent, with the From N2S bit
+  Station();
+  obs.ts += 60;
+  OBS_Encode();
+  memcpy(payload, obs_rec.bin, obs_rec.bin_len);
+  want_len = obs_rec.bin_len;
+  memcpy(want, obs_rec.bin, want_len);
+  PL_AddStatusBits(want, SSB_FROM_N2S);
+  OBS_TxDone((int) obs.ts, false, LW_PORT_BINARY, payload, want_len);
+  CHECK_EQ(SD_N2S_Count(), 2);
+  CHECK(Newest() == std::vector<uint8_t>(want, want + want_len));
+
+  // Text that does not parse is dropped, a sent observation is not saved
+  strcpy(payload, "at=2025-10-09T08%3A53%3A20&bv=4.12&bp1=");
+  OBS_TxDone(1760000000, false, LW_PORT_TEXT, payload, strlen(payload));
+  OBS_TxDone(1760000000, true, LW_PORT_TEXT, payload, strlen(payload));
+  CHECK_EQ(SD_N2S_Count(), 2);
+}
+
+int main() {
+  Golden();
+  TxFailed();
+  return (test_done("obs_render_test"));
+}
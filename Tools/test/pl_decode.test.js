@@ -0,0 +1,35 @@
+/*
+ * ======================================================================================================================
+ *  pl_decode.test.js - Tools/TTN_Decoder.js port 2 against build/pl_fixture.json from pl_test.cpp
+ * ======================================================================================================================
+ */
+var test = require("node:test");
+var assert = require("node:assert");
+var fs = require("fs");
+var path = require("path");
+var decoder = require("../TTN_Decoder.js");
+
+var fixture = JSON.parse(fs.readFileSync(path.join(__dirname, "build", "pl_fixture.json")));
+
+fixture.forEach(function (f) {
+  test("schema version " + f.version, function () {
+    var r = decoder.decodeUplink({ fPort: 2, bytes: Array.from(Buffer.from(f.hex, "hex")) });
+
+    assert.deepStrictEqual(r.errors, []);
+    assert.deepStrictEqual(Object.keys(r.data).sort(), Object.keys(f.expect).sort());
+    Object.keys(f.expect).forEach(function (k) {
+      if (typeof f.expect[k] === "number") {
+        assert.ok(Math.abs(r.data[k] - f.expect[k]) <= Math.abs(f.expect[k]) * 1e-9 + 1e-9,
+                  k + " " + r.data[k] + " != " + f.expect[k]);
+      }
+      else {
+        assert.strictEqual(r.data[k], f.expect[k]);
+      }
+    });
+  });
+});
+
+test("unknown version and short payload", function () {
+  assert.deepStrictEqual(decoder.decodeUplink({ fPort: 2, bytes: [6, 0, 0] }).errors, ["unknown schema version 6"]);
+  assert.deepStrictEqual(decoder.decodeUplink({ fPort: 2, bytes: [5, 0, 0] }).errors, ["payload too short"]);
+});
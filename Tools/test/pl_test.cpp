@@ -0,0 +1,145 @@
+/*
+ * ======================================================================================================================
+ *  pl_test.cpp - PL_Encode() / PL_Decode() round trip for every schema version, see PL.h
+ *
+ *  Writes build/pl_fixture.json, a payload per schema version with the values a decoder must return.
+ *  pl_decode.test.js checks Tools/TTN_Decoder.js against it. Versions before PL_SCHEMA_VERSION are made the way
+ *  the older firmware sent them: only the sensors that version had, version byte and bitmap size to match.
+ * ======================================================================================================================
+ */
+#include "test.h"
+
+struct Value {
+  int id;
+  double in;        // Observation as taken, NAN for a failed read
+  double want;      // What a decode must give back, clamped or rounded
+};
+
+// Clamping, NaN, rounding both ways, 4 byte fields, integer types and the last sensor of each version
+const Value values[] = {
+  {SID_RG1,     0.26,          0.3},
+  {SID_WD,      359,           359},
+  {SID_BP1,     NAN,           -3276.8},        // NaN is sent as the field minimum
+  {SID_BT1,     5000.0,        3276.7},         // Clamped to the field maximum
+  {SID_BH1,     -5000.0,       -3276.8},        // and minimum
+  {SID_ST1,     -12.34,        -12.3},
+  {SID_SH1,     -12.36,        -12.4},
+  {SID_SI1,     1.0e9,         214748364.7},    // 4 byte field clamped
+  {SID_LX,      65432.1,       65432.1},
+  {SID_PM1S10,  12,            12},
+  {SID_WBGT,    31.25,         31.3},           // Last of version 1
+  {SID_SLP,     97.5,          97.5},           // Last of version 2
+  {SID_WPT,     3540,          3540},           // Last of version 3
+  {SID_RL2,     -1,            -1},             // Last of version 4
+  {SID_DSQ,     100,           100},            // Last of version 5
+};
+const int nvalues = sizeof(values) / sizeof(values[0]);
+const uint32_t ts = 1792065600;   // 2026-10-15T12:00:00Z
+
+void Fill(int count) {
+  int sidx = 0;
+
+  OBS_Clear();
+  obs.inuse = true;
+  obs.ts = ts;
+  obs.bv = 4.12;
+  obs.hth = 0x20041;
+  for (int i=0; i<nvalues; i++) {
+    if (values[i].id < count) {
+      if (obs_names[values[i].id].type == F_OBS) {
+        OBS_AddF(&sidx, values[i].id, values[i].in);
+      }
+      else {
+        OBS_AddI(&sidx, values[i].id, (int) values[i].in);
+      }
+    }
+  }
+}
+
+// Payload as a version with count sensors sent it, from a current PL_Encode() of only those sensors
+int EncodeVersion(int version, uint8_t *buf) {
+  int count = PL_SensorCount(version);
+  int len;
+
+  Fill(count);
+  len = PL_Encode(buf, 255);
+  if (version != PL_SCHEMA_VERSION) {
+    int drop = PL_BITMAP_SIZE - ((count + 7) / 8);
+    buf[0] = version;
+    memmove(buf + PL_HEADER_SIZE + (count + 7) / 8, buf + PL_HEADER_SIZE + PL_BITMAP_SIZE,
+            len - PL_HEADER_SIZE - PL_BITMAP_SIZE);
+    len -= drop;
+  }
+  return (len);
+}
+
+int main() {
+  FILE *fp = fopen("build/pl_fixture.json", "w");
+  uint8_t buf[256];
+
+  fprintf(fp, "[\n");
+  for (int version=1; version<=PL_SCHEMA_VERSION; version++) {
+    int count = PL_SensorCount(version);
+    int len = EncodeVersion(version, buf);
+
+    CHECK(len > 0);
+    CHECK(PL_Decode(buf, len));
+    CHECK_EQ(obs.ts, ts);
+    CHECK_NEAR(obs.bv, 4.12, 0.001);
+    CHECK_EQ(obs.hth, 0x20041);
+    for (int i=0; i<nvalues; i++) {
+      const Value &v = values[i];
+      bool found = false;
+      for (int s=0; s<MAX_SENSORS; s++) {
+        if (OBS_Present(s) && (obs.sensor[s].id == v.id)) {
+          double got = (obs.sensor[s].type == F_OBS) ? obs.sensor[s].f_obs : obs.sensor[s].i_obs;
+          CHECK_NEAR(got, v.want, fabs(v.want) * 1e-6 + 1e-4);
+          found = true;
+        }
+      }
+      CHECK_EQ(found, v.id < count);
+    }
+
+    fprintf(fp, "  {\"version\": %d, \"hex\": \"%s\", \"expect\": {\"at\": \"2026-10-15T12:00:00\", \"bv\": 4.12, "
+                "\"hth\": %d", version, test_hex(buf, len).c_str(), 0x20041);
+    for (int i=0; i<nvalues; i++) {
+      if (values[i].id < count) {
+        fprintf(fp, ", \"%s\": %.1f", obs_names[values[i].id].name, values[i].want);
+      }
+    }
+    fprintf(fp, "}}%s\n", (version < PL_SCHEMA_VERSION) ? "," : "");
+  }
+  fprintf(fp, "]\n");
+  fclose(fp);
+
+  // Anything not this version's layout is refused
+  buf[0] = 0;
+  CHECK(!PL_Decode(buf, 40));
+  buf[0] = PL_SCHEMA_VERSION + 1;
+  CHECK(!PL_Decode(buf, 40));
+  EncodeVersion(PL_SCHEMA_VERSION, buf);
+  CHECK(!PL_Decode(buf, PL_HEADER_SIZE + PL_BITMAP_SIZE + 3));   // Truncated in the values
+
+  // Frame sizes quoted in PL.h
+  int sizes[] = { SID_RG1, SID_RGT1, SID_RGP1, SID_WS, SID_WD, SID_WG, SID_WGD, SID_BP1, SID_BT1, SID_BH1, SID_ST1,
+                  SID_SH1, SID_MT1, SID_HI, SID_WBT, SID_WBGT, SID_SLP, SID_WS2, SID_WD2 };
+  int sidx = 0;
+  OBS_Clear();
+  obs.inuse = true;
+  for (int i=0; i<19; i++) {
+    OBS_AddF(&sidx, sizes[i], 1.0);
+  }
+  CHECK_EQ(PL_Encode(buf, 255), PL_HEADER_SIZE + PL_BITMAP_SIZE + 19 * 2);
+  for (int id=SID_RG1; sidx<30; id++) {
+    bool have = false;
+    for (int s=0; s<sidx; s++) {
+      have |= (obs.sensor[s].id == id);
+    }
+    if (!have && (pl_sensors[id].bytes == 2)) {
+      OBS_AddF(&sidx, id, 1.0);
+    }
+  }
+  CHECK_EQ(PL_Encode(buf, 255), PL_HEADER_SIZE + PL_BITMAP_SIZE + 30 * 2);
+
+  return (test_done("pl_test"));
+}
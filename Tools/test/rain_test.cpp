@@ -0,0 +1,140 @@
+/*
+ * ======================================================================================================================
+ *  rain_test.cpp - Rain gauge tips, see WRDB.h. raingauge1_interrupt_handler() is driven with millis() set to each
+ *                  edge, bounces included, and the "RG" task and observations run the way the scheduler runs them.
+ * ======================================================================================================================
+ */
+#include "test.h"
+
+RAIN_TIPS_STR *rt = &raingauge1_tips;
+unsigned long processed = 0;            // millis() the "RG" task last ran
+
+// Magnet edge at ms, the handler debounces it
+void Edge(unsigned long ms) {
+  host_millis = ms;
+  raingauge1_interrupt_handler();
+}
+
+// Run the "RG" task every second up to ms
+void RunTo(unsigned long ms) {
+  while (processed + 1000 <= ms) {
+    processed += 1000;
+    host_millis = processed;
+    Rain_TakeReading();
+  }
+  host_millis = ms;
+}
+
+// Observation at ms as OBS_Take() does it, return the rain in mm and how many rain values OBS_RainExtended() added
+float Observe(unsigned long ms, int *added) {
+  float rg1;
+  int sidx = 0;
+
+  RunTo(ms);
+  rg1 = raingauge1_interrupt_count * 0.2;
+  raingauge1_interrupt_count = 0;
+  raingauge1_interrupt_stime = millis();
+  Rain_IntervalUpdate(rt);
+  OBS_Clear();
+  OBS_RainExtended(&sidx, rt, SID_RR1);
+  *added = sidx;
+  return (rg1);
+}
+
+void Reset() {
+  host_millis = 100000;
+  processed = host_millis;
+  raingauge1_interrupt_count = 0;
+  raingauge1_interrupt_ltime = 0;
+  Rain_TipsReset(rt);
+}
+
+int main() {
+  int added;
+
+  cf_rg1_enable = 1;
+
+  // Bounces 3, 8 and 400 ms after a tip are dropped, debounce runs from the counted tip so 600 ms later counts
+  Reset();
+  Edge(110000); Edge(110003); Edge(110008); Edge(110400);
+  Edge(110600); Edge(110602);
+  Edge(111101);                                                  // 501 ms after 110600, counts
+  Edge(111601);                                                  // 500 ms, a bounce
+  CHECK_EQ(raingauge1_interrupt_count, 3);
+  CHECK_NEAR(Observe(160000, &added), 0.6, 1e-6);
+  CHECK_EQ(rt->interval_tips, 3);
+  CHECK_EQ(added, 4);                                            // rr, ri, rf, rl
+  CHECK_NEAR(rt->rate, 3 * 0.2 * 60, 1e-3);
+  CHECK_NEAR(rt->intensity, 2 * 0.2 * 3600000.0 / 1101, 1e-2);
+  CHECK_EQ(rt->first_seconds, 50);
+  CHECK_EQ(rt->last_seconds, 48);
+
+  // No tips, the tip times are not reported and the rate window has moved on
+  CHECK_NEAR(Observe(220000, &added), 0.0, 1e-6);
+  CHECK_EQ(rt->interval_tips, 0);
+  CHECK_EQ(added, 2);
+  CHECK_EQ(rt->rate, 0.0);
+  CHECK_EQ(rt->intensity, 0.0);
+
+  // One tip, a rate but no intensity
+  Edge(230000); Edge(230004);
+  CHECK_NEAR(Observe(280000, &added), 0.2, 1e-6);
+  CHECK_EQ(rt->interval_tips, 1);
+  CHECK_EQ(added, 4);
+  CHECK_NEAR(rt->rate, 12.0, 1e-3);
+  CHECK_EQ(rt->intensity, 0.0);
+  CHECK_EQ(rt->first_seconds, 50);
+  CHECK_EQ(rt->last_seconds, 50);
+
+  // A bounce just after the observation is still the tip before it, the debounce is not reset by the observation
+  Edge(339900);
+  Observe(340000, &added);
+  Edge(340100);
+  CHECK_EQ(raingauge1_interrupt_count, 0);
+  CHECK_EQ(Observe(400000, &added), 0.0);
+  CHECK_EQ(rt->interval_tips, 0);
+
+  // Rain across an observation, a tip every 5 s from 430 to 490 s. The peak window of the second interval counts
+  // tips from before the observation.
+  Reset();
+  for (unsigned long t=430000; t<460500; t+=5000) {
+    RunTo(t);
+    Edge(t);
+    Edge(t + 3);
+  }
+  CHECK_NEAR(Observe(460500, &added), 7 * 0.2, 1e-6);
+  CHECK_NEAR(rt->rate, 7 * 0.2 * 60, 1e-3);
+  for (unsigned long t=465000; t<=490000; t+=5000) {
+    RunTo(t);
+    Edge(t);
+    Edge(t + 3);
+  }
+  CHECK_NEAR(Observe(520500, &added), 6 * 0.2, 1e-6);
+  CHECK_EQ(rt->interval_tips, 6);
+  CHECK_NEAR(rt->rate, 12 * 0.2 * 60, 1e-3);                     // 435 to 490 s, 12 tips in one minute
+  CHECK_EQ(rt->first_seconds, 55);
+  CHECK_EQ(rt->last_seconds, 30);
+
+  // Heavy rain, a tip every 600 ms for 2 minutes. The window holds RG_TIP_WINDOW tips, 720 mm/hr.
+  Reset();
+  for (unsigned long t=600000; t<720000; t+=600) {
+    RunTo(t);
+    Edge(t);
+  }
+  CHECK_NEAR(Observe(720000, &added), 200 * 0.2, 1e-6);
+  CHECK_EQ(rt->interval_tips, 200);
+  CHECK_NEAR(rt->rate, RG_TIP_WINDOW * 0.2 * 60, 1e-3);
+  CHECK_EQ(rt->lost, 0);
+
+  // The "RG" task stalls, the ring fills and times are lost but the count and total are not
+  Reset();
+  for (unsigned long t=800000; t<800000+70*600; t+=600) {
+    Edge(t);
+  }
+  CHECK_EQ(rt->lost, 70 - RG_TIP_RING);
+  CHECK_NEAR(Observe(800000+70*600, &added), 70 * 0.2, 1e-6);
+  CHECK_EQ(rt->interval_tips, RG_TIP_RING);
+  CHECK_EQ(rt->lost, 0);
+
+  return (test_done("rain_test"));
+}
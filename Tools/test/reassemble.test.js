@@ -0,0 +1,91 @@
+/*
+ * ======================================================================================================================
+ *  reassemble.test.js - Tools/Reassemble.js addFragment(), fragment order, loss and frag_id rollover
+ * ======================================================================================================================
+ */
+var test = require("node:test");
+var assert = require("node:assert");
+var reassemble = require("../Reassemble.js");
+
+// Port 1 text observation split in to count fragments of id, in LW_TXQ_Service() layout
+function fragments(id, text, count) {
+  var bytes = Array.from(Buffer.from(text));
+  var size = Math.ceil(bytes.length / count);
+  var f = [];
+  for (var i = 0; i < count; i++) {
+    f.push({ frag_id: id, port: 1, index: i, count: count, bytes: bytes.slice(i * size, (i + 1) * size) });
+  }
+  return f;
+}
+
+function run(frags) {
+  var out = [];
+  var lost = [];
+  var error = console.error;
+  console.error = function (m) { lost.push(m); };
+  try {
+    frags.forEach(function (f) { reassemble.addFragment(f, function (r) { out.push(r.data); }); });
+  }
+  finally {
+    console.error = error;
+  }
+  return { out: out, lost: lost };
+}
+
+test("fragments in any order", function () {
+  var f = fragments(10, "at=2026-10-15T12%3A00%3A00&bv=4.12&hth=0&bt1=21.5&bh1=55.0", 4);
+  var r = run([f[2], f[0], f[3], f[1]]);
+  assert.deepStrictEqual(r.lost, []);
+  assert.deepStrictEqual(r.out, [{ at: "2026-10-15T12:00:00", bv: 4.12, hth: 0, bt1: 21.5, bh1: 55.0 }]);
+});
+
+test("duplicate fragment counted once", function () {
+  var f = fragments(11, "at=2026-10-15T12%3A01%3A00&bv=4.11&hth=0", 3);
+  var r = run([f[0], f[0], f[1], f[1], f[2]]);
+  assert.strictEqual(r.out.length, 1);
+  assert.strictEqual(r.out[0].bv, 4.11);
+});
+
+test("dropped fragment expires after MAX_PENDING newer ids", function () {
+  var f = fragments(20, "at=2026-10-15T12%3A02%3A00&bv=4.10&hth=0", 2);
+  var frags = [f[0]];
+  for (var i = 1; i < reassemble.MAX_PENDING; i++) {
+    frags = frags.concat(fragments(20 + i, "at=2026-10-15T12%3A02%3A00&bv=4.10&hth=" + i, 2));
+  }
+  var r = run(frags);
+  assert.strictEqual(r.out.length, reassemble.MAX_PENDING - 1);
+  assert.deepStrictEqual(r.lost, []);   // Still waiting
+
+  r = run(fragments(20 + reassemble.MAX_PENDING, "at=2026-10-15T12%3A02%3A00&bv=4.10&hth=0", 2));
+  assert.deepStrictEqual(r.lost, ["fragment id 20 incomplete, 1 of 2"]);
+
+  // A late fragment of the expired payload does not complete it and is dropped in turn
+  frags = [f[1]];
+  for (i = 1; i <= reassemble.MAX_PENDING; i++) {
+    frags = frags.concat(fragments(30 + i, "at=2026-10-15T12%3A02%3A00&bv=4.10&hth=" + i, 1));
+  }
+  r = run(frags);
+  assert.strictEqual(r.out.length, reassemble.MAX_PENDING);
+  assert.deepStrictEqual(r.lost, ["fragment id 20 incomplete, 1 of 2"]);
+});
+
+test("frag_id rolls over at 255", function () {
+  var frags = [];
+  var ids = [253, 254, 255, 0, 1, 2];
+  ids.forEach(function (id) {
+    var f = fragments(id, "at=2026-10-15T12%3A03%3A00&bv=4.09&hth=" + id, 3);
+    frags.push(f[1], f[2], f[0]);
+  });
+  var r = run(frags);
+  assert.deepStrictEqual(r.lost, []);
+  assert.deepStrictEqual(r.out.map(function (o) { return o.hth; }), ids);
+});
+
+test("reused id with a different count replaces a stale payload", function () {
+  var old = fragments(40, "at=2026-10-15T12%3A04%3A00&bv=4.08&hth=0", 3);
+  var f = fragments(40, "at=2026-10-15T12%3A05%3A00&bv=4.07&hth=0", 2);
+  var r = run([old[0], f[0], f[1]]);
+  assert.deepStrictEqual(r.lost, ["fragment id 40 incomplete, 1 of 3"]);
+  assert.strictEqual(r.out.length, 1);
+  assert.strictEqual(r.out[0].bv, 4.07);
+});
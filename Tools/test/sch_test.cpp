@@ -0,0 +1,174 @@
+/*
+ * ======================================================================================================================
+ *  sch_test.cpp - Task scheduler on a fake sch_clock, see SCH.h. Deadline order, late runs, SCH_Delay() and the
+ *                 clock wrapping. unsigned long is 64 bits on the host so the clock wraps at 2^64 here, the same
+ *                 unsigned arithmetic as millis() wrapping at 2^32 on the SAMD21.
+ * ======================================================================================================================
+ */
+#include "test.h"
+
+unsigned long fake_ms;
+std::string ran;        // Task letters in the order they ran
+std::vector<unsigned long> ran_at;
+
+unsigned long FakeClock() {
+  return (fake_ms);
+}
+
+void TaskA() { ran += 'A'; ran_at.push_back(fake_ms); }
+void TaskB() { ran += 'B'; ran_at.push_back(fake_ms); }
+void TaskC() { ran += 'C'; ran_at.push_back(fake_ms); }
+
+int task_d;
+void TaskD() {                       // Puts itself off 25 ms each run
+  ran += 'D';
+  ran_at.push_back(fake_ms);
+  SCH_Delay(task_d, 25);
+}
+
+void Start(unsigned long ms) {
+  sch_clock = FakeClock;
+  sch_task_count = 0;
+  fake_ms = ms;
+  ran.clear();
+  ran_at.clear();
+}
+
+// Step the clock 1 ms at a time for ms, running the scheduler each step
+void Step(unsigned long ms) {
+  for (unsigned long i=0; i<ms; i++) {
+    fake_ms++;
+    SCH_Run();
+  }
+}
+
+void Ordering() {
+  Start(0);
+  CHECK_EQ(SCH_NextDeadline(999), 999);                          // Nothing armed
+  int a = SCH_AddTask("A", TaskA, 100, 50, true);
+  int b = SCH_AddTask("B", TaskB, 30, 10, true);
+  int c = SCH_AddTask("C", TaskC, 0, 70, true);
+  CHECK_EQ(SCH_NextDeadline(999), 10);
+
+  Step(160);
+  CHECK_STR(ran.c_str(), "BBABCBBAB");
+  CHECK_EQ(ran_at[2], 50);
+  CHECK_EQ(ran_at[4], 70);
+  CHECK_EQ(ran_at[7], 150);
+  CHECK_EQ(sch_tasks[c].runs, 1);
+  CHECK(!sch_tasks[c].armed);
+  CHECK_EQ(SCH_NextDeadline(999), 30);                           // B at 190
+
+  // Same deadline, run in the order added
+  ran.clear();
+  SCH_SetDeadline(c, 170);
+  SCH_SetDeadline(b, 170);
+  SCH_SetDeadline(a, 170);
+  Step(10);
+  CHECK_STR(ran.c_str(), "ABC");
+
+  // Disabled keeps its deadline, runs late once enabled
+  ran.clear();
+  SCH_Enable(b, false);
+  Step(40);
+  CHECK_STR(ran.c_str(), "");
+  SCH_Enable(b, true);
+  SCH_Run();
+  CHECK_STR(ran.c_str(), "B");
+  CHECK_EQ(sch_tasks[b].late_max, 10);                           // Due at 200, ran at 210
+}
+
+void Late() {
+  Start(1000);
+  int a = SCH_AddTask("A", TaskA, 100, 100, true);
+
+  // 30 ms late, the next deadline stays on the 100 ms grid
+  fake_ms = 1130;
+  SCH_Run();
+  CHECK_EQ(sch_tasks[a].deadline, 1200);
+  CHECK_EQ(sch_tasks[a].late_max, 30);
+  CHECK_EQ(sch_tasks[a].skips, 0);
+
+  // 2.5 periods late, two periods skipped, start over from now
+  fake_ms = 1450;
+  SCH_Run();
+  CHECK_EQ(sch_tasks[a].skips, 2);
+  CHECK_EQ(sch_tasks[a].deadline, 1550);
+  CHECK_EQ(sch_tasks[a].runs, 2);
+  CHECK_EQ(sch_tasks[a].late_sum, 280);
+}
+
+void Delay() {
+  Start(0);
+  int c = SCH_AddTask("C", TaskC, 0, 10, true);
+  task_d = SCH_AddTask("D", TaskD, 0, 5, true);
+
+  Step(100);
+  CHECK_STR(ran.c_str(), "DCDDD");
+  CHECK_EQ(ran_at[0], 5);
+  CHECK_EQ(ran_at[2], 30);
+  CHECK_EQ(ran_at[4], 80);
+
+  // A run once task waits for SCH_Delay()
+  ran.clear();
+  SCH_Delay(c, 3);
+  CHECK_EQ(SCH_NextDeadline(999), 3);
+  Step(3);
+  CHECK_STR(ran.c_str(), "C");
+
+  // SCH_Delay() of a periodic task moves its grid
+  Start(0);
+  int a = SCH_AddTask("A", TaskA, 50, 50, true);
+  Step(60);
+  SCH_Delay(a, 5);
+  Step(60);
+  CHECK_EQ(ran_at.size(), 3);
+  CHECK_EQ(ran_at[1], 65);
+  CHECK_EQ(ran_at[2], 115);
+}
+
+void Wrap() {
+  std::vector<unsigned long> at;
+
+  Start((unsigned long) -0x100);
+  int a = SCH_AddTask("A", TaskA, 100, 0, true);
+  int c = SCH_AddTask("C", TaskC, 0, 0x120, true);               // Deadline 0x20, past the wrap
+
+  CHECK_EQ(sch_tasks[c].deadline, 0x20);
+  CHECK_EQ(SCH_NextDeadline(0xFFFFFFFFUL), 0);                   // A is due now
+  SCH_Run();
+  CHECK_EQ(SCH_NextDeadline(0xFFFFFFFFUL), 100);
+
+  // C must not run early because 0x20 is less than the clock before the wrap
+  Step(0xFF);
+  CHECK_EQ(fake_ms, (unsigned long) -1);
+  CHECK_EQ(sch_tasks[c].runs, 0);
+  CHECK_EQ(SCH_NextDeadline(0xFFFFFFFFUL), 0x21);
+
+  Step(0x100);
+  CHECK_EQ(fake_ms, 0xFF);
+  CHECK_EQ(sch_tasks[c].runs, 1);
+  CHECK_STR(ran.c_str(), "AAACAAA");
+  CHECK_EQ(ran_at[3], 0x20);
+
+  // A stays 100 ms apart across the wrap, never late
+  for (int i=0; i<(int)ran.size(); i++) {
+    if (ran[i] == 'A') {
+      at.push_back(ran_at[i]);
+    }
+  }
+  CHECK_EQ(at.size(), 6);
+  for (int i=1; i<(int)at.size(); i++) {
+    CHECK_EQ(at[i] - at[i-1], 100);
+  }
+  CHECK_EQ(sch_tasks[a].late_max, 0);
+  CHECK_EQ(sch_tasks[a].skips, 0);
+}
+
+int main() {
+  Ordering();
+  Late();
+  Delay();
+  Wrap();
+  return (test_done("sch_test"));
+}
@@ -0,0 +1,166 @@
+/*
+ * ======================================================================================================================
+ *  sdlog_sim.cpp - Card writes for a day of the observation log on the host SD stand-in, see SDC.h
+ *
+ *    open/close     The old SD_LogObservation(), SD.open(FILE_WRITE), println() and close() for every line
+ *    sync N         SD_LogObservation() with the day's log kept open and cf_sd_sync N seconds
+ *
+ *  Sector writes are 512 byte data writes to the card, directory writes are directory entry updates, opens are the
+ *  directory searches an SD.open() does. The lines a power loss can lose are those logged since the last sync.
+ *
+ *  Then a month of days with a 3 hour uplink outage each, during which a backlog file grows beside the log and is
+ *  removed after, as the old N2SOBS.TXT did. Write amplification is every sector written, data, directory and FAT,
+ *  over the sectors of log lines. Fragments is the mean number of cluster runs a day's log is left in, held is the
+ *  most card space the open day's log took over what it had logged.
+ * ======================================================================================================================
+ */
+#include "test.h"
+
+const uint32_t T0 = 1760054400;         // 2025-10-10T00:00:00
+
+// A station's JSON log line at time t
+const char *Line(uint32_t t) {
+  int sidx = 0;
+
+  OBS_Clear();
+  obs.inuse = true;
+  obs.ts = t;
+  obs.bv = 4.12;
+  for (int id=0; id<30; id++) {
+    OBS_AddF(&sidx, id, (id * 37.1) + (t % 600) / 10.0);
+  }
+  OBS_Render(true);
+  return (obsbuf);
+}
+
+void Blank() {
+  test_sd("sdlog_sim");
+  memset(host_eeprom, 0, sizeof(host_eeprom));
+  SD_log_fp = File();
+  SD_log_day = 0;
+  SD_log_len = 0;
+  SD_idx_len = 0;
+  eeprom_valid = false;
+  SD_initialize();
+  EEPROM_initialize();
+  RTC_valid = true;
+  host_sd_root = "";                    // Nothing to save, the counts are what matter
+}
+
+void Report(const char *name, int interval, long lines, long writes, long dirwrites, long reads, long lost) {
+  printf("%-10s %4d min %5ld lines %6ld sector writes %5ld directory writes %6ld sector reads %4ld lines at risk\n",
+         name, interval, lines, writes, dirwrites, reads, lost);
+}
+
+// A day of observations every interval minutes
+void Day(int interval, int sync) {
+  long writes, dirwrites, reads, lines = 1440 / interval;
+  char name[16];
+
+  Blank();
+  writes = host_sd_writes;
+  dirwrites = host_sd_dirwrites;
+  reads = host_sd_reads;
+  if (sync < 0) {
+    for (long i=0; i<lines; i++) {
+      File fp = SD.open("/OBS/20251010.log", FILE_WRITE);
+      fp.println(Line(T0 + i * interval * 60));
+      fp.close();
+    }
+    Report("open/close", interval, lines, host_sd_writes - writes, host_sd_dirwrites - dirwrites,
+           host_sd_reads - reads, 0);
+    return;
+  }
+
+  cf_sd_sync = sync;
+  for (long i=0; i<lines; i++) {
+    uint32_t t = T0 + i * interval * 60;
+
+    host_unixtime = t;
+    host_millis = (unsigned long) (t - T0) * 1000;
+    now = DateTime(t);
+    SD_LogObservation((char *) Line(t), t);
+  }
+  SD_LogClose(true);
+  sprintf(name, "sync %d", sync);
+  Report(name, interval, lines, host_sd_writes - writes, host_sd_dirwrites - dirwrites, host_sd_reads - reads,
+         (sync + interval * 60 - 1) / (interval * 60));
+}
+
+// Month of days at interval minutes, the old writer when old is set
+void Month(int interval, bool old) {
+  long writes, dirwrites, fatwrites, lines = 1440 / interval, frags = 0, held = 0, bytes = 0;
+  char file[24];
+
+  Blank();
+  cf_sd_sync = 300;
+  cf_5m_enable = (interval == 5);
+  cf_15m_enable = (interval == 15);
+  writes = host_sd_writes;
+  dirwrites = host_sd_dirwrites;
+  fatwrites = host_sd_fatwrites;
+  for (int d=0; d<30; d++) {
+    for (long i=0; i<lines; i++) {
+      uint32_t t = T0 + d * 86400 + i * interval * 60;
+      bool outage = (i * interval >= 600) && (i * interval < 780);
+
+      Line(t);
+      bytes += strlen(obsbuf) + 2;
+      if (old) {
+        now = DateTime(t);
+        sprintf (file, "/OBS/%4d%02d%02d.log", now.year(), now.month(), now.day());
+        File fp = SD.open(file, FILE_WRITE);
+        fp.println(obsbuf);
+        fp.close();
+      }
+      else {
+        host_unixtime = t;
+        host_millis = (unsigned long) (t - T0) * 1000;
+        now = DateTime(t);
+        SD_LogObservation(obsbuf, t);
+        held = std::max<long>(held, (long) SD_log_fp.size() - (long) (SD_log_end + SD_log_len));
+      }
+      if (outage) {
+        File fp = SD.open("/N2SOBS.TXT", FILE_WRITE);
+        fp.write((const uint8_t *) obsbuf, 300);
+        fp.close();
+      }
+      else if (SD.exists("/N2SOBS.TXT")) {
+        SD.remove("/N2SOBS.TXT");
+      }
+    }
+  }
+  if (!old) {
+    SD_LogClose(true);
+  }
+  for (int d=0; d<30; d++) {
+    DateTime dt(T0 + d * 86400);
+    sprintf (file, "/OBS/%4d%02d%02d.log", dt.year(), dt.month(), dt.day());
+    frags += host_sd_fragments(file);
+  }
+  writes = host_sd_writes - writes;
+  dirwrites = host_sd_dirwrites - dirwrites;
+  fatwrites = host_sd_fatwrites - fatwrites;
+  printf("%-10s %4d min %7ld sector %6ld directory %6ld FAT writes  amplification %5.2f  fragments %5.2f  "
+         "held %6.1f KB\n", (old) ? "open/close" : "sync 300", interval, writes, dirwrites, fatwrites,
+         (double) (writes + dirwrites + fatwrites) / (bytes / 512.0), frags / 30.0, held / 1024.0);
+  cf_5m_enable = 0;
+  cf_15m_enable = 0;
+}
+
+int main() {
+  const int syncs[] = { -1, 0, 60, 300, 900, 3600 };
+
+  printf("sdlog_sim: a day of %d byte lines\n", (int) strlen(Line(T0)) + 2);
+  for (int interval : { 1, 5, 15 }) {
+    for (int sync : syncs) {
+      Day(interval, sync);
+    }
+  }
+  printf("\nsdlog_sim: 30 days, a 3 hour outage each day\n");
+  for (int interval : { 1, 5, 15 }) {
+    Month(interval, true);
+    Month(interval, false);
+  }
+  return (0);
+}
@@ -0,0 +1,363 @@
+/*
+ * ======================================================================================================================
+ *  sdlog_test.cpp - Observation log writer, see SDC.h. Days of observations through SD_LogObservation() on the host
+ *                   SD stand-in: what ends up on the card, the rollover at UTC midnight, a power loss between syncs,
+ *                   and the sector and directory entry writes a day costs against the open, println and close it
+ *                   replaced. The preallocation's size, its one run of clusters and the end of the data found again
+ *                   after a reboot, and by the reader of a day that was never trimmed. See sdlog_sim.cpp for the
+ *                   writes at each cf_sd_sync and over a month.
+ * ======================================================================================================================
+ */
+#include "test.h"
+
+const uint32_t T0 = 1760054400;         // 2025-10-10T00:00:00
+std::string logged;                     // Every line logged to the open day, as it should be on the card
+
+// A station's JSON log line at time t, about 380 bytes
+const char *Line(uint32_t t) {
+  int sidx = 0;
+
+  OBS_Clear();
+  obs.inuse = true;
+  obs.ts = t;
+  obs.bv = 4.12;
+  for (int id=0; id<30; id++) {
+    OBS_AddF(&sidx, id, (id * 37.1) + (t % 600) / 10.0);
+  }
+  OBS_Render(true);
+  return (obsbuf);
+}
+
+// Observation at time t, the clocks moved to it as the sketch's would be
+void Log(uint32_t t) {
+  host_unixtime = t;
+  host_millis = (unsigned long) (t - T0) * 1000;
+  now = DateTime(t);
+  SD_LogObservation((char *) Line(t), t);
+  logged += obsbuf;
+  logged += "\r\n";
+}
+
+// What the directory entry of path says is in the file
+std::string Card(const char *path) {
+  auto it = host_sd_files.find(path);
+
+  if (it == host_sd_files.end()) {
+    return ("");
+  }
+  return (it->second.card.substr(0, it->second.dirsize));
+}
+
+// Power on: RAM is lost, the card and EEPROM are what was last written
+void Reboot() {
+  host_sd_powerloss();
+  SD_log_fp = File();
+  SD_log_day = 0;
+  SD_log_len = 0;
+  SD_idx_len = 0;
+  SD_exists = false;
+  eeprom_valid = false;
+  SD_initialize();
+  EEPROM_initialize();
+}
+
+void Blank() {
+  test_sd("sdlog");
+  memset(host_eeprom, 0, sizeof(host_eeprom));
+  Reboot();
+  RTC_valid = true;
+  logged.clear();
+}
+
+// A day of 1 minute observations. The card holds every line, and a day costs about one data sector write per
+// 512 bytes logged plus one per sync, where the open, println and close wrote a sector and a directory entry for
+// every line.
+void Day() {
+  long writes, dirwrites, old_writes, old_dirwrites, syncs = 1440 / 5;
+  std::string day;
+
+  Blank();
+  cf_sd_sync = 300;
+  writes = host_sd_writes;
+  dirwrites = host_sd_dirwrites;
+  for (int m=0; m<1440; m++) {
+    Log(T0 + m * 60);
+  }
+  SD_LogClose(true);
+  writes = host_sd_writes - writes;
+  dirwrites = host_sd_dirwrites - dirwrites;
+
+  CHECK_EQ(Card("/OBS/20251010.log").size(), logged.size());
+  CHECK(Card("/OBS/20251010.log") == logged);
+  CHECK(writes <= (long) (logged.size() / SD_BLOCKSZ) + 2 * syncs + 4);   // Log sectors, sync tails and index
+  CHECK(dirwrites <= 2 * syncs + 4);                                    // Log and index on each sync
+
+  // The way it was, for the same day
+  day = logged;
+  Blank();
+  old_writes = host_sd_writes;
+  old_dirwrites = host_sd_dirwrites;
+  for (int m=0; m<1440; m++) {
+    File fp = SD.open("/OBS/OLD.log", FILE_WRITE);
+    fp.println(Line(T0 + m * 60));
+    fp.close();
+  }
+  old_writes = host_sd_writes - old_writes;
+  old_dirwrites = host_sd_dirwrites - old_dirwrites;
+  CHECK(Card("/OBS/OLD.log") == day);
+  CHECK(old_dirwrites >= 1440);
+  CHECK(writes * 3 < old_writes * 2);
+  CHECK(dirwrites * 10 < old_dirwrites);
+  if (getenv("SERIAL")) {
+    printf("day of %zu bytes  open println close %ld sector %ld directory writes  open log %ld sector %ld "
+           "directory writes\n", day.size(), old_writes, old_dirwrites, writes, dirwrites);
+  }
+}
+
+// With cf_sd_sync 0 each line reaches the directory entry before SD_LogObservation() returns
+void SyncEvery() {
+  Blank();
+  cf_sd_sync = 0;
+  for (int m=0; m<10; m++) {
+    Log(T0 + m * 60);
+    CHECK(Card("/OBS/20251010.log").substr(0, logged.size()) == logged);
+    CHECK_EQ(eeprom.log_end, logged.size());
+  }
+}
+
+// Lines are buffered until a sector fills and only reach the directory entry and EEPROM every cf_sd_sync seconds
+void Cadence() {
+  Blank();
+  cf_sd_sync = 300;
+  Log(T0);                                                      // Opens the day
+  CHECK_EQ(SD_log_len, logged.size());                          // Held in RAM
+  CHECK_EQ(eeprom.log_end, 0);
+  for (int m=1; m<5; m++) {
+    Log(T0 + m * 60);
+  }
+  CHECK(SD_log_end > 0);                                        // Whole sectors handed to the card
+  CHECK_EQ(eeprom.log_end, 0);
+  Log(T0 + 300);                                                // 300 s since the open
+  CHECK_EQ(SD_log_len, 0);
+  CHECK_EQ(eeprom.log_day, 20251010);
+  CHECK_EQ(eeprom.log_end, logged.size());
+  CHECK(Card("/OBS/20251010.log").substr(0, logged.size()) == logged);
+}
+
+// The day rolls at UTC midnight, yesterday's file trimmed to its lines
+void Midnight() {
+  std::string yesterday;
+
+  Blank();
+  cf_sd_sync = 300;
+  for (uint32_t t=T0 + 86400 - 600; t<T0 + 86400; t+=60) {
+    Log(t);
+  }
+  yesterday = logged;
+  logged.clear();
+  Log(T0 + 86400);
+  Log(T0 + 86460);
+  CHECK_EQ(SD_log_day, 20251011);
+  CHECK(host_sd_files["/OBS/20251010.log"].dirsize == yesterday.size());
+  CHECK(Card("/OBS/20251010.log") == yesterday);
+  SD_LogClose(false);
+  CHECK(Card("/OBS/20251011.log").substr(0, logged.size()) == logged);
+  CHECK_EQ(eeprom.log_day, 20251011);
+}
+
+// Power lost between syncs loses only the lines since the last sync, the day carries on after them
+void PowerLoss() {
+  std::string kept;
+
+  Blank();
+  cf_sd_sync = 300;
+  for (int m=0; m<58; m++) {
+    Log(T0 + m * 60);
+  }
+  kept = logged.substr(0, eeprom.log_end);                      // Synced at 55 minutes
+  CHECK_EQ(kept.size(), logged.size() - 2 * (strlen(obsbuf) + 2));
+  CHECK(kept.size() > 0);
+  Reboot();
+  logged = kept;
+  for (int m=60; m<70; m++) {
+    Log(T0 + m * 60);
+  }
+  SD_LogClose(true);
+  CHECK(Card("/OBS/20251010.log") == logged);
+}
+
+// The day is preallocated for the interval and the first line in one run, appending adds nothing to the FAT
+void Prealloc() {
+  int len;
+  long fatwrites;
+
+  Blank();
+  cf_sd_sync = 300;
+  Log(T0);
+  len = strlen(obsbuf) + 2;
+  CHECK_EQ(SD_log_fp.size(), SD_LogPrealloc(len));
+  CHECK_EQ(SD_LogPrealloc(len) % SD_BLOCKSZ, 0);
+  CHECK(SD_LogPrealloc(len) >= 1440 * (len + SD_LOG_SLACK));
+  CHECK(SD_LogPrealloc(len) < 1440 * (len + SD_LOG_SLACK) * 5 / 4);
+  CHECK_EQ(host_sd_fragments("/OBS/20251010.log"), 1);
+  fatwrites = host_sd_fatwrites;
+  for (int m=1; m<1440; m++) {
+    Log(T0 + m * 60);
+  }
+  CHECK(host_sd_fatwrites - fatwrites <= 1);                    // The index's one cluster
+  Log(T0 + 86400);
+  CHECK(host_sd_files["/OBS/20251010.log"].chain.size() * host_sd_cluster < logged.size() + host_sd_cluster);
+
+  // 5 and 15 minute stations preallocate a fifth and a fifteenth of it
+  cf_15m_enable = 1;
+  CHECK(SD_LogPrealloc(len) >= 96 * (len + SD_LOG_SLACK));
+  CHECK(SD_LogPrealloc(len) < 96 * (len + SD_LOG_SLACK) * 5 / 4);
+  cf_15m_enable = 0;
+  cf_5m_enable = 1;
+  CHECK(SD_LogPrealloc(len) >= 288 * (len + SD_LOG_SLACK));
+  cf_5m_enable = 0;
+}
+
+// Lines longer than the preallocation allowed for, the day grows past it and its end is found after a reboot that
+// lost the EEPROM
+void Overflow() {
+  Blank();
+  cf_sd_sync = 300;
+  cf_15m_enable = 1;
+  for (int q=0; q<92; q++) {
+    Log(T0 + q * 900);
+    if (q == 40) {
+      SD_LogWrite(std::string(12000, 'x').c_str(), 12000);        // A burst of long lines, here one
+      SD_LogWrite("\r\n", 2);
+      logged += std::string(12000, 'x') + "\r\n";
+    }
+  }
+  CHECK(SD_log_end > SD_LogPrealloc(strlen(obsbuf) + 2));
+  SD_LogSync();
+  host_eeprom[0] ^= 0xFF;                                       // Checksum no longer matches
+  Reboot();
+  for (int q=92; q<96; q++) {
+    Log(T0 + q * 900);
+  }
+  cf_15m_enable = 0;
+  SD_LogClose(true);
+  CHECK(Card("/OBS/20251010.log") == logged);
+}
+
+// The EEPROM end lost, the preallocated day is scanned for its end
+void LostEnd() {
+  Blank();
+  cf_sd_sync = 0;
+  for (int m=0; m<30; m++) {
+    Log(T0 + m * 60);
+  }
+  Reboot();
+  eeprom.log_end = 12345;                                       // Not a line end
+  for (int m=30; m<40; m++) {
+    Log(T0 + m * 60);
+  }
+  SD_LogClose(true);
+  CHECK(Card("/OBS/20251010.log") == logged);
+}
+
+// Times of the lines SD_LogReadLine() reads back from day yyyymmdd
+std::vector<uint32_t> ReadBack(long day) {
+  std::vector<uint32_t> got;
+  char buf[MAX_MSGBUF_SIZE];
+  uint32_t t;
+  int len;
+
+  if (SD_LogReadOpen(day, 0)) {
+    while ((len = SD_LogReadLine(buf, sizeof(buf), &t)) != 0) {
+      if (len > 0) {
+        got.push_back(t);
+      }
+    }
+  }
+  SD_LogReadClose();
+  return (got);
+}
+
+// A day left untrimmed by a power loss, its preallocation past the data holding old card data that reads as log
+// lines: a non-NUL byte then a month old day's lines. Read back stops at the end from EEPROM, or without it at the
+// end the scan finds, never reaching the old lines.
+void Untrimmed() {
+  std::vector<uint32_t> kept, got;
+  std::string old = "\x01";
+  uint32_t end;
+
+  Blank();
+  cf_sd_sync = 300;
+  for (int m=0; m<5; m++) {
+    old += Line(T0 - 30 * 86400 + m * 60);
+    old += "\r\n";
+  }
+  for (int m=0; m<100; m++) {
+    Log(T0 + m * 60);
+  }
+  Reboot();                                                     // Before SD_LogClose(true), not trimmed
+  end = eeprom.log_end;
+  for (int m=0; m<100; m++) {
+    if (logged.find(Line(T0 + m * 60)) + strlen(obsbuf) + 2 <= end) {
+      kept.push_back(T0 + m * 60);
+    }
+  }
+  HostSDNode &n = host_sd_files["/OBS/20251010.log"];
+  CHECK_EQ(n.dirsize % SD_BLOCKSZ, 0);
+  size_t q = n.card.find_first_of(std::string("\0\xFF", 2), end);
+  n.card.replace(q, old.size(), old);                           // Right after the last sector written
+  CHECK_EQ(eeprom.log_day, 20251010);
+
+  CHECK(ReadBack(20251010) == kept);
+
+  // The EEPROM lost, the scan finds the end of the lines written before the power loss
+  host_eeprom[0] ^= 0xFF;
+  Reboot();
+  got = ReadBack(20251010);
+  CHECK(got.size() >= kept.size());
+  CHECK(got.size() <= 100);
+  for (size_t i=0; i<got.size(); i++) {
+    CHECK_EQ(got[i], T0 + i * 60);
+  }
+
+  // Filled with 0xFF, as a new card is
+  Blank();
+  for (int m=0; m<10; m++) {
+    Log(T0 + m * 60);
+  }
+  SD_LogSync();
+  host_eeprom[0] ^= 0xFF;
+  Reboot();
+  CHECK_EQ(ReadBack(20251010).size(), 10);
+}
+
+// No free run long enough, the log is created and grows a cluster at a time
+void Fragmented() {
+  Blank();
+  cf_sd_sync = 300;
+  host_sd_fat_find(0);
+  for (long c=0; c<host_sd_clusters; c+=4) {
+    host_sd_fat[c] = true;                                      // Three free clusters in every four
+  }
+  for (int m=0; m<300; m++) {
+    Log(T0 + m * 60);
+  }
+  SD_LogClose(true);
+  CHECK(Card("/OBS/20251010.log") == logged);
+  CHECK(host_sd_fragments("/OBS/20251010.log") > 1);
+  host_sd_fat.assign(host_sd_clusters, false);
+}
+
+int main() {
+  Day();
+  Prealloc();
+  Overflow();
+  LostEnd();
+  Fragmented();
+  Untrimmed();
+  SyncEvery();
+  Cadence();
+  Midnight();
+  PowerLoss();
+  return (test_done("sdlog_test"));
+}
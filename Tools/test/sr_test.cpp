@@ -0,0 +1,238 @@
+/*
+ * ======================================================================================================================
+ *  sr_test.cpp - Sensor registry, see SR.h. The sensor libraries in host/ are mock drivers, a test says which are
+ *                found and what they read. SR_TakeObservations() order and QC, derived observations and their
+ *                dependencies, I2C_Check_Sensors() taking sensors offline and back, and the Station Monitor lines.
+ * ======================================================================================================================
+ */
+#include "test.h"
+#include <set>
+
+std::set<int> on_bus;                   // I2C addresses that ACK
+
+bool OnBus(int addr) {
+  return (on_bus.count(addr) != 0);
+}
+
+// HIH8000 humidity and temperature bytes for 50% and 20C
+int Hih8Read(int addr, int reg, uint8_t *buf, int n) {
+  const uint8_t b[4] = { 0x20, 0x05, 0x5D, 0x18 };
+
+  if ((addr != HIH8000_ADDRESS) || (n != 4)) {
+    return (0);
+  }
+  memcpy(buf, b, 4);
+  return (4);
+}
+
+// Names of the observations in obs.sensor[] order
+std::string Names() {
+  std::string s;
+
+  for (int i=0; i<MAX_SENSORS && OBS_Present(i); i++) {
+    s += (s.empty() ? "" : " ");
+    s += obs_names[obs.sensor[i].id].name;
+  }
+  return (s);
+}
+
+// Value of observation id, NAN if it is not in obs
+double Value(int id) {
+  for (int i=0; i<MAX_SENSORS && OBS_Present(i); i++) {
+    if (obs.sensor[i].id == id) {
+      return ((obs.sensor[i].type == F_OBS) ? obs.sensor[i].f_obs : obs.sensor[i].i_obs);
+    }
+  }
+  return (NAN);
+}
+
+int Take() {
+  OBS_Clear();
+  return (SR_TakeObservations(0));
+}
+
+// Every sensor found, reading what the mock drivers say
+void Station() {
+  BMX_1_exists = true;  BMX_1_chip_id = BME280_BMP390_CHIP_ID;  BMX_1_type = BMX_TYPE_BME280;
+  bme1.host_p = 101320;  bme1.host_t = 21.5;  bme1.host_h = 55;
+  BMX_2_exists = true;  BMX_2_chip_id = BMP280_CHIP_ID;  BMX_2_type = BMX_TYPE_BMP280;
+  bmp2.host_p = 101300;  bmp2.host_t = 21.0;
+  HTU21DF_exists = true;  htu.host_t = 22.0;  htu.host_h = 50;
+  SHT_1_exists = true;  sht1.host_t = 30.0;  sht1.host_h = 70;
+  SHT_2_exists = true;  sht2.host_t = 20.5;  sht2.host_h = 45;
+  HIH8_exists = true;
+  SI1145_exists = true;  uv.host_vis = 260;  uv.host_ir = 250;  uv.host_uv = 150;
+  MCP_1_exists = true;  mcp1.host_t = 31.0;
+  MCP_2_exists = true;  mcp2.host_t = -0.4;
+  VEML7700_exists = true;  veml.host_lux = 1234.5;
+  PM25AQI_exists = true;
+  pm25aqi_obs.max_s10 = 3;  pm25aqi_obs.max_s25 = 5;  pm25aqi_obs.max_s100 = 8;
+  pm25aqi_obs.max_e10 = 4;  pm25aqi_obs.max_e25 = 6;  pm25aqi_obs.max_e100 = 9;
+  HI_exists = WBT_exists = WBGT_exists = true;
+  host_i2c_read = Hih8Read;
+  SystemStatusBits = 0;
+}
+
+void Read() {
+  Station();
+  CHECK_EQ(Take(), 29);
+  CHECK_STR(Names(), "bp1 bt1 bh1 bp2 bt2 bh2 hh1 ht1 st1 sh1 st2 sh2 ht2 hh2 sv1 si1 su1 mt1 mt2 lx "
+                     "pm1s10 pm1s25 pm1s100 pm1e10 pm1e25 pm1e100 hi wbt wbgt");
+  CHECK_NEAR(Value(SID_BP1), 1013.2, 1e-3);
+  CHECK_NEAR(Value(SID_BH1), 55, 1e-6);
+  CHECK_NEAR(Value(SID_BP2), 1013.0, 1e-3);
+  CHECK_NEAR(Value(SID_BH2), 0, 1e-6);                            // BMP280 has no humidity
+  CHECK_NEAR(Value(SID_HT1), 22.0, 1e-6);
+  CHECK_NEAR(Value(SID_HH2), 50.0, 0.01);
+  CHECK_NEAR(Value(SID_HT2), 20.0, 0.01);
+  CHECK_NEAR(Value(SID_SU1), 1.5, 1e-6);
+  CHECK_NEAR(Value(SID_MT2), -0.4, 1e-6);
+  CHECK_NEAR(Value(SID_LX), 1234.5, 1e-3);
+  CHECK_EQ(Value(SID_PM1E100), 9);
+  CHECK_EQ(obs.sensor[25].type, I_OBS);
+
+  // The derived reads use MCP1 and SHT1 as read and QC'd earlier in the table
+  CHECK_NEAR(Value(SID_HI), hi_calculate(31.0, 70), 1e-6);
+  CHECK_NEAR(Value(SID_WBT), (float) wbt_calculate(31.0, 70), 1e-6);
+  CHECK_NEAR(Value(SID_WBGT), (float) wbgt_calculate(hi_calculate(31.0, 70)), 1e-6);
+
+  // PM25AQI's clear runs after it is read
+  CHECK_EQ(pm25aqi_obs.max_e100, 0);
+
+  // The same station with its BMX1 a BMP390
+  BMX_1_chip_id = BME280_BMP390_CHIP_ID;  BMX_1_type = BMX_TYPE_BMP390;
+  bm31.host_p = 99000;  bm31.host_t = 5.0;
+  Take();
+  CHECK_NEAR(Value(SID_BP1), 990, 1e-3);
+  CHECK_NEAR(Value(SID_BT1), 5.0, 1e-6);
+}
+
+void Qc() {
+  Station();
+  sht1.host_h = 101;                                             // Out of range
+  mcp1.host_t = NAN;
+  bme1.host_p = 29000;
+  htu.host_h = 100;                                              // On the limit, kept
+  Take();
+  CHECK_NEAR(Value(SID_SH1), QC_ERR_RH, 1e-3);
+  CHECK_NEAR(Value(SID_MT1), QC_ERR_T, 1e-3);
+  CHECK_NEAR(Value(SID_BP1), QC_ERR_P, 1e-3);
+  CHECK_NEAR(Value(SID_HH1), 100, 1e-6);
+
+  // The derived reads get the QC'd values, as OBS_Take() gave them
+  CHECK_NEAR(Value(SID_HI), QC_ERR_HI, 1e-3);
+  CHECK_NEAR(Value(SID_HI), hi_calculate(QC_ERR_T, QC_ERR_RH), 1e-3);
+  CHECK_NEAR(Value(SID_WBT), QC_ERR_T, 1e-3);
+}
+
+void Missing() {
+  // A sensor not found at boot is not read and its observations are left out
+  Station();
+  SHT_2_exists = false;
+  VEML7700_exists = false;
+  PM25AQI_exists = false;
+  CHECK_EQ(Take(), 20);
+  CHECK(isnan(Value(SID_ST2)));
+  CHECK(isnan(Value(SID_LX)));
+  CHECK(isnan(Value(SID_PM1S10)));
+
+  // Derived observations are dropped while a sensor they come from has its status bit set
+  Station();
+  MCP_1_exists = false;
+  SystemStatusBits = SSB_MCP_1;
+  Take();
+  CHECK(isnan(Value(SID_MT1)));
+  CHECK(isnan(Value(SID_HI)));
+  CHECK(isnan(Value(SID_WBT)));
+  CHECK(isnan(Value(SID_WBGT)));
+  SystemStatusBits = 0;
+  HI_exists = false;                                              // Not configured
+  Take();
+  CHECK(isnan(Value(SID_HI)));
+  CHECK(!isnan(Value(SID_WBT)));
+
+  // Nothing found, nothing added
+  SystemStatusBits = 0;
+  for (int r=0; r<SR_COUNT; r++) {
+    *sr_drivers[r].exists = false;
+  }
+  CHECK_EQ(Take(), 0);
+  CHECK_EQ(SR_TakeObservations(5), 5);
+}
+
+void Health() {
+  Station();
+  host_i2c_present = OnBus;
+  on_bus = { BMX_ADDRESS_1, BMX_ADDRESS_2, HTU21DF_I2CADDR, SI1145_ADDR, PM25AQI_ADDRESS, AS5600_ADR };
+
+  I2C_Check_Sensors();
+  CHECK_EQ(SystemStatusBits, 0);
+
+  // HTU and the vane drop off the bus, they go offline and their bits are set
+  on_bus.erase(HTU21DF_I2CADDR);
+  on_bus.erase(AS5600_ADR);
+  I2C_Check_Sensors();
+  CHECK(!HTU21DF_exists);
+  CHECK(!AS5600_exists);
+  CHECK_EQ(SystemStatusBits, SSB_HTU21DF | SSB_AS5600);
+  Take();
+  CHECK(isnan(Value(SID_HT1)));
+
+  // Back on the bus but its probe fails, it stays offline. The vane has no probe and comes straight back.
+  on_bus.insert(HTU21DF_I2CADDR);
+  on_bus.insert(AS5600_ADR);
+  htu.host_found = false;
+  I2C_Check_Sensors();
+  CHECK(!HTU21DF_exists);
+  CHECK(AS5600_exists);
+  CHECK_EQ(SystemStatusBits, SSB_HTU21DF);
+
+  htu.host_found = true;
+  I2C_Check_Sensors();
+  CHECK(HTU21DF_exists);
+  CHECK_EQ(SystemStatusBits, 0);
+  Take();
+  CHECK_NEAR(Value(SID_HT1), 22.0, 1e-6);
+
+  // SHT and MCP are not watched, they stay as they are with nothing on the bus
+  on_bus.clear();
+  I2C_Check_Sensors();
+  CHECK(SHT_1_exists);
+  CHECK(MCP_1_exists);
+  CHECK(!BMX_1_exists);
+  CHECK(!PM25AQI_exists);
+
+  // The status bits of every driver are cleared after the first observation, the rest are left alone
+  SystemStatusBits |= SSB_SD | SSB_SHT_2 | SSB_HIH8;
+  SR_ClearStatusBits();
+  CHECK_EQ(SystemStatusBits, SSB_SD);
+  host_i2c_present = NULL;
+}
+
+void Monitor() {
+  char lines[32][64];
+  int n = SR_MonitorCount();
+
+  Station();
+  CHECK_EQ(n, 11);                                               // Hardware sensors with observations
+  SHT_2_exists = false;
+  for (int i=0; i<n; i++) {
+    SR_MonitorLine(i);
+    strcpy(lines[i], msgbuf);
+  }
+  CHECK_STR(lines[0], "BMX1 1013.2 21.5 55.0");
+  CHECK_STR(lines[4], "SHT2 NF");
+  CHECK_STR(lines[8], "MCP2 -0.4");                               // Sign kept below 1
+  CHECK_STR(lines[10], "PM 3 5 8 4 6 9");
+  SR_MonitorLine(n);
+  CHECK_STR(msgbuf, "");
+}
+
+int main() {
+  Read();
+  Qc();
+  Missing();
+  Health();
+  Monitor();
+  return (test_done("sr_test"));
+}
@@ -0,0 +1,51 @@
+/*
+ * ======================================================================================================================
+ *  test.h - Host test support. Builds the whole sketch against the stand-ins in host/ and gives CHECK macros.
+ *
+ *  A test is a main() that drives the sketch's functions directly, setup() and loop() are never called.
+ *  make -C Tools/test runs every *_test.cpp then every *.test.js, see Makefile.
+ * ======================================================================================================================
+ */
+#include "Arduino.h"
+#include "../../FS-LoRaWAN/FS-LoRaWAN.ino"
+
+#include <string>
+#include <vector>
+
+int test_checks = 0;
+int test_failures = 0;
+
+#define CHECK(c) do { test_checks++; if (!(c)) { test_failures++; \
+  printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #c); } } while (0)
+
+#define CHECK_EQ(a, b) do { test_checks++; long long _a = (long long)(a), _b = (long long)(b); if (_a != _b) { \
+  test_failures++; printf("%s:%d: %s == %s failed, %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); } } while (0)
+
+#define CHECK_NEAR(a, b, tol) do { test_checks++; double _a = (a), _b = (b); if (!(fabs(_a - _b) <= (tol))) { \
+  test_failures++; printf("%s:%d: %s ~= %s failed, %.9g != %.9g\n", __FILE__, __LINE__, #a, #b, _a, _b); } } while (0)
+
+#define CHECK_STR(a, b) do { test_checks++; std::string _a = (a), _b = (b); if (_a != _b) { test_failures++; \
+  printf("%s:%d: %s == %s failed\n  got  [%s]\n  want [%s]\n", __FILE__, __LINE__, #a, #b, _a.c_str(), _b.c_str()); } \
+  } while (0)
+
+// Print the result and return main()'s exit status
+int test_done(const char *name) {
+  printf("%s: %d checks, %d failed\n", name, test_checks, test_failures);
+  return (test_failures ? 1 : 0);
+}
+
+// Per test SD card directory under build/, emptied
+void test_sd(const char *name) {
+  host_sd_root = std::string("build/sd_") + name;
+  host_sd_format();
+}
+
+std::string test_hex(const uint8_t *b, int n) {
+  std::string s;
+  char h[3];
+  for (int i=0; i<n; i++) {
+    snprintf(h, sizeof(h), "%02x", b[i]);
+    s += h;
+  }
+  return (s);
+}
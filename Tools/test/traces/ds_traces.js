@@ -0,0 +1,75 @@
+/*
+ * ======================================================================================================================
+ *  ds_traces.js - Write the distance sensor traces that ds_test.cpp filters, see DS_Filter() in WRDB.h
+ *
+ *    node ds_traces.js
+ *
+ *  Each trace is 10 minutes of a MaxBotix style ultrasonic sensor read 9 times a second on the 12 bit ADC, one
+ *  line a second: the true reading over the second then the 9 samples. The noise is modeled on what these sensors do over snow and
+ *  water. Gaussian ADC noise, dropouts where no echo came back and the sensor reports full range, and multipath
+ *  echoes that read short (off a mast or a snowflake) or long (a second bounce). The seed is fixed so the files
+ *  do not change from run to run. Recorded traces in the same format can be dropped in next to these.
+ * ======================================================================================================================
+ */
+var fs = require("fs");
+var path = require("path");
+
+var SECONDS = 600;
+var SAMPLES = 9;
+
+// mulberry32, so the traces are the same on every node version
+function prng(seed) {
+  return function () {
+    seed = (seed + 0x6D2B79F5) | 0;
+    var t = Math.imul(seed ^ (seed >>> 15), 1 | seed);
+    t = (t + Math.imul(t ^ (t >>> 7), 61 | t)) ^ t;
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+}
+
+function gauss(rand) {
+  return Math.sqrt(-2 * Math.log(1 - rand())) * Math.cos(2 * Math.PI * rand());
+}
+
+function clamp(v) {
+  return Math.max(0, Math.min(4095, Math.round(v)));
+}
+
+// depth(t) is the true reading, sigma the ADC noise, dropout and multipath the chance a sample is either
+function trace(name, comment, seed, depth, sigma, dropout, multipath) {
+  var rand = prng(seed);
+  var lines = ["# " + name + " - " + comment, "# truth over the second, then " + SAMPLES + " ADC samples, one line a second"];
+  for (var t = 0; t < SECONDS; t++) {
+    var truth = 0;
+    for (var i = 0; i < SAMPLES; i++) {
+      truth += depth(t + i / SAMPLES) / SAMPLES;
+    }
+    truth = clamp(truth);
+    var line = [truth];
+    for (var i = 0; i < SAMPLES; i++) {
+      var r = rand();
+      var v;
+      if (r < dropout) {
+        v = 4095;
+      }
+      else if (r < dropout + multipath) {
+        v = (rand() < 0.5) ? truth * (0.3 + 0.5 * rand()) : truth * (1.8 + 0.4 * rand());
+      }
+      else {
+        v = depth(t + i / SAMPLES) + sigma * gauss(rand);
+      }
+      line.push(clamp(v));
+    }
+    lines.push(line.join(" "));
+  }
+  fs.writeFileSync(path.join(__dirname, name + ".txt"), lines.join("\n") + "\n");
+}
+
+trace("ds_quiet", "calm snow surface, ADC noise only", 1,
+      function (t) { return 1600 + 20 * Math.sin(t / 300); }, 2, 0, 0);
+trace("ds_dropout10", "snow, 10 percent of samples drop out to full range", 2,
+      function (t) { return 1600 - t / 20; }, 2, 0.10, 0);
+trace("ds_snowfall30", "falling snow, 20 percent dropouts and 10 percent multipath", 3,
+      function (t) { return 1400 - t / 10; }, 3, 0.20, 0.10);
+trace("ds_stream", "stream with ripple, 5 percent dropouts and 5 percent multipath", 4,
+      function (t) { return 2400 + 40 * Math.sin(t * 2.1) + 100 * Math.sin(t / 200); }, 4, 0.05, 0.05);
@@ -0,0 +1,524 @@
+/*
+ * ======================================================================================================================
+ *  wind_test.cpp - Wind speed and direction, see WRDB.h
+ *
+ *    Speed   Wind_SampleSpeed() on pulse trains fed through anemometer_interrupt_handler() with micros() set to
+ *            each pulse time. Calm to the first pulse, a missing pulse, WS_PULSE_MAXGAP and a full ring.
+ *    Sums    The running sums of Wind_BucketSums() and the gust deque of Wind_GustWindow() against the rescans of
+ *            all 60 buckets they replaced, OldDirectionVector(), OldSpeedAverage() and OldGust(), on random wind
+ *            with calm spells, vane dropouts and repeated gusts for gust lengths 1 to 60.
+ *    Trig    Wind_Sin() and Wind_Atan2() against libm, and the direction of single samples through the integer
+ *            cm/s vectors of Wind_Vector() at low and normal speeds.
+ *    Vane    Wind_SampleDirection() against an AS5600 mock whose angle moves after every I2C transaction, for all
+ *            4096 angles, the two transaction read it replaced, a missing and a short read, and oversampling.
+ *    Averages  Wind_IntervalUpdate() after whole and part minutes of 1 s samples. The 2 minute, 10 minute and
+ *            interval averages against libm vector averages of the samples, a vane dropout ageing out, calm, and
+ *            the peak gust and the seconds before the observation it ended.
+ * ======================================================================================================================
+ */
+#include "test.h"
+
+const double METERS = 3.14156 * 0.079 * 2.64;    // One pulse, see Wind_SampleSpeed()
+
+// Pulses at from, from+period, ... before to, seconds
+void Pulses(double from, double period, double to) {
+  for (double t=from; t<to-1e-9; t+=period) {
+    host_micros = (unsigned long) llround(t * 1e6);
+    anemometer_interrupt_handler();
+  }
+}
+
+// Wind_SampleSpeed() at second t
+float SampleAt(double t) {
+  host_micros = (unsigned long) llround(t * 1e6);
+  host_millis = (unsigned long) llround(t * 1e3);
+  return (Wind_SampleSpeed());
+}
+
+void Speed() {
+  host_micros = 0;
+  host_millis = 0;
+  anemometer_interrupt_count = 0;
+  Wind_PulseReset();
+
+  // Calm, then one pulse has no period
+  CHECK_EQ(SampleAt(1.0), 0.0);
+  Pulses(1.95, 1, 2.0);
+  CHECK_EQ(SampleAt(2.0), 0.0);
+
+  // 10 pulses a second, the first period runs from the last sample's pulse
+  Pulses(2.05, 0.1, 3.0);
+  CHECK_NEAR(SampleAt(3.0), 10 * METERS, 0.001);
+  Pulses(3.05, 0.1, 4.0);
+  CHECK_NEAR(SampleAt(4.0), 10 * METERS, 0.001);
+
+  // Pulses stop at 3.95, the speed can be no more than one pulse in the time since, 0 after WS_PULSE_MAXGAP
+  CHECK_NEAR(SampleAt(4.0 + 0.02), 10 * METERS, 0.001);         // Within the last period, last speed
+  CHECK_NEAR(SampleAt(5.0), METERS / 1.05, 0.001);
+  CHECK_NEAR(SampleAt(6.0), METERS / 2.05, 0.001);
+  CHECK_NEAR(SampleAt(6.95), METERS / 3.0, 0.001);
+  CHECK_EQ(SampleAt(7.0), 0.0);
+  CHECK(!anemometer_pulse_valid);
+
+  // After the gap a pulse starts over, no period back to 3.95
+  Pulses(7.5, 1, 7.6);
+  CHECK_EQ(SampleAt(8.0), 0.0);
+  Pulses(8.2, 1, 8.3);
+  CHECK_NEAR(SampleAt(9.0), METERS / 0.7, 0.001);
+
+  // Samples not taken for 4 s, the pulse at 8.2 is too old to start a period
+  Pulses(13.1, 0.5, 14.0);
+  CHECK_NEAR(SampleAt(14.0), METERS / 0.5, 0.001);
+
+  // 200 pulses in a second, 72 do not fit the ring, the interrupt count is used
+  Pulses(14.0 + 0.0025, 0.005, 15.0);
+  CHECK_EQ(anemometer_pulse_lost, 200 - WS_PULSE_RING);
+  CHECK_NEAR(SampleAt(15.0), 200 * METERS, 0.01);
+  CHECK_EQ(anemometer_pulse_lost, 0);
+  CHECK_EQ(anemometer_pulse_head, anemometer_pulse_tail);
+
+  // The last pulse kept is not the last pulse, the next sample uses only its own periods
+  Pulses(15.05, 0.1, 16.0);
+  CHECK_NEAR(SampleAt(16.0), 10 * METERS, 0.001);
+  Pulses(16.05, 0.1, 17.0);
+  CHECK_NEAR(SampleAt(17.0), 10 * METERS, 0.001);
+}
+
+// Vector average of n buckets from bucket, the loop the old Wind_DirectionVector() and Wind_GustUpdate() had. It
+// uses this build's Wind_Vector() so only the summing differs.
+int OldVector(int bucket, int n, int calm) {
+  WIND_VECTOR NS_vector_sum = 0;
+  WIND_VECTOR EW_vector_sum = 0;
+  WIND_VECTOR ns, ew;
+  bool ws_zero = true;
+
+  for (int i=0; i<n; i++) {
+    int d = wind.bucket[bucket].direction;
+    float s = wind.bucket[bucket].speed;
+    if (d == -1) {
+      return (-1);
+    }
+    if (s > 0) {
+      ws_zero = false;
+    }
+    Wind_Vector(d, s, &ns, &ew);
+    NS_vector_sum += ns;
+    EW_vector_sum += ew;
+    bucket = (bucket + 1) % WIND_READINGS;
+  }
+  return ((ws_zero) ? calm : Wind_VectorDirection(NS_vector_sum, EW_vector_sum));
+}
+
+int OldDirectionVector() {
+  return (OldVector(0, WIND_READINGS, Wind_SampleDirection()));
+}
+
+float OldSpeedAverage() {
+  float wind_speed = 0.0;
+  for (int i=0; i<WIND_READINGS; i++) {
+    wind_speed += wind.bucket[i].speed;
+  }
+  return (wind_speed / (float) WIND_READINGS);
+}
+
+// Highest window of n, the most recent of equal ones. Returns the gust and sets its first bucket.
+float OldGust(int n, int *ws_bucket) {
+  int bucket = wind.bucket_idx;
+  float ws_sum = 0.0;
+  float sum;
+
+  *ws_bucket = bucket;
+  for (int i=0; i<=(WIND_READINGS-n); i++) {
+    sum = 0.0;
+    for (int j=0; j<n; j++) {
+      sum += wind.bucket[(bucket+j) % WIND_READINGS].speed;
+    }
+    if (sum >= ws_sum) {
+      ws_sum = sum;
+      *ws_bucket = bucket;
+    }
+    bucket = (bucket + 1) % WIND_READINGS;
+  }
+  return (ws_sum/n);
+}
+
+void Sums() {
+  long compared = 0;
+
+  srand(11);
+  for (int n : {1, 2, 3, 5, 10, 59, 60}) {
+    cf_ws_gust = n;
+    Wind_Initialize();
+    for (int k=0; k<3000; k++) {
+      int direction = rand() % 360;
+      float speed = (rand() % 200) * 0.1;
+      int phase = (k / 97) % 5;
+
+      if (phase == 1) {
+        speed = 0.0;                                             // Calm spell
+      }
+      else if ((phase == 2) && (rand() % 10 == 0)) {
+        direction = -1;                                          // Vane dropout
+      }
+      else if (phase == 3) {
+        speed = (k % 7) ? 5.0 : 12.5;                            // Equal gusts, the latest wins
+        direction = (k * 37) % 360;
+      }
+      Wind_AddSample(direction, speed);
+      Wind_GustUpdate();
+
+      // Running sums are the rescan, exactly for the integer vectors
+      WIND_VECTOR ns_sum = 0, ew_sum = 0, ns, ew;
+      int moving = 0, invalid = 0;
+      for (int i=0; i<WIND_READINGS; i++) {
+        moving += (wind.bucket[i].speed > 0);
+        if (wind.bucket[i].direction == -1) {
+          invalid++;
+          continue;
+        }
+        Wind_Vector(wind.bucket[i].direction, wind.bucket[i].speed, &ns, &ew);
+        ns_sum += ns;
+        ew_sum += ew;
+      }
+      CHECK_EQ(wind.ns_sum, ns_sum);
+      CHECK_EQ(wind.ew_sum, ew_sum);
+      CHECK_EQ(wind.moving, moving);
+      CHECK_EQ(wind.invalid, invalid);
+
+      CHECK_NEAR(Wind_SpeedAverage(), OldSpeedAverage(), 0.0005);
+      CHECK_EQ(Wind_DirectionVector(), OldDirectionVector());
+
+      // Same window, same float sum, so the gust is equal not near
+      int ws_bucket;
+      float gust = OldGust(n, &ws_bucket);
+      CHECK_EQ(Wind_Gust() == gust, 1);
+      CHECK_EQ(wind.gust_window[wind.gust_head].start % WIND_READINGS, ws_bucket);
+      CHECK_EQ(Wind_GustDirection(), OldVector(ws_bucket, n, -1));
+      compared++;
+    }
+  }
+  printf("wind_test: %ld samples against the rescan\n", compared);
+}
+
+// 1 s samples for secs seconds, speed and direction of minute m from Speed_m() and Dir_m()
+std::vector<std::pair<int, float>> added;     // Every sample, for the libm averages
+
+float Speed_m(int m) { return (1.0 + m); }
+int Dir_m(int m) { return ((m * 10) % 360); }
+
+void Add(int direction, float speed, int secs) {
+  for (int i=0; i<secs; i++) {
+    host_millis += 1000;
+    Wind_AddSample(direction, speed);
+    added.push_back({direction, speed});
+  }
+}
+
+// libm speed and vector direction of the last n samples added
+WIND_AVERAGE_STR LastN(int n) {
+  WIND_AVERAGE_STR avg;
+  double sum = 0, ns = 0, ew = 0;
+
+  for (int i=added.size()-n; i<(int)added.size(); i++) {
+    sum += added[i].second;
+    ns += cos(added[i].first * M_PI / 180) * added[i].second;
+    ew += sin(added[i].first * M_PI / 180) * added[i].second;
+  }
+  avg.speed = sum / n;
+  avg.direction = (int) lround(atan2(ew, ns) * 180 / M_PI + 360) % 360;
+  return (avg);
+}
+
+void CheckAverage(WIND_AVERAGE_STR got, WIND_AVERAGE_STR want, int line) {
+  CHECK_NEAR(got.speed, want.speed, 0.001);
+  int d = abs(got.direction - want.direction) % 360;
+  if (((d > 180) ? 360 - d : d) > 1) {
+    printf("wind_test.cpp:%d: direction %d, want %d\n", line, got.direction, want.direction);
+    test_failures++;
+  }
+}
+
+int AS5600_Read(int addr, int reg, uint8_t *buf, int n) {
+  buf[0] = 0x08;                                                 // 0x800, 180 degrees
+  buf[1] = 0x00;
+  return (n);
+}
+
+void Averages() {
+  host_millis = 0;
+  cf_ws_gust = 3;
+  Wind_Initialize();
+  added.clear();
+
+  // 15 whole minutes, each a steady speed and direction, one gust of 25 m/s in minute 6
+  for (int m=0; m<15; m++) {
+    if (m == 6) {
+      Add(Dir_m(m), Speed_m(m), 20);
+      Add(200, 25.0, 3);
+      Add(Dir_m(m), Speed_m(m), 37);
+    }
+    else {
+      Add(Dir_m(m), Speed_m(m), 60);
+    }
+  }
+  Wind_IntervalUpdate();
+  CHECK_EQ(wind.slot_closed, 0);
+  CheckAverage(wind.avg2, LastN(120), __LINE__);
+  CHECK_NEAR(wind.avg2.speed, 14.5, 0.001);
+  CheckAverage(wind.avg10, LastN(600), __LINE__);
+  CheckAverage(wind.avgi, LastN(900), __LINE__);
+  CHECK_NEAR(wind.peak, 25.0, 0.001);
+  CHECK_EQ(wind.peak_direction, 200);
+  CHECK_EQ(wind.peak_seconds, 900 - (6 * 60 + 23));              // Gust ended at second 383 of 900
+  Wind_PeakClear();
+
+  // 1 minute interval, the 2 and 10 minute averages reach back in to the last interval
+  Add(Dir_m(15), Speed_m(15), 60);
+  Wind_IntervalUpdate();
+  CheckAverage(wind.avg2, LastN(120), __LINE__);
+  CheckAverage(wind.avg10, LastN(600), __LINE__);
+  CheckAverage(wind.avgi, LastN(60), __LINE__);
+  CHECK_NEAR(wind.peak, 16.0, 0.001);                            // Steady wind, the latest window
+  CHECK_EQ(wind.peak_seconds, 0);
+  Wind_PeakClear();
+
+  // Observation 30 s in to a minute, the part slot closes and the 2 minute average takes half the slot before
+  // the last. The first gust window after Wind_PeakClear() still has two samples from the last interval, 16 16 10,
+  // and ends 29 s before the observation.
+  Add(90, 10.0, 30);
+  Wind_IntervalUpdate();
+  CheckAverage(wind.avg2, LastN(120), __LINE__);
+  CheckAverage(wind.avgi, LastN(30), __LINE__);
+  CHECK_NEAR(wind.peak, 14.0, 0.001);
+  CHECK_EQ(wind.peak_seconds, 29);
+  Wind_PeakClear();
+
+  // A vane dropout makes every average over it -1 until it ages out of the 2 minute average
+  Add(90, 10.0, 20);
+  Add(-1, 10.0, 1);
+  Add(90, 10.0, 39);
+  Wind_IntervalUpdate();
+  CHECK_EQ(wind.avg2.direction, -1);
+  CHECK_EQ(wind.avg10.direction, -1);
+  CHECK_EQ(wind.avgi.direction, -1);
+  CHECK_NEAR(wind.avgi.speed, 10.0, 0.001);
+  Add(90, 10.0, 120);
+  Wind_IntervalUpdate();
+  CHECK_EQ(wind.avg2.direction, 90);
+  CHECK_EQ(wind.avg10.direction, -1);
+  CHECK_EQ(wind.avgi.direction, 90);
+
+  // Calm, the speed is 0 and the direction is where the vane points now. The 10 minute average is still 600
+  // samples, 11 slots with the part slot above.
+  host_i2c_present = [](int addr) { return (addr == AS5600_ADR); };
+  host_i2c_read = AS5600_Read;
+  Wind_PeakClear();
+  Add(45, 0.0, 180);
+  Wind_IntervalUpdate();
+  CHECK_EQ(wind.avg2.speed, 0.0);
+  CHECK_EQ(wind.avg2.direction, 180);
+  CHECK_EQ(wind.avgi.direction, 180);
+  CHECK_NEAR(wind.avg10.speed, LastN(600).speed, 0.001);
+  CHECK_NEAR(wind.peak, 20.0 / 3, 0.001);                        // 10 10 0, the first window after the clear
+  CHECK_EQ(wind.peak_seconds, 179);
+  host_i2c_present = nullptr;
+  host_i2c_read = nullptr;
+}
+
+// Observations that drift against the 1 s samples, intervals of 61 and 59 samples at 1 minute and 301 and 299 at 5.
+// A 61 sample interval closes a 60 sample slot and then a 1 sample one, the 2 and 10 minute averages still cover 120
+// and 600 samples. Each interval is steady so the part slots taken are exact.
+void Jitter() {
+  host_millis = 0;
+  Wind_Initialize();
+  added.clear();
+
+  for (int i=0; i<40; i++) {
+    Add(Dir_m(i), Speed_m(i % 20), (i % 3 == 2) ? 59 : 61);
+    Wind_IntervalUpdate();
+    CheckAverage(wind.avgi, LastN((i % 3 == 2) ? 59 : 61), __LINE__);
+    if (i >= 2) {
+      CheckAverage(wind.avg2, LastN(120), __LINE__);
+    }
+    if (i >= 10) {
+      CheckAverage(wind.avg10, LastN(600), __LINE__);
+    }
+  }
+
+  // Every interval 61 samples, the most short slots the ring holds
+  for (int i=0; i<20; i++) {
+    Add(Dir_m(i), Speed_m(i), 61);
+    Wind_IntervalUpdate();
+  }
+  CheckAverage(wind.avg2, LastN(120), __LINE__);
+  CheckAverage(wind.avg10, LastN(600), __LINE__);
+
+  // 5 minutes, 301 then 299 samples
+  for (int i=0; i<6; i++) {
+    Add(Dir_m(i * 5), Speed_m(i), (i % 2) ? 299 : 301);
+    Wind_IntervalUpdate();
+    CheckAverage(wind.avgi, LastN((i % 2) ? 299 : 301), __LINE__);
+    CheckAverage(wind.avg2, LastN(120), __LINE__);
+    CheckAverage(wind.avg10, LastN(600), __LINE__);
+  }
+
+  // 15 minutes and a second, every slot since the last observation is still held
+  Add(45, 7.0, 901);
+  Wind_IntervalUpdate();
+  CheckAverage(wind.avgi, LastN(901), __LINE__);
+}
+
+// Circular difference of two directions, 0 to 180
+int DirDiff(int a, int b) {
+  int d = abs(a - b) % 360;
+  return ((d > 180) ? 360 - d : d);
+}
+
+void Trig() {
+  double sin_err = 0, atan_err = 0;
+  int dir_err[3] = {0, 0, 0};
+
+  for (int d=0; d<720; d++) {
+    double e = fabs(Wind_Sin(d) - sin(d * M_PI / 180) * 32767);
+    sin_err = fmax(sin_err, e);
+  }
+  CHECK(sin_err <= 0.501);                                       // Table is rounded
+
+  // Every octant, both axes, small and large components, the top of int32
+  srand(13);
+  for (int i=0; i<400000; i++) {
+    int32_t y, x;
+    switch (i % 4) {
+      case 0 : y = rand() % 201 - 100; x = rand() % 201 - 100; break;
+      case 1 : y = rand() % 2000001 - 1000000; x = rand() % 2000001 - 1000000; break;
+      case 2 : y = (int32_t) ((rand() * 2.0 / RAND_MAX - 1) * 2147483647.0); x = (i & 8) ? 0 : rand() % 3 - 1; break;
+      default : y = (int32_t) ((rand() * 2.0 / RAND_MAX - 1) * 2147483647.0);
+                x = (int32_t) ((rand() * 2.0 / RAND_MAX - 1) * 2147483647.0); break;
+    }
+    if ((x == 0) && (y == 0)) {
+      CHECK_EQ(Wind_Atan2(0, 0), 0);
+      continue;
+    }
+    double want = atan2((double) y, (double) x) * 18000 / M_PI;
+    double e = fabs(Wind_Atan2(y, x) - want);
+    if (e > 18000) {
+      e = 36000 - e;                                             // -180 and 180 are the same
+    }
+    atan_err = fmax(atan_err, e);
+  }
+  CHECK(atan_err <= 2.5);                                        // Hundredths of a degree
+
+  // One sample, direction back out of its vector. Below about 2 m/s the whole cm components limit it.
+  for (int d=0; d<360; d++) {
+    int k = 0;
+    for (float speed : {0.2f, 2.0f, 20.0f}) {
+      WIND_VECTOR ns, ew;
+      Wind_Vector(d, speed, &ns, &ew);
+      int got = Wind_VectorDirection(ns, ew);
+      int e = abs(got - d) % 360;
+      dir_err[k] = std::max(dir_err[k], (e > 180) ? 360 - e : e);
+      k++;
+    }
+  }
+  CHECK(dir_err[1] <= 1);
+  CHECK(dir_err[2] <= 1);
+  printf("wind_test: sin %.2f/32767, atan2 %.2f hundredths of a degree, one sample direction %d %d %d degrees at "
+         "0.2 2 20 m/s\n", sin_err, atan_err, dir_err[0], dir_err[1], dir_err[2]);
+}
+
+// AS5600 mock, the angle moves by vane_step after every read transaction. The unused upper nibble is not 0.
+int vane_raw, vane_step;
+int vane_bytes;                                                  // Bytes the next read returns, -1 all asked for
+
+bool VanePresent(int addr) {
+  return (addr == AS5600_ADR);
+}
+
+int VaneRead(int addr, int reg, uint8_t *buf, int n) {
+  int raw = vane_raw & 0x0FFF;
+  for (int i=0; i<n; i++) {
+    buf[i] = ((reg + i) == AS5600_raw_ang_hi) ? (0xA0 | (raw >> 8)) : (raw & 0xFF);
+  }
+  vane_raw += vane_step;
+  return ((vane_bytes < 0) ? n : vane_bytes);
+}
+
+// The two transaction read Wind_SampleDirection() had, low byte then high byte
+int OldSampleDirection() {
+  Wire.beginTransmission(AS5600_ADR);
+  Wire.write(AS5600_raw_ang_lo);
+  Wire.endTransmission();
+  Wire.requestFrom(AS5600_ADR, 1);
+  int lo = Wire.read();
+  Wire.beginTransmission(AS5600_ADR);
+  Wire.write(AS5600_raw_ang_hi);
+  Wire.endTransmission();
+  Wire.requestFrom(AS5600_ADR, 1);
+  return ((int) ((((Wire.read() & 0x0F) << 8) | lo) * 0.0879));
+}
+
+void Vane() {
+  int torn = 0, worst = 0;
+
+  host_i2c_present = VanePresent;
+  host_i2c_read = VaneRead;
+  vane_bytes = -1;
+
+  // Turning one count per transaction, the burst read is the angle when it was read
+  vane_step = 1;
+  for (int a=0; a<4096; a++) {
+    vane_raw = a;
+    CHECK_EQ(Wind_SampleDirection(), (int) (a * 0.0879));
+    vane_raw = a;
+    int e = DirDiff(OldSampleDirection(), (int) (a * 0.0879));
+    torn += (e > 1);
+    worst = std::max(worst, e);
+  }
+  CHECK(torn > 0);
+  CHECK(AS5600_exists);
+  CHECK(!(SystemStatusBits & SSB_AS5600));
+
+  // Missing or short reads are -1 and set the status bit, the next good read clears it
+  host_i2c_present = nullptr;
+  CHECK_EQ(Wind_SampleDirection(), -1);
+  CHECK(!AS5600_exists);
+  CHECK(SystemStatusBits & SSB_AS5600);
+  host_i2c_present = VanePresent;
+  vane_bytes = 1;
+  CHECK_EQ(Wind_SampleDirection(), -1);
+  vane_bytes = -1;
+  vane_raw = 0x800;
+  CHECK_EQ(Wind_SampleDirection(), 180);
+  CHECK(AS5600_exists);
+  CHECK(!(SystemStatusBits & SSB_AS5600));
+
+  // Oversampled, 350 and 10 degrees average to north, any failed read makes the sample -1
+  vane_step = 0;
+  vane_raw = (int) (350 / 0.0879) + 1;
+  Wind_OversampleDirection();
+  vane_raw = (int) (10 / 0.0879) + 1;
+  Wind_OversampleDirection();
+  CHECK(DirDiff(Wind_OversampledDirection(), 0) <= 1);
+  Wind_OversampleDirection();
+  vane_bytes = 0;
+  Wind_OversampleDirection();
+  vane_bytes = -1;
+  CHECK_EQ(Wind_OversampledDirection(), -1);
+  vane_raw = 0x400;                                              // No reads since, one read now
+  CHECK_EQ(Wind_OversampledDirection(), 90);
+
+  host_i2c_present = nullptr;
+  host_i2c_read = nullptr;
+  printf("wind_test: old two transaction read off by more than 1 degree at %d of 4096 angles, worst %d degrees\n",
+         torn, worst);
+}
+
+int main() {
+  Speed();
+  Sums();
+  Trig();
+  Vane();
+  Averages();
+  Jitter();
+  return (test_done("wind_test"));
+}
@@ -145,6 +145,14 @@ uint32_t File::size() {
   return _file->fileSize();
 }
 
+boolean File::truncate(uint32_t length) {
+  if (! _file) {
+    return false;
+  }
+
+  return _file->truncate(length);
+}
+
 void File::close() {
   if (_file) {
     _file->close();
@@ -533,6 +533,26 @@ namespace SDLib {
   //}
 
 
+  File SDClass::createContiguous(const char *filepath, uint32_t size) {
+    int pathidx;
+    SdFile file;
+
+    SdFile parentdir = getParentDir(filepath, &pathidx);
+    filepath += pathidx;
+
+    if (! filepath[0] || ! parentdir.isOpen()) {
+      return File();
+    }
+
+    if (! file.createContiguous(&parentdir, filepath, size)) {
+      parentdir.close();
+      return File();
+    }
+    parentdir.close();
+    return File(file, filepath);
+  }
+
+
   boolean SDClass::exists(const char *filepath) {
     /*
 
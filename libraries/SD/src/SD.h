@@ -44,6 +44,7 @@ namespace SDLib {
       boolean seek(uint32_t pos);
       uint32_t position();
       uint32_t size();
+      boolean truncate(uint32_t length);
       void close();
       operator bool();
       char * name();
@@ -82,6 +83,11 @@ namespace SDLib {
         return open(filename.c_str(), mode);
       }
 
+      // Create a new file of size bytes in one contiguous run of clusters and
+      // open it for reading and writing at position 0. The content is not
+      // cleared. Fails if the file exists or there is no run that large.
+      File createContiguous(const char *filepath, uint32_t size);
+
       // Methods to determine if the requested file path exists.
       boolean exists(const char *filepath);
       boolean exists(const String &filepath) {